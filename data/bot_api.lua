@@ -80,6 +80,12 @@ function launched()
 	return __launched( __SIDE )
 end
 
+-- the input the bot wants in the current step. These are local to this file, so the
+-- functions below set them as upvalues instead of through the table of globals.
+local __WANT_LEFT = false
+local __WANT_RIGHT = false
+local __WANT_JUMP = false
+
 function left()
 	__WANT_LEFT  = __SIDE == LEFT_PLAYER
 	__WANT_RIGHT = __SIDE ~= LEFT_PLAYER
@@ -200,7 +206,7 @@ function estimate(time, posx, posy, velx, vely)
 	vely = vely or bspeedy()
 
 	__PERF_ESTIMATE_COUNTER = __PERF_ESTIMATE_COUNTER + 1
-	return simulate( time, posx, posy, velx, vely )
+	return simulate_analytic( time, posx, posy, velx, vely )
 end
 
 -- old style estimate functions, using the new, advanced function for implementation
@@ -232,12 +238,12 @@ function estimate_x_at_y(height, posx, posy, velx, vely, downward)
 		return math.huge, math.huge, math.huge, math.huge, math.huge
 	end
 	
-	time, posx, posy, velx, vely = simulate_until( posx, posy, velx, vely, "y", height )
+	time, posx, posy, velx, vely = simulate_until_analytic( posx, posy, velx, vely, "y", height )
 
 	if vely > 0 and downward then
 		local ot = time + 1
-		posx, posy, velx, vely = simulate(1, posx, posy, velx, vely)
-		time, posx, posy, velx, vely = simulate_until( posx, posy, velx, vely, "y", height )
+		posx, posy, velx, vely = simulate_analytic(1, posx, posy, velx, vely)
+		time, posx, posy, velx, vely = simulate_until_analytic( posx, posy, velx, vely, "y", height )
 		time = time + ot
 	end
 	
@@ -246,10 +252,14 @@ end
 
 ---------------------------------------------------------------------------------------------
 
--- this function is called every game step from the C++ api
+-- this function is called every game step from the C++ api. It returns the
+-- input the bot wants: left, right, jump
 __lastBallSpeed = nil
 function __OnStep()
 	ActiveMode = "game"
+	__WANT_LEFT = false
+	__WANT_RIGHT = false
+	__WANT_JUMP = false
 
 	__PERF_ESTIMATE_COUNTER = 0 -- count the calls to estimate!
 	__bx, __by, __bvx, __bvy = __balldata()
@@ -331,6 +341,7 @@ function __OnStep()
 	end
 	
 	--print(__PERF_ESTIMATE_COUNTER)
+	return __WANT_LEFT, __WANT_RIGHT, __WANT_JUMP
 end
 
 -----------------------------------------------------------------------------------------------
@@ -0,0 +1,286 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+/* header include */
+#include "BallTrajectory.h"
+
+/* includes */
+#include <algorithm>
+#include <cmath>
+
+#include "GameConstants.h"
+
+/* implementation */
+
+// The ball movement in PhysicWorld::step is
+//		pos += (0, g/2) + vel;  vel.y += g;
+// so after n steps of free flight we have
+//		x(n) = x0 + n * vx,  y(n) = y0 + n * vy + g/2 * n^2,  vy(n) = vy + n * g
+// The collision tests happen after the ball has been moved, so a collision happens in the first
+// step n for which one of the tests succeeds for (x(n), y(n)).
+struct TrajectoryParabola
+{
+	explicit TrajectoryParabola(const BallTrajectory::BallState& s) :
+		x0(s.position.x), y0(s.position.y), vx(s.velocity.x), vy(s.velocity.y)
+	{
+	}
+
+	double x(int n) const
+	{
+		return x0 + n * vx;
+	}
+
+	double y(int n) const
+	{
+		return y0 + n * vy + 0.5 * BALL_GRAVITATION * n * n;
+	}
+
+	BallTrajectory::BallState at(int n) const
+	{
+		return BallTrajectory::BallState{ Vector2(x(n), y(n)), Vector2(vx, vy + n * BALL_GRAVITATION) };
+	}
+
+	/// solves y(n) == level. returns false if the ball never reaches level.
+	bool solveY(double level, double& first, double& second) const
+	{
+		const double g = BALL_GRAVITATION;
+		double disc = vy * vy - 2 * g * (y0 - level);
+		if(disc < 0)
+			return false;
+		disc = std::sqrt(disc);
+		first = (-vy - disc) / g;
+		second = (-vy + disc) / g;
+		return true;
+	}
+
+	double x0, y0, vx, vy;
+};
+
+/// finds the first step in [lo, hi] for which pred is true. The search starts at candidate,
+/// which has to be a (possibly slightly inaccurate) solution of the continuous problem, and
+/// assumes that pred is false between lo and candidate.
+/// \return the step, or hi + 1 if pred does not become true in the searched range
+template<class Predicate>
+static int refineStep(int lo, int hi, double candidate, Predicate pred)
+{
+	if(lo > hi)
+		return hi + 1;
+
+	if(pred(lo))
+		return lo;
+
+	// this also catches NaN
+	if(!(candidate < hi + 2.0))
+		return hi + 1;
+
+	int start = candidate < lo ? lo : std::max(lo, (int)std::floor(candidate) - 1);
+	for(int n = start; n <= hi && n <= start + 3; ++n)
+	{
+		if(pred(n))
+			return n;
+	}
+	return hi + 1;
+}
+
+/// first step in [lo, hi] in which the ball is below level, i.e. y(n) > level
+static int firstBelow(const TrajectoryParabola& p, double level, int lo, int hi)
+{
+	auto pred = [&](int n) { return p.y(n) > level; };
+	double r1, r2;
+	if(!p.solveY(level, r1, r2))
+	{
+		// the parabola is completely below level, except for rounding errors
+		return refineStep(lo, hi, lo, pred);
+	}
+	// as y is convex, this is either true at lo, or after the second root
+	return refineStep(lo, hi, r2, pred);
+}
+
+/// calculates the range of steps [first, last] within [lo, hi] where |x(n) - center| < halfwidth.
+/// \return false if the range is empty
+static bool horizontalWindow(const TrajectoryParabola& p, double center, double halfwidth, int lo, int hi,
+							int& first, int& last)
+{
+	auto inside = [&](int n) { return std::abs(p.x(n) - center) < halfwidth; };
+
+	if(p.vx == 0)
+	{
+		first = lo;
+		last = hi;
+		return lo <= hi && inside(lo);
+	}
+
+	double t1 = (center - halfwidth - p.x0) / p.vx;
+	double t2 = (center + halfwidth - p.x0) / p.vx;
+	if(t1 > t2)
+		std::swap(t1, t2);
+
+	first = refineStep(lo, hi, t1, inside);
+	if(first > hi)
+		return false;
+
+	// last step inside is the step before the first step that is outside again
+	auto outside = [&](int n) { return !inside(n); };
+	last = refineStep(first, hi, t2, outside) - 1;
+	return true;
+}
+
+BallTrajectory::BallTrajectory() = default;
+
+int BallTrajectory::findNextCollision(const BallState& state, int limit) const
+{
+	const TrajectoryParabola p(state);
+	const double netDistance = BALL_RADIUS + NET_RADIUS;
+
+	// ground
+	int best = firstBelow(p, GROUND_PLANE_HEIGHT_MAX - BALL_RADIUS, 1, limit);
+
+	// walls
+	if(p.vx < 0)
+	{
+		auto leftWall = [&](int n) { return p.x(n) - BALL_RADIUS <= LEFT_PLANE; };
+		best = refineStep(1, best - 1, (p.x0 - BALL_RADIUS - LEFT_PLANE) / -p.vx, leftWall);
+	}
+	else if(p.vx > 0)
+	{
+		auto rightWall = [&](int n) { return p.x(n) + BALL_RADIUS >= RIGHT_PLANE; };
+		best = refineStep(1, best - 1, (RIGHT_PLANE - BALL_RADIUS - p.x0) / p.vx, rightWall);
+	}
+
+	// net rod: the ball is below the net sphere and horizontally touches the net
+	int first, last;
+	if(horizontalWindow(p, NET_POSITION_X, netDistance, 1, best - 1, first, last))
+	{
+		best = std::min(best, firstBelow(p, NET_SPHERE_POSITION, first, last));
+	}
+
+	// net sphere: we only look at the few steps in which the ball is close to the sphere.
+	// The margin makes sure rounding errors in the window calculation do not make us miss a collision.
+	const double margin = 1;
+	if(horizontalWindow(p, NET_POSITION_X, netDistance + margin, 1, best - 1, first, last))
+	{
+		// steps where the ball is above the lower end of the collision zone
+		double lower1, lower2;
+		if(p.solveY(NET_SPHERE_POSITION + netDistance + margin, lower1, lower2))
+		{
+			first = std::max(first, (int)std::max(std::floor(lower1), 0.0));
+			last = std::min((double)last, std::ceil(lower2));
+
+			// steps where the ball is still above the upper end of the collision zone, which we can skip
+			double upper1 = 0, upper2 = 0;
+			bool skip = p.solveY(NET_SPHERE_POSITION - netDistance - margin, upper1, upper2);
+
+			for(int n = first; n <= last; ++n)
+			{
+				if(skip && n > upper1 + 1 && n < upper2 - 1)
+				{
+					n = (int)std::floor(upper2 - 1);
+					continue;
+				}
+
+				double dx = p.x(n) - NET_POSITION_X;
+				double dy = p.y(n) - NET_SPHERE_POSITION;
+				if(dx * dx + dy * dy < netDistance * netDistance)
+				{
+					best = std::min(best, n);
+					break;
+				}
+			}
+		}
+	}
+
+	return best;
+}
+
+BallTrajectory::BallState BallTrajectory::simulateStep(const BallState& state)
+{
+	mWorld.setBallPosition( state.position );
+	mWorld.setBallVelocity( state.velocity );
+	// set ball valid to false to ignore blobby bounces
+	mWorld.step(PlayerInput(), PlayerInput(), false, true);
+	return BallState{ mWorld.getBallPosition(), mWorld.getBallVelocity() };
+}
+
+BallTrajectory::BallState BallTrajectory::advance(BallState state, int steps)
+{
+	while(steps > 0)
+	{
+		int collision = findNextCollision(state, steps);
+		if(collision > steps)
+			return TrajectoryParabola(state).at(steps);
+
+		state = simulateStep( TrajectoryParabola(state).at(collision - 1) );
+		steps -= collision;
+	}
+	return state;
+}
+
+int BallTrajectory::advanceUntil(BallState& state, Axis axis, float coordinate, int max_steps)
+{
+	auto value = [axis](const BallState& s) { return axis == Axis::X ? s.position.x : s.position.y; };
+	if(value(state) == coordinate)
+		return 0;
+
+	const bool init = value(state) < coordinate;
+	int done = 0;
+	while(done < max_steps)
+	{
+		const TrajectoryParabola p(state);
+		int collision = findNextCollision(state, max_steps - done);
+
+		// look for a crossing before the next collision
+		int crossing;
+		if(axis == Axis::X)
+		{
+			auto crossed = [&](int n) { return (p.x(n) < coordinate) != init; };
+			crossing = refineStep(1, collision - 1, p.vx == 0 ? collision : (coordinate - p.x0) / p.vx, crossed);
+		}
+		else
+		{
+			auto crossed = [&](int n) { return (p.y(n) < coordinate) != init; };
+			double r1, r2;
+			if(!p.solveY(coordinate, r1, r2))
+				crossing = refineStep(1, collision - 1, collision, crossed);
+			else
+				crossing = refineStep(1, collision - 1, init ? r2 : r1, crossed);
+		}
+
+		if(crossing < collision)
+		{
+			state = p.at(crossing);
+			done += crossing;
+			return done < max_steps ? done : -1;
+		}
+
+		if(collision > max_steps - done)
+		{
+			state = p.at(max_steps - done);
+			return -1;
+		}
+
+		state = simulateStep( p.at(collision - 1) );
+		done += collision;
+		if((value(state) < coordinate) != init)
+			return done < max_steps ? done : -1;
+	}
+
+	return -1;
+}
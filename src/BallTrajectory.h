@@ -0,0 +1,73 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+#pragma once
+
+#include "Vector.h"
+#include "PhysicWorld.h"
+
+/*! \brief predicts the flight of the ball
+	\details Calculates where the ball will be after a number of steps, or when it will reach
+			a certain coordinate, without stepping through every frame. Between two bounces the
+			ball follows a parabola that can be computed in closed form, so only the steps where
+			the ball hits the ground, a wall or the net have to be simulated. These are found
+			analytically, the costs depend on the number of bounces, not on the number of frames.
+			Blobbys are ignored, i.e. the result is the same as stepping a PhysicWorld with
+			isBallValid = false, up to floating point rounding.
+			All positions and velocities are in world coordinates, i.e. y pointing downwards.
+*/
+class BallTrajectory : public ObjectCounter<BallTrajectory>
+{
+	public:
+		struct BallState
+		{
+			Vector2 position;
+			Vector2 velocity;
+		};
+
+		enum class Axis
+		{
+			X,
+			Y
+		};
+
+		BallTrajectory();
+
+		/// advances \p state by \p steps physic steps
+		BallState advance(BallState state, int steps);
+
+		/// \brief advances \p state until the ball crosses \p coordinate on \p axis
+		/// \details The ball crosses the coordinate in step n if it was on one side of
+		///			\p coordinate before the first step, and is on the other side after step n.
+		/// \return the number of steps n, or -1 if the ball does not cross \p coordinate within
+		///			less than \p max_steps steps. In that case, \p state is advanced by \p max_steps.
+		int advanceUntil(BallState& state, Axis axis, float coordinate, int max_steps);
+
+	private:
+		// finds the first step in 1 ... limit in which the ball collides with the world
+		// returns limit + 1 if there is no collision
+		int findNextCollision(const BallState& state, int limit) const;
+
+		// simulates a single step with PhysicWorld, to get exact collision handling
+		BallState simulateStep(const BallState& state);
+
+		PhysicWorld mWorld;
+};
@@ -23,6 +23,14 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <iostream>
 #include <fstream>
 #include <utility>
+#include <mutex>
+
+// objects are created on several threads, e.g. by the match runner, so access to the maps is guarded
+std::mutex& GetCounterMutex()
+{
+	static std::mutex CounterMutex;
+	return CounterMutex;
+}
 
 std::map<std::string, CountingReport>& GetCounterMap()
 {
@@ -44,6 +52,7 @@ std::map<std::string, int>& GetProfMap()
 
 int count(const std::type_info& type)
 {
+	std::lock_guard<std::mutex> lock(GetCounterMutex());
 	std::string test = type.name();
 	if(GetCounterMap().find(type.name()) == GetCounterMap().end() )
 	{
@@ -56,16 +65,19 @@ int count(const std::type_info& type)
 
 int uncount(const std::type_info& type)
 {
+	std::lock_guard<std::mutex> lock(GetCounterMutex());
 	return --GetCounterMap()[type.name()].alive;
 }
 
 int getObjectCount(const std::type_info& type)
 {
+	std::lock_guard<std::mutex> lock(GetCounterMutex());
 	return 	GetCounterMap()[type.name()].alive;
 }
 
 int count(const std::type_info& type, const std::string& tag, int n)
 {
+	std::lock_guard<std::mutex> lock(GetCounterMutex());
 	std::string name = std::string(type.name()) + " - " + tag;
 	if(GetCounterMap().find(name) == GetCounterMap().end() )
 	{
@@ -77,6 +89,7 @@ int count(const std::type_info& type, const std::string& tag, int n)
 
 int uncount(const std::type_info& type, const std::string& tag, int n)
 {
+	std::lock_guard<std::mutex> lock(GetCounterMutex());
 	return GetCounterMap()[std::string(type.name()) + " - " + tag].alive -= n;
 }
 
@@ -84,13 +97,18 @@ int count(const std::type_info& type, const std::string& tag, void* address, int
 {
 	std::cout << "MALLOC " << num << "\n";
 	count(type, tag, num);
+	std::lock_guard<std::mutex> lock(GetCounterMutex());
 	GetAddressMap()[address] = num;
 	return 0;
 }
 
 int uncount(const std::type_info& type, const std::string& tag, void* address)
 {
-	int num = GetAddressMap()[address];
+	int num;
+	{
+		std::lock_guard<std::mutex> lock(GetCounterMutex());
+		num = GetAddressMap()[address];
+	}
 	std::cout << "FREE " << num << "\n";
 	uncount(type, tag, num);
 	return 0;
@@ -99,6 +117,7 @@ int uncount(const std::type_info& type, const std::string& tag, void* address)
 void debug_count_execution_fkt(const std::string& file, int line)
 {
 	std::string rec = file + ":" + std::to_string(line);
+	std::lock_guard<std::mutex> lock(GetCounterMutex());
 	if(GetProfMap().find(rec) == GetProfMap().end() )
 	{
 		GetProfMap()[rec] = 0;
@@ -110,6 +129,7 @@ std::fstream total_plot("logs/total.txt", std::fstream::out);
 
 void report(std::ostream& stream)
 {
+	std::lock_guard<std::mutex> lock(GetCounterMutex());
 	stream << "MEMORY REPORT\n";
 	int sum = 0;
 	for(auto & i : GetCounterMap())
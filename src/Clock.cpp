@@ -23,11 +23,18 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 /* includes */
 #include <sstream>
-
-#include "SDL2/SDL.h"
+#include <chrono>
 
 /* implementation */
 
+// milliseconds since the first call
+static int getTicks()
+{
+	static const auto start = std::chrono::steady_clock::now();
+	auto passed = std::chrono::steady_clock::now() - start;
+	return (int)std::chrono::duration_cast<std::chrono::milliseconds>(passed).count();
+}
+
 Clock::Clock() : mRunning(false), mGameTime(0), mLastTime(0)
 {
 	
@@ -38,12 +45,12 @@ void Clock::reset()
 	// set all variables to their default values
 	mRunning = false;
 	mGameTime = 0;
-	mLastTime = SDL_GetTicks();
+	mLastTime = getTicks();
 }
 
 void Clock::start()
 {
-	mLastTime = SDL_GetTicks();
+	mLastTime = getTicks();
 	mRunning = true;
 }
 
@@ -106,7 +113,7 @@ void Clock::step()
 {
 	if(mRunning)
 	{
-		int newTime = SDL_GetTicks();
+		int newTime = getTicks();
 		if(newTime > mLastTime)
 		{
 			mGameTime += newTime - mLastTime;
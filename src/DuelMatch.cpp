@@ -47,7 +47,7 @@ DuelMatch::DuelMatch(bool remote, const std::string& rules, int score_to_win) :
 	setInputSources(std::make_shared<InputSource>(), std::make_shared<InputSource>());
 
 	if(!mRemote)
-		mPhysicWorld->setEventCallback( [this]( const MatchEvent& event ) { mEvents.push_back(event); } );
+		mPhysicWorld->setEventBuffer( &mEvents );
 }
 
 void DuelMatch::setPlayers( const PlayerIdentity& lplayer, const PlayerIdentity& rplayer)
@@ -70,7 +70,11 @@ void DuelMatch::setInputSources(const std::shared_ptr<InputSource>& linput, cons
 
 void DuelMatch::reset()
 {
+	bool deterministic = mPhysicWorld->isDeterministic();
 	mPhysicWorld.reset(new PhysicWorld());
+	mPhysicWorld->setDeterministic(deterministic);
+	if(!mRemote)
+		mPhysicWorld->setEventBuffer( &mEvents );
 	mLogic = mLogic->clone();
 }
 
@@ -83,6 +87,21 @@ void DuelMatch::setRules(const std::string& rulesFile, int score_to_win)
 	mLogic = createGameLogic(rulesFile, this, score_to_win);
 }
 
+void DuelMatch::setGameLogic(GameLogicPtr logic)
+{
+	assert(logic);
+	mLogic = std::move(logic);
+}
+
+void DuelMatch::setDeterministicPhysics(bool deterministic)
+{
+	mPhysicWorld->setDeterministic(deterministic);
+}
+
+bool DuelMatch::hasDeterministicPhysics() const
+{
+	return mPhysicWorld->isDeterministic();
+}
 
 void DuelMatch::step()
 {
@@ -158,6 +177,18 @@ void DuelMatch::step()
 	mEvents.clear();
 }
 
+void DuelMatch::resimulate()
+{
+	MatchEventBuffer pending = mEvents;
+	MatchEventBuffer last = mLastEvents;
+	mEvents.clear();
+
+	step();
+
+	mEvents = pending;
+	mLastEvents = last;
+}
+
 void DuelMatch::setScore(int left, int right)
 {
 	mLogic->setScore(LEFT_PLAYER, left);
@@ -273,13 +304,16 @@ void DuelMatch::trigger( const MatchEvent& event )
 DuelMatchState DuelMatch::getState() const
 {
 	DuelMatchState state;
-	state.worldState = mPhysicWorld->getState();
-	state.logicState = mLogic->getState();
+	getState(state);
+	return state;
+}
+
+void DuelMatch::getState(DuelMatchState& state) const
+{
+	mPhysicWorld->getState(state.worldState);
+	mLogic->getState(state.logicState);
 	state.playerInput[LEFT_PLAYER] = mTransformedInput[LEFT_PLAYER];
 	state.playerInput[RIGHT_PLAYER] = mTransformedInput[RIGHT_PLAYER];
-
-
-	return state;
 }
 
 void DuelMatch::setServingPlayer(PlayerSide side)
@@ -336,7 +370,6 @@ PlayerIdentity& DuelMatch::getPlayer(PlayerSide player)
 
 void DuelMatch::updateEvents()
 {
-	/// \todo more economical with a swap?
 	mLastEvents = mEvents;
 	mEvents.clear();
 }
@@ -58,11 +58,21 @@ class DuelMatch : public ObjectCounter<DuelMatch>
 		~DuelMatch();
 
 		void setRules(const std::string& rulesFile, int score_to_win = 0);
+		/// replaces the game logic. \p logic has to be created for this match.
+		void setGameLogic(GameLogicPtr logic);
+
+		/// selects the deterministic fixed point physics instead of the floating point physics.
+		/// \sa PhysicWorld::setDeterministic
+		void setDeterministicPhysics(bool deterministic);
+		bool hasDeterministicPhysics() const;
 
 		void reset();
 
 		// This steps through one frame
 		void step();
+		/// steps through one frame like step(), but leaves pending and last events untouched.
+		/// This is used to re-simulate frames for client side prediction.
+		void resimulate();
 
 		// this methods allow external input
 		// events triggered by the network
@@ -114,6 +124,8 @@ class DuelMatch : public ObjectCounter<DuelMatch>
 
 		/// gets the current state
 		DuelMatchState getState() const;
+		/// writes the current state into \p state. This avoids the temporary state object of getState().
+		void getState(DuelMatchState& state) const;
 
 		//Input stuff for recording and playing replays
 		std::shared_ptr<InputSource> getInputSource(PlayerSide player) const;
@@ -123,7 +135,7 @@ class DuelMatch : public ObjectCounter<DuelMatch>
 
 		void setServingPlayer(PlayerSide side);
 
-		const std::vector<MatchEvent>& getEvents() const { return mLastEvents; }
+		const MatchEventBuffer& getEvents() const { return mLastEvents; }
 		// this function will move all events into mLastEvents, so they will be returned by get events.
 		// use this if no match step is performed, but external events have to be processed.
 		void updateEvents();
@@ -142,8 +154,8 @@ class DuelMatch : public ObjectCounter<DuelMatch>
 		bool mPaused;
 
 		// accumulation of physic events since last event processing
-		std::vector<MatchEvent> mEvents;
-		std::vector<MatchEvent> mLastEvents;	// events that were generated in the last processed frame
+		MatchEventBuffer mEvents;
+		MatchEventBuffer mLastEvents;	// events that were generated in the last processed frame
 
 		bool mRemote;
 };
@@ -0,0 +1,329 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "DuelMatchStateCodec.h"
+
+/* includes */
+#include <cstdint>
+#include <cstring>
+
+#include "raknet/BitStream.h"
+
+#include "PhysicWorld.h"
+#include "GameConstants.h"
+
+/* implementation */
+
+namespace
+{
+	typedef std::uint32_t field_t;
+
+	// 16 physic fields, 12 logic fields and 2 inputs
+	const int FIELD_COUNT = 30;
+
+	field_t floatToField(float value)
+	{
+		field_t field;
+		std::memcpy(&field, &value, sizeof(field));
+		return field;
+	}
+
+	float fieldToFloat(field_t field)
+	{
+		float value;
+		std::memcpy(&value, &field, sizeof(value));
+		return value;
+	}
+
+	void toFields(const DuelMatchState& state, field_t* fields)
+	{
+		const PhysicState& world = state.worldState;
+		const GameLogicState& logic = state.logicState;
+
+		int i = 0;
+		for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+		{
+			fields[i++] = floatToField(world.blobPosition[p].x);
+			fields[i++] = floatToField(world.blobPosition[p].y);
+			fields[i++] = floatToField(world.blobVelocity[p].x);
+			fields[i++] = floatToField(world.blobVelocity[p].y);
+			fields[i++] = floatToField(world.blobState[p]);
+		}
+		fields[i++] = floatToField(world.ballPosition.x);
+		fields[i++] = floatToField(world.ballPosition.y);
+		fields[i++] = floatToField(world.ballVelocity.x);
+		fields[i++] = floatToField(world.ballVelocity.y);
+		fields[i++] = floatToField(world.ballRotation);
+		fields[i++] = floatToField(world.ballAngularVelocity);
+
+		fields[i++] = logic.leftScore;
+		fields[i++] = logic.rightScore;
+		fields[i++] = logic.hitCount[LEFT_PLAYER];
+		fields[i++] = logic.hitCount[RIGHT_PLAYER];
+		// shift player sides so NO_PLAYER becomes 0
+		fields[i++] = field_t(logic.servingPlayer + 1);
+		fields[i++] = field_t(logic.winningPlayer + 1);
+		fields[i++] = logic.squish[LEFT_PLAYER];
+		fields[i++] = logic.squish[RIGHT_PLAYER];
+		fields[i++] = logic.squishWall;
+		fields[i++] = logic.squishGround;
+		fields[i++] = logic.isGameRunning;
+		fields[i++] = logic.isBallValid;
+
+		fields[i++] = state.playerInput[LEFT_PLAYER].getAll();
+		fields[i++] = state.playerInput[RIGHT_PLAYER].getAll();
+	}
+
+	void fromFields(const field_t* fields, DuelMatchState& state)
+	{
+		PhysicState& world = state.worldState;
+		GameLogicState& logic = state.logicState;
+
+		int i = 0;
+		for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+		{
+			world.blobPosition[p].x = fieldToFloat(fields[i++]);
+			world.blobPosition[p].y = fieldToFloat(fields[i++]);
+			world.blobVelocity[p].x = fieldToFloat(fields[i++]);
+			world.blobVelocity[p].y = fieldToFloat(fields[i++]);
+			world.blobState[p] = fieldToFloat(fields[i++]);
+		}
+		world.ballPosition.x = fieldToFloat(fields[i++]);
+		world.ballPosition.y = fieldToFloat(fields[i++]);
+		world.ballVelocity.x = fieldToFloat(fields[i++]);
+		world.ballVelocity.y = fieldToFloat(fields[i++]);
+		world.ballRotation = fieldToFloat(fields[i++]);
+		world.ballAngularVelocity = fieldToFloat(fields[i++]);
+
+		logic.leftScore = fields[i++];
+		logic.rightScore = fields[i++];
+		logic.hitCount[LEFT_PLAYER] = fields[i++];
+		logic.hitCount[RIGHT_PLAYER] = fields[i++];
+		logic.servingPlayer = PlayerSide(int(fields[i++]) - 1);
+		logic.winningPlayer = PlayerSide(int(fields[i++]) - 1);
+		logic.squish[LEFT_PLAYER] = fields[i++];
+		logic.squish[RIGHT_PLAYER] = fields[i++];
+		logic.squishWall = fields[i++];
+		logic.squishGround = fields[i++];
+		logic.isGameRunning = fields[i++] != 0;
+		logic.isBallValid = fields[i++] != 0;
+
+		state.playerInput[LEFT_PLAYER].setAll( (unsigned char)fields[i++] );
+		state.playerInput[RIGHT_PLAYER].setAll( (unsigned char)fields[i++] );
+	}
+
+	// moves the baseline state the given number of frames forward. The ball and the blobs move as
+	// in PhysicWorld, but without collisions and jumps, and the player input does not change.
+	DuelMatchState predict(const DuelMatchState& baseline, unsigned int frames)
+	{
+		DuelMatchState prediction = baseline;
+		PhysicState& world = prediction.worldState;
+
+		short fpf = set_fpu_single_precision();
+		for(unsigned int i = 0; i < frames; ++i)
+		{
+			if(baseline.logicState.isGameRunning)
+			{
+				world.ballPosition += Vector2(0, 0.5f * BALL_GRAVITATION) + world.ballVelocity;
+				world.ballVelocity.y += BALL_GRAVITATION;
+			}
+
+			for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+			{
+				world.blobPosition[p].x += world.blobVelocity[p].x;
+
+				// resting blobs stay on the ground
+				if(world.blobPosition[p].y >= GROUND_PLANE_HEIGHT)
+					continue;
+
+				float gravity = GRAVITATION;
+				if(baseline.playerInput[p].up)
+					gravity -= BLOBBY_JUMP_BUFFER;
+
+				world.blobPosition[p].y += 0.5f * gravity + world.blobVelocity[p].y;
+				world.blobVelocity[p].y += gravity;
+				if(world.blobPosition[p].y > GROUND_PLANE_HEIGHT)
+				{
+					world.blobPosition[p].y = GROUND_PLANE_HEIGHT;
+					world.blobVelocity[p].y = 0.0;
+				}
+			}
+		}
+		reset_fpu_flags(fpf);
+
+		return prediction;
+	}
+
+	// maps small positive and negative differences to small unsigned numbers
+	field_t zigzag(field_t diff)
+	{
+		return (diff << 1) ^ (0 - (diff >> 31));
+	}
+
+	field_t unzigzag(field_t value)
+	{
+		return (value >> 1) ^ (0 - (value & 1));
+	}
+
+	// writes the lowest \p bits bits of \p value, most significant bit first. This does not
+	// depend on the byte order of the machine.
+	void writeBits(RakNet::BitStream& stream, field_t value, int bits)
+	{
+		while(bits > 0)
+		{
+			int chunk = bits % 8 != 0 ? bits % 8 : 8;
+			bits -= chunk;
+			unsigned char byte = (value >> bits) & ((1u << chunk) - 1);
+			stream.WriteBits(&byte, chunk);
+		}
+	}
+
+	bool readBits(RakNet::BitStream& stream, field_t& value, int bits)
+	{
+		value = 0;
+		while(bits > 0)
+		{
+			int chunk = bits % 8 != 0 ? bits % 8 : 8;
+			bits -= chunk;
+			unsigned char byte;
+			if(!stream.ReadBits(&byte, chunk))
+				return false;
+			value = (value << chunk) | byte;
+		}
+		return true;
+	}
+
+	int significantBits(field_t value)
+	{
+		int bits = 0;
+		for(; value != 0; value >>= 1)
+			++bits;
+		return bits;
+	}
+
+	// FNV-1a hash of the fields, folded to CHECKSUM_BITS bits
+	field_t checksum(const field_t* fields)
+	{
+		field_t hash = 2166136261u;
+		for(int i = 0; i < FIELD_COUNT; ++i)
+		{
+			for(int shift = 0; shift < 32; shift += 8)
+			{
+				hash ^= (fields[i] >> shift) & 0xFF;
+				hash *= 16777619u;
+			}
+		}
+		return (hash ^ (hash >> DuelMatchStateCodec::CHECKSUM_BITS)) & ((1u << DuelMatchStateCodec::CHECKSUM_BITS) - 1);
+	}
+}
+
+const int DuelMatchStateCodec::CHECKSUM_BITS;
+
+DuelMatchStateCodec::DuelMatchStateCodec()
+{
+	clear();
+}
+
+void DuelMatchStateCodec::store(unsigned int frame, const DuelMatchState& state)
+{
+	Entry& entry = mHistory[frame % HISTORY_SIZE];
+	entry.frame = frame;
+	entry.valid = true;
+	entry.state = state;
+}
+
+const DuelMatchState* DuelMatchStateCodec::find(unsigned int frame) const
+{
+	const Entry& entry = mHistory[frame % HISTORY_SIZE];
+	if(!entry.valid || entry.frame != frame)
+		return nullptr;
+	return &entry.state;
+}
+
+void DuelMatchStateCodec::clear()
+{
+	for(auto& entry : mHistory)
+		entry.valid = false;
+}
+
+// Each field is written as a single 0 bit if it equals the prediction. Otherwise, a 1 bit follows,
+// then the number of significant bits n of the zigzag coded difference to the prediction as n-1 in
+// 5 bits, then the lower n-1 bits of the difference (the highest bit is always set, so it need not be sent).
+// Delta frames end with a checksum of the state, so a receiver whose prediction differs notices it.
+void DuelMatchStateCodec::encode(RakNet::BitStream& stream, const DuelMatchState& state,
+								const DuelMatchState* baseline, unsigned int frames)
+{
+	field_t fields[FIELD_COUNT];
+	field_t base[FIELD_COUNT] = {0};
+	toFields(state, fields);
+	if(baseline)
+		toFields(predict(*baseline, frames), base);
+
+	for(int i = 0; i < FIELD_COUNT; ++i)
+	{
+		field_t diff = zigzag(fields[i] - base[i]);
+		if(diff == 0)
+		{
+			stream.Write0();
+			continue;
+		}
+
+		stream.Write1();
+		int bits = significantBits(diff);
+		writeBits(stream, bits - 1, 5);
+		writeBits(stream, diff, bits - 1);
+	}
+
+	if(baseline)
+		writeBits(stream, checksum(fields), CHECKSUM_BITS);
+}
+
+bool DuelMatchStateCodec::decode(RakNet::BitStream& stream, DuelMatchState& state,
+								const DuelMatchState* baseline, unsigned int frames)
+{
+	field_t fields[FIELD_COUNT] = {0};
+	if(baseline)
+		toFields(predict(*baseline, frames), fields);
+
+	for(int i = 0; i < FIELD_COUNT; ++i)
+	{
+		if(stream.GetNumberOfUnreadBits() < 1)
+			return false;
+		if(!stream.ReadBit())
+			continue;
+
+		field_t bits;
+		field_t diff;
+		if(!readBits(stream, bits, 5) || !readBits(stream, diff, bits))
+			return false;
+		fields[i] += unzigzag(diff | (field_t(1) << bits));
+	}
+
+	if(baseline)
+	{
+		field_t expected;
+		if(!readBits(stream, expected, CHECKSUM_BITS) || expected != checksum(fields))
+			return false;
+	}
+
+	fromFields(fields, state);
+	return true;
+}
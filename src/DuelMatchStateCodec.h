@@ -0,0 +1,89 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include "DuelMatchState.h"
+#include "BlobbyDebug.h"
+
+namespace RakNet
+{
+	class BitStream;
+}
+
+/*! \class DuelMatchStateCodec
+	\brief delta compression of DuelMatchStates for network game updates
+	\details The state is treated as a fixed list of 32 bit fields. A state is encoded relative
+			to a baseline state the receiver already knows: The baseline is moved forward to the
+			current frame, assuming the ball flies freely and the blobs keep their horizontal speed.
+			Fields that match this prediction cost a single bit, all others are sent as the difference
+			of their bit patterns to the prediction, with leading zero bits stripped. Scores, hit
+			counts and resting blobs do not change from frame to frame, and the ball and the blobs
+			mostly follow the prediction exactly, so most fields are very cheap.
+			Encoding without a baseline produces a keyframe that can be decoded on its own.
+			The coding is lossless, the decoded state is bit-identical to the encoded one. The
+			prediction uses the same single precision floating point setup as PhysicWorld, so
+			both peers compute the same prediction. Should the predictions still differ, e.g.
+			because of a different compiler, a checksum at the end of each delta frame lets the
+			receiver detect this, so it can drop its baselines and wait for a keyframe.
+
+			An object of this class additionally stores the last HISTORY_SIZE states, so sender and
+			receiver can look up the baseline by frame number.
+*/
+class DuelMatchStateCodec : public ObjectCounter<DuelMatchStateCodec>
+{
+	public:
+		/// number of frames that are kept as possible baselines. Senders must not
+		/// reference a baseline that is older than this.
+		static const unsigned int HISTORY_SIZE = 32;
+		/// a sender should send a keyframe at least every KEYFRAME_INTERVAL frames
+		static const unsigned int KEYFRAME_INTERVAL = 128;
+		/// size of the checksum of the decoded state that is appended to delta frames
+		static const int CHECKSUM_BITS = 16;
+
+		DuelMatchStateCodec();
+
+		/// remembers \p state as the state of frame \p frame, replacing the oldest stored state.
+		void store(unsigned int frame, const DuelMatchState& state);
+		/// gets the stored state of frame \p frame, or nullptr if that frame is not known (anymore).
+		const DuelMatchState* find(unsigned int frame) const;
+		/// forgets all stored states
+		void clear();
+
+		/// writes \p state relative to \p baseline, which is the state \p frames frames earlier.
+		/// If \p baseline is nullptr, a keyframe is written.
+		static void encode(RakNet::BitStream& stream, const DuelMatchState& state,
+							const DuelMatchState* baseline, unsigned int frames);
+		/// reads a state that has been written by encode with the same \p baseline and \p frames.
+		/// \return false, if the stream does not contain enough data, or if the decoded state does
+		///			not match the checksum, i.e. the baseline of the receiver differs from the one of the sender.
+		static bool decode(RakNet::BitStream& stream, DuelMatchState& state,
+							const DuelMatchState* baseline, unsigned int frames);
+
+	private:
+		struct Entry
+		{
+			unsigned int frame;
+			bool valid;
+			DuelMatchState state;
+		};
+
+		Entry mHistory[HISTORY_SIZE];
+};
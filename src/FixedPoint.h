@@ -0,0 +1,266 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+/**
+ * @file FixedPoint.h
+ * @brief Contains fixed point types for deterministic physics
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+/// \brief signed fixed point number with 12 fractional bits
+/// \details All arithmetic is done on integers with explicitly specified rounding, so the
+///			results are identical on every platform, independent of compiler, optimization
+///			settings and floating point hardware. Conversion from and to float is exact
+///			for all values with an absolute value below 4096 that lie on the 1/4096 grid,
+///			and deterministic for all others.
+class Fixed
+{
+	public:
+		static constexpr int FRACTIONAL_BITS = 12;
+		static constexpr int32_t ONE = 1 << FRACTIONAL_BITS;
+
+		constexpr Fixed() : mRaw(0)
+		{
+		}
+
+		/// creates a fixed point number with the given internal representation
+		static constexpr Fixed fromRaw(int32_t raw)
+		{
+			return Fixed(raw, 0);
+		}
+
+		/// converts an integer, this is always exact
+		static constexpr Fixed fromInt(int32_t value)
+		{
+			return Fixed(value * ONE, 0);
+		}
+
+		/// converts a float, rounding to the nearest representable value.
+		/// values out of range are saturated.
+		static Fixed fromFloat(float value)
+		{
+			// multiplication with a power of two is exact
+			float scaled = value * ONE;
+			if( !(scaled > (float)std::numeric_limits<int32_t>::min()) )
+				return fromRaw( std::isnan(scaled) ? 0 : std::numeric_limits<int32_t>::min() );
+			if( !(scaled < (float)std::numeric_limits<int32_t>::max()) )
+				return fromRaw( std::numeric_limits<int32_t>::max() );
+			return fromRaw( (int32_t)std::lround(scaled) );
+		}
+
+		float toFloat() const
+		{
+			return (float)mRaw / ONE;
+		}
+
+		constexpr int32_t raw() const
+		{
+			return mRaw;
+		}
+
+		// arithmetic
+		constexpr Fixed operator-() const
+		{
+			return fromRaw(-mRaw);
+		}
+
+		constexpr Fixed operator+(Fixed o) const
+		{
+			return fromRaw(mRaw + o.mRaw);
+		}
+
+		constexpr Fixed operator-(Fixed o) const
+		{
+			return fromRaw(mRaw - o.mRaw);
+		}
+
+		/// multiplication, rounds half away from zero
+		Fixed operator*(Fixed o) const
+		{
+			return fromProduct( (int64_t)mRaw * o.mRaw );
+		}
+
+		/// division, rounds half away from zero. Division by zero yields zero.
+		Fixed operator/(Fixed o) const
+		{
+			if(o.mRaw == 0)
+				return Fixed();
+			return saturate( roundedDivide( (int64_t)mRaw * ONE, o.mRaw ) );
+		}
+
+		/// converts the product of two raw values, which has 2 * FRACTIONAL_BITS
+		/// fractional bits, back to a Fixed. Rounds half away from zero.
+		static Fixed fromProduct(int64_t rawProduct)
+		{
+			return saturate( roundedDivide( rawProduct, ONE ) );
+		}
+
+		Fixed& operator+=(Fixed o)
+		{
+			mRaw += o.mRaw;
+			return *this;
+		}
+
+		Fixed& operator-=(Fixed o)
+		{
+			mRaw -= o.mRaw;
+			return *this;
+		}
+
+		Fixed& operator*=(Fixed o)
+		{
+			return *this = *this * o;
+		}
+
+		// comparison
+		constexpr bool operator<(Fixed o) const { return mRaw < o.mRaw; }
+		constexpr bool operator>(Fixed o) const { return mRaw > o.mRaw; }
+		constexpr bool operator<=(Fixed o) const { return mRaw <= o.mRaw; }
+		constexpr bool operator>=(Fixed o) const { return mRaw >= o.mRaw; }
+		constexpr bool operator==(Fixed o) const { return mRaw == o.mRaw; }
+		constexpr bool operator!=(Fixed o) const { return mRaw != o.mRaw; }
+
+		/// square root, rounded down. Negative arguments yield zero.
+		static Fixed sqrt(Fixed v)
+		{
+			if(v.mRaw <= 0)
+				return Fixed();
+			// sqrt(raw * ONE) is the raw value of the result
+			return fromRaw( (int32_t)isqrt( (uint64_t)v.mRaw << FRACTIONAL_BITS ) );
+		}
+
+		/// square root of a raw 64 bit square, e.g. the sum of the squares of two raw values.
+		/// This is needed for vector lengths, where the squares do not fit into a Fixed.
+		static Fixed sqrtOfRawSquare(int64_t square)
+		{
+			if(square <= 0)
+				return Fixed();
+			return saturate( (int64_t)isqrt( (uint64_t)square ) );
+		}
+
+	private:
+		constexpr Fixed(int32_t raw, int) : mRaw(raw)
+		{
+		}
+
+		static Fixed saturate(int64_t raw)
+		{
+			if(raw > std::numeric_limits<int32_t>::max())
+				return fromRaw( std::numeric_limits<int32_t>::max() );
+			if(raw < std::numeric_limits<int32_t>::min())
+				return fromRaw( std::numeric_limits<int32_t>::min() );
+			return fromRaw( (int32_t)raw );
+		}
+
+		// division of integers, rounding half away from zero
+		static int64_t roundedDivide(int64_t num, int64_t den)
+		{
+			if(den < 0)
+			{
+				num = -num;
+				den = -den;
+			}
+			if(num >= 0)
+				return (num + den / 2) / den;
+			else
+				return -((-num + den / 2) / den);
+		}
+
+		// integer square root, rounded down
+		static uint64_t isqrt(uint64_t v)
+		{
+			uint64_t result = 0;
+			uint64_t bit = uint64_t(1) << 62;
+			while(bit > v)
+				bit >>= 2;
+
+			while(bit != 0)
+			{
+				if(v >= result + bit)
+				{
+					v -= result + bit;
+					result = (result >> 1) + bit;
+				}
+				else
+				{
+					result >>= 1;
+				}
+				bit >>= 2;
+			}
+			return result;
+		}
+
+		int32_t mRaw;
+};
+
+/// \brief 2d vector of fixed point numbers
+struct FixedVector2
+{
+	Fixed x;
+	Fixed y;
+
+	FixedVector2() = default;
+	constexpr FixedVector2(Fixed x_, Fixed y_) : x(x_), y(y_)
+	{
+	}
+
+	FixedVector2 operator+(const FixedVector2& o) const { return FixedVector2(x + o.x, y + o.y); }
+	FixedVector2 operator-(const FixedVector2& o) const { return FixedVector2(x - o.x, y - o.y); }
+	FixedVector2 operator-() const { return FixedVector2(-x, -y); }
+	FixedVector2 operator*(Fixed f) const { return FixedVector2(x * f, y * f); }
+
+	/// dot product, computed with a single rounding
+	Fixed dotProduct(const FixedVector2& o) const
+	{
+		return Fixed::fromProduct( (int64_t)x.raw() * o.x.raw() + (int64_t)y.raw() * o.y.raw() );
+	}
+
+	Fixed length() const
+	{
+		return Fixed::sqrtOfRawSquare( lengthSQRaw() );
+	}
+
+	/// squared length as raw value with 2 * FRACTIONAL_BITS fractional bits, so it can not overflow
+	int64_t lengthSQRaw() const
+	{
+		return (int64_t)x.raw() * x.raw() + (int64_t)y.raw() * y.raw();
+	}
+
+	/// returns a vector of the given length pointing in the same direction.
+	/// a null vector is returned unchanged.
+	FixedVector2 withLength(Fixed len) const
+	{
+		Fixed current = length();
+		if(current.raw() == 0)
+			return *this;
+		return FixedVector2(x * len / current, y * len / current);
+	}
+
+	FixedVector2 reflect(const FixedVector2& normal) const
+	{
+		return *this - normal * (dotProduct(normal) * Fixed::fromInt(2));
+	}
+};
@@ -34,6 +34,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "DuelMatch.h"
 #include "GameConstants.h"
 #include "IScriptableComponent.h"
+#include "NativeGameLogic.h"
 #include "PlayerInput.h"
 
 
@@ -52,6 +53,9 @@ const int SQUISH_TOLERANCE = 11;
 const std::string FALLBACK_RULES_NAME = "__FALLBACK__";
 const std::string TEMP_RULES_NAME = "server_rules.lua";
 
+// the address of this variable is the registry key of the LuaGameLogic that uses a lua state
+static const char GAME_LOGIC_KEY = 0;
+
 
 IGameLogic::IGameLogic( int stw )
 : mScoreToWin( stw)
@@ -129,6 +133,12 @@ PlayerSide IGameLogic::getLastErrorSide()
 GameLogicState IGameLogic::getState() const
 {
 	GameLogicState gls;
+	getState(gls);
+	return gls;
+}
+
+void IGameLogic::getState(GameLogicState& gls) const
+{
 	gls.leftScore = getScore(LEFT_PLAYER);
 	gls.rightScore = getScore(RIGHT_PLAYER);
 	gls.hitCount[LEFT_PLAYER] = getTouches(LEFT_PLAYER);
@@ -141,8 +151,6 @@ GameLogicState IGameLogic::getState() const
 	gls.squishGround = mSquishGround;
 	gls.isGameRunning = mIsGameRunning;
 	gls.isBallValid = mIsBallValid;
-
-	return gls;
 }
 
 void IGameLogic::setState(GameLogicState gls)
@@ -443,6 +451,18 @@ class LuaGameLogic : public FallbackGameLogic, public IScriptableComponent
 		// lua state
 		std::string mSourceFile;
 
+		// references to the handler functions of the script, resolved once after loading
+		int mIsWinningRef;
+		int mHandleInputRef;
+		int mOnBallHitsPlayerRef;
+		int mOnBallHitsWallRef;
+		int mOnBallHitsNetRef;
+		int mOnBallHitsGroundRef;
+		int mOnGameRef;
+
+		// result of the last successful HandleInput call for each player
+		PlayerInput mLastInput[MAX_PLAYERS];
+
 		std::string mAuthor;
 		std::string mTitle;
 };
@@ -452,28 +472,26 @@ LuaGameLogic::LuaGameLogic( std::string filename, DuelMatch* match, int score_to
 	FallbackGameLogic( score_to_win ), mSourceFile(std::move(filename))
 {
 	setMatch( match );
+
+	// get a state with the rules loaded, and add functions
+	acquireState("rules", {"api", "rules_api", "rules/" + mSourceFile}, [](lua_State* state)
+	{
+		lua_register(state, "score", luaScore);
+		lua_register(state, "mistake", luaMistake);
+		lua_register(state, "servingplayer", luaGetServingPlayer);
+		lua_register(state, "time", luaGetGameTime);
+		lua_register(state, "isgamerunning", luaIsGameRunning);
+	});
+
 	lua_pushlightuserdata(mState, this);
-	lua_setglobal(mState, "__GAME_LOGIC_POINTER");
+	lua_rawsetp(mState, LUA_REGISTRYINDEX, &GAME_LOGIC_KEY);
 
 	/// \todo use lua registry instead of globals!
 	lua_pushnumber(mState, getScoreToWin());
 	lua_setglobal(mState, "SCORE_TO_WIN");
 
-	setGameConstants();
-	setGameFunctions();
-
-	// add functions
-	luaL_requiref(mState, "math", luaopen_math, 1);
-	lua_register(mState, "score", luaScore);
-	lua_register(mState, "mistake", luaMistake);
-	lua_register(mState, "servingplayer", luaGetServingPlayer);
-	lua_register(mState, "time", luaGetGameTime);
-	lua_register(mState, "isgamerunning", luaIsGameRunning);
-
-	// now load script file
-	openScript("api");
-	openScript("rules_api");
-	openScript("rules/"+mSourceFile);
+	// now run the scripts
+	runScripts();
 
 	lua_getglobal(mState, "SCORE_TO_WIN");
 	mScoreToWin = lua_toint(mState, -1);
@@ -489,6 +507,14 @@ LuaGameLogic::LuaGameLogic( std::string filename, DuelMatch* match, int score_to
 	mTitle = ( title ? title : "untitled script" );
 	lua_pop(mState, 1);
 
+	mIsWinningRef = getLuaFunctionRef("IsWinning");
+	mHandleInputRef = getLuaFunctionRef("HandleInput");
+	mOnBallHitsPlayerRef = getLuaFunctionRef("OnBallHitsPlayer");
+	mOnBallHitsWallRef = getLuaFunctionRef("OnBallHitsWall");
+	mOnBallHitsNetRef = getLuaFunctionRef("OnBallHitsNet");
+	mOnBallHitsGroundRef = getLuaFunctionRef("OnBallHitsGround");
+	mOnGameRef = getLuaFunctionRef("OnGame");
+
 	std::cout << "loaded rules "<< getTitle()<< " by " << getAuthor() << " from " << mSourceFile << std::endl;
 }
 
@@ -496,17 +522,16 @@ LuaGameLogic::~LuaGameLogic() = default;
 
 PlayerSide LuaGameLogic::checkWin() const
 {
-	if (!getLuaFunction("IsWinning"))
+	if (!pushLuaFunction( mIsWinningRef ))
 	{
 		return FallbackGameLogic::checkWin();
 	}
 
 	lua_pushnumber(mState, getScore(LEFT_PLAYER) );
 	lua_pushnumber(mState, getScore(RIGHT_PLAYER) );
-	if( lua_pcall(mState, 2, 1, 0) )
+	if( callLuaFunction(2, 1) != ScriptWatchdog::Result::OK )
 	{
-		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
-		std::cerr << std::endl;
+		return NO_PLAYER;
 	}
 
     bool won = lua_toboolean(mState, -1);
@@ -526,7 +551,7 @@ PlayerSide LuaGameLogic::checkWin() const
 
 PlayerInput LuaGameLogic::handleInput(PlayerInput ip, PlayerSide player)
 {
-	if (!getLuaFunction( "HandleInput" ))
+	if (!pushLuaFunction( mHandleInputRef ))
 	{
 		return FallbackGameLogic::handleInput(ip, player);
 	}
@@ -534,10 +559,14 @@ PlayerInput LuaGameLogic::handleInput(PlayerInput ip, PlayerSide player)
 	lua_pushboolean(mState, ip.left);
 	lua_pushboolean(mState, ip.right);
 	lua_pushboolean(mState, ip.up);
-	if(lua_pcall(mState, 4, 3, 0))
+	auto result = callLuaFunction(4, 3);
+	if(result == ScriptWatchdog::Result::OVERRUN && getBudget().policy == ScriptWatchdog::OverrunPolicy::LAST_INPUT)
 	{
-		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
-		std::cerr << std::endl;
+		return mLastInput[side2index(player)];
+	}
+	else if(result != ScriptWatchdog::Result::OK)
+	{
+		return ip;
 	}
 
 	PlayerInput ret;
@@ -548,43 +577,36 @@ PlayerInput LuaGameLogic::handleInput(PlayerInput ip, PlayerSide player)
 	// cleanup stack
 	lua_pop(mState, lua_gettop(mState));
 
+	mLastInput[side2index(player)] = ret;
 	return ret;
 }
 
 void LuaGameLogic::OnBallHitsPlayerHandler(PlayerSide side)
 {
-	if (!getLuaFunction("OnBallHitsPlayer"))
+	if (!pushLuaFunction( mOnBallHitsPlayerRef ))
 	{
 		FallbackGameLogic::OnBallHitsPlayerHandler(side);
 		return;
 	}
 	lua_pushnumber(mState, side);
-	if( lua_pcall(mState, 1, 0, 0) )
-	{
-		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
-		std::cerr << std::endl;
-	}
+	callLuaFunction(1);
 }
 
 void LuaGameLogic::OnBallHitsWallHandler(PlayerSide side)
 {
-	if (!getLuaFunction("OnBallHitsWall"))
+	if (!pushLuaFunction( mOnBallHitsWallRef ))
 	{
 		FallbackGameLogic::OnBallHitsWallHandler(side);
 		return;
 	}
 
 	lua_pushnumber(mState, side);
-	if( lua_pcall(mState, 1, 0, 0) )
-	{
-		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
-		std::cerr << std::endl;
-	}
+	callLuaFunction(1);
 }
 
 void LuaGameLogic::OnBallHitsNetHandler(PlayerSide side)
 {
-	if (!getLuaFunction( "OnBallHitsNet" ))
+	if (!pushLuaFunction( mOnBallHitsNetRef ))
 	{
 		FallbackGameLogic::OnBallHitsNetHandler(side);
 		return;
@@ -592,16 +614,12 @@ void LuaGameLogic::OnBallHitsNetHandler(PlayerSide side)
 
 	lua_pushnumber(mState, side);
 
-	if( lua_pcall(mState, 1, 0, 0) )
-	{
-		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
-		std::cerr << std::endl;
-	}
+	callLuaFunction(1);
 }
 
 void LuaGameLogic::OnBallHitsGroundHandler(PlayerSide side)
 {
-	if (!getLuaFunction( "OnBallHitsGround" ))
+	if (!pushLuaFunction( mOnBallHitsGroundRef ))
 	{
 		FallbackGameLogic::OnBallHitsGroundHandler(side);
 		return;
@@ -609,30 +627,22 @@ void LuaGameLogic::OnBallHitsGroundHandler(PlayerSide side)
 
 	lua_pushnumber(mState, side);
 
-	if( lua_pcall(mState, 1, 0, 0) )
-	{
-		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
-		std::cerr << std::endl;
-	}
+	callLuaFunction(1);
 }
 
 void LuaGameLogic::OnGameHandler( const DuelMatchState& state )
 {
-	if (!getLuaFunction( "OnGame" ))
+	if (!pushLuaFunction( mOnGameRef ))
 	{
 		FallbackGameLogic::OnGameHandler( state );
 		return;
 	}
-	if( lua_pcall(mState, 0, 0, 0) )
-	{
-		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
-		std::cerr << std::endl;
-	}
+	callLuaFunction();
 }
 
 LuaGameLogic* LuaGameLogic::getGameLogic(lua_State* state)
 {
-	lua_getglobal(state, "__GAME_LOGIC_POINTER");
+	lua_rawgetp(state, LUA_REGISTRYINDEX, &GAME_LOGIC_KEY);
 	auto* gl = (LuaGameLogic*)lua_touserdata(state, -1);
 	lua_pop(state, 1);
 	return gl;
@@ -693,6 +703,18 @@ GameLogicPtr createGameLogic(const std::string& file, DuelMatch* match, int scor
 		return GameLogicPtr(new FallbackGameLogic( score_to_win ));
 	}
 
+	// the bundled rules don't need a lua state
+	auto logic = createNativeGameLogic(file, match, score_to_win);
+	if (logic)
+	{
+		return logic;
+	}
+
+	return createLuaGameLogic(file, match, score_to_win);
+}
+
+GameLogicPtr createLuaGameLogic(const std::string& file, DuelMatch* match, int score_to_win )
+{
 	try
 	{
 		return GameLogicPtr( new LuaGameLogic(file, match, score_to_win ) );
@@ -99,6 +99,8 @@ class IGameLogic: public ObjectCounter<IGameLogic>
 		// -----------------------------------------------------------------------------------------
 
 		GameLogicState getState() const;
+		/// writes the logic state into \p gls
+		void getState(GameLogicState& gls) const;
 		void setState(GameLogicState gls);
 
 
@@ -238,6 +240,10 @@ extern const std::string FALLBACK_RULES_NAME;
 extern const std::string TEMP_RULES_NAME;
 
 // functions for creating a game logic object
+/// creates the game logic for \p rulefile. Unmodified bundled rules are run natively, everything
+/// else by lua. If the script cannot be loaded, the fallback rules are used.
 GameLogicPtr createGameLogic(const std::string& rulefile, DuelMatch* match, int score_to_win);
+/// creates the game logic for \p rulefile, always running the script with lua.
+GameLogicPtr createLuaGameLogic(const std::string& rulefile, DuelMatch* match, int score_to_win);
 
 
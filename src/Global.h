@@ -22,7 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <string>
 #include <exception>
-#include <SDL2/SDL_stdinc.h>
+#include <cstdint>
 #include <cstring>
 #include <utility>
 // I hope the GP2X is the only combination of these systems
@@ -47,7 +47,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 const int BLOBBY_PORT = 1234;
 
 const int BLOBBY_VERSION_MAJOR = 0;
-const int BLOBBY_VERSION_MINOR = 105;
+const int BLOBBY_VERSION_MINOR = 106;
 
 const char AppTitle[] = "Blobby Volley 2 Version 1.0";
 const int BASE_RESOLUTION_X = 800;
@@ -107,11 +107,11 @@ struct Color
 	{
 		struct
 		{
-			Uint8 r;
-			Uint8 g;
-			Uint8 b;
+			uint8_t r;
+			uint8_t g;
+			uint8_t b;
 		};
-		Uint8 val[3];
+		uint8_t val[3];
 	};
 
 	bool operator == (Color rval) const
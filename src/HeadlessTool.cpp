@@ -0,0 +1,85 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "HeadlessTool.h"
+
+/* includes */
+#include <cstdio>
+#include <iostream>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "FileSystem.h"
+#include "Global.h"
+
+#include "config.h"
+
+/* implementation */
+
+void setupHeadlessSearchPath()
+{
+	FileSystem& fs = FileSystem::getSingleton();
+
+	#if __DESKTOP__
+	#ifndef WIN32
+		fs.addToSearchPath(BLOBBY_INSTALL_PREFIX  "/share/blobby");
+		fs.addToSearchPath(BLOBBY_INSTALL_PREFIX  "/share/blobby/rules.zip");
+	#endif
+	#endif
+	fs.addToSearchPath("data");
+	fs.addToSearchPath("data" + fs.getDirSeparator() + "rules.zip");
+}
+
+StdoutSilencer::StdoutSilencer(bool silence) : mStdoutCopy(-1)
+{
+	#ifndef WIN32
+	if(silence)
+	{
+		std::cout.flush();
+		mStdoutCopy = dup(STDOUT_FILENO);
+		int null_fd = open("/dev/null", O_WRONLY);
+		dup2(null_fd, STDOUT_FILENO);
+		close(null_fd);
+	}
+	#endif
+}
+
+StdoutSilencer::~StdoutSilencer()
+{
+	restore();
+}
+
+void StdoutSilencer::restore()
+{
+	#ifndef WIN32
+	if(mStdoutCopy != -1)
+	{
+		std::cout.flush();
+		std::fflush(stdout);
+		dup2(mStdoutCopy, STDOUT_FILENO);
+		close(mStdoutCopy);
+		mStdoutCopy = -1;
+	}
+	#endif
+}
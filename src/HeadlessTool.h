@@ -0,0 +1,53 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+/*! \file HeadlessTool.h
+	\brief helpers shared by the command line tools that run matches without a window,
+			i.e. blobby-bench, blobby-sim and blobby-tournament.
+*/
+
+/// adds the data directories to the search path of the FileSystem, which has to exist already:
+/// that of the installation on desktop systems, and data/ in the working directory.
+void setupHeadlessSearchPath();
+
+/*! \class StdoutSilencer
+	\brief redirects stdout to /dev/null while it exists
+	\details Rules and bot scripts may print to stdout, which would mix with the results the tools write
+			there. The redirection ends when restore() is called or the object is destroyed.
+			Does nothing on windows.
+*/
+class StdoutSilencer
+{
+	public:
+		/// silences stdout if \p silence is true
+		explicit StdoutSilencer(bool silence);
+		~StdoutSilencer();
+
+		StdoutSilencer(const StdoutSilencer&) = delete;
+		StdoutSilencer& operator=(const StdoutSilencer&) = delete;
+
+		/// flushes everything written so far to /dev/null and redirects stdout back to where it went before
+		void restore();
+
+	private:
+		int mStdoutCopy;
+};
@@ -7,35 +7,96 @@
 #include "DuelMatch.h"
 #include "DuelMatchState.h"
 #include "FileRead.h"
+#include "RulesCache.h"
+#include "LuaStatePool.h"
 
 #include <iostream>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
 
 // fwd decl
+int lua_random(lua_State* state);
+int lua_randomseed(lua_State* state);
 int lua_print(lua_State* state);
 
+// the address of this variable is the registry key of the component that uses the state.
+// Unlike a string key, it does not need to be hashed for every api call.
+static const char COMPONENT_KEY = 0;
+
+// number of calls after which the statistics are passed to the watchdog
+static const unsigned int STATISTICS_INTERVAL = 1024;
+
 IScriptableComponent::IScriptableComponent() :
-	mState(luaL_newstate())
+	mState(nullptr), mRandom(std::rand())
 {
-	// register this in the lua registry
-	lua_pushliteral(mState, "__C++_ScriptComponent__");
-	lua_pushlightuserdata(mState, (void*)this);
-	lua_settable(mState, LUA_REGISTRYINDEX);
+}
 
-	lua_register(mState, "print", lua_print);
+IScriptableComponent::~IScriptableComponent()
+{
+	if(mStatistics.calls > 0)
+		ScriptWatchdog::record(mScriptName, mStatistics);
 
-	// open math lib
-	luaL_requiref(mState, "math", luaopen_math, 1);
-	luaL_requiref(mState, "base", luaopen_base, 1);
+	if(mState)
+	{
+		for(int ref : mFunctionRefs)
+			luaL_unref(mState, LUA_REGISTRYINDEX, ref);
+		LuaStatePool::release(mState);
+	}
 }
 
-IScriptableComponent::~IScriptableComponent()
+void IScriptableComponent::acquireState(const std::string& kind, const std::vector<std::string>& scripts,
+										const std::function<void(lua_State*)>& setup)
 {
-	lua_close(mState);
+	assert(mState == nullptr);
+
+	mBudget = ScriptWatchdog::getBudget();
+	mScriptName = scripts.empty() ? kind : FileRead::makeLuaFilename(scripts.back());
+
+	mState = LuaStatePool::acquire(kind, scripts, [this, &setup](lua_State* state)
+	{
+		// the setup functions below work on mState
+		mState = state;
+
+		lua_register(mState, "print", lua_print);
+
+		// open math lib
+		luaL_requiref(mState, "math", luaopen_math, 1);
+		luaL_requiref(mState, "base", luaopen_base, 1);
+
+		setGameConstants();
+		setGameFunctions();
+
+		if(setup)
+			setup(mState);
+
+		mState = nullptr;
+	});
+
+	// register this in the lua registry
+	lua_pushlightuserdata(mState, (void*)this);
+	lua_rawsetp(mState, LUA_REGISTRYINDEX, &COMPONENT_KEY);
+}
+
+void IScriptableComponent::runScripts()
+{
+	// the scripts may already loop forever when they are loaded
+	ScriptWatchdog::Scope scope(mState, mBudget);
+	if (LuaStatePool::runScripts(mState))
+	{
+		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
+		std::cerr << std::endl;
+		ScriptException except;
+		except.luaerror = lua_tostring(mState, -1);
+		BOOST_THROW_EXCEPTION(except);
+	}
 }
 
 void IScriptableComponent::openScript(const std::string& file)
 {
-	int error = FileRead::readLuaScript(file, mState);
+	// prefer the precompiled version, if the script is cached
+	auto cached = RulesCache::find(file);
+	int error = cached ? RulesCache::loadScript(mState, *cached) : FileRead::readLuaScript(file, mState);
 	if (error == 0)
 		error = lua_pcall(mState, 0, 0, 0);
 
@@ -67,14 +128,50 @@ bool IScriptableComponent::getLuaFunction(const char* fname) const
 	return true;
 }
 
-void IScriptableComponent::callLuaFunction(int arg_count)
+int IScriptableComponent::getLuaFunctionRef(const char* fname)
+{
+	if (!getLuaFunction(fname))
+		return LUA_NOREF;
+
+	int ref = luaL_ref(mState, LUA_REGISTRYINDEX);
+	mFunctionRefs.push_back(ref);
+	return ref;
+}
+
+bool IScriptableComponent::pushLuaFunction(int ref) const
+{
+	if (ref < 0)
+		return false;
+
+	lua_rawgeti(mState, LUA_REGISTRYINDEX, ref);
+	return true;
+}
+
+ScriptWatchdog::Result IScriptableComponent::callLuaFunction(int arg_count, int result_count) const
 {
-	if (lua_pcall(mState, arg_count, 0, 0))
+	auto result = ScriptWatchdog::call(mState, arg_count, result_count, mBudget, mStatistics);
+	if (result != ScriptWatchdog::Result::OK)
 	{
 		std::cerr << "Lua Error: " << lua_tostring(mState, -1);
 		std::cerr << std::endl;
+
+		if (result == ScriptWatchdog::Result::OVERRUN && mBudget.policy == ScriptWatchdog::OverrunPolicy::ABORT_MATCH)
+		{
+			ScriptException except;
+			except.luaerror = lua_tostring(mState, -1);
+			lua_pop(mState, 1);
+			BOOST_THROW_EXCEPTION(except);
+		}
 		lua_pop(mState, 1);
 	}
+
+	if (mStatistics.calls >= STATISTICS_INTERVAL)
+	{
+		ScriptWatchdog::record(mScriptName, mStatistics);
+		mStatistics = ScriptWatchdog::Statistics();
+	}
+
+	return result;
 }
 
 void IScriptableComponent::setGameConstants()
@@ -103,8 +200,7 @@ void IScriptableComponent::setGameConstants()
 // helpers
 inline IScriptableComponent* getScriptComponent(lua_State* state)
 {
-	lua_pushliteral(state, "__C++_ScriptComponent__");
-	lua_gettable(state, LUA_REGISTRYINDEX);
+	lua_rawgetp(state, LUA_REGISTRYINDEX, &COMPONENT_KEY);
 	void* result = lua_touserdata(state, -1);
 	lua_pop(state, 1);
 	return (IScriptableComponent*)result;
@@ -151,10 +247,24 @@ struct IScriptableComponent::Access
 		auto sc = getScriptComponent( state );
 		return &sc->mDummyWorld;
 	}
+
+	static BallTrajectory* getTrajectory( lua_State* state )
+	{
+		auto sc = getScriptComponent( state );
+		return &sc->mTrajectory;
+	}
+
+	static std::mt19937* getRandom( lua_State* state )
+	{
+		auto sc = getScriptComponent( state );
+		return &sc->mRandom;
+	}
 };
 
 inline DuelMatch* getMatch( lua_State* s )  { return IScriptableComponent::Access::getMatch(s); }
 inline PhysicWorld* getWorld( lua_State* s )  { return IScriptableComponent::Access::getWorld(s); }
+inline BallTrajectory* getTrajectory( lua_State* s )  { return IScriptableComponent::Access::getTrajectory(s); }
+inline std::mt19937* getRandom( lua_State* s )  { return IScriptableComponent::Access::getRandom(s); }
 
 // standard lua functions
 int get_ball_pos(lua_State* state)
@@ -340,6 +450,100 @@ int simulate_until(lua_State* state)
 	return ret;
 }
 
+// same as simulate_steps, but calculates the ball flight in closed form
+int simulate_steps_analytic( lua_State* state )
+{
+	BallTrajectory* trajectory = getTrajectory( state );
+	// get the initial ball settings
+	lua_checkstack(state, 5);
+	int steps = lua_tointeger( state, 1);
+	float x = lua_tonumber( state, 2);
+	float y = lua_tonumber( state, 3);
+	float vx = lua_tonumber( state, 4);
+	float vy = lua_tonumber( state, 5);
+	lua_pop( state, 5);
+
+	auto result = trajectory->advance( BallTrajectory::BallState{ Vector2{x, 600 - y}, Vector2{vx, -vy} }, steps );
+
+	int ret = lua_pushvector(state, result.position, VectorType::POSITION);
+	ret += lua_pushvector(state, result.velocity, VectorType::VELOCITY);
+	return ret;
+}
+
+// same as simulate_until, but calculates the ball flight in closed form
+int simulate_until_analytic(lua_State* state)
+{
+	BallTrajectory* trajectory = getTrajectory( state );
+	// get the initial ball settings
+	lua_checkstack(state, 6);
+	float x = lua_tonumber( state, 1);
+	float y = lua_tonumber( state, 2);
+	float vx = lua_tonumber( state, 3);
+	float vy = lua_tonumber( state, 4);
+	std::string axis = lua_tostring( state, 5 );
+	const float coordinate = lua_tonumber( state, 6 );
+	lua_pop( state, 6 );
+
+	if(axis != "x" && axis != "y")
+	{
+		lua_pushstring(state, "invalid condition specified: choose either 'x' or 'y'");
+		lua_error(state);
+	}
+
+	BallTrajectory::BallState ball{ Vector2{x, 600 - y}, Vector2{vx, -vy} };
+	int steps = 0;
+	if( (axis == "x" ? x : y) != coordinate )
+	{
+		if( axis == "x" )
+			steps = trajectory->advanceUntil( ball, BallTrajectory::Axis::X, coordinate, 75 * 5 );
+		else
+			steps = trajectory->advanceUntil( ball, BallTrajectory::Axis::Y, 600 - coordinate, 75 * 5 );
+	}
+
+	lua_pushinteger(state, steps);
+	int ret = 1;
+	ret += lua_pushvector(state, ball.position, VectorType::POSITION);
+	ret += lua_pushvector(state, ball.velocity, VectorType::VELOCITY);
+	return ret;
+}
+
+
+// replacements for math.random and math.randomseed with the same semantics as the
+// lua library, but using the random engine of the component
+int lua_random(lua_State* state)
+{
+	double r = std::uniform_real_distribution<double>(0.0, 1.0)(*getRandom(state));
+	switch( lua_gettop(state) )
+	{
+		case 0:
+			lua_pushnumber(state, r);
+			break;
+		case 1:
+		{
+			double u = luaL_checknumber(state, 1);
+			luaL_argcheck(state, 1.0 <= u, 1, "interval is empty");
+			lua_pushnumber(state, std::floor(r * u) + 1.0);
+			break;
+		}
+		case 2:
+		{
+			double l = luaL_checknumber(state, 1);
+			double u = luaL_checknumber(state, 2);
+			luaL_argcheck(state, l <= u, 2, "interval is empty");
+			lua_pushnumber(state, std::floor(r * (u - l + 1)) + l);
+			break;
+		}
+		default:
+			return luaL_error(state, "wrong number of arguments");
+	}
+	return 1;
+}
+
+int lua_randomseed(lua_State* state)
+{
+	getRandom(state)->seed( luaL_checkunsigned(state, 1) );
+	return 0;
+}
 
 int lua_print(lua_State* state)
 {
@@ -372,6 +576,15 @@ void IScriptableComponent::setGameFunctions()
 	lua_register(mState, "get_serving_player", get_serving_player);
 	lua_register(mState, "simulate", simulate_steps);
 	lua_register(mState, "simulate_until", simulate_until);
+	lua_register(mState, "simulate_analytic", simulate_steps_analytic);
+	lua_register(mState, "simulate_until_analytic", simulate_until_analytic);
+
+	lua_getglobal(mState, "math");
+	lua_pushcfunction(mState, lua_random);
+	lua_setfield(mState, -2, "random");
+	lua_pushcfunction(mState, lua_randomseed);
+	lua_setfield(mState, -2, "randomseed");
+	lua_pop(mState, 1);
 
 	#ifndef NDEBUG
 	// only enable this function in debug builds.
@@ -21,7 +21,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #pragma once
 
 #include <string>
+#include <vector>
+#include <functional>
+#include <random>
 #include "PhysicWorld.h"
+#include "BallTrajectory.h"
+#include "ScriptWatchdog.h"
 
 struct lua_State;
 struct DuelMatch;
@@ -40,23 +45,54 @@ protected:
 	virtual ~IScriptableComponent();
 
 	void openScript(const std::string& file);
+
+	/// gets a lua state with the game api and \p scripts loaded, if possible from the LuaStatePool.
+	/// States of the same \p kind have to use the same \p setup, which can register additional functions.
+	void acquireState(const std::string& kind, const std::vector<std::string>& scripts,
+						const std::function<void(lua_State*)>& setup = nullptr);
+	/// runs the scripts of the state from acquireState
+	void runScripts();
 	void setLuaGlobal(const char* name, double value);
 	bool getLuaFunction(const char* name) const;
 
-	// calls a lua function that is on the stack and performs error handling
-	void callLuaFunction(int arg_count = 0);
+	/// gets a registry reference to the global function \p name, or a negative value if there is
+	/// no such function. Use this for functions that are called often, the reference is released
+	/// together with the state.
+	int getLuaFunctionRef(const char* name);
+	/// pushes the function referenced by \p ref onto the stack. Returns false if \p ref is invalid.
+	bool pushLuaFunction(int ref) const;
+
+	/// calls a lua function that is on the stack within the script budget, and performs error handling.
+	/// On success, \p result_count results are left on the stack, otherwise nothing.
+	/// \throw ScriptException if the budget is exceeded and the policy is to abort the match
+	ScriptWatchdog::Result callLuaFunction(int arg_count = 0, int result_count = 0) const;
+	/// the budget of the calls to this script
+	const ScriptWatchdog::Budget& getBudget() const { return mBudget; };
 
 	// load lua functions
 	void setGameConstants();
 	void setGameFunctions();
 	void setMatch( DuelMatch* m ) { mGame = m; };
 	DuelMatch* getMatch() const { return mGame; };
+	/// seeds the random engine behind math.random
+	void seedRandom(unsigned int seed) { mRandom.seed(seed); };
 
 	lua_State* mState;
 
 private:
 	DuelMatch* mGame;
+	// references created by getLuaFunctionRef
+	std::vector<int> mFunctionRefs;
+	// budget and call statistics, which are passed to the watchdog from time to time
+	ScriptWatchdog::Budget mBudget;
+	std::string mScriptName;
+	mutable ScriptWatchdog::Statistics mStatistics;
 	// we save a dummy physic world here to do simulations
 	PhysicWorld mDummyWorld;
+	// and a trajectory solver for the analytic predictions
+	BallTrajectory mTrajectory;
+	// random engine behind math.random, so that scripts running on different
+	// threads do not share the global rand() sequence
+	std::mt19937 mRandom;
 };
 
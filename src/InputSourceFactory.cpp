@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 /* includes */
 #include <iostream>
+#include <algorithm>
 
 #include <boost/make_shared.hpp>
 
@@ -43,8 +44,12 @@ std::shared_ptr<InputSource> InputSourceFactory::createInputSource( const std::s
 		}
 		else
 		{
-			return std::make_shared<ScriptedInputSource>("scripts/" + config->getString(prefix + "_script_name"),
+			auto bot = std::make_shared<ScriptedInputSource>("scripts/" + config->getString(prefix + "_script_name"),
 					side, config->getInteger(prefix + "_script_strength"));
+			// let the bot think while the frame is drawn. It has to finish within one frame.
+			if (config->getBool("bot_async"))
+				bot->enableAsync( std::chrono::microseconds(1000000 / std::max(1, config->getInteger("gamefps"))) );
+			return bot;
 		}
 	} catch (std::exception& e)
 	{
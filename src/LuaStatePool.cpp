@@ -0,0 +1,274 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "LuaStatePool.h"
+
+/* includes */
+#include <iostream>
+#include <chrono>
+#include <cassert>
+#include <algorithm>
+
+#include <boost/throw_exception.hpp>
+
+#include "lua.hpp"
+
+#include "Global.h"
+#include "FileRead.h"
+#include "RulesCache.h"
+
+/* implementation */
+
+namespace
+{
+	LuaStatePool* currentPool = nullptr;
+
+	// registry field that holds the pool data of a state: its key, the compiled scripts and the recorded globals
+	const char* POOL_DATA = "__C++_StatePool__";
+}
+
+const std::size_t LuaStatePool::DEFAULT_MAX_IDLE;
+
+double LuaStatePool::Statistics::getHitRate() const
+{
+	return acquired ? double(hits) / acquired : 0;
+}
+
+double LuaStatePool::Statistics::getAverageCreationTime() const
+{
+	return acquired > hits ? creationTime / (acquired - hits) : 0;
+}
+
+LuaStatePool::LuaStatePool(std::size_t maxIdle) : mMaxIdle(maxIdle)
+{
+	assert(currentPool == nullptr);
+	currentPool = this;
+}
+
+LuaStatePool::~LuaStatePool()
+{
+	currentPool = nullptr;
+	for(auto& kind : mIdleStates)
+	{
+		for(auto state : kind.second)
+			lua_close(state);
+	}
+}
+
+lua_State* LuaStatePool::acquire(const std::string& kind, const std::vector<std::string>& scripts, const setup_fn& setup)
+{
+	// the checksums of cached scripts are part of the key, so states with an old version of a script
+	// are not reused once the rules cache was reloaded
+	std::vector<RulesCache::script_ptr> cached;
+	std::string key = kind;
+	for(const auto& script : scripts)
+	{
+		cached.push_back( RulesCache::find(script) );
+		key += ":" + script;
+		if(cached.back())
+			key += "@" + std::to_string(cached.back()->checksum);
+	}
+
+	if(currentPool)
+	{
+		std::lock_guard<std::mutex> lock(currentPool->mMutex);
+		currentPool->mStatistics.acquired++;
+		auto& idle = currentPool->mIdleStates[key];
+		if(!idle.empty())
+		{
+			lua_State* state = idle.back();
+			idle.pop_back();
+			currentPool->mStatistics.hits++;
+			currentPool->mStatistics.idle--;
+			return state;
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	lua_State* state = createState(key, scripts, cached, setup);
+	double duration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if(currentPool)
+	{
+		std::lock_guard<std::mutex> lock(currentPool->mMutex);
+		currentPool->mStatistics.creationTime += duration;
+		currentPool->mStatistics.maxCreationTime = std::max(currentPool->mStatistics.maxCreationTime, duration);
+	}
+
+	return state;
+}
+
+int LuaStatePool::runScripts(lua_State* state)
+{
+	lua_getfield(state, LUA_REGISTRYINDEX, POOL_DATA);
+	lua_getfield(state, -1, "scripts");
+	lua_remove(state, -2);
+
+	int count = lua_rawlen(state, -1);
+	for(int i = 1; i <= count; ++i)
+	{
+		lua_rawgeti(state, -1, i);
+		int error = lua_pcall(state, 0, 0, 0);
+		if(error)
+		{
+			// keep only the error message
+			lua_remove(state, -2);
+			return error;
+		}
+	}
+
+	lua_pop(state, 1);
+	return 0;
+}
+
+void LuaStatePool::release(lua_State* state)
+{
+	if(!currentPool)
+	{
+		lua_close(state);
+		return;
+	}
+
+	resetState(state);
+
+	lua_getfield(state, LUA_REGISTRYINDEX, POOL_DATA);
+	lua_getfield(state, -1, "key");
+	std::string key = lua_tostring(state, -1);
+	lua_pop(state, 2);
+
+	{
+		std::lock_guard<std::mutex> lock(currentPool->mMutex);
+		auto& idle = currentPool->mIdleStates[key];
+		if(idle.size() < currentPool->mMaxIdle)
+		{
+			idle.push_back(state);
+			currentPool->mStatistics.idle++;
+			return;
+		}
+		currentPool->mStatistics.discarded++;
+	}
+
+	lua_close(state);
+}
+
+LuaStatePool::Statistics LuaStatePool::getStatistics() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStatistics;
+}
+
+void LuaStatePool::printStatus(std::ostream& stream) const
+{
+	auto stats = getStatistics();
+	stream << " lua states: " << stats.acquired << " acquired, " << stats.getHitRate() * 100 << "% reused, ";
+	stream << stats.idle << " idle, " << stats.discarded << " discarded\n";
+	stream << " lua state creation: " << stats.getAverageCreationTime() << " ms average, " << stats.maxCreationTime << " ms max\n";
+}
+
+lua_State* LuaStatePool::createState(const std::string& key, const std::vector<std::string>& scripts,
+									const std::vector<RulesCache::script_ptr>& cached, const setup_fn& setup)
+{
+	lua_State* state = luaL_newstate();
+	try
+	{
+		setup(state);
+		lua_settop(state, 0);
+
+		lua_newtable(state);
+		lua_pushstring(state, key.c_str());
+		lua_setfield(state, -2, "key");
+
+		// compile the scripts. If they are in the rules cache, this only has to load the bytecode.
+		lua_createtable(state, scripts.size(), 0);
+		for(unsigned int i = 0; i < scripts.size(); ++i)
+		{
+			int error = cached[i] ? RulesCache::loadScript(state, *cached[i]) : FileRead::readLuaScript(scripts[i], state);
+			if(error)
+			{
+				std::cerr << "Lua Error: " << lua_tostring(state, -1) << std::endl;
+				ScriptException except;
+				except.luaerror = lua_tostring(state, -1);
+				BOOST_THROW_EXCEPTION(except);
+			}
+			lua_rawseti(state, -2, i + 1);
+		}
+		lua_setfield(state, -2, "scripts");
+
+		// record the globals, so the state can be reset later
+		lua_newtable(state);
+		lua_pushglobaltable(state);
+		lua_pushnil(state);
+		while(lua_next(state, -2))
+		{
+			lua_pushvalue(state, -2);
+			lua_insert(state, -2);
+			lua_rawset(state, -5);
+		}
+		lua_pop(state, 1);
+		lua_setfield(state, -2, "globals");
+
+		lua_setfield(state, LUA_REGISTRYINDEX, POOL_DATA);
+	}
+	catch(...)
+	{
+		lua_close(state);
+		throw;
+	}
+
+	return state;
+}
+
+void LuaStatePool::resetState(lua_State* state)
+{
+	lua_settop(state, 0);
+	lua_getfield(state, LUA_REGISTRYINDEX, POOL_DATA);
+	lua_getfield(state, 1, "globals");
+	lua_pushglobaltable(state);
+
+	// remove all globals that were added after the setup. Assigning nil to
+	// existing fields is allowed during the traversal.
+	lua_pushnil(state);
+	while(lua_next(state, 3))
+	{
+		lua_pop(state, 1);
+		lua_pushvalue(state, -1);
+		lua_rawget(state, 2);
+		bool recorded = !lua_isnil(state, -1);
+		lua_pop(state, 1);
+		if(!recorded)
+		{
+			lua_pushvalue(state, -1);
+			lua_pushnil(state);
+			lua_rawset(state, 3);
+		}
+	}
+
+	// restore the recorded values
+	lua_pushnil(state);
+	while(lua_next(state, 2))
+	{
+		lua_pushvalue(state, -2);
+		lua_insert(state, -2);
+		lua_rawset(state, 3);
+	}
+
+	lua_settop(state, 0);
+}
@@ -0,0 +1,106 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <functional>
+
+#include "BlobbyDebug.h"
+#include "RulesCache.h"
+
+struct lua_State;
+
+/*! \class LuaStatePool
+	\brief keeps initialised lua states for reuse by scripted components
+	\details Setting up a lua state for a rules script or a bot means opening the libraries, registering
+			the api functions and loading several scripts. The pool does this once for every kind of state
+			and keeps the states of finished matches around, so the next LuaGameLogic or ScriptedInputSource
+			that needs the same scripts gets a ready state.
+
+			A pooled state contains the api functions and the compiled, but not yet executed, scripts.
+			Its global table is recorded after the setup. When a state is released, all globals are reset
+			to that record, so the scripts are run again from scratch by the next user. Changes to the
+			contents of library tables (e.g. math) are not undone.
+
+			States of scripts from the RulesCache are only reused while the cached checksums are the same,
+			so reloading changed rules takes effect for the next match.
+
+			As with the RulesCache, at most one pool exists at a time. Without a pool, acquire and release
+			simply create and close states.
+*/
+class LuaStatePool : public ObjectCounter<LuaStatePool>
+{
+	public:
+		/// sets up a new state, e.g. by registering functions
+		typedef std::function<void(lua_State*)> setup_fn;
+
+		struct Statistics
+		{
+			unsigned long long acquired = 0;	///< number of states handed out
+			unsigned long long hits = 0;		///< number of states that were taken from the pool
+			unsigned long long discarded = 0;	///< released states that were closed because the pool was full
+			double creationTime = 0;			///< total time spent creating new states, in ms
+			double maxCreationTime = 0;			///< longest time it took to create a state, in ms
+			std::size_t idle = 0;				///< number of states waiting for reuse
+
+			double getHitRate() const;
+			double getAverageCreationTime() const;
+		};
+
+		static const std::size_t DEFAULT_MAX_IDLE = 8;
+
+		/// creates the pool. At most \p maxIdle unused states of each kind are kept.
+		explicit LuaStatePool(std::size_t maxIdle = DEFAULT_MAX_IDLE);
+		~LuaStatePool();
+
+		LuaStatePool(const LuaStatePool&) = delete;
+		LuaStatePool& operator=(const LuaStatePool&) = delete;
+
+		/// gets a state that has been set up by \p setup and has \p scripts loaded. States of the same
+		/// \p kind have to use the same setup function.
+		/// \throw ScriptException if a script does not compile, FileLoadException if it cannot be read
+		static lua_State* acquire(const std::string& kind, const std::vector<std::string>& scripts, const setup_fn& setup);
+
+		/// runs the scripts of a state from acquire, in the order they were given.
+		/// \return the lua error code, 0 on success. In case of an error, the message is on the stack.
+		static int runScripts(lua_State* state);
+
+		/// gives a state from acquire back to the pool
+		static void release(lua_State* state);
+
+		Statistics getStatistics() const;
+		void printStatus(std::ostream& stream) const;
+
+	private:
+		/// \p cached holds the rules cache entry of each script, or an empty pointer if it has to be read from disk
+		static lua_State* createState(const std::string& key, const std::vector<std::string>& scripts,
+									const std::vector<RulesCache::script_ptr>& cached, const setup_fn& setup);
+		static void resetState(lua_State* state);
+
+		mutable std::mutex mMutex;
+		std::map<std::string, std::vector<lua_State*>> mIdleStates;
+		std::size_t mMaxIdle;
+		Statistics mStatistics;
+};
@@ -0,0 +1,127 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+/*! \class MPSCQueue
+	\brief bounded lock-free queue for many producers and one consumer
+	\details The queue is a fixed ring of cells that is allocated once, so pushing and popping never
+			allocate memory. Each cell carries a sequence number that tells whether it is free
+			for the producer of a given position, or filled for the consumer (the bounded queue
+			by Dmitry Vyukov). Producers claim a position with a single compare-and-swap, the
+			consumer needs no atomic read-modify-write at all.
+			push may be called from any number of threads concurrently, pop only from one thread
+			at a time. If the consumer thread changes, the handover has to be synchronized externally.
+*/
+template<class T>
+class MPSCQueue
+{
+	public:
+		/// creates a queue that can hold at least \p capacity elements. The capacity is rounded up
+		/// to a power of two.
+		explicit MPSCQueue(std::size_t capacity) : mEnqueuePosition(0), mDequeuePosition(0)
+		{
+			std::size_t size = 2;
+			while(size < capacity)
+				size *= 2;
+
+			mMask = size - 1;
+			mCells.reset(new Cell[size]);
+			for(std::size_t i = 0; i < size; ++i)
+				mCells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
+		MPSCQueue(const MPSCQueue&) = delete;
+		MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+		std::size_t capacity() const
+		{
+			return mMask + 1;
+		}
+
+		/// adds \p value to the queue.
+		/// \return false, if the queue is full. In that case, the queue is not changed.
+		bool push(const T& value)
+		{
+			Cell* cell;
+			std::size_t position = mEnqueuePosition.load(std::memory_order_relaxed);
+			while(true)
+			{
+				cell = &mCells[position & mMask];
+				std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t difference = std::ptrdiff_t(sequence) - std::ptrdiff_t(position);
+				if(difference == 0)
+				{
+					// the cell is free, try to claim it
+					if(mEnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if(difference < 0)
+				{
+					// the consumer has not freed this cell yet
+					return false;
+				}
+				else
+				{
+					// another producer was faster
+					position = mEnqueuePosition.load(std::memory_order_relaxed);
+				}
+			}
+
+			cell->value = value;
+			cell->sequence.store(position + 1, std::memory_order_release);
+			return true;
+		}
+
+		/// removes the oldest element and moves it into \p value.
+		/// \return false, if the queue is empty.
+		bool pop(T& value)
+		{
+			Cell& cell = mCells[mDequeuePosition & mMask];
+			std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			if(std::ptrdiff_t(sequence) - std::ptrdiff_t(mDequeuePosition + 1) < 0)
+				return false;
+
+			value = std::move(cell.value);
+			// don't keep the resources of the element alive until the cell is reused
+			cell.value = T();
+			cell.sequence.store(mDequeuePosition + mMask + 1, std::memory_order_release);
+			++mDequeuePosition;
+			return true;
+		}
+
+	private:
+		struct Cell
+		{
+			std::atomic<std::size_t> sequence;
+			T value;
+		};
+
+		std::unique_ptr<Cell[]> mCells;
+		std::size_t mMask;
+
+		// producers and consumer work on different cache lines
+		alignas(64) std::atomic<std::size_t> mEnqueuePosition;
+		alignas(64) std::size_t mDequeuePosition;
+};
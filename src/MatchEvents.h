@@ -20,6 +20,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #pragma once
 
+#include <utility>
+
+#include "Global.h"
+
 // encoding of events that can happen in the physics subsystem
 struct MatchEvent
 {
@@ -48,5 +52,75 @@ struct MatchEvent
 	{
 
 	}
+
+	MatchEvent() : MatchEvent(BALL_HIT_BLOB, NO_PLAYER)
+	{
+
+	}
+};
+
+/*! \class MatchEventBuffer
+	\brief fixed capacity ring buffer of match events
+	\details Collects the events of a frame without any heap allocation. A frame generates
+			only a handful of events, so the capacity is never reached during normal play. If
+			more events are pushed, e.g. because a client receives many events from the network
+			while no frame is processed, the oldest events are overwritten.
+*/
+class MatchEventBuffer
+{
+	public:
+		static const unsigned CAPACITY = 32;
+
+		class const_iterator
+		{
+			public:
+				const_iterator(const MatchEventBuffer* buffer, unsigned index) : mBuffer(buffer), mIndex(index)
+				{
+				}
+
+				const MatchEvent& operator*() const { return (*mBuffer)[mIndex]; }
+				const MatchEvent* operator->() const { return &(*mBuffer)[mIndex]; }
+				const_iterator& operator++() { ++mIndex; return *this; }
+				bool operator==(const const_iterator& other) const { return mIndex == other.mIndex; }
+				bool operator!=(const const_iterator& other) const { return mIndex != other.mIndex; }
+
+			private:
+				const MatchEventBuffer* mBuffer;
+				unsigned mIndex;
+		};
+
+		void push_back(const MatchEvent& event)
+		{
+			mEvents[(mBegin + mSize) % CAPACITY] = event;
+			if(mSize < CAPACITY)
+				++mSize;
+			else
+				mBegin = (mBegin + 1) % CAPACITY;
+		}
+
+		template<class... Args>
+		void emplace_back(Args&&... args)
+		{
+			push_back( MatchEvent(std::forward<Args>(args)...) );
+		}
+
+		void clear()
+		{
+			mBegin = 0;
+			mSize = 0;
+		}
+
+		bool empty() const { return mSize == 0; }
+		unsigned size() const { return mSize; }
+
+		const MatchEvent& operator[](unsigned index) const { return mEvents[(mBegin + index) % CAPACITY]; }
+
+		const_iterator begin() const { return const_iterator(this, 0); }
+		const_iterator end() const { return const_iterator(this, mSize); }
+
+	private:
+		MatchEvent mEvents[CAPACITY];
+		unsigned mBegin = 0;
+		unsigned mSize = 0;
 };
 
@@ -0,0 +1,148 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "MatchPredictor.h"
+
+/* includes */
+#include <algorithm>
+
+#include "DuelMatch.h"
+#include "InputSource.h"
+
+/* implementation */
+
+namespace
+{
+	// fraction of the correction offset that is left after each frame
+	const float SMOOTHING_FACTOR = 0.8f;
+	// offsets smaller than this are dropped, larger ones (e.g. a ball reset) are not smoothed at all
+	const float MIN_OFFSET = 0.1f;
+	const float MAX_OFFSET = 100.f;
+	// a prediction counts as wrong if the ball or a blob is off by more than this
+	const float MISPREDICTION_TOLERANCE = 1.f;
+
+	Vector2 clampOffset(Vector2 offset)
+	{
+		float length = offset.length();
+		if(length < MIN_OFFSET || length > MAX_OFFSET)
+			return Vector2();
+		return offset;
+	}
+
+	bool isClose(const Vector2& a, const Vector2& b)
+	{
+		return (a - b).length() <= MISPREDICTION_TOLERANCE;
+	}
+}
+
+float MatchPredictor::Statistics::getMispredictionRate() const
+{
+	return compared != 0 ? float(mispredictions) / compared : 0.f;
+}
+
+float MatchPredictor::Statistics::getAverageRollbackDepth() const
+{
+	return corrections != 0 ? float(replayedFrames) / corrections : 0.f;
+}
+
+MatchPredictor::MatchPredictor(DuelMatch& match, PlayerSide localSide) :
+	mMatch(match),
+	mLocalSide(localSide)
+{
+}
+
+void MatchPredictor::step(unsigned int inputId, const PlayerInput& input)
+{
+	// if the server does not answer for a long time, we forget the oldest frames.
+	if(mCount == BUFFER_SIZE)
+	{
+		mFirst = (mFirst + 1) % BUFFER_SIZE;
+		--mCount;
+	}
+
+	mMatch.getInputSource(mLocalSide)->setInput(input);
+	mMatch.step();
+
+	Frame& current = frame(mCount++);
+	current.inputId = inputId;
+	current.input = input;
+	current.predicted = mMatch.getState();
+
+	mBallOffset = clampOffset(mBallOffset * SMOOTHING_FACTOR);
+	for(auto& offset : mBlobOffset)
+		offset = clampOffset(offset * SMOOTHING_FACTOR);
+}
+
+void MatchPredictor::correct(const DuelMatchState& state, unsigned int ackedInputId)
+{
+	// drop all frames the server already knows about, and remember what we predicted for the last of them
+	const DuelMatchState* predicted = nullptr;
+	while(mCount > 0 && int(frame(0).inputId - ackedInputId) <= 0)
+	{
+		if(frame(0).inputId == ackedInputId)
+			predicted = &frame(0).predicted;
+		mFirst = (mFirst + 1) % BUFFER_SIZE;
+		--mCount;
+	}
+
+	++mStatistics.corrections;
+	if(predicted)
+	{
+		++mStatistics.compared;
+		if( !isClose(predicted->getBallPosition(), state.getBallPosition()) ||
+			!isClose(predicted->getBlobPosition(LEFT_PLAYER), state.getBlobPosition(LEFT_PLAYER)) ||
+			!isClose(predicted->getBlobPosition(RIGHT_PLAYER), state.getBlobPosition(RIGHT_PLAYER)) )
+		{
+			++mStatistics.mispredictions;
+		}
+	}
+
+	Vector2 oldBall = mMatch.getBallPosition() + mBallOffset;
+	Vector2 oldBlobs[MAX_PLAYERS];
+	for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+		oldBlobs[p] = mMatch.getBlobPosition(PlayerSide(p)) + mBlobOffset[p];
+
+	// replay the inputs the server has not seen yet
+	mMatch.setState(state);
+	for(unsigned int i = 0; i < mCount; ++i)
+	{
+		Frame& replayed = frame(i);
+		mMatch.getInputSource(mLocalSide)->setInput(replayed.input);
+		mMatch.resimulate();
+		replayed.predicted = mMatch.getState();
+	}
+	mStatistics.replayedFrames += mCount;
+	mStatistics.maxRollbackDepth = std::max(mStatistics.maxRollbackDepth, mCount);
+
+	// keep the drawn positions where they were, the offsets move them to the corrected ones smoothly
+	mBallOffset = clampOffset(oldBall - mMatch.getBallPosition());
+	for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+		mBlobOffset[p] = clampOffset(oldBlobs[p] - mMatch.getBlobPosition(PlayerSide(p)));
+}
+
+void MatchPredictor::reset()
+{
+	mFirst = 0;
+	mCount = 0;
+	mBallOffset = Vector2();
+	for(auto& offset : mBlobOffset)
+		offset = Vector2();
+}
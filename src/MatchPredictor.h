@@ -0,0 +1,101 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include "DuelMatchState.h"
+#include "PlayerInput.h"
+#include "Vector.h"
+#include "BlobbyDebug.h"
+
+class DuelMatch;
+
+/*! \class MatchPredictor
+	\brief client side prediction for network games
+	\details Without prediction, the local blob of a network game only moves when the server state
+			containing the new input has come back, i.e. one round trip after the key press. The
+			MatchPredictor steps the local match with the local input right away and keeps the inputs
+			and resulting states of the last BUFFER_SIZE frames. When a state arrives from the server,
+			it replaces the local state, and all local inputs the server had not received yet are
+			replayed on top of it.
+			The positions jump when the prediction was wrong. To hide this, the difference is kept
+			as an offset that should be added to the drawn positions, which decays over a few frames.
+*/
+class MatchPredictor : public ObjectCounter<MatchPredictor>
+{
+	public:
+		/// maximum number of unacknowledged frames that are kept for replay
+		static const unsigned int BUFFER_SIZE = 64;
+
+		struct Statistics
+		{
+			unsigned int corrections = 0;		///< number of server states that have been applied
+			unsigned int compared = 0;			///< corrections for which the predicted state was known
+			unsigned int mispredictions = 0;	///< compared corrections that differed from the prediction
+			unsigned int replayedFrames = 0;	///< total number of re-simulated frames
+			unsigned int maxRollbackDepth = 0;	///< most frames re-simulated for a single correction
+
+			float getMispredictionRate() const;
+			float getAverageRollbackDepth() const;
+		};
+
+		/// creates a predictor for \p match, where the local player plays on side \p localSide.
+		MatchPredictor(DuelMatch& match, PlayerSide localSide);
+
+		/// steps the match with the local input \p input, which is sent to the server tagged with \p inputId.
+		/// The ids have to increase (possibly wrapping around).
+		void step(unsigned int inputId, const PlayerInput& input);
+
+		/// replaces the match state with \p state from the server, which already contains all local
+		/// inputs up to \p ackedInputId, and replays the newer local inputs.
+		void correct(const DuelMatchState& state, unsigned int ackedInputId);
+
+		/// forgets all buffered inputs and the correction offsets, e.g. after a pause.
+		void reset();
+
+		// offsets that should be added to the positions when drawing, so corrections are smoothed
+		Vector2 getBallOffset() const { return mBallOffset; }
+		Vector2 getBlobOffset(PlayerSide player) const { return mBlobOffset[player]; }
+
+		const Statistics& getStatistics() const { return mStatistics; }
+
+	private:
+		struct Frame
+		{
+			unsigned int inputId;
+			PlayerInput input;
+			DuelMatchState predicted;
+		};
+
+		Frame& frame(unsigned int index) { return mFrames[(mFirst + index) % BUFFER_SIZE]; }
+
+		DuelMatch& mMatch;
+		PlayerSide mLocalSide;
+
+		// ring buffer of unacknowledged frames
+		Frame mFrames[BUFFER_SIZE];
+		unsigned int mFirst = 0;
+		unsigned int mCount = 0;
+
+		Vector2 mBallOffset;
+		Vector2 mBlobOffset[MAX_PLAYERS];
+
+		Statistics mStatistics;
+};
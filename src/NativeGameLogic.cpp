@@ -0,0 +1,515 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "NativeGameLogic.h"
+
+/* includes */
+#include <cstdint>
+#include <iostream>
+#include <utility>
+
+#include "DuelMatch.h"
+#include "FileRead.h"
+#include "GameConstants.h"
+#include "PlayerInput.h"
+#include "RulesCache.h"
+
+/* implementation */
+
+namespace
+{
+
+/// \class NativeGameLogic
+/// \brief base class for the compiled versions of the bundled rules scripts
+/// \details The default implementations of the handlers behave like the fallback rules, i.e. like a
+///			script that does not define the corresponding function. Subclasses only override what their
+///			script defines, and have to do exactly what the script does, as a client running the Lua
+///			version has to arrive at the same score.
+class NativeGameLogic : public IGameLogic
+{
+	public:
+		NativeGameLogic(std::string file, DuelMatch* match, int score_to_win, std::string author, std::string title) :
+			IGameLogic( score_to_win ), mMatch( match ), mSourceFile( std::move(file) ),
+			mAuthor( std::move(author) ), mTitle( std::move(title) )
+		{
+		}
+
+		std::string getSourceFile() const override
+		{
+			return mSourceFile;
+		}
+
+		std::string getAuthor() const override
+		{
+			return mAuthor;
+		}
+
+		std::string getTitle() const override
+		{
+			return mTitle;
+		}
+
+	protected:
+		/// equivalent of the mistake function of the lua api
+		void mistake(PlayerSide mistakeSide, PlayerSide serveSide, int amount)
+		{
+			score(other_side(mistakeSide), amount);
+			onError(mistakeSide, serveSide);
+		}
+
+		PlayerSide checkWin() const override
+		{
+			int left = getScore(LEFT_PLAYER);
+			int right = getScore(RIGHT_PLAYER);
+			int stw = getScoreToWin();
+			if( left >= stw && left >= right + 2 )
+			{
+				return LEFT_PLAYER;
+			}
+
+			if( right >= stw && right >= left + 2 )
+			{
+				return RIGHT_PLAYER;
+			}
+
+			return NO_PLAYER;
+		}
+
+		PlayerInput handleInput(PlayerInput ip, PlayerSide player) override
+		{
+			return ip;
+		}
+
+		void OnBallHitsPlayerHandler(PlayerSide side) override
+		{
+			if (getTouches(side) > 3)
+			{
+				mistake( side, other_side(side), 1 );
+			}
+		}
+
+		void OnBallHitsGroundHandler(PlayerSide side) override
+		{
+			mistake( side, other_side(side), 1 );
+		}
+
+		void OnBallHitsWallHandler(PlayerSide side) override		{ };
+		void OnBallHitsNetHandler(PlayerSide side) override		{ };
+		void OnGameHandler( const DuelMatchState& state ) override { };
+
+		DuelMatch* mMatch;
+
+	private:
+		std::string mSourceFile;
+		std::string mAuthor;
+		std::string mTitle;
+};
+
+/// helper that implements clone for the native rules. Like a cloned LuaGameLogic, the clone starts
+/// with the score to win of the original, which the constructor may adjust again.
+template<class Rules>
+class NativeRules : public NativeGameLogic
+{
+	public:
+		using NativeGameLogic::NativeGameLogic;
+
+		GameLogicPtr clone() const override
+		{
+			return GameLogicPtr(new Rules(getSourceFile(), mMatch, getScoreToWin()));
+		}
+};
+
+// -------------------------------------------------------------------------------------------------
+// 	rules/default.lua
+// ---------------------
+
+class DefaultRules : public NativeRules<DefaultRules>
+{
+	public:
+		DefaultRules(std::string file, DuelMatch* match, int score_to_win) :
+			NativeRules(std::move(file), match, score_to_win, "Blobby Volley 2 Developers", "BV2 Default Rules")
+		{
+		}
+};
+
+// -------------------------------------------------------------------------------------------------
+// 	rules/classic.lua
+// ---------------------
+
+/// a team can only score while serving
+class ClassicRules : public NativeRules<ClassicRules>
+{
+	public:
+		ClassicRules(std::string file, DuelMatch* match, int score_to_win) :
+			NativeRules(std::move(file), match, score_to_win, "Blobby Volley 2 Developers", "BV2 Classic Rules")
+		{
+		}
+
+	protected:
+		void OnBallHitsPlayerHandler(PlayerSide side) override
+		{
+			if (getTouches(side) > 3)
+			{
+				mistake( side, other_side(side), amountOfPoints(side) );
+			}
+		}
+
+		void OnBallHitsGroundHandler(PlayerSide side) override
+		{
+			mistake( side, other_side(side), amountOfPoints(side) );
+		}
+
+	private:
+		int amountOfPoints(PlayerSide side)
+		{
+			if( mFirstRound )
+			{
+				mLastHit = side;
+				mFirstRound = false;
+				return 0;
+			}
+
+			if( mLastHit != side )
+			{
+				mLastHit = side;
+				return 0;
+			}
+
+			return 1;
+		}
+
+		bool mFirstRound = true;
+		PlayerSide mLastHit = LEFT_PLAYER;
+};
+
+// -------------------------------------------------------------------------------------------------
+// 	rules/blitz.lua
+// ---------------------
+
+class BlitzRules : public NativeRules<BlitzRules>
+{
+	public:
+		BlitzRules(std::string file, DuelMatch* match, int score_to_win) :
+			NativeRules(std::move(file), match, score_to_win, "chameleon", "Crazy Volley - Blitz")
+		{
+			mScoreToWin = 2;
+		}
+};
+
+// -------------------------------------------------------------------------------------------------
+// 	rules/firewall.lua
+// ---------------------
+
+class FirewallRules : public NativeRules<FirewallRules>
+{
+	public:
+		FirewallRules(std::string file, DuelMatch* match, int score_to_win) :
+			NativeRules(std::move(file), match, score_to_win, "chameleon", "Crazy Volley - Firewall")
+		{
+			mScoreToWin = 10 * mScoreToWin;
+		}
+
+	protected:
+		void OnBallHitsPlayerHandler(PlayerSide side) override
+		{
+			if (getTouches(side) > 3)
+			{
+				mistake( side, other_side(side), 10 );
+			}
+		}
+
+		void OnBallHitsWallHandler(PlayerSide side) override
+		{
+			score( other_side(side), 1 );
+		}
+
+		void OnBallHitsGroundHandler(PlayerSide side) override
+		{
+			mistake( side, other_side(side), 10 );
+		}
+};
+
+// -------------------------------------------------------------------------------------------------
+// 	rules/jumping_jack.lua
+// ---------------------
+
+class JumpingJackRules : public NativeRules<JumpingJackRules>
+{
+	public:
+		JumpingJackRules(std::string file, DuelMatch* match, int score_to_win) :
+			NativeRules(std::move(file), match, score_to_win, "chameleon", "Crazy Volley - Jumping Jack")
+		{
+		}
+
+	protected:
+		PlayerInput handleInput(PlayerInput ip, PlayerSide player) override
+		{
+			ip.up = true;
+			return ip;
+		}
+};
+
+// -------------------------------------------------------------------------------------------------
+// 	rules/one_hit_wonder.lua
+// ---------------------
+
+class OneHitWonderRules : public NativeRules<OneHitWonderRules>
+{
+	public:
+		OneHitWonderRules(std::string file, DuelMatch* match, int score_to_win) :
+			NativeRules(std::move(file), match, score_to_win, "chameleon", "Crazy Volley - One Hit Wonder")
+		{
+		}
+
+	protected:
+		void OnBallHitsPlayerHandler(PlayerSide side) override
+		{
+			if (getTouches(side) > 1)
+			{
+				mistake( side, other_side(side), 1 );
+			}
+		}
+};
+
+// -------------------------------------------------------------------------------------------------
+// 	rules/sticky_mode.lua
+// ---------------------
+
+class StickyModeRules : public NativeRules<StickyModeRules>
+{
+	public:
+		StickyModeRules(std::string file, DuelMatch* match, int score_to_win) :
+			NativeRules(std::move(file), match, score_to_win, "chameleon", "Crazy Volley - Sticky Mode")
+		{
+		}
+
+	protected:
+		PlayerInput handleInput(PlayerInput ip, PlayerSide player) override
+		{
+			if( isGameRunning() )
+				ip.up = false;
+			return ip;
+		}
+};
+
+// -------------------------------------------------------------------------------------------------
+// 	rules/the_double.lua
+// ---------------------
+
+class TheDoubleRules : public NativeRules<TheDoubleRules>
+{
+	public:
+		TheDoubleRules(std::string file, DuelMatch* match, int score_to_win) :
+			NativeRules(std::move(file), match, score_to_win, "chameleon", "Crazy Volley - The Double")
+		{
+		}
+
+	protected:
+		void OnBallHitsPlayerHandler(PlayerSide side) override
+		{
+			PlayerSide opp = other_side(side);
+			if (getTouches(side) > 2)
+			{
+				mistake( side, opp, 1 );
+			}
+			if (getTouches(opp) == 1)
+			{
+				mistake( opp, side, 1 );
+			}
+		}
+
+		void OnBallHitsGroundHandler(PlayerSide side) override
+		{
+			PlayerSide opp = other_side(side);
+			if (getTouches(opp) == 1)
+			{
+				mistake( opp, side, 1 );
+			}
+			else
+			{
+				mistake( side, opp, 1 );
+			}
+		}
+};
+
+// -------------------------------------------------------------------------------------------------
+// 	rules/back_defence.lua
+// ---------------------
+
+/// a blob that has not touched the ball cannot jump in the middle of its half, and cannot move
+/// towards the net while it is in the air there.
+class BackDefenceRules : public NativeRules<BackDefenceRules>
+{
+	public:
+		BackDefenceRules(std::string file, DuelMatch* match, int score_to_win) :
+			NativeRules(std::move(file), match, score_to_win, "chameleon", "Crazy Volley - Back Defence")
+		{
+		}
+
+	protected:
+		PlayerInput handleInput(PlayerInput ip, PlayerSide player) override
+		{
+			// positions are compared in the coordinate system of the lua api, in double precision
+			const double field_width = RIGHT_PLANE;
+			const double blobby_ground_height = double(600 - GROUND_PLANE_HEIGHT_MAX) + double(BLOBBY_HEIGHT) / 2;
+
+			if( !isGameRunning() || getTouches(player) != 0 )
+				return ip;
+
+			Vector2 position = mMatch->getBlobPosition(player);
+			double x = position.x;
+			if( x > field_width / 4 && x < field_width * 3 / 4 )
+			{
+				double y = 600 - position.y;
+				if( y > blobby_ground_height )
+				{
+					if( player == LEFT_PLAYER )
+						ip.right = false;
+					else
+						ip.left = false;
+				}
+				else
+				{
+					ip.up = false;
+				}
+			}
+			return ip;
+		}
+};
+
+// -------------------------------------------------------------------------------------------------
+// 	rules/tennis.lua
+// ---------------------
+
+/// the ball may hit the ground once on each side before it has to be played
+class TennisRules : public NativeRules<TennisRules>
+{
+	public:
+		TennisRules(std::string file, DuelMatch* match, int score_to_win) :
+			NativeRules(std::move(file), match, score_to_win, "chameleon", "Crazy Volley - Tennis")
+		{
+		}
+
+	protected:
+		void OnBallHitsPlayerHandler(PlayerSide side) override
+		{
+			PlayerSide opp = other_side(side);
+			int opponentHits = mGroundHits[side2index(opp)];
+			mGroundHits[0] = 0;
+			mGroundHits[1] = 0;
+
+			if (getTouches(side) > 1)
+			{
+				mistake( side, opp, 1 );
+			}
+			if (opponentHits > 0 && getTouches(opp) == 0)
+			{
+				mistake( opp, side, 1 );
+			}
+		}
+
+		void OnBallHitsGroundHandler(PlayerSide side) override
+		{
+			PlayerSide opp = other_side(side);
+			int ownHits = ++mGroundHits[side2index(side)];
+			int opponentHits = mGroundHits[side2index(opp)];
+			mGroundHits[side2index(opp)] = 0;
+
+			if (ownHits > 1 || getTouches(side) > 0)
+			{
+				mGroundHits[0] = 0;
+				mGroundHits[1] = 0;
+				mistake( side, opp, 1 );
+			}
+			if (opponentHits > 0 && getTouches(opp) == 0)
+			{
+				mGroundHits[0] = 0;
+				mGroundHits[1] = 0;
+				mistake( opp, side, 1 );
+			}
+		}
+
+	private:
+		/// ground hits since the ball was last played, per side
+		int mGroundHits[2] = {0, 0};
+};
+
+// -------------------------------------------------------------------------------------------------
+// 	checksum lookup
+// ---------------------
+
+template<class Rules>
+GameLogicPtr createRules(const std::string& file, DuelMatch* match, int score_to_win)
+{
+	return GameLogicPtr(new Rules(file, match, score_to_win));
+}
+
+/// the bundled rules scripts, identified by the checksum FileRead::calcChecksum calculates for them.
+/// When one of the scripts in data/rules is changed, its entry has to be updated together with the
+/// corresponding class above.
+const struct
+{
+	const char* name;
+	uint32_t checksum;
+	GameLogicPtr (*create)(const std::string&, DuelMatch*, int);
+} BUNDLED_RULES[] = {
+	{"default.lua",			0x79fa89dd, createRules<DefaultRules>},
+	{"classic.lua",			0x7f97a5e5, createRules<ClassicRules>},
+	{"blitz.lua",			0xb72b4587, createRules<BlitzRules>},
+	{"firewall.lua",		0x5eb7beda, createRules<FirewallRules>},
+	{"jumping_jack.lua",	0x6f7424b3, createRules<JumpingJackRules>},
+	{"one_hit_wonder.lua",	0x1b362f44, createRules<OneHitWonderRules>},
+	{"sticky_mode.lua",		0x195743eb, createRules<StickyModeRules>},
+	{"the_double.lua",		0xf0e62f27, createRules<TheDoubleRules>},
+	{"back_defence.lua",	0x671dfc6a, createRules<BackDefenceRules>},
+	{"tennis.lua",			0x79903ccd, createRules<TennisRules>},
+};
+
+}
+
+GameLogicPtr createNativeGameLogic(const std::string& file, DuelMatch* match, int score_to_win)
+{
+	std::string filename = "rules/" + FileRead::makeLuaFilename(file);
+
+	uint32_t checksum;
+	try
+	{
+		auto script = RulesCache::find( filename );
+		checksum = script ? script->checksum : FileRead(filename).calcChecksum(0);
+	}
+	catch( std::exception& exp )
+	{
+		// the lua game logic reports the error
+		return GameLogicPtr();
+	}
+
+	for( const auto& rules : BUNDLED_RULES )
+	{
+		if( rules.checksum == checksum )
+		{
+			GameLogicPtr logic = rules.create(file, match, score_to_win);
+			std::cout << "loaded native rules " << logic->getTitle() << " by " << logic->getAuthor() << " for " << file << std::endl;
+			return logic;
+		}
+	}
+
+	return GameLogicPtr();
+}
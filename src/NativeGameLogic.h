@@ -0,0 +1,33 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <string>
+
+#include "GameLogic.h"
+
+/// \brief creates a compiled implementation of one of the bundled rules scripts.
+/// \details The rules file is identified by its checksum, not by its name, so a modified script
+///			and a third party script with the same name are still run by a LuaGameLogic. The native
+///			rules mirror the bundled scripts exactly, including title, author and scoring.
+/// \return the native game logic, or an empty pointer if \p rulefile is not one of the bundled
+///			rules or cannot be read.
+GameLogicPtr createNativeGameLogic(const std::string& rulefile, DuelMatch* match, int score_to_win);
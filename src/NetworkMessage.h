@@ -48,7 +48,8 @@ enum MessageType
 	ID_RULES_CHECKSUM,
 	ID_RULES,
 	ID_SERVER_STATUS,
-	ID_LOBBY
+	ID_LOBBY,
+	ID_GAME_UPDATE_DELTA	// send delta encoded game status from server to client [unreliable]
 };
 
 // General Information:
@@ -62,6 +63,8 @@ enum MessageType
 // 	Description:
 // 		This packet is sent from client to server every frame.
 // 		It contains the current input state as three booleans.
+// 		The server echoes the timestamp of the newest applied input in the
+// 		game updates. The client counts it up every frame, so it identifies the input.
 // 	Structure:
 // 		ID_INPUT_UPDATE
 // 		ID_TIMESTAMP
@@ -69,6 +72,27 @@ enum MessageType
 // 		left keypress (bool)
 // 		right keypress (bool)
 // 		up keypress (bool)
+//		acknowledged frame (unsigned)
+//	Clients that append the number of the newest ID_GAME_UPDATE_DELTA frame
+//	they decoded (0 if none yet) get ID_GAME_UPDATE_DELTA instead of
+//	ID_GAME_UPDATE from the server.
+//
+// ID_GAME_UPDATE_DELTA:
+// 	Description:
+// 		Replaces ID_GAME_UPDATE for clients that acknowledge frames.
+// 		The state is encoded in the view of the server by DuelMatchStateCodec,
+// 		relative to the state of frame (frame - baseline distance), which the
+// 		client has acknowledged. A baseline distance of 0 marks a keyframe.
+// 		Other frames end with a checksum of the state. If it does not match,
+// 		the client acknowledges frame 0 until it gets the next keyframe.
+// 		If swap sides is set, the client has to call swapSides on the decoded state.
+// 	Structure:
+// 		ID_GAME_UPDATE_DELTA
+// 		timestamp (unsigned)
+// 		frame (unsigned)
+// 		baseline distance (unsigned char)
+// 		swap sides (bool)
+// 		encoded state
 //
 // ID_PHYSIC_UPDATE:
 // 	Description:
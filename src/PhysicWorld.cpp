@@ -30,21 +30,19 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "GameConstants.h"
 #include "MatchEvents.h"
+#include "FixedPoint.h"
 
 /* implementation */
 // Gamefeeling relevant constants:
 const float BLOBBY_ANIMATION_SPEED = 0.5;
 
-// helper function for setting FPU precision
-inline short set_fpu_single_precision();
-void reset_fpu_flags(short flags);
-
 PhysicWorld::PhysicWorld()
 : mBallPosition(Vector2(200, STANDARD_BALL_HEIGHT))
 , mBallRotation(0)
 , mBallAngularVelocity(STANDARD_BALL_ANGULAR_VELOCITY)
 , mLastHitIntensity(0)
-, mCallback( [](const MatchEvent& me) {} )
+, mDeterministic(false)
+, mEvents( nullptr )
 {
 	mCurrentBlobbyAnimationSpeed[LEFT_PLAYER] = 0.0;
 	mCurrentBlobbyAnimationSpeed[RIGHT_PLAYER] = 0.0;
@@ -82,7 +80,7 @@ inline bool PhysicWorld::playerBottomBallCollision(int player) const
 								blobpos, BLOBBY_LOWER_RADIUS );
 }
 
-inline bool PhysicWorld::circleCircleCollision(const Vector2& pos1, float rad1, const Vector2& pos2, float rad2)
+bool PhysicWorld::circleCircleCollision(const Vector2& pos1, float rad1, const Vector2& pos2, float rad2)
 {
 	Vector2 distance = pos1 - pos2;
 	float mxdist = rad1 + rad2;
@@ -214,6 +212,12 @@ bool PhysicWorld::handleBlobbyBallCollision(PlayerSide player)
 void PhysicWorld::step(const PlayerInput& leftInput, const PlayerInput& rightInput,
 					bool isBallValid, bool isGameRunning)
 {
+	if(mDeterministic)
+	{
+		stepDeterministic(leftInput, rightInput, isBallValid, isGameRunning);
+		return;
+	}
+
 	// Determistic IEEE 754 floating point computations
 	short fpf = set_fpu_single_precision();
 
@@ -235,9 +239,9 @@ void PhysicWorld::step(const PlayerInput& leftInput, const PlayerInput& rightInp
 	if(isBallValid)
 	{
 		if (handleBlobbyBallCollision(LEFT_PLAYER))
-			mCallback( MatchEvent{MatchEvent::BALL_HIT_BLOB, LEFT_PLAYER, mLastHitIntensity} );
+			pushEvent( MatchEvent{MatchEvent::BALL_HIT_BLOB, LEFT_PLAYER, mLastHitIntensity} );
 		if (handleBlobbyBallCollision(RIGHT_PLAYER))
-			mCallback( MatchEvent{MatchEvent::BALL_HIT_BLOB, RIGHT_PLAYER, mLastHitIntensity} );
+			pushEvent( MatchEvent{MatchEvent::BALL_HIT_BLOB, RIGHT_PLAYER, mLastHitIntensity} );
 	}
 
 	handleBallWorldCollisions();
@@ -282,7 +286,7 @@ void PhysicWorld::handleBallWorldCollisions()
 		mBallVelocity = mBallVelocity.reflectY();
 		mBallVelocity = mBallVelocity.scale(0.95);
 		mBallPosition.y = GROUND_PLANE_HEIGHT_MAX - BALL_RADIUS;
-		mCallback( MatchEvent{MatchEvent::BALL_HIT_GROUND, mBallPosition.x > NET_POSITION_X ? RIGHT_PLAYER : LEFT_PLAYER, 0} );
+		pushEvent( MatchEvent{MatchEvent::BALL_HIT_GROUND, mBallPosition.x > NET_POSITION_X ? RIGHT_PLAYER : LEFT_PLAYER, 0} );
 	}
 
 	// Border Collision
@@ -291,14 +295,14 @@ void PhysicWorld::handleBallWorldCollisions()
 		mBallVelocity = mBallVelocity.reflectX();
 		// set the ball's position
 		mBallPosition.x = LEFT_PLANE + BALL_RADIUS;
-		mCallback( MatchEvent{MatchEvent::BALL_HIT_WALL, LEFT_PLAYER, 0} );
+		pushEvent( MatchEvent{MatchEvent::BALL_HIT_WALL, LEFT_PLAYER, 0} );
 	}
 	else if (mBallPosition.x + BALL_RADIUS >= RIGHT_PLANE && mBallVelocity.x > 0.0)
 	{
 		mBallVelocity = mBallVelocity.reflectX();
 		// set the ball's position
 		mBallPosition.x = RIGHT_PLANE - BALL_RADIUS;
-		mCallback( MatchEvent{MatchEvent::BALL_HIT_WALL, RIGHT_PLAYER, 0} );
+		pushEvent( MatchEvent{MatchEvent::BALL_HIT_WALL, RIGHT_PLAYER, 0} );
 	}
 	else if (mBallPosition.y > NET_SPHERE_POSITION &&
 			fabs(mBallPosition.x - NET_POSITION_X) < BALL_RADIUS + NET_RADIUS)
@@ -308,7 +312,7 @@ void PhysicWorld::handleBallWorldCollisions()
 		// set the ball's position so that it touches the net
 		mBallPosition.x = NET_POSITION_X + (right ? (BALL_RADIUS + NET_RADIUS) : (-BALL_RADIUS - NET_RADIUS));
 
-		mCallback( MatchEvent{MatchEvent::BALL_HIT_NET, right ? RIGHT_PLAYER : LEFT_PLAYER, 0} );
+		pushEvent( MatchEvent{MatchEvent::BALL_HIT_NET, right ? RIGHT_PLAYER : LEFT_PLAYER, 0} );
 	}
 	else
 	{
@@ -339,11 +343,291 @@ void PhysicWorld::handleBallWorldCollisions()
 			// pushes the ball out of the net
 			mBallPosition = (Vector2(NET_POSITION_X, NET_SPHERE_POSITION) - normal * (NET_RADIUS + BALL_RADIUS));
 
-			mCallback( MatchEvent{MatchEvent::BALL_HIT_NET_TOP, NO_PLAYER, 0} );
+			pushEvent( MatchEvent{MatchEvent::BALL_HIT_NET_TOP, NO_PLAYER, 0} );
 		}
 		// mBallVelocity = mBallVelocity.reflect( Vector2( mBallPosition, Vector2 (NET_POSITION_X, temp) ).normalise()).scale(0.75);
 	}
 }
+
+// constants for the deterministic physics. They are given as raw fixed point values where they
+// are not exactly representable, so they do not depend on compile time floating point arithmetic.
+const Fixed FX_LEFT_PLANE = Fixed::fromInt(0);
+const Fixed FX_RIGHT_PLANE = Fixed::fromInt(800);
+const Fixed FX_BLOBBY_UPPER_SPHERE = Fixed::fromInt(19);
+const Fixed FX_BLOBBY_UPPER_RADIUS = Fixed::fromInt(25);
+const Fixed FX_BLOBBY_LOWER_SPHERE = Fixed::fromInt(13);
+const Fixed FX_BLOBBY_LOWER_RADIUS = Fixed::fromInt(33);
+const Fixed FX_GROUND_PLANE_HEIGHT_MAX = Fixed::fromInt(500);
+const Fixed FX_GROUND_PLANE_HEIGHT = Fixed::fromRaw(1865728);		// 455.5
+const Fixed FX_BLOBBY_JUMP_ACCELERATION = Fixed::fromRaw(-61850);	// -15.1
+const Fixed FX_GRAVITATION = Fixed::fromRaw(3749);					// 0.91524
+const Fixed FX_BLOBBY_JUMP_BUFFER = Fixed::fromRaw(1874);			// 0.45762
+const Fixed FX_BLOBBY_SPEED = Fixed::fromRaw(18432);				// 4.5
+const Fixed FX_BLOBBY_ANIMATION_SPEED = Fixed::fromRaw(2048);		// 0.5
+const Fixed FX_BALL_RADIUS = Fixed::fromRaw(129024);				// 31.5
+const Fixed FX_BALL_GRAVITATION = Fixed::fromRaw(1176);				// 0.287
+const Fixed FX_BALL_COLLISION_VELOCITY = Fixed::fromRaw(53750);		// 13.1225
+const Fixed FX_NET_POSITION_X = Fixed::fromInt(400);
+const Fixed FX_NET_RADIUS = Fixed::fromInt(7);
+const Fixed FX_NET_SPHERE_POSITION = Fixed::fromInt(284);
+const Fixed FX_HALF = Fixed::fromRaw(2048);							// 0.5
+
+inline FixedVector2 toFixed(const Vector2& v)
+{
+	return FixedVector2(Fixed::fromFloat(v.x), Fixed::fromFloat(v.y));
+}
+
+inline Vector2 toFloat(const FixedVector2& v)
+{
+	return Vector2(v.x.toFloat(), v.y.toFloat());
+}
+
+inline bool circleCircleCollisionFixed(const FixedVector2& pos1, Fixed rad1, const FixedVector2& pos2, Fixed rad2)
+{
+	int64_t mxdist = (rad1 + rad2).raw();
+	return (pos1 - pos2).lengthSQRaw() < mxdist * mxdist;
+}
+
+void PhysicWorld::stepDeterministic(const PlayerInput& leftInput, const PlayerInput& rightInput,
+									bool isBallValid, bool isGameRunning)
+{
+	// This follows step() exactly, only with fixed point arithmetic. We work on local copies of the
+	// state and write them back at the end. As the stored floats lie on the fixed point grid, the
+	// conversions are lossless.
+	FixedVector2 blobPosition[MAX_PLAYERS];
+	FixedVector2 blobVelocity[MAX_PLAYERS];
+	Fixed blobState[MAX_PLAYERS];
+	Fixed animationSpeed[MAX_PLAYERS];
+	for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+	{
+		blobPosition[p] = toFixed( mBlobPosition[p] );
+		blobVelocity[p] = toFixed( mBlobVelocity[p] );
+		blobState[p] = Fixed::fromFloat( mBlobState[p] );
+		animationSpeed[p] = Fixed::fromFloat( mCurrentBlobbyAnimationSpeed[p] );
+	}
+
+	FixedVector2 ballPosition = toFixed( mBallPosition );
+	FixedVector2 ballVelocity = toFixed( mBallVelocity );
+	Fixed ballRotation = Fixed::fromFloat( mBallRotation );
+	Fixed ballAngularVelocity = Fixed::fromFloat( mBallAngularVelocity );
+
+	// blobs
+	const PlayerInput* inputs[MAX_PLAYERS] = {&leftInput, &rightInput};
+	for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+	{
+		const PlayerInput& input = *inputs[p];
+		const bool onGround = blobPosition[p].y >= FX_GROUND_PLANE_HEIGHT;
+		bool startAnimation = false;
+
+		Fixed currentBlobbyGravity = FX_GRAVITATION;
+		if (input.up)
+		{
+			if (onGround)
+			{
+				blobVelocity[p].y = FX_BLOBBY_JUMP_ACCELERATION;
+				startAnimation = true;
+			}
+
+			currentBlobbyGravity -= FX_BLOBBY_JUMP_BUFFER;
+		}
+
+		if ((input.left || input.right) && onGround)
+			startAnimation = true;
+
+		blobVelocity[p].x = (input.right ? FX_BLOBBY_SPEED : Fixed()) - (input.left ? FX_BLOBBY_SPEED : Fixed());
+
+		// ds = a/2 * dt^2 + v * dt
+		blobPosition[p] = blobPosition[p] + FixedVector2(Fixed(), currentBlobbyGravity * FX_HALF) + blobVelocity[p];
+		// dv = a * dt
+		blobVelocity[p].y += currentBlobbyGravity;
+
+		// Hitting the ground
+		if (blobPosition[p].y > FX_GROUND_PLANE_HEIGHT)
+		{
+			if(blobVelocity[p].y > Fixed::fromRaw(14336))	// 3.5
+				startAnimation = true;
+
+			blobPosition[p].y = FX_GROUND_PLANE_HEIGHT;
+			blobVelocity[p].y = Fixed();
+		}
+
+		// animation
+		if (startAnimation && animationSpeed[p] == Fixed())
+			animationSpeed[p] = FX_BLOBBY_ANIMATION_SPEED;
+
+		if (blobState[p] < Fixed())
+		{
+			animationSpeed[p] = Fixed();
+			blobState[p] = Fixed();
+		}
+
+		if (blobState[p] >= Fixed::fromRaw(18432))	// 4.5
+			animationSpeed[p] = -FX_BLOBBY_ANIMATION_SPEED;
+
+		blobState[p] += animationSpeed[p];
+
+		if (blobState[p] >= Fixed::fromInt(5))
+			blobState[p] = Fixed::fromRaw(20439);	// 4.99
+	}
+
+	// Move ball when game is running
+	if (isGameRunning)
+	{
+		ballPosition = ballPosition + FixedVector2(Fixed(), FX_BALL_GRAVITATION * FX_HALF) + ballVelocity;
+		ballVelocity.y += FX_BALL_GRAVITATION;
+	}
+
+	// Collision detection
+	if(isBallValid)
+	{
+		for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+		{
+			FixedVector2 circlepos = blobPosition[p];
+			if(circleCircleCollisionFixed(ballPosition, FX_BALL_RADIUS,
+					FixedVector2(circlepos.x, circlepos.y + FX_BLOBBY_LOWER_SPHERE), FX_BLOBBY_LOWER_RADIUS))
+			{
+				circlepos.y += FX_BLOBBY_LOWER_SPHERE;
+			}
+			else if(circleCircleCollisionFixed(ballPosition, FX_BALL_RADIUS,
+					FixedVector2(circlepos.x, circlepos.y - FX_BLOBBY_UPPER_SPHERE), FX_BLOBBY_UPPER_RADIUS))
+			{
+				circlepos.y -= FX_BLOBBY_LOWER_SPHERE;
+			}
+			else
+			{
+				continue;
+			}
+
+			// calculate hit intensity
+			Fixed intensity = (ballVelocity - blobVelocity[p]).length() / Fixed::fromInt(25);
+			intensity = intensity > Fixed::fromInt(1) ? Fixed::fromInt(1) : intensity;
+			mLastHitIntensity = intensity.toFloat();
+
+			// set ball velocity
+			ballVelocity = (ballPosition - circlepos).withLength(FX_BALL_COLLISION_VELOCITY);
+			ballPosition = ballPosition + ballVelocity;
+
+			pushEvent( MatchEvent{MatchEvent::BALL_HIT_BLOB, (PlayerSide)p, mLastHitIntensity} );
+		}
+	}
+
+	// Ball to ground Collision
+	if (ballPosition.y + FX_BALL_RADIUS > FX_GROUND_PLANE_HEIGHT_MAX)
+	{
+		ballVelocity.y = -ballVelocity.y;
+		ballVelocity = ballVelocity * Fixed::fromRaw(3891);	// 0.95
+		ballPosition.y = FX_GROUND_PLANE_HEIGHT_MAX - FX_BALL_RADIUS;
+		pushEvent( MatchEvent{MatchEvent::BALL_HIT_GROUND, ballPosition.x > FX_NET_POSITION_X ? RIGHT_PLAYER : LEFT_PLAYER, 0} );
+	}
+
+	// Border Collision
+	if (ballPosition.x - FX_BALL_RADIUS <= FX_LEFT_PLANE && ballVelocity.x < Fixed())
+	{
+		ballVelocity.x = -ballVelocity.x;
+		ballPosition.x = FX_LEFT_PLANE + FX_BALL_RADIUS;
+		pushEvent( MatchEvent{MatchEvent::BALL_HIT_WALL, LEFT_PLAYER, 0} );
+	}
+	else if (ballPosition.x + FX_BALL_RADIUS >= FX_RIGHT_PLANE && ballVelocity.x > Fixed())
+	{
+		ballVelocity.x = -ballVelocity.x;
+		ballPosition.x = FX_RIGHT_PLANE - FX_BALL_RADIUS;
+		pushEvent( MatchEvent{MatchEvent::BALL_HIT_WALL, RIGHT_PLAYER, 0} );
+	}
+	else if (ballPosition.y > FX_NET_SPHERE_POSITION &&
+			(ballPosition.x - FX_NET_POSITION_X < FX_BALL_RADIUS + FX_NET_RADIUS) &&
+			(FX_NET_POSITION_X - ballPosition.x < FX_BALL_RADIUS + FX_NET_RADIUS))
+	{
+		bool right = ballPosition.x - FX_NET_POSITION_X > Fixed();
+		ballVelocity.x = -ballVelocity.x;
+		// set the ball's position so that it touches the net
+		ballPosition.x = FX_NET_POSITION_X + (right ? (FX_BALL_RADIUS + FX_NET_RADIUS) : -(FX_BALL_RADIUS + FX_NET_RADIUS));
+
+		pushEvent( MatchEvent{MatchEvent::BALL_HIT_NET, right ? RIGHT_PLAYER : LEFT_PLAYER, 0} );
+	}
+	else
+	{
+		// Net Collisions
+		const FixedVector2 netSphere(FX_NET_POSITION_X, FX_NET_SPHERE_POSITION);
+		FixedVector2 toNet = netSphere - ballPosition;
+
+		if (circleCircleCollisionFixed(ballPosition, FX_BALL_RADIUS, netSphere, FX_NET_RADIUS))
+		{
+			FixedVector2 normal = toNet.withLength( Fixed::fromInt(1) );
+
+			// normal component of kinetic energy
+			Fixed perp_ekin = normal.dotProduct(ballVelocity);
+			perp_ekin *= perp_ekin;
+			// parallel component of kinetic energy
+			Fixed para_ekin = Fixed::fromProduct( ballVelocity.lengthSQRaw() ) - perp_ekin;
+
+			perp_ekin *= Fixed::fromRaw(2867);	// 0.7
+			para_ekin *= Fixed::fromRaw(3686);	// 0.9
+
+			Fixed nspeed = Fixed::sqrt(perp_ekin + para_ekin);
+
+			ballVelocity = ballVelocity.reflect(normal).withLength(nspeed);
+
+			// pushes the ball out of the net
+			ballPosition = netSphere - normal * (FX_NET_RADIUS + FX_BALL_RADIUS);
+
+			pushEvent( MatchEvent{MatchEvent::BALL_HIT_NET_TOP, NO_PLAYER, 0} );
+		}
+	}
+
+	// Collision between blobby and the net
+	if (blobPosition[LEFT_PLAYER].x + FX_BLOBBY_LOWER_RADIUS > FX_NET_POSITION_X - FX_NET_RADIUS)
+		blobPosition[LEFT_PLAYER].x = FX_NET_POSITION_X - FX_NET_RADIUS - FX_BLOBBY_LOWER_RADIUS;
+
+	if (blobPosition[RIGHT_PLAYER].x - FX_BLOBBY_LOWER_RADIUS < FX_NET_POSITION_X + FX_NET_RADIUS)
+		blobPosition[RIGHT_PLAYER].x = FX_NET_POSITION_X + FX_NET_RADIUS + FX_BLOBBY_LOWER_RADIUS;
+
+	// Collision between blobby and the border
+	if (blobPosition[LEFT_PLAYER].x < FX_LEFT_PLANE)
+		blobPosition[LEFT_PLAYER].x = FX_LEFT_PLANE;
+
+	if (blobPosition[RIGHT_PLAYER].x > FX_RIGHT_PLANE)
+		blobPosition[RIGHT_PLAYER].x = FX_RIGHT_PLANE;
+
+	// Velocity Integration
+	if( !isGameRunning )
+		ballRotation -= ballAngularVelocity;
+	else if (ballVelocity.x > Fixed())
+		ballRotation += ballAngularVelocity * (ballVelocity.length() / Fixed::fromInt(6));
+	else
+		ballRotation -= ballAngularVelocity * (ballVelocity.length() / Fixed::fromInt(6));
+
+	// Overflow-Protection
+	const Fixed fullRotation = Fixed::fromRaw(25600);	// 6.25
+	if (ballRotation <= Fixed())
+		ballRotation += fullRotation;
+	else if (ballRotation >= fullRotation)
+		ballRotation -= fullRotation;
+
+	// write back the state
+	for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+	{
+		mBlobPosition[p] = toFloat( blobPosition[p] );
+		mBlobVelocity[p] = toFloat( blobVelocity[p] );
+		mBlobState[p] = blobState[p].toFloat();
+		mCurrentBlobbyAnimationSpeed[p] = animationSpeed[p].toFloat();
+	}
+
+	mBallPosition = toFloat( ballPosition );
+	mBallVelocity = toFloat( ballVelocity );
+	mBallRotation = ballRotation.toFloat();
+	mBallAngularVelocity = ballAngularVelocity.toFloat();
+}
+
+void PhysicWorld::setDeterministic(bool deterministic)
+{
+	mDeterministic = deterministic;
+}
+
+bool PhysicWorld::isDeterministic() const
+{
+	return mDeterministic;
+}
+
 Vector2 PhysicWorld::getBallPosition() const
 {
 	return mBallPosition;
@@ -374,6 +658,12 @@ void PhysicWorld::setBallAngularVelocity( float angvel )
 PhysicState PhysicWorld::getState() const
 {
 	PhysicState st;
+	getState(st);
+	return st;
+}
+
+void PhysicWorld::getState(PhysicState& st) const
+{
 	st.blobPosition[LEFT_PLAYER] = mBlobPosition[LEFT_PLAYER];
 	st.blobPosition[RIGHT_PLAYER] = mBlobPosition[RIGHT_PLAYER];
 	st.blobVelocity[LEFT_PLAYER] = mBlobVelocity[LEFT_PLAYER];
@@ -385,7 +675,6 @@ PhysicState PhysicWorld::getState() const
 	st.ballVelocity = mBallVelocity;
 	st.ballRotation = mBallRotation;
 	st.ballAngularVelocity = mBallAngularVelocity;
-	return st;
 }
 
 void PhysicWorld::setState(const PhysicState& ps)
@@ -403,12 +692,12 @@ void PhysicWorld::setState(const PhysicState& ps)
 	mBallAngularVelocity = ps.ballAngularVelocity;
 }
 
-void PhysicWorld::setEventCallback( event_callback_fn cb )
+void PhysicWorld::setEventBuffer( MatchEventBuffer* events )
 {
-	mCallback = std::move(cb);
+	mEvents = events;
 }
 
-inline short set_fpu_single_precision()
+short set_fpu_single_precision()
 {
 	short fl = 0;
 	#if defined(i386) || defined(__x86_64) // We need to set a precision for diverse x86 hardware
@@ -26,7 +26,6 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "BlobbyDebug.h"
 #include "PhysicState.h"
 #include "MatchEvents.h"
-#include <functional>	// for std::function used for the callback
 
 /*! \brief blobby world
 	\details This class encapuslates the physical world where blobby happens. It manages the two blobs,
@@ -34,15 +33,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 class PhysicWorld : public ObjectCounter<PhysicWorld>
 {
-	// callback function type
-	typedef std::function<void(MatchEvent)> event_callback_fn;
-
 	public:
 		PhysicWorld();
 		~PhysicWorld();
 
-		// set the callback
-		void setEventCallback( event_callback_fn );
+		/// sets the buffer the physic events are appended to. The events are discarded if \p events is null.
+		/// The buffer is never cleared by the world.
+		void setEventBuffer( MatchEventBuffer* events );
 
 		// ball information queries
 		Vector2 getBallPosition() const;
@@ -63,8 +60,19 @@ class PhysicWorld : public ObjectCounter<PhysicWorld>
 		void step(const PlayerInput& leftInput, const PlayerInput& rightInput,
 					bool isBallValid, bool isGameRunning);
 
+		/// \brief switches between floating point and deterministic physics
+		/// \details The deterministic physics use fixed point arithmetic with explicitly specified rounding,
+		///			so a sequence of inputs leads to exactly the same states on every platform and with every
+		///			compiler. The state is still reported as floats, but these lie on the fixed point grid.
+		///			The game plays almost, but not exactly, the same as with floating point physics, so both
+		///			sides of a lockstep simulation or a replay have to use the same mode.
+		void setDeterministic(bool deterministic);
+		bool isDeterministic() const;
+
 		// gets the physic state
 		PhysicState getState() const;
+		/// writes the physic state into \p state
+		void getState(PhysicState& state) const;
 
 		// sets a new physic state
 		void setState(const PhysicState& state);
@@ -89,6 +97,16 @@ class PhysicWorld : public ObjectCounter<PhysicWorld>
 		// calculate ball impacts vs wall, ground and net
 		void handleBallWorldCollisions();
 
+		void pushEvent(const MatchEvent& event)
+		{
+			if(mEvents)
+				mEvents->push_back(event);
+		}
+
+		// step implementation for the deterministic mode
+		void stepDeterministic(const PlayerInput& leftInput, const PlayerInput& rightInput,
+								bool isBallValid, bool isGameRunning);
+
 		Vector2 mBlobPosition[MAX_PLAYERS];
 		Vector2 mBallPosition;
 
@@ -102,8 +120,14 @@ class PhysicWorld : public ObjectCounter<PhysicWorld>
 
 		float mLastHitIntensity;
 
-		event_callback_fn mCallback;
+		bool mDeterministic;
+
+		MatchEventBuffer* mEvents;
 };
 
+// helper functions for setting FPU precision, so the physics are computed deterministically
+short set_fpu_single_precision();
+void reset_fpu_flags(short flags);
+
 
 
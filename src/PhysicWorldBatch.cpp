@@ -0,0 +1,473 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "PhysicWorldBatch.h"
+
+/* includes */
+#include <algorithm>
+#include <cmath>
+
+#include "GameConstants.h"
+#include "PhysicWorld.h"
+
+/* implementation */
+
+// All computations in this file have to be done exactly as in PhysicWorld.cpp, including the order of
+// operations and the implicit float/double conversions, otherwise the results are no longer bit-identical.
+// The rarely taken collision branches therefore use the same Vector2 expressions as PhysicWorld.
+
+const float BLOBBY_ANIMATION_SPEED = 0.5;
+
+PhysicWorldBatch::PhysicWorldBatch(unsigned int count)
+: mCount(0)
+{
+	resize(count);
+}
+
+PhysicWorldBatch::~PhysicWorldBatch() = default;
+
+void PhysicWorldBatch::resize(unsigned int count)
+{
+	for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+	{
+		mBlobPositionX[p].resize(count);
+		mBlobPositionY[p].resize(count);
+		mBlobVelocityX[p].resize(count);
+		mBlobVelocityY[p].resize(count);
+		mBlobState[p].resize(count);
+		mCurrentBlobbyAnimationSpeed[p].resize(count);
+	}
+
+	mBallPositionX.resize(count);
+	mBallPositionY.resize(count);
+	mBallVelocityX.resize(count);
+	mBallVelocityY.resize(count);
+	mBallRotation.resize(count);
+	mBallAngularVelocity.resize(count);
+	mEvents.resize(count, nullptr);
+
+	for(unsigned int i = mCount; i < count; ++i)
+		resetWorld(i);
+
+	mCount = count;
+}
+
+void PhysicWorldBatch::resetWorld(unsigned int world)
+{
+	// this mirrors PhysicWorld::PhysicWorld
+	PhysicWorld initial;
+	setState(world, initial.getState());
+	mCurrentBlobbyAnimationSpeed[LEFT_PLAYER][world] = 0.0;
+	mCurrentBlobbyAnimationSpeed[RIGHT_PLAYER][world] = 0.0;
+}
+
+void PhysicWorldBatch::setEventBuffer( unsigned int world, MatchEventBuffer* events )
+{
+	mEvents[world] = events;
+}
+
+void PhysicWorldBatch::step(const StepInput* inputs)
+{
+	// Determistic IEEE 754 floating point computations
+	short fpf = set_fpu_single_precision();
+
+	// Compute independent actions
+	handleBlobs(LEFT_PLAYER, inputs);
+	handleBlobs(RIGHT_PLAYER, inputs);
+
+	moveBalls(inputs);
+
+	handleBlobbyBallCollisions(inputs);
+
+	handleBallWorldCollisions();
+
+	clampBlobs();
+
+	rotateBalls(inputs);
+
+	reset_fpu_flags(fpf);
+}
+
+void PhysicWorldBatch::handleBlobs(PlayerSide player, const StepInput* inputs)
+{
+	float* posX = mBlobPositionX[player].data();
+	float* posY = mBlobPositionY[player].data();
+	float* velX = mBlobVelocityX[player].data();
+	float* velY = mBlobVelocityY[player].data();
+	float* state = mBlobState[player].data();
+	float* anim = mCurrentBlobbyAnimationSpeed[player].data();
+
+	for(unsigned int i = 0; i < mCount; ++i)
+	{
+		// this is PhysicWorld::handleBlob, written with selects instead of branches,
+		// so the compiler can vectorize this loop
+		const bool up = inputs[i].input[player].up;
+		const bool left = inputs[i].input[player].left;
+		const bool right = inputs[i].input[player].right;
+		const bool onGround = posY[i] >= GROUND_PLANE_HEIGHT;
+		const bool jump = up & onGround;
+
+		// whether the blobby animation is started in this frame
+		bool start = jump | ((left | right) & onGround);
+
+		const float currentBlobbyGravity = up ? GRAVITATION - BLOBBY_JUMP_BUFFER : GRAVITATION;
+		float vy = jump ? BLOBBY_JUMP_ACCELERATION : velY[i];
+		const float vx = (right ? BLOBBY_SPEED : 0) - (left ? BLOBBY_SPEED : 0);
+
+		// compute blobby fall movement (dt = 1)
+		// ds = a/2 * dt^2 + v * dt
+		posX[i] += 0.f + vx;
+		float py = posY[i] + (0.5f * currentBlobbyGravity + vy);
+		// dv = a * dt
+		vy += currentBlobbyGravity;
+
+		// Hitting the ground
+		const bool landed = py > GROUND_PLANE_HEIGHT;
+		start = start | (landed & (vy > 3.5));
+		posY[i] = landed ? GROUND_PLANE_HEIGHT : py;
+		velY[i] = landed ? 0.f : vy;
+		velX[i] = vx;
+
+		// starting the animation more than once per frame has no additional effect
+		float speed = (start & (anim[i] == 0)) ? BLOBBY_ANIMATION_SPEED : anim[i];
+
+		// animation step
+		float st = state[i];
+		speed = st < 0.0 ? 0 : speed;
+		st = st < 0.0 ? 0 : st;
+		speed = st >= 4.5 ? -BLOBBY_ANIMATION_SPEED : speed;
+		st += speed;
+
+		anim[i] = speed;
+		state[i] = st >= 5 ? 4.99f : st;
+	}
+}
+
+void PhysicWorldBatch::moveBalls(const StepInput* inputs)
+{
+	float* posX = mBallPositionX.data();
+	float* posY = mBallPositionY.data();
+	float* velX = mBallVelocityX.data();
+	float* velY = mBallVelocityY.data();
+
+	for(unsigned int i = 0; i < mCount; ++i)
+	{
+		// Move ball when game is running
+		if (inputs[i].isGameRunning)
+		{
+			// dt = 1 !!
+			// move ball ds = a/2 * dt^2 + v * dt
+			posX[i] += 0.f + velX[i];
+			posY[i] += 0.5f * BALL_GRAVITATION + velY[i];
+			// dv = a*dt
+			velY[i] += BALL_GRAVITATION;
+		}
+	}
+}
+
+void PhysicWorldBatch::handleBlobbyBallCollisions(const StepInput* inputs)
+{
+	// A ball that is farther away from a blob than this can not touch it. The additional margin
+	// makes sure that this coarse test never rejects a collision the exact test would find.
+	const float reachX = BALL_RADIUS + std::max(BLOBBY_LOWER_RADIUS, BLOBBY_UPPER_RADIUS) + 1;
+	const float reachUp = BALL_RADIUS + BLOBBY_UPPER_SPHERE + BLOBBY_UPPER_RADIUS + 1;
+	const float reachDown = BALL_RADIUS + BLOBBY_LOWER_SPHERE + BLOBBY_LOWER_RADIUS + 1;
+
+	// the left player is handled first for all worlds, so within each world
+	// the order is the same as in PhysicWorld::step
+	for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+	{
+		const float* blobX = mBlobPositionX[p].data();
+		const float* blobY = mBlobPositionY[p].data();
+		const float* ballX = mBallPositionX.data();
+		const float* ballY = mBallPositionY.data();
+
+		for(unsigned int i = 0; i < mCount; ++i)
+		{
+			if (std::fabs(ballX[i] - blobX[i]) < reachX &&
+				ballY[i] > blobY[i] - reachUp && ballY[i] < blobY[i] + reachDown &&
+				inputs[i].isBallValid)
+			{
+				handleBlobbyBallCollision(i, (PlayerSide)p);
+			}
+		}
+	}
+}
+
+bool PhysicWorldBatch::handleBlobbyBallCollision(unsigned int world, PlayerSide player)
+{
+	const Vector2 ballPosition{mBallPositionX[world], mBallPositionY[world]};
+	const Vector2 blobPosition{mBlobPositionX[player][world], mBlobPositionY[player][world]};
+
+	Vector2 circlepos = blobPosition;
+	// check for impact
+	if(PhysicWorld::circleCircleCollision(ballPosition, BALL_RADIUS,
+			Vector2{blobPosition.x, blobPosition.y + BLOBBY_LOWER_SPHERE}, BLOBBY_LOWER_RADIUS))
+	{
+		circlepos.y += BLOBBY_LOWER_SPHERE;
+	}
+	else if(PhysicWorld::circleCircleCollision(ballPosition, BALL_RADIUS,
+			Vector2{blobPosition.x, blobPosition.y - BLOBBY_UPPER_SPHERE}, BLOBBY_UPPER_RADIUS))
+	{
+		circlepos.y -= BLOBBY_LOWER_SPHERE;
+	} else
+	{	// no impact!
+		return false;
+	}
+
+	Vector2 ballVelocity{mBallVelocityX[world], mBallVelocityY[world]};
+	const Vector2 blobVelocity{mBlobVelocityX[player][world], mBlobVelocityY[player][world]};
+
+	// calculate hit intensity
+	float hitIntensity = Vector2(ballVelocity, blobVelocity).length() / 25.0;
+	hitIntensity = hitIntensity > 1.0 ? 1.0 : hitIntensity;
+
+	// set ball velocity
+	ballVelocity = -Vector2(ballPosition, circlepos);
+	ballVelocity = ballVelocity.normalise();
+	ballVelocity = ballVelocity.scale(BALL_COLLISION_VELOCITY);
+	Vector2 newPosition = ballPosition;
+	newPosition += ballVelocity;
+
+	mBallPositionX[world] = newPosition.x;
+	mBallPositionY[world] = newPosition.y;
+	mBallVelocityX[world] = ballVelocity.x;
+	mBallVelocityY[world] = ballVelocity.y;
+
+	pushEvent( world, MatchEvent{MatchEvent::BALL_HIT_BLOB, player, hitIntensity} );
+	return true;
+}
+
+void PhysicWorldBatch::handleBallWorldCollisions()
+{
+	const float* posX = mBallPositionX.data();
+	const float* posY = mBallPositionY.data();
+	const float* velX = mBallVelocityX.data();
+
+	// coarse test for the net sphere, with a margin so it never rejects an actual collision
+	const float netReach = NET_RADIUS + BALL_RADIUS + 1;
+
+	for(unsigned int i = 0; i < mCount; ++i)
+	{
+		// most of the time, the ball is in free flight, so we only do the exact
+		// computations if the ball is close to the ground, a wall or the net.
+		if (posY[i] + BALL_RADIUS > GROUND_PLANE_HEIGHT_MAX ||
+			(posX[i] - BALL_RADIUS <= LEFT_PLANE && velX[i] < 0.0) ||
+			(posX[i] + BALL_RADIUS >= RIGHT_PLANE && velX[i] > 0.0) ||
+			(std::fabs(posX[i] - NET_POSITION_X) < netReach && posY[i] > NET_SPHERE_POSITION - netReach))
+		{
+			handleBallWorldCollision(i);
+		}
+	}
+}
+
+void PhysicWorldBatch::handleBallWorldCollision(unsigned int world)
+{
+	Vector2 ballPosition{mBallPositionX[world], mBallPositionY[world]};
+	Vector2 ballVelocity{mBallVelocityX[world], mBallVelocityY[world]};
+
+	// Ball to ground Collision
+	if (ballPosition.y + BALL_RADIUS > GROUND_PLANE_HEIGHT_MAX)
+	{
+		ballVelocity = ballVelocity.reflectY();
+		ballVelocity = ballVelocity.scale(0.95);
+		ballPosition.y = GROUND_PLANE_HEIGHT_MAX - BALL_RADIUS;
+		pushEvent( world, MatchEvent{MatchEvent::BALL_HIT_GROUND, ballPosition.x > NET_POSITION_X ? RIGHT_PLAYER : LEFT_PLAYER, 0} );
+	}
+
+	// Border Collision
+	if (ballPosition.x - BALL_RADIUS <= LEFT_PLANE && ballVelocity.x < 0.0)
+	{
+		ballVelocity = ballVelocity.reflectX();
+		// set the ball's position
+		ballPosition.x = LEFT_PLANE + BALL_RADIUS;
+		pushEvent( world, MatchEvent{MatchEvent::BALL_HIT_WALL, LEFT_PLAYER, 0} );
+	}
+	else if (ballPosition.x + BALL_RADIUS >= RIGHT_PLANE && ballVelocity.x > 0.0)
+	{
+		ballVelocity = ballVelocity.reflectX();
+		// set the ball's position
+		ballPosition.x = RIGHT_PLANE - BALL_RADIUS;
+		pushEvent( world, MatchEvent{MatchEvent::BALL_HIT_WALL, RIGHT_PLAYER, 0} );
+	}
+	else if (ballPosition.y > NET_SPHERE_POSITION &&
+			fabs(ballPosition.x - NET_POSITION_X) < BALL_RADIUS + NET_RADIUS)
+	{
+		bool right = ballPosition.x - NET_POSITION_X > 0;
+		ballVelocity = ballVelocity.reflectX();
+		// set the ball's position so that it touches the net
+		ballPosition.x = NET_POSITION_X + (right ? (BALL_RADIUS + NET_RADIUS) : (-BALL_RADIUS - NET_RADIUS));
+
+		pushEvent( world, MatchEvent{MatchEvent::BALL_HIT_NET, right ? RIGHT_PLAYER : LEFT_PLAYER, 0} );
+	}
+	else
+	{
+		// Net Collisions
+		float ballNetDistance = Vector2(ballPosition, Vector2(NET_POSITION_X, NET_SPHERE_POSITION)).length();
+
+		if (ballNetDistance < NET_RADIUS + BALL_RADIUS)
+		{
+			Vector2 normal = Vector2(ballPosition,	Vector2(NET_POSITION_X, NET_SPHERE_POSITION)).normalise();
+
+			// normal component of kinetic energy
+			float perp_ekin = normal.dotProduct(ballVelocity);
+			perp_ekin *= perp_ekin;
+			// parallel component of kinetic energy
+			float para_ekin = ballVelocity.length() * ballVelocity.length() - perp_ekin;
+
+			perp_ekin *= 0.7;
+			para_ekin *= 0.9;
+
+			float nspeed = sqrt(perp_ekin + para_ekin);
+
+			ballVelocity = Vector2(ballVelocity.reflect(normal).normalise().scale(nspeed));
+
+			// pushes the ball out of the net
+			ballPosition = (Vector2(NET_POSITION_X, NET_SPHERE_POSITION) - normal * (NET_RADIUS + BALL_RADIUS));
+
+			pushEvent( world, MatchEvent{MatchEvent::BALL_HIT_NET_TOP, NO_PLAYER, 0} );
+		}
+	}
+
+	mBallPositionX[world] = ballPosition.x;
+	mBallPositionY[world] = ballPosition.y;
+	mBallVelocityX[world] = ballVelocity.x;
+	mBallVelocityY[world] = ballVelocity.y;
+}
+
+void PhysicWorldBatch::clampBlobs()
+{
+	float* leftX = mBlobPositionX[LEFT_PLAYER].data();
+	float* rightX = mBlobPositionX[RIGHT_PLAYER].data();
+
+	for(unsigned int i = 0; i < mCount; ++i)
+	{
+		// Collision between blobby and the net
+		if (leftX[i] + BLOBBY_LOWER_RADIUS > NET_POSITION_X - NET_RADIUS)
+			leftX[i] = NET_POSITION_X - NET_RADIUS - BLOBBY_LOWER_RADIUS;
+
+		if (rightX[i] - BLOBBY_LOWER_RADIUS < NET_POSITION_X + NET_RADIUS)
+			rightX[i] = NET_POSITION_X + NET_RADIUS + BLOBBY_LOWER_RADIUS;
+
+		// Collision between blobby and the border
+		if (leftX[i] < LEFT_PLANE)
+			leftX[i] = LEFT_PLANE;
+
+		if (rightX[i] > RIGHT_PLANE)
+			rightX[i] = RIGHT_PLANE;
+	}
+}
+
+void PhysicWorldBatch::rotateBalls(const StepInput* inputs)
+{
+	const float* velX = mBallVelocityX.data();
+	const float* velY = mBallVelocityY.data();
+	float* rotation = mBallRotation.data();
+	const float* angular = mBallAngularVelocity.data();
+
+	for(unsigned int i = 0; i < mCount; ++i)
+	{
+		// Velocity Integration
+		// written as selects instead of branches, so this loop can be vectorized
+		float rollSpeed = angular[i] * (Vector2(velX[i], velY[i]).length() / 6);
+		const bool running = inputs[i].isGameRunning;
+		float delta = !running ? -angular[i] : (velX[i] > 0.0 ? rollSpeed : -rollSpeed);
+		float rot = rotation[i] + delta;
+
+		// Overflow-Protection
+		float wrapped = rot <= 0 ? 6.25 + rot : rot - 6.25;
+		rotation[i] = ((rot <= 0) | (rot >= 6.25)) ? wrapped : rot;
+	}
+}
+
+PhysicState PhysicWorldBatch::getState(unsigned int world) const
+{
+	PhysicState st;
+	for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+	{
+		st.blobPosition[p] = Vector2(mBlobPositionX[p][world], mBlobPositionY[p][world]);
+		st.blobVelocity[p] = Vector2(mBlobVelocityX[p][world], mBlobVelocityY[p][world]);
+		st.blobState[p] = mBlobState[p][world];
+	}
+
+	st.ballPosition = getBallPosition(world);
+	st.ballVelocity = getBallVelocity(world);
+	st.ballRotation = mBallRotation[world];
+	st.ballAngularVelocity = mBallAngularVelocity[world];
+	return st;
+}
+
+void PhysicWorldBatch::setState(unsigned int world, const PhysicState& ps)
+{
+	for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+	{
+		mBlobPositionX[p][world] = ps.blobPosition[p].x;
+		mBlobPositionY[p][world] = ps.blobPosition[p].y;
+		mBlobVelocityX[p][world] = ps.blobVelocity[p].x;
+		mBlobVelocityY[p][world] = ps.blobVelocity[p].y;
+		mBlobState[p][world] = ps.blobState[p];
+	}
+
+	setBallPosition(world, ps.ballPosition);
+	setBallVelocity(world, ps.ballVelocity);
+	mBallRotation[world] = ps.ballRotation;
+	mBallAngularVelocity[world] = ps.ballAngularVelocity;
+}
+
+Vector2 PhysicWorldBatch::getBallPosition(unsigned int world) const
+{
+	return Vector2(mBallPositionX[world], mBallPositionY[world]);
+}
+
+void PhysicWorldBatch::setBallPosition(unsigned int world, Vector2 newPosition)
+{
+	mBallPositionX[world] = newPosition.x;
+	mBallPositionY[world] = newPosition.y;
+}
+
+Vector2 PhysicWorldBatch::getBallVelocity(unsigned int world) const
+{
+	return Vector2(mBallVelocityX[world], mBallVelocityY[world]);
+}
+
+void PhysicWorldBatch::setBallVelocity(unsigned int world, Vector2 newVelocity)
+{
+	mBallVelocityX[world] = newVelocity.x;
+	mBallVelocityY[world] = newVelocity.y;
+}
+
+void PhysicWorldBatch::setBallAngularVelocity(unsigned int world, float angvel)
+{
+	mBallAngularVelocity[world] = angvel;
+}
+
+Vector2 PhysicWorldBatch::getBlobPosition(unsigned int world, PlayerSide player) const
+{
+	return Vector2(mBlobPositionX[player][world], mBlobPositionY[player][world]);
+}
+
+bool PhysicWorldBatch::blobHitGround(unsigned int world, PlayerSide player) const
+{
+	if (player == LEFT_PLAYER || player == RIGHT_PLAYER)
+		return mBlobPositionY[player][world] >= GROUND_PLANE_HEIGHT;
+	else
+		return false;
+}
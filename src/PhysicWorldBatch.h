@@ -0,0 +1,125 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <vector>
+
+#include "Global.h"
+#include "Vector.h"
+#include "PlayerInput.h"
+#include "BlobbyDebug.h"
+#include "PhysicState.h"
+#include "MatchEvents.h"
+
+/*! \brief many blobby worlds, stepped together
+	\details This class simulates a whole batch of independent worlds with exactly the same rules as
+			the floating point mode of PhysicWorld. The state is stored in structure-of-arrays layout,
+			i.e. one contiguous array per physical quantity, and every phase of the simulation runs as
+			a loop over all worlds, so the compiler can vectorize the branch free parts.
+			Stepping a world in the batch gives bit-identical results to PhysicWorld::step with the same
+			inputs, so both can be mixed freely, e.g. by moving states around with getState/setState.
+*/
+class PhysicWorldBatch : public ObjectCounter<PhysicWorldBatch>
+{
+	public:
+		/// input for a single world for one step
+		struct StepInput
+		{
+			PlayerInput input[MAX_PLAYERS];
+			bool isBallValid = true;
+			bool isGameRunning = true;
+		};
+
+		/// creates \p count worlds, each in the same state as a freshly constructed PhysicWorld
+		explicit PhysicWorldBatch(unsigned int count);
+		~PhysicWorldBatch();
+
+		/// number of worlds in this batch
+		unsigned int size() const { return mCount; }
+
+		/// changes the number of worlds. New worlds are in initial state.
+		void resize(unsigned int count);
+
+		/// sets the buffer the physic events of world \p world are appended to, as PhysicWorld::setEventBuffer.
+		/// The events are discarded if \p events is null, which is the default for all worlds.
+		void setEventBuffer( unsigned int world, MatchEventBuffer* events );
+
+		/// steps all worlds. \p inputs has to point to size() elements.
+		/// Important: This assumes a fixed framerate of 60 FPS!
+		void step(const StepInput* inputs);
+
+		// state access for single worlds
+		PhysicState getState(unsigned int world) const;
+		void setState(unsigned int world, const PhysicState& state);
+
+		// ball information queries
+		Vector2 getBallPosition(unsigned int world) const;
+		void setBallPosition(unsigned int world, Vector2 newPosition);
+		Vector2 getBallVelocity(unsigned int world) const;
+		void setBallVelocity(unsigned int world, Vector2 newVelocity);
+		void setBallAngularVelocity(unsigned int world, float angvel);
+
+		// blobby information queries
+		Vector2 getBlobPosition(unsigned int world, PlayerSide player) const;
+		bool blobHitGround(unsigned int world, PlayerSide player) const;
+
+	private:
+		// the individual phases of a step. They are run for all worlds before the next phase starts.
+		void handleBlobs(PlayerSide player, const StepInput* inputs);
+		void moveBalls(const StepInput* inputs);
+		void handleBlobbyBallCollisions(const StepInput* inputs);
+		void handleBallWorldCollisions();
+		void clampBlobs();
+		void rotateBalls(const StepInput* inputs);
+
+		bool handleBlobbyBallCollision(unsigned int world, PlayerSide player);
+		void handleBallWorldCollision(unsigned int world);
+
+		// sets world i to the initial state
+		void resetWorld(unsigned int world);
+
+		void pushEvent(unsigned int world, const MatchEvent& event)
+		{
+			if(mEvents[world])
+				mEvents[world]->push_back(event);
+		}
+
+		unsigned int mCount;
+
+		// blob data, one array per player
+		std::vector<float> mBlobPositionX[MAX_PLAYERS];
+		std::vector<float> mBlobPositionY[MAX_PLAYERS];
+		std::vector<float> mBlobVelocityX[MAX_PLAYERS];
+		std::vector<float> mBlobVelocityY[MAX_PLAYERS];
+		std::vector<float> mBlobState[MAX_PLAYERS];
+		std::vector<float> mCurrentBlobbyAnimationSpeed[MAX_PLAYERS];
+
+		// ball data
+		std::vector<float> mBallPositionX;
+		std::vector<float> mBallPositionY;
+		std::vector<float> mBallVelocityX;
+		std::vector<float> mBallVelocityY;
+		std::vector<float> mBallRotation;
+		std::vector<float> mBallAngularVelocity;
+
+		// event buffer of each world
+		std::vector<MatchEventBuffer*> mEvents;
+};
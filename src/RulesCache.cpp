@@ -0,0 +1,151 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "RulesCache.h"
+
+/* includes */
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <cassert>
+
+#include "lua.hpp"
+
+#include "FileRead.h"
+#include "FileSystem.h"
+
+/* implementation */
+
+namespace
+{
+	RulesCache* currentCache = nullptr;
+
+	int writeBytecode(lua_State* state, const void* data, size_t size, void* target)
+	{
+		static_cast<std::string*>(target)->append(static_cast<const char*>(data), size);
+		return 0;
+	}
+
+	bool isSameScript(const RulesCache::Script& a, const RulesCache::Script& b)
+	{
+		return a.checksum == b.checksum && a.length == b.length &&
+				std::memcmp(a.source.get(), b.source.get(), a.length) == 0;
+	}
+}
+
+RulesCache::RulesCache()
+{
+	assert(currentCache == nullptr);
+	currentCache = this;
+}
+
+RulesCache::~RulesCache()
+{
+	currentCache = nullptr;
+}
+
+unsigned int RulesCache::loadAll()
+{
+	std::vector<std::string> files{"api.lua", "rules_api.lua", "bot_api.lua"};
+	for(const auto& rules : FileSystem::getSingleton().enumerateFiles("rules", ".lua", true))
+		files.push_back("rules/" + rules);
+
+	unsigned int changed = 0;
+	for(const auto& file : files)
+	{
+		script_ptr script;
+		try
+		{
+			script = readScript(file);
+		}
+		catch(std::exception& e)
+		{
+			std::cerr << "Could not read " << file << ": " << e.what() << std::endl;
+			continue;
+		}
+
+		// broken scripts are cached anyway, the error is reported when they are used
+		if(script->bytecode.empty())
+			std::cerr << "Could not precompile " << file << std::endl;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		script_ptr& cached = mScripts[file];
+		if(!cached || !isSameScript(*cached, *script))
+		{
+			cached = script;
+			++changed;
+		}
+	}
+
+	return changed;
+}
+
+RulesCache::script_ptr RulesCache::load(const std::string& filename)
+{
+	auto script = readScript(filename);
+	std::lock_guard<std::mutex> lock(mMutex);
+	mScripts[script->filename] = script;
+	return script;
+}
+
+RulesCache::script_ptr RulesCache::get(const std::string& filename) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto found = mScripts.find(FileRead::makeLuaFilename(filename));
+	if(found == mScripts.end())
+		return script_ptr();
+	return found->second;
+}
+
+RulesCache::script_ptr RulesCache::find(const std::string& filename)
+{
+	if(!currentCache)
+		return script_ptr();
+	return currentCache->get(filename);
+}
+
+RulesCache::script_ptr RulesCache::readScript(const std::string& filename)
+{
+	auto script = std::make_shared<Script>();
+	script->filename = FileRead::makeLuaFilename(filename);
+
+	FileRead file(script->filename);
+	script->checksum = file.calcChecksum(0);
+	script->length = file.length();
+	script->source = file.readRawBytes(script->length);
+
+	// compile in a temporary lua state. The dump keeps the debug information, so errors
+	// in the precompiled script report the same line numbers as the source.
+	lua_State* state = luaL_newstate();
+	if(luaL_loadbufferx(state, script->source.get(), script->length, script->filename.c_str(), "t") == 0)
+		lua_dump(state, writeBytecode, &script->bytecode);
+	lua_close(state);
+
+	return script;
+}
+
+int RulesCache::loadScript(lua_State* state, const Script& script)
+{
+	if(script.bytecode.empty())
+		return luaL_loadbufferx(state, script.source.get(), script.length, script.filename.c_str(), "t");
+
+	return luaL_loadbufferx(state, script.bytecode.data(), script.bytecode.size(), script.filename.c_str(), "b");
+}
@@ -0,0 +1,98 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include <boost/shared_array.hpp>
+
+#include "BlobbyDebug.h"
+
+struct lua_State;
+
+/*! \class RulesCache
+	\brief keeps rules scripts in memory, together with their checksum and precompiled bytecode
+	\details Creating a game needs the rules file three times: its checksum and raw bytes are sent to the
+			clients, and it is parsed by the LuaGameLogic. The cache reads and compiles each script only
+			once, so games can be started without any file access. Besides the rules files, the api scripts
+			that rules and bot scripts depend on are cached as well.
+
+			Scripts are identified by their file name including the .lua extension, e.g. "rules/default.lua".
+			Cached scripts are never modified, so a script_ptr can be used without locking even when the
+			cache is reloaded concurrently.
+
+			At most one cache exists at a time. The constructor registers it, so LuaGameLogic and
+			NetworkGame can find it through the static find function.
+*/
+class RulesCache : public ObjectCounter<RulesCache>
+{
+	public:
+		struct Script
+		{
+			std::string filename;				///< name of the file, with .lua extension
+			boost::shared_array<char> source;	///< raw file contents
+			uint32_t length;					///< size of source in bytes
+			uint32_t checksum;					///< crc of the file, as calculated by FileRead::calcChecksum
+			std::string bytecode;				///< the precompiled script, empty if it does not compile
+		};
+
+		typedef std::shared_ptr<const Script> script_ptr;
+
+		RulesCache();
+		~RulesCache();
+
+		RulesCache(const RulesCache&) = delete;
+		RulesCache& operator=(const RulesCache&) = delete;
+
+		/// reads the api scripts and all scripts in the rules directory. Already cached scripts are only
+		/// replaced when their content has changed.
+		/// \return number of scripts that were added or replaced
+		unsigned int loadAll();
+
+		/// reads a single script into the cache, replacing an older version.
+		/// \throw FileLoadException if the file cannot be read
+		script_ptr load(const std::string& filename);
+
+		/// gets a script from this cache, or an empty pointer if it has not been loaded
+		script_ptr get(const std::string& filename) const;
+
+		/// looks up \p filename in the current cache. Returns an empty pointer if there is no cache
+		/// or if the script is not cached.
+		static script_ptr find(const std::string& filename);
+
+		/// reads and compiles a script without caching it. A script with syntax errors is still
+		/// returned, it just has no bytecode.
+		/// \throw FileLoadException if the file cannot be read
+		static script_ptr readScript(const std::string& filename);
+
+		/// pushes \p script as a function onto the stack of \p state. If the script could not be
+		/// precompiled, the source is loaded instead, which leaves the error message on the stack.
+		/// \return the lua_load error code, 0 on success.
+		static int loadScript(lua_State* state, const Script& script);
+
+	private:
+		mutable std::mutex mMutex;
+		std::map<std::string, script_ptr> mScripts;
+};
@@ -0,0 +1,271 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "ScriptWatchdog.h"
+
+/* includes */
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+
+#include "lua.hpp"
+
+#include "IUserConfigReader.h"
+
+/* implementation */
+
+namespace
+{
+	ScriptWatchdog* currentWatchdog = nullptr;
+
+	// innermost scope of this thread. The hook has no other way to find it.
+	thread_local ScriptWatchdog::Scope* currentScope = nullptr;
+
+	/// number of instructions between two checks of the budget
+	const int CHECK_INTERVAL = 1000;
+
+	int histogramBucket(uint64_t nanoseconds)
+	{
+		if(nanoseconds < 4)
+			return nanoseconds;
+
+		// exponent and the two bits below the leading one
+		int exponent = 0;
+		while(nanoseconds >> (exponent + 1))
+			++exponent;
+		int bucket = 4 * (exponent - 1) + ((nanoseconds >> (exponent - 2)) & 3);
+		return std::min(bucket, ScriptWatchdog::Statistics::HISTOGRAM_SIZE - 1);
+	}
+
+	// exclusive upper bound of the times in a bucket, in nanoseconds
+	double histogramBucketEnd(int bucket)
+	{
+		if(bucket < 4)
+			return bucket + 1;
+
+		int exponent = bucket / 4 + 1;
+		return double(5 + bucket % 4) * double(1ull << (exponent - 2));
+	}
+}
+
+const unsigned int ScriptWatchdog::DEFAULT_INSTRUCTIONS;
+const unsigned int ScriptWatchdog::DEFAULT_TIME;
+const int ScriptWatchdog::Statistics::HISTOGRAM_SIZE;
+
+// -------------------------------------------------------------------------------------------------
+// 	Statistics
+// ---------------------
+
+void ScriptWatchdog::Statistics::addCall(std::chrono::nanoseconds duration)
+{
+	double micros = duration.count() / 1000.0;
+	calls++;
+	totalTime += micros;
+	maxTime = std::max(maxTime, micros);
+	histogram[histogramBucket(std::max<int64_t>(duration.count(), 0))]++;
+}
+
+void ScriptWatchdog::Statistics::merge(const Statistics& other)
+{
+	calls += other.calls;
+	overruns += other.overruns;
+	errors += other.errors;
+	totalTime += other.totalTime;
+	maxTime = std::max(maxTime, other.maxTime);
+	for(int i = 0; i < HISTOGRAM_SIZE; ++i)
+		histogram[i] += other.histogram[i];
+}
+
+double ScriptWatchdog::Statistics::getMeanTime() const
+{
+	return calls ? totalTime / calls : 0;
+}
+
+double ScriptWatchdog::Statistics::getPercentile(double fraction) const
+{
+	unsigned long long count = 0;
+	for(int i = 0; i < HISTOGRAM_SIZE; ++i)
+	{
+		count += histogram[i];
+		if(count > 0 && count >= fraction * calls)
+			return std::min(histogramBucketEnd(i) / 1000.0, maxTime);
+	}
+	return maxTime;
+}
+
+// -------------------------------------------------------------------------------------------------
+// 	Scope
+// ---------------------
+
+ScriptWatchdog::Scope::Scope(lua_State* state, const Budget& budget) :
+	mState(state), mPrevious(currentScope), mBudget(budget),
+	mInterval(budget.instructions ? std::min<unsigned int>(budget.instructions, CHECK_INTERVAL) : CHECK_INTERVAL),
+	mDeadline(clock_type::now() + budget.time)
+{
+	currentScope = this;
+	if(budget.instructions || budget.time.count())
+		lua_sethook(mState, hook, LUA_MASKCOUNT, mInterval);
+}
+
+ScriptWatchdog::Scope::~Scope()
+{
+	assert(currentScope == this);
+	currentScope = mPrevious;
+
+	// restore the hook of an enclosing scope for the same state
+	Scope* outer = mPrevious;
+	while(outer && outer->mState != mState)
+		outer = outer->mPrevious;
+
+	if(outer)
+		lua_sethook(mState, hook, LUA_MASKCOUNT, outer->mOverrun ? 1 : outer->mInterval);
+	else
+		lua_sethook(mState, nullptr, 0, 0);
+}
+
+void ScriptWatchdog::Scope::hook(lua_State* state, lua_Debug* debug)
+{
+	Scope* scope = currentScope;
+	while(scope && scope->mState != state)
+		scope = scope->mPrevious;
+	if(!scope)
+		return;
+
+	scope->mInstructions += scope->mInterval;
+	const Budget& budget = scope->mBudget;
+	if( !scope->mOverrun &&
+		(budget.instructions == 0 || scope->mInstructions <= budget.instructions) &&
+		(budget.time.count() == 0 || clock_type::now() <= scope->mDeadline) )
+	{
+		return;
+	}
+
+	// from now on, every instruction raises an error, so the script cannot go on by catching it with pcall
+	if(!scope->mOverrun)
+	{
+		scope->mOverrun = true;
+		lua_sethook(state, hook, LUA_MASKCOUNT, 1);
+	}
+	luaL_error(state, "script exceeded its budget of %d instructions or %d us",
+				int(budget.instructions), int(budget.time.count()));
+}
+
+// -------------------------------------------------------------------------------------------------
+// 	ScriptWatchdog
+// ---------------------
+
+ScriptWatchdog::ScriptWatchdog() : ScriptWatchdog(Budget())
+{
+}
+
+ScriptWatchdog::ScriptWatchdog(const Budget& budget) : mBudget(budget)
+{
+	assert(currentWatchdog == nullptr);
+	currentWatchdog = this;
+}
+
+ScriptWatchdog::~ScriptWatchdog()
+{
+	currentWatchdog = nullptr;
+}
+
+ScriptWatchdog::Budget ScriptWatchdog::getBudget()
+{
+	return currentWatchdog ? currentWatchdog->mBudget : Budget();
+}
+
+ScriptWatchdog::Budget ScriptWatchdog::readBudget(const IUserConfigReader& config)
+{
+	Budget budget;
+	budget.instructions = std::max(0, config.getInteger("script_instruction_budget", DEFAULT_INSTRUCTIONS));
+	budget.time = std::chrono::microseconds( std::max(0, config.getInteger("script_time_budget", DEFAULT_TIME)) );
+
+	std::string policy = config.getString("script_overrun_policy", "last_input");
+	if(policy == "skip")
+		budget.policy = OverrunPolicy::SKIP_FRAME;
+	else if(policy == "last_input")
+		budget.policy = OverrunPolicy::LAST_INPUT;
+	else if(policy == "abort")
+		budget.policy = OverrunPolicy::ABORT_MATCH;
+	else
+		std::cerr << "unknown script_overrun_policy " << policy << ", using last_input" << std::endl;
+
+	return budget;
+}
+
+ScriptWatchdog::Result ScriptWatchdog::call(lua_State* state, int arg_count, int result_count, const Budget& budget, Statistics& stats)
+{
+	auto start = clock_type::now();
+	int error;
+	bool overrun;
+	{
+		Scope scope(state, budget);
+		error = lua_pcall(state, arg_count, result_count, 0);
+		overrun = scope.hasOverrun();
+	}
+	stats.addCall(clock_type::now() - start);
+
+	if(overrun)
+	{
+		stats.overruns++;
+		// the script may have caught the error, but its results must not be used anyway
+		if(!error)
+		{
+			lua_pop(state, result_count);
+			lua_pushstring(state, "script exceeded its budget");
+		}
+		return Result::OVERRUN;
+	}
+
+	if(error)
+	{
+		stats.errors++;
+		return Result::ERROR;
+	}
+
+	return Result::OK;
+}
+
+void ScriptWatchdog::record(const std::string& script, const Statistics& stats)
+{
+	if(!currentWatchdog)
+		return;
+
+	std::lock_guard<std::mutex> lock(currentWatchdog->mMutex);
+	currentWatchdog->mStatistics[script].merge(stats);
+}
+
+std::map<std::string, ScriptWatchdog::Statistics> ScriptWatchdog::getStatistics() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStatistics;
+}
+
+void ScriptWatchdog::printStatus(std::ostream& stream) const
+{
+	for(const auto& script : getStatistics())
+	{
+		const Statistics& stats = script.second;
+		stream << " script " << script.first << ": " << stats.calls << " calls, " << stats.getMeanTime() << " us mean, ";
+		stream << stats.getPercentile(0.99) << " us p99, " << stats.maxTime << " us max, ";
+		stream << stats.overruns << " overruns, " << stats.errors << " errors\n";
+	}
+}
@@ -0,0 +1,159 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <iosfwd>
+#include <cstdint>
+
+#include "BlobbyDebug.h"
+
+struct lua_State;
+struct lua_Debug;
+class IUserConfigReader;
+
+/*! \class ScriptWatchdog
+	\brief limits the time rules and bot scripts may take per call, and collects statistics about them
+	\details Scripted components call their lua functions through ScriptWatchdog::call. While the function
+			runs, a count hook checks the number of executed instructions and the elapsed time. If either
+			exceeds the budget, the hook raises an error, so a script stuck in an endless loop cannot stall
+			the game loop. What happens with the affected frame is decided by the component, following the
+			OverrunPolicy of the budget. Time spent in C functions, e.g. a long simulate call, can only
+			be checked after they return.
+
+			Like the LuaStatePool, at most one watchdog exists at a time. It provides the budget for new
+			components and collects the call statistics of all scripts. Without a watchdog, the default
+			budget is used and no statistics are kept.
+*/
+class ScriptWatchdog : public ObjectCounter<ScriptWatchdog>
+{
+	public:
+		typedef std::chrono::steady_clock clock_type;
+
+		static const unsigned int DEFAULT_INSTRUCTIONS = 1000000;
+		/// in microseconds
+		static const unsigned int DEFAULT_TIME = 10000;
+
+		/// what to do with a frame whose script call exceeded the budget
+		enum class OverrunPolicy
+		{
+			SKIP_FRAME,		///< behave as if the script did nothing this frame
+			LAST_INPUT,		///< repeat the input of the last successful call
+			ABORT_MATCH		///< throw a ScriptException, which ends the match
+		};
+
+		struct Budget
+		{
+			/// maximum number of lua instructions per call, 0 for no limit
+			unsigned int instructions = DEFAULT_INSTRUCTIONS;
+			/// maximum time per call, 0 for no limit
+			std::chrono::microseconds time = std::chrono::microseconds(DEFAULT_TIME);
+			OverrunPolicy policy = OverrunPolicy::LAST_INPUT;
+		};
+
+		/// call statistics of a single script
+		struct Statistics
+		{
+			static const int HISTOGRAM_SIZE = 4 * 36;
+
+			unsigned long long calls = 0;
+			unsigned long long overruns = 0;	///< calls that were aborted because they exceeded the budget
+			unsigned long long errors = 0;		///< calls that failed with a lua error
+			double totalTime = 0;				///< in microseconds
+			double maxTime = 0;					///< in microseconds
+			/// call times, in buckets that grow exponentially with four buckets per power of two nanoseconds
+			uint32_t histogram[HISTOGRAM_SIZE] = {0};
+
+			void addCall(std::chrono::nanoseconds duration);
+			void merge(const Statistics& other);
+
+			double getMeanTime() const;
+			/// returns an upper bound of the call time below which \p fraction of all calls finished, in microseconds
+			double getPercentile(double fraction) const;
+		};
+
+		/// enforces a budget for everything that runs in a lua state while the scope exists
+		class Scope
+		{
+			public:
+				Scope(lua_State* state, const Budget& budget);
+				~Scope();
+
+				Scope(const Scope&) = delete;
+				Scope& operator=(const Scope&) = delete;
+
+				/// whether the budget has been exceeded
+				bool hasOverrun() const { return mOverrun; }
+
+			private:
+				static void hook(lua_State* state, lua_Debug* debug);
+
+				lua_State* mState;
+				Scope* mPrevious;
+				const Budget& mBudget;
+				int mInterval;
+				unsigned long long mInstructions = 0;
+				clock_type::time_point mDeadline;
+				bool mOverrun = false;
+		};
+
+		enum class Result
+		{
+			OK,
+			ERROR,		///< the function raised an error, the message is on the stack
+			OVERRUN		///< the function exceeded the budget and was aborted, the message is on the stack
+		};
+
+		/// creates the watchdog with the default budget
+		ScriptWatchdog();
+		/// creates the watchdog, which hands out \p budget to new components
+		explicit ScriptWatchdog(const Budget& budget);
+		~ScriptWatchdog();
+
+		ScriptWatchdog(const ScriptWatchdog&) = delete;
+		ScriptWatchdog& operator=(const ScriptWatchdog&) = delete;
+
+		/// gets the budget of the current watchdog, or the default budget if there is none
+		static Budget getBudget();
+
+		/// reads the budget from the script_instruction_budget, script_time_budget (in microseconds)
+		/// and script_overrun_policy (skip, last_input or abort) settings.
+		static Budget readBudget(const IUserConfigReader& config);
+
+		/// calls the function on the stack like lua_pcall, but aborts it when it exceeds \p budget.
+		/// The time the call took is added to \p stats.
+		static Result call(lua_State* state, int arg_count, int result_count, const Budget& budget, Statistics& stats);
+
+		/// adds \p stats to the statistics of \p script in the current watchdog, if there is one
+		static void record(const std::string& script, const Statistics& stats);
+
+		std::map<std::string, Statistics> getStatistics() const;
+		void printStatus(std::ostream& stream) const;
+
+	private:
+		Budget mBudget;
+
+		mutable std::mutex mMutex;
+		std::map<std::string, Statistics> mStatistics;
+};
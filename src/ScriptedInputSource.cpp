@@ -28,24 +28,23 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <boost/throw_exception.hpp>
 
-#include <SDL2/SDL.h>
 #include "lua.hpp"
 
 #include "DuelMatch.h"
+#include "DuelMatchState.h"
+#include "GameLogic.h"
 #include "IUserConfigReader.h"
+#include "ThreadPool.h"
 
 /* implementation */
 
 ScriptedInputSource::ScriptedInputSource(const std::string& filename, PlayerSide playerside, unsigned int difficulty)
-: mDifficulty(difficulty)
+: mStepCounter(0)
+, mDifficulty(difficulty)
 , mSide(playerside)
 , mDelayDistribution( difficulty/3, difficulty/2 )
 {
-	mStartTime = SDL_GetTicks();
-
-	// set game constants
-	setGameConstants();
-	setGameFunctions();
+	acquireState("bot", {"api", "bot_api", filename});
 
 	// push infos into script
 	lua_pushnumber(mState, mDifficulty / 25.0);
@@ -57,13 +56,11 @@ ScriptedInputSource::ScriptedInputSource(const std::string& filename, PlayerSide
 	lua_pushinteger(mState, mSide);
 	lua_setglobal(mState, "__SIDE");
 
-	openScript("api");
-	openScript("bot_api");
-	openScript(filename);
+	runScripts();
 
 	// check whether all required lua functions are available
-	bool step = getLuaFunction("__OnStep");
-	if (!step)
+	mOnStepRef = getLuaFunctionRef("__OnStep");
+	if (mOnStepRef < 0)
 	{
 		std::string error_message = "Missing bot functions, check bot_api.lua! ";
 		std::cerr << "Lua Error: " << error_message << std::endl;
@@ -79,42 +76,107 @@ ScriptedInputSource::ScriptedInputSource(const std::string& filename, PlayerSide
 
 ScriptedInputSource::~ScriptedInputSource() = default;
 
-PlayerInputAbs ScriptedInputSource::getNextInput()
+void ScriptedInputSource::enableAsync(std::chrono::microseconds deadline)
 {
-	bool serving = false;
-	// reset input
-	lua_pushboolean(mState, false);
-	lua_setglobal(mState, "__WANT_LEFT");
-	lua_pushboolean(mState, false);
-	lua_setglobal(mState, "__WANT_RIGHT");
-	lua_pushboolean(mState, false);
-	lua_setglobal(mState, "__WANT_JUMP");
+	mDeadline = deadline;
+	if (!mWorker)
+		mWorker.reset( new ThreadPool(1) );
+}
 
+unsigned int ScriptedInputSource::getMissedDeadlines() const
+{
+	return mMissedDeadlines;
+}
+
+void ScriptedInputSource::setRandomSeed(unsigned int seed)
+{
+	seedRandom(seed);
+}
+
+PlayerInputAbs ScriptedInputSource::getNextInput()
+{
 	if (getMatch() == nullptr)
 	{
 		return {};
-	} else
+	}
+
+	if (!mWorker)
+	{
+		return computeInput( *getMatch() );
+	}
+
+	// get the input that was computed during the last frame
+	if (mPending.valid())
+	{
+		if (mDeadline.count() > 0 && mPending.wait_until(mPendingDeadline) != std::future_status::ready)
+		{
+			// the bot is still busy, so keep the last input. We look again next frame.
+			++mMissedDeadlines;
+			return mAsyncInput;
+		}
+		mAsyncInput = mPending.get();
+	}
+
+	// and let the worker compute the next one, from a copy of the current state
+	if (!mSnapshot)
 	{
-		IScriptableComponent::setMatch( const_cast<DuelMatch*>(getMatch()) );
+		mSnapshot.reset( new DuelMatch(false, FALLBACK_RULES_NAME, getMatch()->getScoreToWin()) );
 	}
-	lua_getglobal(mState, "__OnStep");
-	callLuaFunction();
+	mSnapshot->setState( getMatch()->getState() );
 
-	if (!getMatch()->getBallActive() && mSide ==
+	auto result = std::make_shared<std::promise<PlayerInputAbs>>();
+	mPending = result->get_future();
+	mPendingDeadline = std::chrono::steady_clock::now() + mDeadline;
+	mWorker->post( [this, result]()
+	{
+		try
+		{
+			result->set_value( computeInput(*mSnapshot) );
+		}
+		catch (...)
+		{
+			// e.g. a ScriptException, which is rethrown by get
+			result->set_exception( std::current_exception() );
+		}
+	});
+
+	return mAsyncInput;
+}
+
+PlayerInputAbs ScriptedInputSource::computeInput(const DuelMatch& match)
+{
+	bool serving = false;
+
+	IScriptableComponent::setMatch( const_cast<DuelMatch*>(&match) );
+
+	// __OnStep returns the wanted input
+	pushLuaFunction(mOnStepRef);
+	auto result = callLuaFunction(0, 3);
+
+	if (!match.getBallActive() && mSide ==
 			// if no player is serving player, assume the left one is
-			(getMatch()->getServingPlayer() == NO_PLAYER ? LEFT_PLAYER : getMatch()->getServingPlayer() ))
+			(match.getServingPlayer() == NO_PLAYER ? LEFT_PLAYER : match.getServingPlayer() ))
 	{
 		serving = true;
 	}
 
 	// read input info from lua script
-	lua_getglobal(mState, "__WANT_LEFT");
-	lua_getglobal(mState, "__WANT_RIGHT");
-	lua_getglobal(mState, "__WANT_JUMP");
-	bool wantleft = lua_toboolean(mState, -3);
-	bool wantright = lua_toboolean(mState, -2);
-	bool wantjump = lua_toboolean(mState, -1);
-	lua_pop(mState, 3);
+	PlayerInput wanted;
+	if (result == ScriptWatchdog::Result::OK)
+	{
+		wanted.left = lua_toboolean(mState, -3);
+		wanted.right = lua_toboolean(mState, -2);
+		wanted.up = lua_toboolean(mState, -1);
+		lua_pop(mState, 3);
+		mLastWanted = wanted;
+	}
+	else if (result == ScriptWatchdog::Result::OVERRUN && getBudget().policy == ScriptWatchdog::OverrunPolicy::LAST_INPUT)
+	{
+		wanted = mLastWanted;
+	}
+	bool wantleft = wanted.left;
+	bool wantright = wanted.right;
+	bool wantjump = wanted.up;
 
 	int stacksize = lua_gettop(mState);
 	if (stacksize > 0)
@@ -125,8 +187,13 @@ PlayerInputAbs ScriptedInputSource::getNextInput()
 		lua_pop(mState, stacksize);
 	}
 
-	if (mStartTime + WAITING_TIME > SDL_GetTicks() && serving)
-		return {};
+	// wait a moment after the start of the game before serving
+	if (mStepCounter < WAITING_STEPS)
+	{
+		++mStepCounter;
+		if (serving)
+			return {};
+	}
 
 	// random jump delay depending on difficulty
 	if( wantjump && !mLastJump )
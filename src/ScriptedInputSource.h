@@ -27,6 +27,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <string>
 #include <random>
+#include <chrono>
+#include <future>
+#include <memory>
 
 #include "Global.h"
 #include "InputSource.h"
@@ -41,11 +44,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 /// The API documentation can now be found in doc/ScriptAPI.txt
 
-// The time the bot waits after game start
-const int WAITING_TIME = 1500;
+// The number of steps the bot waits after game start before serving, i.e. 1.5 seconds at normal speed.
+// This counts steps instead of real time, so bots behave the same at any simulation speed.
+const unsigned int WAITING_STEPS = 1500 * 75 / 1000;
 
 struct lua_State;
 class DuelMatch;
+class ThreadPool;
 
 class ScriptedInputSource : public InputSource, public IScriptableComponent
 {
@@ -59,9 +64,33 @@ class ScriptedInputSource : public InputSource, public IScriptableComponent
 		PlayerInputAbs getNextInput() override;
 		using InputSource::getMatch;
 
+		/// \brief runs the bot on its own worker thread.
+		/// \details The input for the next frame is computed from a snapshot of the current match state
+		///			while the current frame is processed, so the bot reacts one frame later than in
+		///			synchronous mode. As long as every result is ready in time, the inputs only depend on
+		///			the match, so two asynchronous bots play deterministically.
+		/// \param deadline time the bot gets for each frame. If the result is not ready in time, the previous
+		///			input is used again. Zero means to always wait for the result.
+		void enableAsync(std::chrono::microseconds deadline = std::chrono::microseconds(0));
+
+		/// number of frames in which the asynchronous bot did not finish in time
+		unsigned int getMissedDeadlines() const;
+
+		/// restarts the sequence of math.random of this bot. By default, the seed is taken from rand().
+		void setRandomSeed(unsigned int seed);
+
 	private:
+		// calculates the input from the state of \p match
+		PlayerInputAbs computeInput(const DuelMatch& match);
 
-		unsigned int mStartTime;
+		// reference to the __OnStep function of the bot api
+		int mOnStepRef;
+
+		// result of the last successful __OnStep call
+		PlayerInput mLastWanted;
+
+		// number of steps since the start of the game, counts only up to WAITING_STEPS
+		unsigned int mStepCounter;
 
 		// ki strength values
 		int mDifficulty;
@@ -73,4 +102,14 @@ class ScriptedInputSource : public InputSource, public IScriptableComponent
 		double mJumpDelay = 0;
 		std::normal_distribution<double> mDelayDistribution;
 		std::default_random_engine mRandom;
+
+		// asynchronous mode
+		std::unique_ptr<DuelMatch> mSnapshot;
+		std::future<PlayerInputAbs> mPending;
+		std::chrono::steady_clock::time_point mPendingDeadline;
+		std::chrono::microseconds mDeadline{0};
+		PlayerInputAbs mAsyncInput;
+		unsigned int mMissedDeadlines = 0;
+		// declared last, so it finishes a pending computation before the members above are destroyed
+		std::unique_ptr<ThreadPool> mWorker;
 };
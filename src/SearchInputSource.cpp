@@ -0,0 +1,247 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+/* header include */
+#include "SearchInputSource.h"
+
+/* includes */
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "DuelMatch.h"
+#include "DuelMatchState.h"
+#include "GameConstants.h"
+#include "MatchEvents.h"
+#include "PhysicWorld.h"
+#include "ThreadPool.h"
+
+/* implementation */
+
+namespace
+{
+	// the same values as in the game logic and the default rules
+	const int SQUISH_TOLERANCE = 11;
+	const int MAX_TOUCHES = 3;
+
+	// scores of rollouts in which the rally is decided. Earlier wins and later losses are better.
+	const double WIN_SCORE = 10000;
+	const double LOSS_SCORE = -10000;
+
+	// the inputs a plan is built from
+	const PlayerInput ACTIONS[] = {
+		PlayerInput(false, false, false), PlayerInput(true, false, false), PlayerInput(false, true, false),
+		PlayerInput(false, false, true), PlayerInput(true, false, true), PlayerInput(false, true, true) };
+
+	// number of frames the first input of a plan is held, longest first
+	const int DURATIONS[] = {32, 16, 8, 4, 2, 1};
+}
+
+struct SearchInputSource::Worker
+{
+	Worker()
+	{
+		world.setEventBuffer( &events );
+	}
+
+	PhysicWorld world;
+	MatchEventBuffer events;
+	unsigned int rollouts = 0;
+	unsigned int steps = 0;
+};
+
+SearchInputSource::SearchInputSource(PlayerSide side) : SearchInputSource(side, Settings())
+{
+}
+
+SearchInputSource::SearchInputSource(PlayerSide side, const Settings& settings) :
+	mSide(side), mSettings(settings), mCurrent{PlayerInput(), PlayerInput(), 0}
+{
+	mSettings.threads = std::max(1u, mSettings.threads);
+	mSettings.horizon = std::max(1, mSettings.horizon);
+
+	// the first candidate is the plan of the last frame, then come the plans with a single input
+	mCandidates.push_back( mCurrent );
+	for(const auto& action : ACTIONS)
+		mCandidates.push_back( Plan{action, action, 0} );
+
+	for(int duration : DURATIONS)
+	{
+		for(const auto& first : ACTIONS)
+		{
+			for(const auto& second : ACTIONS)
+			{
+				if( !(first == second) )
+					mCandidates.push_back( Plan{first, second, duration} );
+			}
+		}
+	}
+	mScores.resize( mCandidates.size() );
+
+	for(unsigned int i = 0; i < mSettings.threads; ++i)
+		mWorkers.emplace_back( new Worker() );
+	// the calling thread does its share of the work, too
+	if(mSettings.threads > 1)
+		mPool.reset( new ThreadPool(mSettings.threads - 1) );
+}
+
+SearchInputSource::~SearchInputSource() = default;
+
+const SearchInputSource::Settings& SearchInputSource::getSettings() const
+{
+	return mSettings;
+}
+
+SearchInputSource::Statistics SearchInputSource::getStatistics() const
+{
+	return mStatistics;
+}
+
+PlayerInputAbs SearchInputSource::getNextInput()
+{
+	const DuelMatch* match = getMatch();
+	if (match == nullptr)
+	{
+		return {};
+	}
+
+	DuelMatchState state = match->getState();
+	for(auto& worker : mWorkers)
+	{
+		worker->world.setDeterministic( match->hasDeterministicPhysics() );
+		worker->rollouts = 0;
+		worker->steps = 0;
+	}
+
+	// continue the plan of the last frame
+	if(mCurrent.duration > 0)
+		--mCurrent.duration;
+	mCandidates[0] = mCurrent;
+	std::fill(mScores.begin(), mScores.end(), -std::numeric_limits<double>::infinity());
+
+	auto deadline = std::chrono::steady_clock::now() + mSettings.budget;
+	std::atomic<unsigned int> next(0);
+	for(unsigned int i = 1; i < mWorkers.size(); ++i)
+	{
+		Worker* worker = mWorkers[i].get();
+		mPool->post( [this, &state, worker, &next, deadline]() { search(state, *worker, next, deadline); } );
+	}
+	search(state, *mWorkers[0], next, deadline);
+	if(mPool)
+		mPool->wait();
+
+	// the first of the best candidates wins, so the result does not depend on the order of evaluation
+	auto best = std::max_element(mScores.begin(), mScores.end());
+	mCurrent = mCandidates[best - mScores.begin()];
+
+	++mStatistics.frames;
+	for(const auto& worker : mWorkers)
+	{
+		mStatistics.rollouts += worker->rollouts;
+		mStatistics.steps += worker->steps;
+	}
+
+	PlayerInput input = mCurrent.at(0);
+	return PlayerInputAbs(input.left, input.right, input.up);
+}
+
+void SearchInputSource::search(const DuelMatchState& state, Worker& worker, std::atomic<unsigned int>& next,
+								std::chrono::steady_clock::time_point deadline)
+{
+	bool limited = mSettings.budget.count() > 0;
+	for(unsigned int index = next++; index < mCandidates.size(); index = next++)
+	{
+		// the plan of the last frame is always evaluated, so there is a valid result
+		if(index > 0 && limited && std::chrono::steady_clock::now() >= deadline)
+			return;
+
+		mScores[index] = evaluate(mCandidates[index], state, worker);
+	}
+}
+
+double SearchInputSource::evaluate(const Plan& plan, const DuelMatchState& state, Worker& worker) const
+{
+	const PlayerSide other = mSide == LEFT_PLAYER ? RIGHT_PLAYER : LEFT_PLAYER;
+	const float home = mSide == LEFT_PLAYER ? NET_POSITION_X / 2 : (NET_POSITION_X + RIGHT_PLANE) / 2;
+	auto onOwnSide = [this](float x) { return mSide == LEFT_PLAYER ? x < NET_POSITION_X : x > NET_POSITION_X; };
+
+	PhysicWorld& world = worker.world;
+	world.setState( state.worldState );
+	++worker.rollouts;
+
+	PlayerInput input[MAX_PLAYERS];
+	input[other] = state.playerInput[other];
+
+	bool valid = state.logicState.isBallValid;
+	bool running = state.logicState.isGameRunning;
+	int touches = state.logicState.hitCount[mSide];
+	int squish = state.logicState.squish[mSide];
+
+	for(int frame = 0; frame < mSettings.horizon; ++frame)
+	{
+		input[mSide] = plan.at(frame);
+		worker.events.clear();
+		--squish;
+		world.step( input[LEFT_PLAYER], input[RIGHT_PLAYER], valid, running );
+		++worker.steps;
+
+		if(!valid)
+			continue;
+
+		for(const auto& event : worker.events)
+		{
+			if(event.event == MatchEvent::BALL_HIT_BLOB)
+			{
+				running = true;
+				if(event.side != mSide)
+				{
+					touches = 0;
+					squish = 0;
+				}
+				else if(squish <= 0)
+				{
+					squish = SQUISH_TOLERANCE;
+					if(++touches > MAX_TOUCHES)
+						return LOSS_SCORE + frame;
+				}
+			}
+			else if(event.event == MatchEvent::BALL_HIT_GROUND)
+			{
+				if(event.side == other)
+					return WIN_SCORE - frame;
+
+				// when the rally is lost, it is still better to be close to the ball
+				float distance = std::abs(world.getBlobPosition(mSide).x - world.getBallPosition().x);
+				return LOSS_SCORE + frame - distance / RIGHT_PLANE;
+			}
+		}
+	}
+
+	// the rally is still open. If the ball is on our side, we want to be near it, otherwise near our home position.
+	float blob = world.getBlobPosition(mSide).x;
+	float ball = world.getBallPosition().x;
+	if(!valid || !onOwnSide(ball))
+	{
+		float depth = valid ? std::abs(ball - NET_POSITION_X) : 0;
+		return RIGHT_PLANE / 8 + depth / 10 - std::abs(blob - home) / 10;
+	}
+	return -std::abs(blob - ball);
+}
@@ -0,0 +1,107 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "Global.h"
+#include "InputSource.h"
+
+struct DuelMatchState;
+class ThreadPool;
+
+/*! \class SearchInputSource
+	\brief native bot that searches for good input sequences
+	\details Every frame, the bot rolls out a set of candidate plans from a copy of the current physics
+			state and picks the plan with the best outcome. A plan holds one input for a number of frames,
+			and then switches to a second input for the rest of the horizon. The opponent is assumed to keep
+			its current input. Outcomes are scored with the default rules: the ball touching the ground,
+			and more than three touches, decide the rally; rallies that are still open at the end of the
+			horizon are judged by the position of the ball and the blob.
+			Simple plans are evaluated first, so the per frame time budget controls the strength of the bot.
+			The rollouts can be distributed over a few threads.
+*/
+class SearchInputSource : public InputSource
+{
+	public:
+		struct Settings
+		{
+			/// time that may be spent on a single frame. Zero means to evaluate all candidates, which
+			/// makes the bot deterministic.
+			std::chrono::microseconds budget{2000};
+			/// threads used for the rollouts, including the calling thread
+			unsigned int threads = 1;
+			/// number of frames each candidate is simulated
+			int horizon = 120;
+		};
+
+		/// work done since the bot was created
+		struct Statistics
+		{
+			unsigned long long frames = 0;
+			unsigned long long rollouts = 0;
+			unsigned long long steps = 0;
+		};
+
+		explicit SearchInputSource(PlayerSide side);
+		SearchInputSource(PlayerSide side, const Settings& settings);
+		~SearchInputSource() override;
+
+		const Settings& getSettings() const;
+		Statistics getStatistics() const;
+
+	private:
+		/// an input sequence: \p first for \p duration frames, then \p second
+		struct Plan
+		{
+			PlayerInput first;
+			PlayerInput second;
+			int duration;
+
+			PlayerInput at(int frame) const { return frame < duration ? first : second; }
+		};
+
+		// per thread rollout data
+		struct Worker;
+
+		PlayerInputAbs getNextInput() override;
+
+		// rolls \p plan out from \p state and returns its score
+		double evaluate(const Plan& plan, const DuelMatchState& state, Worker& worker) const;
+		// evaluates candidates, claiming them through \p next, until all are done or the deadline has passed
+		void search(const DuelMatchState& state, Worker& worker, std::atomic<unsigned int>& next,
+					std::chrono::steady_clock::time_point deadline);
+
+		PlayerSide mSide;
+		Settings mSettings;
+
+		std::vector<Plan> mCandidates;
+		std::vector<double> mScores;
+		// the best plan of the last frame, which is continued if nothing better is found
+		Plan mCurrent;
+
+		std::vector<std::unique_ptr<Worker>> mWorkers;
+		std::unique_ptr<ThreadPool> mPool;
+		Statistics mStatistics;
+};
@@ -0,0 +1,96 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+/* header include */
+#include "ThreadPool.h"
+
+/* includes */
+#include <algorithm>
+#include <utility>
+
+/* implementation */
+
+ThreadPool::ThreadPool(unsigned int threads)
+{
+	if( threads == 0 )
+		threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	mWorkers.reserve(threads);
+	for(unsigned int i = 0; i < threads; ++i)
+		mWorkers.emplace_back( [this](){ run(); } );
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mTaskAvailable.notify_all();
+
+	for(auto& worker : mWorkers)
+		worker.join();
+}
+
+unsigned int ThreadPool::size() const
+{
+	return mWorkers.size();
+}
+
+void ThreadPool::post(task_fn task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mTasks.push_back( std::move(task) );
+	}
+	mTaskAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mIdle.wait(lock, [this](){ return mTasks.empty() && mRunning == 0; });
+}
+
+void ThreadPool::run()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	while(true)
+	{
+		mTaskAvailable.wait(lock, [this](){ return mStop || !mTasks.empty(); });
+
+		// when stopping, we still finish all queued tasks
+		if( mTasks.empty() )
+			return;
+
+		task_fn task = std::move(mTasks.front());
+		mTasks.pop_front();
+		++mRunning;
+
+		lock.unlock();
+		task();
+		lock.lock();
+
+		--mRunning;
+		if( mTasks.empty() && mRunning == 0 )
+			mIdle.notify_all();
+	}
+}
@@ -0,0 +1,71 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "BlobbyDebug.h"
+
+/*! \class ThreadPool
+	\brief fixed number of worker threads that process a shared task queue
+	\details Tasks are run in the order they were posted, but several tasks may run
+			concurrently. Tasks must not throw, an escaping exception terminates the program.
+			The destructor finishes all queued tasks before joining the workers.
+*/
+class ThreadPool : public ObjectCounter<ThreadPool>
+{
+	public:
+		typedef std::function<void()> task_fn;
+
+		/// starts \p threads workers. If \p threads is zero, one worker per hardware thread is started.
+		explicit ThreadPool(unsigned int threads = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		/// number of worker threads
+		unsigned int size() const;
+
+		/// queues a task for execution on one of the workers.
+		void post(task_fn task);
+
+		/// blocks until the task queue is empty and no task is running
+		void wait();
+
+	private:
+		// worker thread main function
+		void run();
+
+		std::vector<std::thread> mWorkers;
+		std::deque<task_fn> mTasks;
+		std::mutex mMutex;
+		std::condition_variable mTaskAvailable;
+		std::condition_variable mIdle;
+		unsigned int mRunning = 0;
+		bool mStop = false;
+};
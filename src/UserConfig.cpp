@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 /* includes */
 #include <iostream>
 #include <map>
+#include <mutex>
 
 #include "tinyxml.h"
 
@@ -44,6 +45,10 @@ std::map<std::string, std::shared_ptr<IUserConfigReader> >& userConfigCache()
 
 std::shared_ptr<IUserConfigReader> IUserConfigReader::createUserConfigReader(const std::string& file)
 {
+	// matches may be created on several threads at once
+	static std::mutex cache_mutex;
+	std::lock_guard<std::mutex> lock(cache_mutex);
+
 	// if we have this userconfig already cached, just return from cache
 	auto cfg_cached = userConfigCache().find(file);
 	if( cfg_cached != userConfigCache().end() )
@@ -0,0 +1,249 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+/* header include */
+#include "Benchmark.h"
+
+/* includes */
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+
+/* implementation */
+
+BenchmarkState::BenchmarkState() : mRunning(true), mStart(clock_type::now()), mElapsed(0)
+{
+}
+
+void BenchmarkState::pauseTiming()
+{
+	if(!mRunning)
+		return;
+	mElapsed += clock_type::now() - mStart;
+	mRunning = false;
+}
+
+void BenchmarkState::resumeTiming()
+{
+	if(mRunning)
+		return;
+	mStart = clock_type::now();
+	mRunning = true;
+}
+
+std::chrono::nanoseconds BenchmarkState::elapsed() const
+{
+	auto total = mElapsed;
+	if(mRunning)
+		total += clock_type::now() - mStart;
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(total);
+}
+
+// helper that runs body for a given number of iterations and returns the time in seconds
+static double measure(const BenchmarkRunner::body_fn& body, unsigned int iterations)
+{
+	BenchmarkState state;
+	for(unsigned int i = 0; i < iterations; ++i)
+		body(state);
+	state.pauseTiming();
+	return std::chrono::duration<double>(state.elapsed()).count();
+}
+
+// escapes a string for use in JSON
+static std::string jsonString(const std::string& str)
+{
+	std::string result = "\"";
+	for(char c : str)
+	{
+		switch(c)
+		{
+		case '"':
+			result += "\\\"";
+			break;
+		case '\\':
+			result += "\\\\";
+			break;
+		case '\n':
+			result += "\\n";
+			break;
+		case '\t':
+			result += "\\t";
+			break;
+		default:
+			result += c;
+		}
+	}
+	return result + "\"";
+}
+
+BenchmarkRunner::BenchmarkRunner() : mRepetitions(5), mMinTime(0.2)
+{
+}
+
+void BenchmarkRunner::add(const std::string& name, setup_fn setup)
+{
+	mBenchmarks.emplace_back(name, std::move(setup));
+}
+
+void BenchmarkRunner::setFilter(const std::string& filter)
+{
+	mFilter = filter;
+}
+
+void BenchmarkRunner::setRepetitions(unsigned int repetitions)
+{
+	mRepetitions = std::max(1u, repetitions);
+}
+
+void BenchmarkRunner::setMinTime(double seconds)
+{
+	mMinTime = seconds;
+}
+
+std::vector<std::string> BenchmarkRunner::getNames() const
+{
+	std::vector<std::string> names;
+	for(const auto& bench : mBenchmarks)
+	{
+		if(bench.first.find(mFilter) != std::string::npos)
+			names.push_back(bench.first);
+	}
+	return names;
+}
+
+std::vector<BenchmarkResult> BenchmarkRunner::run(std::ostream& log) const
+{
+	std::vector<BenchmarkResult> results;
+
+	log << std::left << std::setw(48) << "benchmark" << std::right << std::setw(12) << "iterations"
+		<< std::setw(14) << "min ns/op" << std::setw(14) << "median ns/op" << std::setw(10) << "stddev" << "\n";
+
+	for(const auto& bench : mBenchmarks)
+	{
+		if(bench.first.find(mFilter) == std::string::npos)
+			continue;
+
+		// a broken benchmark, e.g. a bot script that fails to load, should not stop the others
+		try
+		{
+			results.push_back( runSingle(bench.first, bench.second) );
+		}
+		catch(std::exception& e)
+		{
+			log << std::left << std::setw(48) << bench.first << " failed: " << e.what() << std::endl;
+			continue;
+		}
+
+		const auto& r = results.back();
+		log << std::left << std::setw(48) << r.name << std::right << std::setw(12) << r.iterations
+			<< std::fixed << std::setprecision(1) << std::setw(14) << r.min << std::setw(14) << r.median
+			<< std::setw(9) << (r.mean > 0 ? 100 * r.stddev / r.mean : 0) << "%" << std::endl;
+	}
+
+	return results;
+}
+
+BenchmarkResult BenchmarkRunner::runSingle(const std::string& name, const setup_fn& setup) const
+{
+	BenchmarkResult result;
+	result.name = name;
+
+	body_fn body = setup();
+
+	// find the number of iterations that takes at least mMinTime. This also serves as warm up.
+	unsigned int iterations = 1;
+	while(true)
+	{
+		double time = measure(body, iterations);
+		if(time >= mMinTime || iterations >= 1000000000u)
+			break;
+
+		// aim a little higher than needed, but do not grow too fast if the first measurements were too short
+		double factor = time > 0 ? 1.4 * mMinTime / time : 10;
+		factor = std::min(10.0, std::max(1.5, factor));
+		iterations = (unsigned int)std::min(1e9, std::ceil(iterations * factor));
+	}
+	result.iterations = iterations;
+
+	for(unsigned int i = 0; i < mRepetitions; ++i)
+		result.samples.push_back( 1e9 * measure(body, iterations) / iterations );
+
+	std::vector<double> sorted = result.samples;
+	std::sort(sorted.begin(), sorted.end());
+	result.min = sorted.front();
+	result.median = sorted.size() % 2 ? sorted[sorted.size() / 2] :
+					0.5 * (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]);
+	result.mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+	double variance = 0;
+	for(double s : sorted)
+		variance += (s - result.mean) * (s - result.mean);
+	result.stddev = std::sqrt(variance / sorted.size());
+
+	return result;
+}
+
+void BenchmarkRunner::writeJSON(std::ostream& target, const std::vector<BenchmarkResult>& results) const
+{
+	char date[32];
+	std::time_t now = std::time(nullptr);
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+	target << std::setprecision(6) << std::defaultfloat;
+	target << "{\n";
+	target << "\t\"context\": {\n";
+	target << "\t\t\"date\": " << jsonString(date) << ",\n";
+	#ifdef __VERSION__
+	target << "\t\t\"compiler\": " << jsonString(__VERSION__) << ",\n";
+	#endif
+	#ifdef NDEBUG
+	target << "\t\t\"debug\": false,\n";
+	#else
+	target << "\t\t\"debug\": true,\n";
+	#endif
+	target << "\t\t\"repetitions\": " << mRepetitions << ",\n";
+	target << "\t\t\"min_time\": " << mMinTime << "\n";
+	target << "\t},\n";
+	target << "\t\"benchmarks\": [";
+	for(unsigned int i = 0; i < results.size(); ++i)
+	{
+		const auto& r = results[i];
+		target << (i == 0 ? "\n" : ",\n");
+		target << "\t\t{\n";
+		target << "\t\t\t\"name\": " << jsonString(r.name) << ",\n";
+		target << "\t\t\t\"iterations\": " << r.iterations << ",\n";
+		target << "\t\t\t\"time_unit\": \"ns\",\n";
+		target << "\t\t\t\"min\": " << r.min << ",\n";
+		target << "\t\t\t\"median\": " << r.median << ",\n";
+		target << "\t\t\t\"mean\": " << r.mean << ",\n";
+		target << "\t\t\t\"stddev\": " << r.stddev << ",\n";
+		target << "\t\t\t\"samples\": [";
+		for(unsigned int s = 0; s < r.samples.size(); ++s)
+			target << (s == 0 ? "" : ", ") << r.samples[s];
+		target << "]\n";
+		target << "\t\t}";
+	}
+	target << "\n\t]\n";
+	target << "}\n";
+}
@@ -0,0 +1,110 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <iosfwd>
+
+/*! \brief timing information passed to a running benchmark
+	\details The runner calls the benchmark body repeatedly while the clock is running. Work that
+			should not be measured, like advancing a match or resetting state, can be excluded with
+			pauseTiming() and resumeTiming().
+*/
+class BenchmarkState
+{
+	typedef std::chrono::steady_clock clock_type;
+
+	public:
+		BenchmarkState();
+
+		/// stops the clock, e.g. before preparing the next iteration
+		void pauseTiming();
+		/// restarts the clock after pauseTiming()
+		void resumeTiming();
+
+		/// time measured so far
+		std::chrono::nanoseconds elapsed() const;
+
+	private:
+		bool mRunning;
+		clock_type::time_point mStart;
+		clock_type::duration mElapsed;
+};
+
+/// results of a single benchmark. All times are in nanoseconds per iteration.
+struct BenchmarkResult
+{
+	std::string name;
+	unsigned int iterations;
+	std::vector<double> samples;
+
+	double min;
+	double median;
+	double mean;
+	double stddev;
+};
+
+/*! \brief runs a set of registered microbenchmarks
+	\details Each benchmark consists of a setup function, which is called once and returns the body
+			of the benchmark. The body is one iteration of the measured operation. The runner first
+			determines how many iterations are needed to run at least the minimum time, and then
+			measures that number of iterations a few times. Results are printed as a table and can
+			be exported as JSON for automatic comparisons.
+*/
+class BenchmarkRunner
+{
+	public:
+		typedef std::function<void(BenchmarkState&)> body_fn;
+		typedef std::function<body_fn()> setup_fn;
+
+		BenchmarkRunner();
+
+		/// registers a benchmark
+		void add(const std::string& name, setup_fn setup);
+
+		/// only benchmarks whose name contains \p filter are run
+		void setFilter(const std::string& filter);
+		/// number of measurements per benchmark
+		void setRepetitions(unsigned int repetitions);
+		/// minimum time for a single measurement, in seconds
+		void setMinTime(double seconds);
+
+		/// names of all benchmarks that match the filter
+		std::vector<std::string> getNames() const;
+
+		/// runs all benchmarks that match the filter and prints progress to \p log
+		std::vector<BenchmarkResult> run(std::ostream& log) const;
+
+		/// writes \p results as a JSON document
+		void writeJSON(std::ostream& target, const std::vector<BenchmarkResult>& results) const;
+
+	private:
+		BenchmarkResult runSingle(const std::string& name, const setup_fn& setup) const;
+
+		std::vector<std::pair<std::string, setup_fn>> mBenchmarks;
+		std::string mFilter;
+		unsigned int mRepetitions;
+		double mMinTime;
+};
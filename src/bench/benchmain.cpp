@@ -0,0 +1,417 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+/* includes */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "raknet/BitStream.h"
+
+#include "Benchmark.h"
+#include "DuelMatch.h"
+#include "DuelMatchState.h"
+#include "FileSystem.h"
+#include "GenericIO.h"
+#include "HeadlessTool.h"
+#include "InputSource.h"
+#include "PhysicWorld.h"
+#include "PhysicWorldBatch.h"
+#include "ScriptedInputSource.h"
+#include "SearchInputSource.h"
+#include "env/VectorEnv.h"
+#include "replays/ReplayRecorder.h"
+
+/* implementation */
+
+// all benchmarks use the same seed, so repeated runs do exactly the same work
+const unsigned int BENCH_SEED = 1907;
+
+// a table of inputs that change every few steps, similar to human players
+std::vector<PlayerInput> generateInputs(unsigned int count)
+{
+	std::mt19937 gen(BENCH_SEED);
+	std::uniform_int_distribution<int> input(0, 7);
+	std::uniform_int_distribution<int> duration(1, 20);
+
+	std::vector<PlayerInput> inputs;
+	while(inputs.size() < count)
+	{
+		PlayerInput in;
+		in.setAll( input(gen) );
+		inputs.resize( std::min<std::size_t>(count, inputs.size() + duration(gen)), in );
+	}
+	return inputs;
+}
+
+/// input source that replays a precomputed table of inputs
+class TableInputSource : public InputSource
+{
+	public:
+		explicit TableInputSource(unsigned int offset) : mInputs(generateInputs(4096)), mPosition(offset)
+		{
+		}
+
+	private:
+		PlayerInputAbs getNextInput() override
+		{
+			const PlayerInput& in = mInputs[mPosition++ % mInputs.size()];
+			return PlayerInputAbs(in.left, in.right, in.up);
+		}
+
+		std::vector<PlayerInput> mInputs;
+		unsigned int mPosition;
+};
+
+// ---------------------------------------------------------------------------------------------------
+//		physics
+// ---------------------------------------------------------------------------------------------------
+
+BenchmarkRunner::body_fn benchPhysicWorld(bool deterministic)
+{
+	auto world = std::make_shared<PhysicWorld>();
+	world->setDeterministic(deterministic);
+	auto inputs = std::make_shared<std::vector<PlayerInput>>(generateInputs(4096));
+	auto step = std::make_shared<unsigned int>(0);
+
+	return [=](BenchmarkState&)
+	{
+		const auto& in = *inputs;
+		unsigned int i = (*step)++;
+		world->step( in[i % in.size()], in[(i + 1000) % in.size()], true, true );
+	};
+}
+
+BenchmarkRunner::body_fn benchPhysicWorldBatch(unsigned int count)
+{
+	auto batch = std::make_shared<PhysicWorldBatch>(count);
+	auto inputs = std::make_shared<std::vector<PlayerInput>>(generateInputs(4096));
+	auto steps = std::make_shared<std::vector<PhysicWorldBatch::StepInput>>(count);
+	auto step = std::make_shared<unsigned int>(0);
+
+	return [=](BenchmarkState&)
+	{
+		const auto& in = *inputs;
+		unsigned int i = (*step)++;
+		for(unsigned int w = 0; w < count; ++w)
+		{
+			(*steps)[w].input[LEFT_PLAYER] = in[(i + 17 * w) % in.size()];
+			(*steps)[w].input[RIGHT_PLAYER] = in[(i + 17 * w + 1000) % in.size()];
+		}
+		batch->step( steps->data() );
+	};
+}
+
+// ---------------------------------------------------------------------------------------------------
+//		game
+// ---------------------------------------------------------------------------------------------------
+
+BenchmarkRunner::body_fn benchDuelMatch(const std::string& rules)
+{
+	auto match = std::make_shared<DuelMatch>(false, rules, 15);
+	match->setInputSources( std::make_shared<TableInputSource>(0), std::make_shared<TableInputSource>(1000) );
+
+	return [=](BenchmarkState& state)
+	{
+		match->step();
+		if(match->winningPlayer() != NO_PLAYER)
+		{
+			state.pauseTiming();
+			match->reset();
+			state.resumeTiming();
+		}
+	};
+}
+
+// measures only the bot. Both sides are played by the bot, but the match itself is advanced untimed.
+BenchmarkRunner::body_fn benchBot(const std::string& script)
+{
+	auto match = std::make_shared<DuelMatch>(false, DEFAULT_RULES_FILE, 15);
+	auto left = std::make_shared<InputSource>();
+	auto right = std::make_shared<InputSource>();
+	match->setInputSources(left, right);
+
+	std::shared_ptr<InputSource> leftBot = std::make_shared<ScriptedInputSource>(script, LEFT_PLAYER, 0);
+	std::shared_ptr<InputSource> rightBot = std::make_shared<ScriptedInputSource>(script, RIGHT_PLAYER, 0);
+	leftBot->setMatch( match.get() );
+	rightBot->setMatch( match.get() );
+	auto bot = std::static_pointer_cast<ScriptedInputSource>(leftBot);
+
+	return [=](BenchmarkState& state)
+	{
+		PlayerInputAbs input = bot->getNextInput();
+
+		state.pauseTiming();
+		left->setInput( input );
+		rightBot->updateInput();
+		right->setInput( rightBot->getRealInput() );
+		match->step();
+		if(match->winningPlayer() != NO_PLAYER)
+			match->reset();
+		state.resumeTiming();
+	};
+}
+
+// one frame of the search bot without a time limit, i.e. a fixed number of physics rollouts
+BenchmarkRunner::body_fn benchSearchBot(unsigned int threads)
+{
+	auto match = std::make_shared<DuelMatch>(false, DEFAULT_RULES_FILE, 15);
+	auto left = std::make_shared<InputSource>();
+	auto right = std::make_shared<TableInputSource>(0);
+	match->setInputSources(left, right);
+
+	SearchInputSource::Settings settings;
+	settings.budget = std::chrono::microseconds(0);
+	settings.threads = threads;
+	auto bot = std::make_shared<SearchInputSource>(LEFT_PLAYER, settings);
+	bot->setMatch( match.get() );
+
+	return [=](BenchmarkState& state)
+	{
+		left->setInput( bot->updateInput() );
+
+		state.pauseTiming();
+		match->step();
+		if(match->winningPlayer() != NO_PLAYER)
+			match->reset();
+		state.resumeTiming();
+	};
+}
+
+// one step of a batch of training matches, with random actions for both agents
+BenchmarkRunner::body_fn benchVectorEnv(unsigned int count, unsigned int threads)
+{
+	VectorEnv::Settings settings;
+	settings.threads = threads;
+	auto env = std::make_shared<VectorEnv>(settings);
+	env->reset(count);
+
+	auto actions = std::make_shared<std::vector<int>>();
+	for(const auto& input : generateInputs(4096))
+		actions->push_back( input.getAll() );
+	auto step = std::make_shared<unsigned int>(0);
+
+	return [=](BenchmarkState&)
+	{
+		unsigned int offset = (*step)++ * env->getAgentCount() % (actions->size() - env->getAgentCount());
+		env->step( actions->data() + offset );
+	};
+}
+
+// ---------------------------------------------------------------------------------------------------
+//		serialization
+// ---------------------------------------------------------------------------------------------------
+
+// a number of consecutive states of a match
+std::vector<DuelMatchState> generateStates(unsigned int count)
+{
+	DuelMatch match(false, DEFAULT_RULES_FILE, 15);
+	match.setInputSources( std::make_shared<TableInputSource>(0), std::make_shared<TableInputSource>(1000) );
+
+	std::vector<DuelMatchState> states;
+	for(unsigned int i = 0; i < count; ++i)
+	{
+		match.step();
+		states.push_back( match.getState() );
+	}
+	return states;
+}
+
+BenchmarkRunner::body_fn benchWriteState()
+{
+	auto states = std::make_shared<std::vector<DuelMatchState>>(generateStates(1024));
+	auto stream = std::make_shared<RakNet::BitStream>();
+	auto step = std::make_shared<unsigned int>(0);
+
+	// this is what the server does for every game update
+	return [=](BenchmarkState&)
+	{
+		stream->Reset();
+		auto out = createGenericWriter( stream.get() );
+		out->generic<DuelMatchState>( (*states)[(*step)++ % states->size()] );
+	};
+}
+
+BenchmarkRunner::body_fn benchReadState()
+{
+	auto stream = std::make_shared<RakNet::BitStream>();
+	auto out = createGenericWriter( stream.get() );
+	out->generic<DuelMatchState>( generateStates(200).back() );
+	auto target = std::make_shared<DuelMatchState>();
+
+	return [=](BenchmarkState&)
+	{
+		stream->ResetReadPointer();
+		auto in = createGenericReader( stream.get() );
+		in->generic<DuelMatchState>( *target );
+	};
+}
+
+BenchmarkRunner::body_fn benchReplayRecord()
+{
+	auto states = std::make_shared<std::vector<DuelMatchState>>(generateStates(1024));
+	auto recorder = std::make_shared<std::unique_ptr<ReplayRecorder>>( new ReplayRecorder() );
+	auto step = std::make_shared<unsigned int>(0);
+
+	return [=](BenchmarkState& state)
+	{
+		unsigned int i = (*step)++;
+		(*recorder)->record( (*states)[i % states->size()] );
+
+		// start a new replay every hour of game time, so memory usage does not grow without bounds
+		if(i % (75 * 3600) == 0)
+		{
+			state.pauseTiming();
+			recorder->reset( new ReplayRecorder() );
+			state.resumeTiming();
+		}
+	};
+}
+
+// ---------------------------------------------------------------------------------------------------
+//		main
+// ---------------------------------------------------------------------------------------------------
+
+void printHelp()
+{
+	std::cout << "Usage: blobby-bench [OPTION...]" << std::endl;
+	std::cout << "  -f, --filter <text>       Only run benchmarks whose name contains text" << std::endl;
+	std::cout << "  -r, --repetitions <n>     Number of measurements per benchmark (default 5)" << std::endl;
+	std::cout << "  -t, --min-time <seconds>  Minimum duration of a single measurement (default 0.2)" << std::endl;
+	std::cout << "  -j, --json <file>         Write results as JSON to file, - for stdout" << std::endl;
+	std::cout << "  -l, --list                List benchmarks instead of running them" << std::endl;
+	std::cout << "  -v, --verbose             Show output of rules and bot scripts" << std::endl;
+	std::cout << "  -h, --help                This message" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkRunner runner;
+	std::string json_file;
+	bool list = false;
+	bool verbose = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		bool has_argument = i + 1 < argc;
+		if ((strcmp(argv[i], "--filter") == 0 || strcmp(argv[i], "-f") == 0) && has_argument)
+		{
+			runner.setFilter( argv[++i] );
+		}
+		else if ((strcmp(argv[i], "--repetitions") == 0 || strcmp(argv[i], "-r") == 0) && has_argument)
+		{
+			runner.setRepetitions( std::atoi(argv[++i]) );
+		}
+		else if ((strcmp(argv[i], "--min-time") == 0 || strcmp(argv[i], "-t") == 0) && has_argument)
+		{
+			runner.setMinTime( std::atof(argv[++i]) );
+		}
+		else if ((strcmp(argv[i], "--json") == 0 || strcmp(argv[i], "-j") == 0) && has_argument)
+		{
+			json_file = argv[++i];
+		}
+		else if (strcmp(argv[i], "--list") == 0 || strcmp(argv[i], "-l") == 0)
+		{
+			list = true;
+		}
+		else if (strcmp(argv[i], "--verbose") == 0 || strcmp(argv[i], "-v") == 0)
+		{
+			verbose = true;
+		}
+		else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+		{
+			printHelp();
+			return 0;
+		}
+		else
+		{
+			std::cout << "Unknown option or missing argument \"" << argv[i] << "\"" << std::endl;
+			printHelp();
+			return 1;
+		}
+	}
+
+	FileSystem fileSys(argv[0]);
+	setupHeadlessSearchPath();
+
+	runner.add("PhysicWorld::step", [](){ return benchPhysicWorld(false); });
+	runner.add("PhysicWorld::step/deterministic", [](){ return benchPhysicWorld(true); });
+	runner.add("PhysicWorldBatch::step/64", [](){ return benchPhysicWorldBatch(64); });
+
+	// sort the files, so the order of the results does not depend on the file system
+	auto rulesFiles = fileSys.enumerateFiles("rules", ".lua", true);
+	std::sort(rulesFiles.begin(), rulesFiles.end());
+	for(const auto& rules : rulesFiles)
+		runner.add("DuelMatch::step/" + rules, [rules](){ return benchDuelMatch(rules); });
+
+	auto scriptFiles = fileSys.enumerateFiles("scripts", ".lua", true);
+	std::sort(scriptFiles.begin(), scriptFiles.end());
+	for(const auto& script : scriptFiles)
+		runner.add("ScriptedInputSource::getNextInput/" + script, [script](){ return benchBot("scripts/" + script); });
+
+	runner.add("SearchInputSource::getNextInput", [](){ return benchSearchBot(1); });
+	runner.add("SearchInputSource::getNextInput/4 threads", [](){ return benchSearchBot(4); });
+
+	runner.add("VectorEnv::step/64", [](){ return benchVectorEnv(64, 1); });
+	runner.add("VectorEnv::step/64/4 threads", [](){ return benchVectorEnv(64, 4); });
+
+	runner.add("GenericIO/write DuelMatchState", benchWriteState);
+	runner.add("GenericIO/read DuelMatchState", benchReadState);
+	runner.add("ReplayRecorder::record", benchReplayRecord);
+
+	if(list)
+	{
+		for(const auto& name : runner.getNames())
+			std::cout << name << "\n";
+		return 0;
+	}
+
+	// rules and bots print to stdout, which would mess up the results. Unless requested otherwise,
+	// stdout is redirected to /dev/null while the benchmarks run, and the progress goes to stderr.
+	StdoutSilencer silencer(!verbose);
+
+	auto results = runner.run( std::cerr );
+
+	silencer.restore();
+
+	if(json_file == "-")
+	{
+		runner.writeJSON(std::cout, results);
+	}
+	else if(!json_file.empty())
+	{
+		std::ofstream target(json_file);
+		runner.writeJSON(target, results);
+		if(!target)
+		{
+			std::cerr << "could not write " << json_file << std::endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,180 @@
+/*=============================================================================
+blobNet
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef _SEQUENCERING_HPP_
+#define _SEQUENCERING_HPP_
+
+/* Includes */
+#include <limits>
+#include <vector>
+
+namespace BlobNet {
+namespace ADT {
+	/*!	\class SequenceRing
+		\brief Maps wrapping sequence numbers (packet numbers, ordering indices) to values
+		\details The slot of a sequence number is its value modulo the capacity, so all
+				operations are O(1). The capacity is a power of two and is doubled whenever
+				two live sequence numbers would share a slot, up to the range of SequenceType.
+				No memory is allocated before the first insert.
+	*/
+	template <class SequenceType, class ValueType> class SequenceRing
+	{
+	public:
+		/// @brief constructor, creates an empty ring
+		/// @param initialCapacity Number of slots allocated by the first insert, a power of two
+		explicit SequenceRing(unsigned int initialCapacity = 64);
+
+		/// @brief Count of elements in the ring
+		/// @return Count of elements
+		inline unsigned int size() const;
+
+		/// @brief Count of allocated slots
+		inline unsigned int capacity() const;
+
+		/// @brief Stores a value for a sequence number, replacing the value stored for the
+		///		same sequence number before
+		/// @param sequence Sequence number
+		/// @param value Value to store
+		void insert(SequenceType sequence, const ValueType& value);
+
+		/// @brief Looks up the value of a sequence number
+		/// @param sequence Sequence number
+		/// @return Pointer to the stored value, 0 if there is none
+		inline ValueType* find(SequenceType sequence);
+
+		/// @brief Removes the value of a sequence number
+		/// @param sequence Sequence number
+		/// @param value Receives the removed value, may be 0
+		/// @return true if there was a value to remove
+		bool remove(SequenceType sequence, ValueType* value = 0);
+
+		/// @brief Returns the value in a slot, for iterating over all elements
+		/// @param slot Index of the slot, less than capacity()
+		/// @return Pointer to the stored value, 0 if the slot is empty
+		inline ValueType* atSlot(unsigned int slot);
+
+		/// @brief Deletes all elements, keeping the allocated slots
+		void clear();
+
+	private:
+		struct Slot
+		{
+			SequenceType sequence;
+			bool used;
+			ValueType value;
+		};
+
+		/// all values of SequenceType map to their own slot at this capacity
+		static const unsigned long long MAXIMUM_CAPACITY = (unsigned long long)std::numeric_limits<SequenceType>::max() + 1;
+
+		void grow();
+
+		std::vector<Slot> mSlots;
+		unsigned int mInitialCapacity;
+		unsigned int mSize;
+	};
+
+	template <class SequenceType, class ValueType> SequenceRing<SequenceType, ValueType>::SequenceRing(unsigned int initialCapacity)
+		: mInitialCapacity(initialCapacity < MAXIMUM_CAPACITY ? initialCapacity : (unsigned int)MAXIMUM_CAPACITY)
+		, mSize(0)
+	{
+	}
+
+	template <class SequenceType, class ValueType> inline unsigned int SequenceRing<SequenceType, ValueType>::size() const
+	{
+		return mSize;
+	}
+
+	template <class SequenceType, class ValueType> inline unsigned int SequenceRing<SequenceType, ValueType>::capacity() const
+	{
+		return mSlots.size();
+	}
+
+	template <class SequenceType, class ValueType> void SequenceRing<SequenceType, ValueType>::insert(SequenceType sequence, const ValueType& value)
+	{
+		if(mSlots.empty())
+			mSlots.resize(mInitialCapacity);
+
+		Slot* slot = &mSlots[sequence & (mSlots.size() - 1)];
+		while(slot->used && slot->sequence != sequence && mSlots.size() < MAXIMUM_CAPACITY)
+		{
+			grow();
+			slot = &mSlots[sequence & (mSlots.size() - 1)];
+		}
+
+		if(!slot->used)
+			++mSize;
+
+		slot->sequence = sequence;
+		slot->used = true;
+		slot->value = value;
+	}
+
+	template <class SequenceType, class ValueType> inline ValueType* SequenceRing<SequenceType, ValueType>::find(SequenceType sequence)
+	{
+		if(mSlots.empty())
+			return 0;
+
+		Slot& slot = mSlots[sequence & (mSlots.size() - 1)];
+		if(!slot.used || slot.sequence != sequence)
+			return 0;
+
+		return &slot.value;
+	}
+
+	template <class SequenceType, class ValueType> bool SequenceRing<SequenceType, ValueType>::remove(SequenceType sequence, ValueType* value)
+	{
+		ValueType* stored = find(sequence);
+		if(!stored)
+			return false;
+
+		if(value)
+			*value = *stored;
+
+		mSlots[sequence & (mSlots.size() - 1)].used = false;
+		--mSize;
+		return true;
+	}
+
+	template <class SequenceType, class ValueType> inline ValueType* SequenceRing<SequenceType, ValueType>::atSlot(unsigned int slot)
+	{
+		return mSlots[slot].used ? &mSlots[slot].value : 0;
+	}
+
+	template <class SequenceType, class ValueType> void SequenceRing<SequenceType, ValueType>::clear()
+	{
+		for(auto& slot : mSlots)
+			slot.used = false;
+		mSize = 0;
+	}
+
+	template <class SequenceType, class ValueType> void SequenceRing<SequenceType, ValueType>::grow()
+	{
+		std::vector<Slot> old(mSlots.size() * 2);
+		old.swap(mSlots);
+
+		for(const auto& slot : old)
+		{
+			if(slot.used)
+				mSlots[slot.sequence & (mSlots.size() - 1)] = slot;
+		}
+	}
+}
+}
+#endif
@@ -0,0 +1,263 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+/* header include */
+#include "VectorEnv.h"
+
+/* includes */
+#include <algorithm>
+#include <cassert>
+
+#include "DuelMatch.h"
+#include "DuelMatchState.h"
+#include "GameConstants.h"
+#include "InputSource.h"
+
+/* implementation */
+
+struct VectorEnv::Environment
+{
+	std::unique_ptr<DuelMatch> match;
+	// the inputs of the agents
+	std::shared_ptr<InputSource> input[MAX_PLAYERS];
+	// matches are reset by restoring this state, which is cheaper than creating new physics and rules
+	DuelMatchState initial;
+	unsigned int steps = 0;
+};
+
+VectorEnv::VectorEnv(const Settings& settings) :
+	mSettings(settings), mAgentsPerMatch(settings.opponent ? 1 : MAX_PLAYERS)
+{
+	mSettings.threads = std::max(1u, mSettings.threads);
+
+	// the calling thread steps the first slice
+	for(unsigned int worker = 1; worker < mSettings.threads; ++worker)
+		mWorkers.emplace_back( [this, worker]() { runWorker(worker); } );
+}
+
+VectorEnv::~VectorEnv()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mStepStarted.notify_all();
+
+	for(auto& worker : mWorkers)
+		worker.join();
+}
+
+void VectorEnv::reset(unsigned int count)
+{
+	mEnvironments.clear();
+	for(unsigned int i = 0; i < count; ++i)
+	{
+		std::unique_ptr<Environment> env( new Environment() );
+		env->match.reset( new DuelMatch(false, mSettings.rules, mSettings.scoreToWin) );
+		env->match->setDeterministicPhysics( mSettings.deterministicPhysics );
+
+		env->input[LEFT_PLAYER] = std::make_shared<InputSource>();
+		if(mSettings.opponent)
+		{
+			env->match->setInputSources( env->input[LEFT_PLAYER], mSettings.opponent() );
+		}
+		else
+		{
+			env->input[RIGHT_PLAYER] = std::make_shared<InputSource>();
+			env->match->setInputSources( env->input[LEFT_PLAYER], env->input[RIGHT_PLAYER] );
+		}
+
+		env->initial = env->match->getState();
+		mEnvironments.push_back( std::move(env) );
+	}
+
+	mObservations.assign( getAgentCount() * OBSERVATION_SIZE, 0.f );
+	mRewards.assign( getAgentCount(), 0.f );
+	mDone.assign( getAgentCount(), 0.f );
+
+	for(unsigned int i = 0; i < count; ++i)
+		observe(i, mEnvironments[i]->initial);
+}
+
+void VectorEnv::step(const int* actions)
+{
+	mActions = actions;
+
+	if(mWorkers.empty())
+	{
+		stepRange(0, size());
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		++mGeneration;
+		mRunning = mWorkers.size();
+	}
+	mStepStarted.notify_all();
+
+	stepRange(0, getSliceBegin(1));
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mStepFinished.wait(lock, [this]() { return mRunning == 0; });
+}
+
+unsigned int VectorEnv::size() const
+{
+	return mEnvironments.size();
+}
+
+unsigned int VectorEnv::getAgentsPerMatch() const
+{
+	return mAgentsPerMatch;
+}
+
+unsigned int VectorEnv::getAgentCount() const
+{
+	return size() * mAgentsPerMatch;
+}
+
+const float* VectorEnv::getObservations() const
+{
+	return mObservations.data();
+}
+
+const float* VectorEnv::getRewards() const
+{
+	return mRewards.data();
+}
+
+const float* VectorEnv::getDone() const
+{
+	return mDone.data();
+}
+
+const VectorEnv::Settings& VectorEnv::getSettings() const
+{
+	return mSettings;
+}
+
+void VectorEnv::stepRange(unsigned int begin, unsigned int end)
+{
+	for(unsigned int index = begin; index < end; ++index)
+	{
+		Environment& env = *mEnvironments[index];
+		DuelMatch& match = *env.match;
+		const unsigned int first = index * mAgentsPerMatch;
+
+		for(unsigned int agent = 0; agent < mAgentsPerMatch; ++agent)
+		{
+			PlayerInput input;
+			input.setAll( mActions[first + agent] & (ACTION_COUNT - 1) );
+			// right agents see the field mirrored
+			if(agent == RIGHT_PLAYER)
+				std::swap(input.left, input.right);
+			env.input[agent]->setInput( input );
+		}
+
+		int before[MAX_PLAYERS] = { match.getScore(LEFT_PLAYER), match.getScore(RIGHT_PLAYER) };
+		match.step();
+		++env.steps;
+
+		int won[MAX_PLAYERS] = { match.getScore(LEFT_PLAYER) - before[LEFT_PLAYER],
+								match.getScore(RIGHT_PLAYER) - before[RIGHT_PLAYER] };
+		bool done = match.winningPlayer() != NO_PLAYER || (mSettings.maxSteps != 0 && env.steps >= mSettings.maxSteps);
+
+		for(unsigned int agent = 0; agent < mAgentsPerMatch; ++agent)
+		{
+			mRewards[first + agent] = won[agent] - won[1 - agent];
+			mDone[first + agent] = done ? 1.f : 0.f;
+		}
+
+		if(done)
+		{
+			match.setState( env.initial );
+			env.steps = 0;
+		}
+
+		observe(index, match.getState());
+	}
+}
+
+void VectorEnv::observe(unsigned int index, const DuelMatchState& state)
+{
+	for(unsigned int agent = 0; agent < mAgentsPerMatch; ++agent)
+	{
+		// every agent sees itself as the left player
+		DuelMatchState view = state;
+		if(agent == RIGHT_PLAYER)
+			view.swapSides();
+
+		float* out = &mObservations[(index * mAgentsPerMatch + agent) * OBSERVATION_SIZE];
+		auto position = [](float* target, const Vector2& p)
+		{
+			target[0] = p.x / RIGHT_PLANE;
+			target[1] = (GROUND_PLANE_HEIGHT_MAX - p.y) / RIGHT_PLANE;
+		};
+		auto velocity = [](float* target, const Vector2& v)
+		{
+			target[0] = v.x / BALL_COLLISION_VELOCITY;
+			target[1] = -v.y / BALL_COLLISION_VELOCITY;
+		};
+
+		const PhysicState& world = view.worldState;
+		position(out + OWN_POSITION_X, world.blobPosition[LEFT_PLAYER]);
+		velocity(out + OWN_VELOCITY_X, world.blobVelocity[LEFT_PLAYER]);
+		position(out + OPPONENT_POSITION_X, world.blobPosition[RIGHT_PLAYER]);
+		velocity(out + OPPONENT_VELOCITY_X, world.blobVelocity[RIGHT_PLAYER]);
+		position(out + BALL_POSITION_X, world.ballPosition);
+		velocity(out + BALL_VELOCITY_X, world.ballVelocity);
+
+		const GameLogicState& logic = view.logicState;
+		out[OWN_TOUCHES] = logic.hitCount[LEFT_PLAYER];
+		out[OPPONENT_TOUCHES] = logic.hitCount[RIGHT_PLAYER];
+		out[SERVING] = logic.servingPlayer == LEFT_PLAYER ? 1.f : (logic.servingPlayer == RIGHT_PLAYER ? -1.f : 0.f);
+		out[BALL_VALID] = logic.isBallValid ? 1.f : 0.f;
+		out[GAME_RUNNING] = logic.isGameRunning ? 1.f : 0.f;
+	}
+}
+
+void VectorEnv::runWorker(unsigned int worker)
+{
+	unsigned int generation = 0;
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mStepStarted.wait(lock, [this, generation]() { return mStop || mGeneration != generation; });
+			if(mStop)
+				return;
+			generation = mGeneration;
+		}
+
+		stepRange( getSliceBegin(worker), getSliceBegin(worker + 1) );
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		assert(mRunning > 0);
+		if(--mRunning == 0)
+			mStepFinished.notify_one();
+	}
+}
+
+unsigned int VectorEnv::getSliceBegin(unsigned int worker) const
+{
+	return (unsigned long long)size() * worker / mSettings.threads;
+}
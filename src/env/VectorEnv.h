@@ -0,0 +1,159 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "Global.h"
+#include "BlobbyDebug.h"
+
+class DuelMatch;
+class InputSource;
+struct DuelMatchState;
+
+/*! \class VectorEnv
+	\brief many matches that are stepped together, for training bots
+	\details This is the interface for reinforcement learning. It runs a number of independent DuelMatches
+			with the normal rules, and exchanges actions, observations, rewards and done flags with the
+			caller through contiguous arrays, one entry per agent.
+			Usually both players of a match are agents. If an opponent is set, only the left player
+			is an agent and the right one is controlled by the opponent's InputSource.
+			Every agent sees the match as if it were the left player, i.e. the observations and actions of
+			right agents are mirrored, so one policy can play on both sides.
+			Finished matches are reset automatically. The observation after such a step already belongs to
+			the new match, while reward and done flag still belong to the old one.
+			After reset(), stepping does not allocate any memory in the environment itself, and the matches
+			are distributed over a fixed set of worker threads.
+			The rules are loaded through the FileSystem, so one has to exist when reset() is called.
+*/
+class VectorEnv : public ObjectCounter<VectorEnv>
+{
+	public:
+		/// layout of the observation of a single agent. Positions are divided by the width of the
+		/// field, heights are measured upwards from the ground, velocities point upwards and are
+		/// divided by the velocity of a ball hit.
+		enum Observation
+		{
+			OWN_POSITION_X,
+			OWN_POSITION_Y,
+			OWN_VELOCITY_X,
+			OWN_VELOCITY_Y,
+			OPPONENT_POSITION_X,
+			OPPONENT_POSITION_Y,
+			OPPONENT_VELOCITY_X,
+			OPPONENT_VELOCITY_Y,
+			BALL_POSITION_X,
+			BALL_POSITION_Y,
+			BALL_VELOCITY_X,
+			BALL_VELOCITY_Y,
+			OWN_TOUCHES,
+			OPPONENT_TOUCHES,
+			/// 1 if the agent serves, -1 if the opponent serves
+			SERVING,
+			BALL_VALID,
+			GAME_RUNNING,
+			OBSERVATION_SIZE
+		};
+
+		/// actions are the bits of PlayerInput::getAll: 4 is left, 2 is right and 1 is jump
+		static const int ACTION_COUNT = 8;
+
+		typedef std::function<std::shared_ptr<InputSource>()> opponent_fn;
+
+		struct Settings
+		{
+			std::string rules = DEFAULT_RULES_FILE;
+			int scoreToWin = 15;
+			bool deterministicPhysics = false;
+			/// matches that take longer are ended, with done set. Zero means no limit.
+			unsigned int maxSteps = 75 * 120;
+			/// number of threads stepping the matches, including the calling thread
+			unsigned int threads = 1;
+			/// creates the InputSource of the right player of every match. If this is empty,
+			/// both players are agents.
+			opponent_fn opponent;
+		};
+
+		explicit VectorEnv(const Settings& settings);
+		~VectorEnv();
+
+		VectorEnv(const VectorEnv&) = delete;
+		VectorEnv& operator=(const VectorEnv&) = delete;
+
+		/// starts \p count new matches. Afterwards, the observations of the first frame are available.
+		void reset(unsigned int count);
+
+		/// steps all matches by one frame. \p actions has one entry per agent.
+		void step(const int* actions);
+
+		/// number of matches
+		unsigned int size() const;
+		/// number of agents in each match
+		unsigned int getAgentsPerMatch() const;
+		/// number of agents in all matches. This is the length of the reward and done arrays.
+		unsigned int getAgentCount() const;
+
+		/// OBSERVATION_SIZE values for every agent
+		const float* getObservations() const;
+		/// the points won minus the points lost by every agent in the last step
+		const float* getRewards() const;
+		/// 1 for every agent whose match ended in the last step, 0 otherwise
+		const float* getDone() const;
+
+		const Settings& getSettings() const;
+
+	private:
+		struct Environment;
+
+		// steps the matches [begin, end)
+		void stepRange(unsigned int begin, unsigned int end);
+		// writes the observations of match \p index
+		void observe(unsigned int index, const DuelMatchState& state);
+		// main function of the worker threads
+		void runWorker(unsigned int worker);
+		// the range of matches that belong to \p worker
+		unsigned int getSliceBegin(unsigned int worker) const;
+
+		Settings mSettings;
+		unsigned int mAgentsPerMatch;
+
+		std::vector<std::unique_ptr<Environment>> mEnvironments;
+		std::vector<float> mObservations;
+		std::vector<float> mRewards;
+		std::vector<float> mDone;
+		const int* mActions = nullptr;
+
+		// worker synchronisation: each step increases the generation, and the workers report back
+		// when their slice is done
+		std::vector<std::thread> mWorkers;
+		std::mutex mMutex;
+		std::condition_variable mStepStarted;
+		std::condition_variable mStepFinished;
+		unsigned int mGeneration = 0;
+		unsigned int mRunning = 0;
+		bool mStop = false;
+};
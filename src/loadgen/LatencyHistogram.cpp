@@ -0,0 +1,96 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+/* header include */
+#include "LatencyHistogram.h"
+
+/* includes */
+#include <algorithm>
+#include <cmath>
+
+/* implementation */
+
+void LatencyHistogram::add(std::uint64_t value)
+{
+	unsigned int bucket = getBucket(value);
+	if(bucket >= mCounts.size())
+		mCounts.resize(bucket + 1, 0);
+
+	++mCounts[bucket];
+	++mCount;
+	mSum += value;
+	mMaximum = std::max(mMaximum, value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+	if(other.mCounts.size() > mCounts.size())
+		mCounts.resize(other.mCounts.size(), 0);
+
+	for(unsigned int bucket = 0; bucket < other.mCounts.size(); ++bucket)
+		mCounts[bucket] += other.mCounts[bucket];
+
+	mCount += other.mCount;
+	mSum += other.mSum;
+	mMaximum = std::max(mMaximum, other.mMaximum);
+}
+
+double LatencyHistogram::getMean() const
+{
+	return mCount == 0 ? 0.0 : double(mSum) / mCount;
+}
+
+std::uint64_t LatencyHistogram::getPercentile(double percent) const
+{
+	if(mCount == 0)
+		return 0;
+
+	// the rank of the sample we are looking for, counted from 1
+	double rank = std::ceil(std::min(std::max(percent, 0.0), 100.0) / 100.0 * mCount);
+	std::uint64_t needed = std::max(std::uint64_t(1), std::uint64_t(rank));
+
+	std::uint64_t seen = 0;
+	for(unsigned int bucket = 0; bucket < mCounts.size(); ++bucket)
+	{
+		seen += mCounts[bucket];
+		if(seen >= needed)
+			return std::min(getUpperBound(bucket), mMaximum);
+	}
+
+	return mMaximum;
+}
+
+unsigned int LatencyHistogram::getBucket(std::uint64_t value)
+{
+	// shift the value until it has as many significant bits as a sub bucket index
+	unsigned int shift = 0;
+	while((value >> shift) >= 2 * SUB_BUCKETS)
+		++shift;
+
+	return shift * SUB_BUCKETS + unsigned(value >> shift);
+}
+
+std::uint64_t LatencyHistogram::getUpperBound(unsigned int bucket)
+{
+	unsigned int shift = bucket < 2 * SUB_BUCKETS ? 0 : bucket / SUB_BUCKETS - 1;
+	std::uint64_t index = bucket - shift * SUB_BUCKETS;
+	return ((index + 1) << shift) - 1;
+}
@@ -0,0 +1,59 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*! \brief counts samples in buckets of bounded relative width, to report percentiles with fixed memory
+	\details Values below 2 * SUB_BUCKETS have a bucket of their own. Larger values share a bucket with
+			values that differ by less than 1 / SUB_BUCKETS of their size, so a percentile is never more
+			than that too large. Histograms can be merged, so every thread can count its own samples.
+*/
+class LatencyHistogram
+{
+	public:
+		static const unsigned int SUB_BUCKETS = 64;
+
+		/// adds a sample
+		void add(std::uint64_t value);
+		/// adds all samples of \p other
+		void merge(const LatencyHistogram& other);
+
+		std::uint64_t getCount() const { return mCount; }
+		std::uint64_t getMaximum() const { return mMaximum; }
+		double getMean() const;
+
+		/// smallest value that at least \p percent percent of the samples do not exceed, up to the
+		/// width of its bucket. Returns 0 if there are no samples.
+		std::uint64_t getPercentile(double percent) const;
+
+	private:
+		static unsigned int getBucket(std::uint64_t value);
+		/// largest value that is counted in \p bucket
+		static std::uint64_t getUpperBound(unsigned int bucket);
+
+		std::vector<std::uint64_t> mCounts;
+		std::uint64_t mCount = 0;
+		std::uint64_t mSum = 0;
+		std::uint64_t mMaximum = 0;
+};
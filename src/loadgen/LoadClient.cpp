@@ -0,0 +1,406 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+/* header include */
+#include "LoadClient.h"
+
+/* includes */
+#include <algorithm>
+#include <cstdlib>
+
+#include "GenericIO.h"
+#include "NetworkMessage.h"
+#include "PlayerIdentity.h"
+#include "raknet/PacketEnumerations.h"
+
+/* implementation */
+
+void LoadStatistics::merge(const LoadStatistics& other)
+{
+	connect.merge(other.connect);
+	matchStart.merge(other.matchStart);
+	inputLatency.merge(other.inputLatency);
+	tickJitter.merge(other.tickJitter);
+
+	connections += other.connections;
+	refused += other.refused;
+	failed += other.failed;
+	timeouts += other.timeouts;
+	matchesStarted += other.matchesStarted;
+	matchesFinished += other.matchesFinished;
+	opponentsLost += other.opponentsLost;
+	updates += other.updates;
+}
+
+LoadClient::LoadClient(const LoadSettings& settings, std::string name, std::string hostName, unsigned int seed) :
+	mSettings(settings),
+	mName(std::move(name)),
+	mHostName(std::move(hostName)),
+	mRandom(seed),
+	mState(State::IDLE),
+	mLastProgress(0)
+{
+	NetworkImpairmentSettings impairment = settings.impairment;
+	impairment.seed += 2 * seed;
+	mClient.SetNetworkImpairment(impairment);
+	mClient.setUpdateCallback([this](){ update(); });
+}
+
+LoadClient::~LoadClient()
+{
+	mClient.Disconnect(0);
+}
+
+void LoadClient::connect(const std::string& host, unsigned short port)
+{
+	mConnectTime = Clock::now();
+	mGameRequested = false;
+	mGameSpeed = 0;
+	mLastTimeBack = 0;
+	mLastFrame = 0;
+	mInputFrame = 0;
+	setState(State::CONNECTING);
+
+	if(!mClient.Connect(host.c_str(), port, 0, 0, RAKNET_THREAD_SLEEP_TIME))
+	{
+		std::lock_guard<std::mutex> lock(mStatisticsMutex);
+		++mStatistics.failed;
+		setState(State::FAILED);
+	}
+}
+
+void LoadClient::disconnect()
+{
+	mClient.Disconnect(50);
+	setState(State::IDLE);
+}
+
+bool LoadClient::isStuck(Clock::time_point now) const
+{
+	State state = mState;
+	if(state == State::IDLE || state == State::FINISHED || state == State::FAILED)
+		return false;
+
+	return now - Clock::time_point(Clock::duration(mLastProgress.load())) > mSettings.timeout;
+}
+
+void LoadClient::collect(LoadStatistics& statistics)
+{
+	std::lock_guard<std::mutex> lock(mStatisticsMutex);
+	statistics.merge(mStatistics);
+	mStatistics = LoadStatistics();
+}
+
+void LoadClient::update()
+{
+	packet_ptr packet;
+	while ((packet = mClient.Receive()))
+		processPacket(packet, Clock::now());
+}
+
+void LoadClient::processPacket(const packet_ptr& packet, Clock::time_point now)
+{
+	switch(packet->data[0])
+	{
+		case ID_CONNECTION_REQUEST_ACCEPTED:
+		{
+			{
+				std::lock_guard<std::mutex> lock(mStatisticsMutex);
+				mStatistics.connect.add( micros(now - mConnectTime) );
+				++mStatistics.connections;
+			}
+
+			PlayerIdentity identity(mName);
+			identity.setPreferredSide( mHostName.empty() ? LEFT_PLAYER : RIGHT_PLAYER );
+			RakNet::BitStream stream = makeEnterServerPacket( identity );
+			mClient.Send(&stream, LOW_PRIORITY, RELIABLE_ORDERED, 0);
+
+			mEnterTime = now;
+			setState(State::LOBBY);
+			break;
+		}
+
+		case ID_NO_FREE_INCOMING_CONNECTIONS:
+		{
+			std::lock_guard<std::mutex> lock(mStatisticsMutex);
+			++mStatistics.refused;
+			setState(State::FAILED);
+			break;
+		}
+
+		case ID_CONNECTION_ATTEMPT_FAILED:
+		case ID_CONNECTION_LOST:
+		case ID_DISCONNECTION_NOTIFICATION:
+		{
+			if(mState == State::FINISHED)
+				break;
+
+			std::lock_guard<std::mutex> lock(mStatisticsMutex);
+			++mStatistics.failed;
+			setState(State::FAILED);
+			break;
+		}
+
+		case ID_LOBBY:
+		{
+			RakNet::BitStream stream = packet->getStream();
+			processLobbyPacket(stream);
+			break;
+		}
+
+		// the game was created, we already know the rules
+		case ID_RULES_CHECKSUM:
+		{
+			RakNet::BitStream stream;
+			stream.Write((unsigned char)ID_RULES);
+			stream.Write(false);
+			mClient.Send(&stream, HIGH_PRIORITY, RELIABLE_ORDERED, 0);
+			setState(State::STARTING);
+			break;
+		}
+
+		case ID_GAME_READY:
+		{
+			RakNet::BitStream stream((char*)packet->data, packet->length, false);
+			stream.IgnoreBytes(1);	// ID_GAME_READY
+			stream.Read(mGameSpeed);
+
+			{
+				std::lock_guard<std::mutex> lock(mStatisticsMutex);
+				mStatistics.matchStart.add( micros(now - mEnterTime) );
+				++mStatistics.matchesStarted;
+			}
+
+			setState(State::PLAYING);
+			sendInput(now);
+			break;
+		}
+
+		case ID_GAME_UPDATE:
+		{
+			RakNet::BitStream stream((char*)packet->data, packet->length, false);
+			stream.IgnoreBytes(1);	// ID_GAME_UPDATE
+			unsigned timeBack;
+			stream.Read(timeBack);
+			processGameUpdate(timeBack, 0, false, now);
+			break;
+		}
+
+		case ID_GAME_UPDATE_DELTA:
+		{
+			RakNet::BitStream stream((char*)packet->data, packet->length, false);
+			stream.IgnoreBytes(1);	// ID_GAME_UPDATE_DELTA
+			unsigned timeBack;
+			unsigned frame;
+			stream.Read(timeBack);
+			stream.Read(frame);
+			processGameUpdate(timeBack, frame, true, now);
+			break;
+		}
+
+		case ID_WIN_NOTIFICATION:
+		{
+			std::lock_guard<std::mutex> lock(mStatisticsMutex);
+			++mStatistics.matchesFinished;
+			setState(State::FINISHED);
+			break;
+		}
+
+		case ID_OPPONENT_DISCONNECTED:
+		{
+			std::lock_guard<std::mutex> lock(mStatisticsMutex);
+			++mStatistics.opponentsLost;
+			setState(State::FINISHED);
+			break;
+		}
+
+		// everything else is only interesting for the user interface
+		default:
+			break;
+	}
+}
+
+void LoadClient::processLobbyPacket(RakNet::BitStream& stream)
+{
+	auto in = createGenericReader( &stream );
+	unsigned char type;
+	in->byte(type);	// ID_LOBBY
+	in->byte(type);
+
+	if((LobbyPacketType)type == LobbyPacketType::SERVER_STATUS)
+	{
+		uint32_t playerCount;
+		std::vector<unsigned int> speeds;
+		std::vector<std::string> rules;
+		std::vector<std::string> authors;
+		std::vector<unsigned int> gameIDs;
+		std::vector<std::string> gameNames;
+		in->uint32( playerCount );
+		in->generic<std::vector<unsigned int>>( speeds );
+		in->generic<std::vector<std::string>>( rules );
+		in->generic<std::vector<std::string>>( authors );
+		in->generic<std::vector<unsigned int>>( gameIDs );
+		in->generic<std::vector<std::string>>( gameNames );
+
+		if(mGameRequested)
+			return;
+
+		if(mHostName.empty())
+		{
+			// the first speed and rules of the server
+			RakNet::BitStream open;
+			open.Write((unsigned char)ID_LOBBY);
+			open.Write((unsigned char)LobbyPacketType::OPEN_GAME);
+			open.Write( 0u );
+			open.Write( unsigned(mSettings.scoreToWin) );
+			open.Write( 0u );
+			mClient.Send(&open, HIGH_PRIORITY, RELIABLE_ORDERED, 0);
+			mGameRequested = true;
+			return;
+		}
+
+		// the server names the games after their creators
+		for(unsigned i = 0; i < gameIDs.size() && i < gameNames.size(); ++i)
+		{
+			if(gameNames[i] != mHostName + "'s game")
+				continue;
+
+			RakNet::BitStream join;
+			join.Write((unsigned char)ID_LOBBY);
+			join.Write((unsigned char)LobbyPacketType::JOIN_GAME);
+			join.Write( gameIDs[i] );
+			mClient.Send(&join, LOW_PRIORITY, RELIABLE_ORDERED, 0);
+			mGameRequested = true;
+			return;
+		}
+	}
+	else if((LobbyPacketType)type == LobbyPacketType::GAME_STATUS)
+	{
+		unsigned gameID, speed, rules, score;
+		PlayerID creator;
+		std::string name;
+		std::vector<PlayerID> players;
+		in->uint32( gameID );
+		in->generic<PlayerID>( creator );
+		in->string( name );
+		in->uint32( speed );
+		in->uint32( rules );
+		in->uint32( score );
+		in->generic<std::vector<PlayerID>>( players );
+
+		// the host starts as soon as somebody joined
+		if(mHostName.empty() && !players.empty())
+		{
+			RakNet::BitStream start;
+			start.Write((unsigned char)ID_LOBBY);
+			start.Write((unsigned char)LobbyPacketType::START_GAME);
+			auto out = createGenericWriter(&start);
+			out->generic<PlayerID>( players.front() );
+			mClient.Send(&start, LOW_PRIORITY, RELIABLE_ORDERED, 0);
+		}
+	}
+	else if((LobbyPacketType)type == LobbyPacketType::REMOVED_FROM_GAME && mState == State::LOBBY)
+	{
+		// open or look for the game again with the next server status. Once the match started, the
+		// open game is removed, too.
+		mGameRequested = false;
+	}
+}
+
+void LoadClient::processGameUpdate(unsigned timeBack, unsigned frame, bool hasFrame, Clock::time_point now)
+{
+	if(mState != State::PLAYING)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mStatisticsMutex);
+		++mStatistics.updates;
+
+		// the server repeats the newest input it knows until the next one arrives, and -1 before the first
+		if(timeBack != mLastTimeBack && timeBack != unsigned(-1))
+			mStatistics.inputLatency.add( unsigned(micros(now - mSettings.epoch)) - timeBack );
+
+		// updates may be lost or arrive out of order, so we compare with the ticks in between
+		if(hasFrame && mLastFrame != 0 && frame > mLastFrame && mGameSpeed > 0)
+		{
+			std::int64_t interval = micros(now - mLastUpdateTime);
+			std::int64_t expected = std::int64_t(frame - mLastFrame) * 1000000 / mGameSpeed;
+			mStatistics.tickJitter.add( std::llabs(interval - expected) );
+		}
+	}
+
+	mLastTimeBack = timeBack;
+	if(hasFrame && frame > mLastFrame)
+	{
+		mLastFrame = frame;
+		mLastUpdateTime = now;
+	}
+
+	setState(State::PLAYING);
+	sendInput(now);
+}
+
+void LoadClient::sendInput(Clock::time_point now)
+{
+	// the server echoes this id, so it tells us when the input was sent. Never 0, which means no input.
+	unsigned inputID = std::max(1u, unsigned(micros(now - mSettings.epoch)));
+
+	RakNet::BitStream stream;
+	stream.Write((unsigned char)ID_INPUT_UPDATE);
+	stream.Write( inputID );
+	nextInput().writeTo(stream);
+	stream.Write( mLastFrame );
+	mClient.Send(&stream, HIGH_PRIORITY, UNRELIABLE_SEQUENCED, 0);
+}
+
+PlayerInputAbs LoadClient::nextInput()
+{
+	unsigned frame = mInputFrame++;
+	switch(mSettings.inputMode)
+	{
+		case InputMode::IDLE:
+			return PlayerInputAbs();
+
+		case InputMode::PATTERN:
+			return mSettings.pattern.at( frame % mSettings.pattern.size() );
+
+		case InputMode::RANDOM:
+		default:
+			// humans keep their keys pressed for a while
+			if(std::uniform_int_distribution<int>(0, 9)(mRandom) == 0)
+			{
+				int keys = std::uniform_int_distribution<int>(0, 7)(mRandom);
+				mInput = PlayerInputAbs(keys & 1, keys & 2, keys & 4);
+			}
+			return mInput;
+	}
+}
+
+void LoadClient::setState(State state)
+{
+	mState = state;
+	mLastProgress = Clock::now().time_since_epoch().count();
+}
+
+std::uint64_t LoadClient::micros(Clock::duration duration)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
@@ -0,0 +1,167 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "PlayerInput.h"
+#include "raknet/RakClient.h"
+
+#include "LatencyHistogram.h"
+
+/// how the simulated players press their keys
+enum class InputMode
+{
+	RANDOM,
+	IDLE,
+	PATTERN
+};
+
+/// settings shared by all clients of a load test
+struct LoadSettings
+{
+	int scoreToWin = 5;
+	InputMode inputMode = InputMode::RANDOM;
+	/// keys of consecutive frames, repeated, for InputMode::PATTERN
+	std::vector<PlayerInputAbs> pattern;
+	/// clients that make no progress for this long are restarted
+	std::chrono::seconds timeout{30};
+	/// applied to the traffic of every client, with a seed of its own
+	NetworkImpairmentSettings impairment;
+	/// origin of the input ids, which the server echoes in its game updates
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+/// measurements of a set of clients, all durations in microseconds
+struct LoadStatistics
+{
+	/// from the connection request until the server accepted it
+	LatencyHistogram connect;
+	/// from entering the server until the match started
+	LatencyHistogram matchStart;
+	/// from sending an input until the first game update that contains it
+	LatencyHistogram inputLatency;
+	/// deviation of the time between game updates from the server tick
+	LatencyHistogram tickJitter;
+
+	unsigned long connections = 0;
+	/// connections the server refused because it was full
+	unsigned long refused = 0;
+	/// connections that failed or were lost
+	unsigned long failed = 0;
+	/// sessions that were restarted because they made no progress
+	unsigned long timeouts = 0;
+	unsigned long matchesStarted = 0;
+	unsigned long matchesFinished = 0;
+	/// matches that ended because the opponent left
+	unsigned long opponentsLost = 0;
+	/// game updates received
+	unsigned long updates = 0;
+
+	void merge(const LoadStatistics& other);
+};
+
+/*! \class LoadClient
+	\brief a headless client that plays matches on a server like a human player would
+	\details Clients come in pairs of a host, which opens a game in the lobby and starts it as soon as
+			its guest joined, and a guest, which looks for the game of its host by name. During the
+			match, the client answers every game update with an input, and acknowledges the update
+			frames so the server sends delta encoded updates.
+			All packets are handled in the network thread of the client as soon as they arrive, so the
+			measurements do not depend on how often the main thread looks at the clients. Connecting
+			and disconnecting are left to the main thread.
+*/
+class LoadClient
+{
+	public:
+		enum class State
+		{
+			IDLE,
+			CONNECTING,
+			LOBBY,
+			STARTING,
+			PLAYING,
+			FINISHED,
+			FAILED
+		};
+
+		/// \param name player name, at most 15 characters
+		/// \param hostName name of the host of the game to join, empty if this client hosts the game
+		LoadClient(const LoadSettings& settings, std::string name, std::string hostName, unsigned int seed);
+		~LoadClient();
+
+		/// connects to the server and starts a new session. Not callable from the network thread.
+		void connect(const std::string& host, unsigned short port);
+		/// ends the session, notifying the server
+		void disconnect();
+
+		State getState() const { return mState; }
+		/// true if the session made no progress within the timeout
+		bool isStuck(std::chrono::steady_clock::time_point now) const;
+
+		/// moves the measurements since the last call into \p statistics
+		void collect(LoadStatistics& statistics);
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		// called by the network thread after every update cycle
+		void update();
+		void processPacket(const packet_ptr& packet, Clock::time_point now);
+		void processLobbyPacket(RakNet::BitStream& stream);
+		void processGameUpdate(unsigned timeBack, unsigned frame, bool hasFrame, Clock::time_point now);
+		void sendInput(Clock::time_point now);
+		PlayerInputAbs nextInput();
+
+		void setState(State state);
+		static std::uint64_t micros(Clock::duration duration);
+
+		const LoadSettings& mSettings;
+		const std::string mName;
+		const std::string mHostName;
+		RakClient mClient;
+		std::mt19937 mRandom;
+
+		std::atomic<State> mState;
+		std::atomic<Clock::rep> mLastProgress;
+
+		// only used by the network thread while a session is running
+		Clock::time_point mConnectTime;
+		Clock::time_point mEnterTime;
+		bool mGameRequested;
+		int mGameSpeed;
+		unsigned mLastTimeBack;
+		unsigned mLastFrame;
+		Clock::time_point mLastUpdateTime;
+		unsigned mInputFrame;
+		PlayerInputAbs mInput;
+
+		// measurements that were not collected yet
+		std::mutex mStatisticsMutex;
+		LoadStatistics mStatistics;
+};
@@ -0,0 +1,360 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+
+/* includes */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+#include "Global.h"
+
+#include "LoadClient.h"
+
+/* implementation */
+
+struct ServerAddress
+{
+	std::string host;
+	unsigned short port;
+};
+
+struct LoadgenConfig
+{
+	std::vector<ServerAddress> servers;
+	unsigned int clients = 100;
+	unsigned int duration = 60;
+	// clients connected per second while the load ramps up
+	unsigned int ramp = 100;
+	unsigned int seed = 1;
+	std::string output = "-";
+};
+
+// a client, the server it plays on, and the restart that may be running in the background
+struct Slot
+{
+	std::unique_ptr<LoadClient> client;
+	const ServerAddress* server = nullptr;
+	bool started = false;
+	std::future<void> restart;
+};
+
+void printHelp()
+{
+	std::cout << "Usage: blobby-loadgen [OPTION...]" << std::endl;
+	std::cout << "Connects many headless clients to blobby-server, lets them play matches against each other" << std::endl;
+	std::cout << "and prints percentiles of connect time, match start time, input latency and tick jitter as CSV." << std::endl;
+	std::cout << "  -s, --server <host:port>  Server to load, may be given several times (default 127.0.0.1:1234)" << std::endl;
+	std::cout << "  -n, --clients <n>         Number of clients, rounded up to pairs (default 100)" << std::endl;
+	std::cout << "  -d, --duration <s>        Length of the test in seconds (default 60)" << std::endl;
+	std::cout << "  -r, --ramp <n>            Clients connected per second at the start (default 100)" << std::endl;
+	std::cout << "  -i, --input <mode>        random, idle, or a pattern of keys per frame like l,l,lu,r,- (default random)" << std::endl;
+	std::cout << "      --score-to-win <n>    Score to win of the matches (default 5)" << std::endl;
+	std::cout << "      --timeout <s>         Restart clients that make no progress for this long (default 30)" << std::endl;
+	std::cout << "      --impair <settings>   Simulate a bad network for every client, e.g. loss=0.05,latency=40" << std::endl;
+	std::cout << "      --seed <n>            Seed of the random inputs and the network impairment (default 1)" << std::endl;
+	std::cout << "  -o, --output <file>       Write the percentiles to file instead of stdout" << std::endl;
+	std::cout << "  -h, --help                This message" << std::endl;
+}
+
+// reads keys like "l,lu,r,-", where l, r and u stand for left, right and up
+bool parsePattern(const std::string& spec, std::vector<PlayerInputAbs>& pattern)
+{
+	pattern.clear();
+	std::string::size_type begin = 0;
+	while(begin <= spec.size())
+	{
+		std::string::size_type end = std::min(spec.find(',', begin), spec.size());
+		std::string keys = spec.substr(begin, end - begin);
+		if(keys.empty() || keys.find_first_not_of(keys == "-" ? "-" : "lru") != std::string::npos)
+			return false;
+
+		pattern.emplace_back( keys.find('l') != std::string::npos, keys.find('r') != std::string::npos,
+								keys.find('u') != std::string::npos );
+		begin = end + 1;
+	}
+	return !pattern.empty();
+}
+
+void process_arguments(int argc, char** argv, LoadgenConfig& config, LoadSettings& settings)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		// returns the argument of the current option
+		auto value = [&]() -> const char*
+		{
+			if (i + 1 >= argc)
+			{
+				std::cerr << "\"" << arg << "\" option needs an argument" << std::endl;
+				printHelp();
+				exit(1);
+			}
+			return argv[++i];
+		};
+		auto fail = [&](const std::string& reason)
+		{
+			std::cerr << reason << std::endl;
+			printHelp();
+			exit(1);
+		};
+
+		if (arg == "--server" || arg == "-s")
+		{
+			std::string address = value();
+			std::string::size_type colon = address.rfind(':');
+			int port = colon == std::string::npos ? 0 : std::atoi( address.c_str() + colon + 1 );
+			if (port <= 0 || port > 65535)
+				fail("\"" + address + "\" is not a server address like 127.0.0.1:1234");
+			config.servers.push_back( ServerAddress{address.substr(0, colon), (unsigned short)port} );
+		}
+		else if (arg == "--clients" || arg == "-n")
+			config.clients = std::max(2, std::atoi( value() ));
+		else if (arg == "--duration" || arg == "-d")
+			config.duration = std::max(1, std::atoi( value() ));
+		else if (arg == "--ramp" || arg == "-r")
+			config.ramp = std::max(1, std::atoi( value() ));
+		else if (arg == "--input" || arg == "-i")
+		{
+			std::string mode = value();
+			if (mode == "random")
+				settings.inputMode = InputMode::RANDOM;
+			else if (mode == "idle")
+				settings.inputMode = InputMode::IDLE;
+			else if (parsePattern(mode, settings.pattern))
+				settings.inputMode = InputMode::PATTERN;
+			else
+				fail("Invalid input \"" + mode + "\"");
+		}
+		else if (arg == "--score-to-win")
+			settings.scoreToWin = std::max(1, std::atoi( value() ));
+		else if (arg == "--timeout")
+			settings.timeout = std::chrono::seconds( std::max(1, std::atoi( value() )) );
+		else if (arg == "--impair")
+		{
+			std::string spec = value();
+			if (!settings.impairment.Parse( spec.c_str() ))
+				fail("Invalid network impairment \"" + spec + "\"");
+		}
+		else if (arg == "--seed")
+			config.seed = std::atoi( value() );
+		else if (arg == "--output" || arg == "-o")
+			config.output = value();
+		else if (arg == "--help" || arg == "-h")
+		{
+			printHelp();
+			exit(0);
+		}
+		else
+			fail("Unknown option \"" + arg + "\"");
+	}
+
+	if (config.servers.empty())
+		config.servers.push_back( ServerAddress{"127.0.0.1", 1234} );
+	config.clients += config.clients % 2;
+}
+
+// every client needs two sockets
+void raiseFileLimit(unsigned int clients)
+{
+	#ifndef WIN32
+	rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+		return;
+
+	rlim_t needed = 2 * rlim_t(clients) + 64;
+	if (limit.rlim_cur < needed)
+	{
+		limit.rlim_cur = std::min(needed, limit.rlim_max);
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+	if (limit.rlim_cur < needed)
+		std::cerr << "Only " << limit.rlim_cur << " files may be opened, some clients will fail to connect" << std::endl;
+	#endif
+}
+
+void writePercentiles(std::ostream& target, const LoadStatistics& statistics)
+{
+	auto write = [&target](const char* metric, const LatencyHistogram& histogram)
+	{
+		auto ms = [](double micros) { return micros / 1000.0; };
+		target << metric << "," << histogram.getCount() << "," << std::fixed << std::setprecision(3)
+				<< ms(histogram.getMean()) << "," << ms(histogram.getPercentile(50)) << ","
+				<< ms(histogram.getPercentile(90)) << "," << ms(histogram.getPercentile(99)) << ","
+				<< ms(histogram.getPercentile(99.9)) << "," << ms(histogram.getMaximum()) << "\n";
+	};
+
+	target << "metric,samples,mean_ms,p50_ms,p90_ms,p99_ms,p99.9_ms,max_ms\n";
+	write("connect", statistics.connect);
+	write("match_start", statistics.matchStart);
+	write("input_latency", statistics.inputLatency);
+	write("tick_jitter", statistics.tickJitter);
+}
+
+int main(int argc, char** argv)
+{
+	LoadgenConfig config;
+	LoadSettings settings;
+	process_arguments(argc, argv, config, settings);
+	raiseFileLimit(config.clients);
+
+	// clients come in pairs of a host and a guest, which play on the same server
+	std::vector<Slot> slots(config.clients);
+	for (unsigned int pair = 0; pair < config.clients / 2; ++pair)
+	{
+		std::string host = "host" + std::to_string(pair);
+		unsigned int seed = config.seed * config.clients + 2 * pair;
+		slots[2 * pair].client.reset( new LoadClient(settings, host, "", seed) );
+		slots[2 * pair + 1].client.reset( new LoadClient(settings, "guest" + std::to_string(pair), host, seed + 1) );
+		slots[2 * pair].server = slots[2 * pair + 1].server = &config.servers[pair % config.servers.size()];
+	}
+
+	LoadStatistics total;
+	auto collect = [&]()
+	{
+		for (auto& slot : slots)
+			slot.client->collect(total);
+	};
+
+	typedef std::chrono::steady_clock Clock;
+	auto start = Clock::now();
+	auto end = start + std::chrono::seconds(config.duration);
+	auto nextReport = start + std::chrono::seconds(10);
+	unsigned int started = 0;
+
+	for (auto now = start; now < end; now = Clock::now())
+	{
+		// ramp up
+		double elapsed = std::chrono::duration<double>(now - start).count();
+		unsigned int due = std::min(config.clients, unsigned(config.ramp * elapsed) + 1);
+		for (; started < due; ++started)
+		{
+			Slot& slot = slots[started];
+			slot.client->connect(slot.server->host, slot.server->port);
+			slot.started = true;
+		}
+
+		// start a new session once a match is over or a session got stuck, without blocking the others
+		unsigned int playing = 0;
+		for (auto& slot : slots)
+		{
+			if (!slot.started)
+				break;
+
+			if (slot.restart.valid())
+			{
+				if (slot.restart.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+					continue;
+				slot.restart.get();
+			}
+
+			LoadClient::State state = slot.client->getState();
+			playing += state == LoadClient::State::PLAYING;
+			bool stuck = slot.client->isStuck(now);
+			if (state != LoadClient::State::FINISHED && state != LoadClient::State::FAILED && !stuck)
+				continue;
+
+			total.timeouts += stuck;
+			LoadClient* client = slot.client.get();
+			const ServerAddress* server = slot.server;
+			slot.restart = std::async(std::launch::async, [client, server, state]()
+			{
+				client->disconnect();
+				// do not hammer a server that is full
+				if (state == LoadClient::State::FAILED)
+					std::this_thread::sleep_for(std::chrono::seconds(1));
+				client->connect(server->host, server->port);
+			});
+		}
+
+		collect();
+		if (now >= nextReport)
+		{
+			std::cerr << std::chrono::duration_cast<std::chrono::seconds>(now - start).count() << "s: "
+					<< total.connections << " connections, " << playing << " clients playing, "
+					<< total.matchesStarted / 2 << " matches started, " << total.matchesFinished / 2 << " finished" << std::endl;
+			nextReport += std::chrono::seconds(10);
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+
+	for (auto& slot : slots)
+	{
+		if (slot.restart.valid())
+			slot.restart.get();
+	}
+	collect();
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	// disconnecting waits for the notification to be sent, so we do that in parallel
+	std::vector<std::thread> stoppers;
+	unsigned int threads = 16;
+	for (unsigned int t = 0; t < threads; ++t)
+	{
+		stoppers.emplace_back([&slots, t, threads]()
+		{
+			for (unsigned int i = t; i < slots.size(); i += threads)
+			{
+				if (slots[i].started)
+					slots[i].client->disconnect();
+			}
+		});
+	}
+	for (auto& stopper : stoppers)
+		stopper.join();
+
+	if (config.output == "-")
+	{
+		writePercentiles(std::cout, total);
+	}
+	else
+	{
+		std::ofstream target(config.output);
+		writePercentiles(target, total);
+		if (!target)
+		{
+			std::cerr << "Could not write " << config.output << std::endl;
+			return 1;
+		}
+	}
+
+	// matches are counted by both clients
+	std::cerr << config.clients << " clients in " << std::fixed << std::setprecision(1) << seconds << "s: "
+			<< total.connections << " connections, " << total.refused << " refused, " << total.failed << " failed, "
+			<< total.timeouts << " timed out, " << total.matchesStarted / 2 << " matches started, "
+			<< total.matchesFinished / 2 << " finished, " << total.opponentsLost << " opponents lost, "
+			<< total.updates << " game updates" << std::endl;
+
+	return total.connections > 0 ? 0 : 1;
+}
@@ -51,6 +51,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "SpeedController.h"
 #include "Blood.h"
 #include "FileSystem.h"
+#include "ScriptWatchdog.h"
 #include "state/State.h"
 
 #if defined(WIN32)
@@ -230,6 +231,9 @@ void setupPHYSFS()
 
 		TextManager::createTextManager(gameConfig.getString("language"));
 
+		// keep bots and rules from freezing the game
+		ScriptWatchdog scriptWatchdog( ScriptWatchdog::readBudget(gameConfig) );
+
 		if(gameConfig.getString("device") == "SDL")
 			rmanager = RenderManager::createRenderManagerSDL();
 		/*else if (gameConfig.getString("device") == "GP2X")
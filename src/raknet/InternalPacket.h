@@ -35,6 +35,9 @@
 #ifdef _DEBUG
 #include "NetworkTypes.h"
 #endif
+
+struct ReceiveBuffer;
+
 /**
 * This must be able to hold the highest value of RECEIVED_PACKET_LOG_LENGTH.
 */
@@ -108,6 +111,10 @@ struct InternalPacket
 	* Buffer is a pointer to the actual data, assuming this packet has data at all
 	*/
 	char *data;
+	/**
+	* The received datagram data points into, 0 if data was allocated with new []
+	*/
+	ReceiveBuffer *receiveBuffer;
 };
 
 #endif
@@ -40,6 +40,8 @@ namespace RakNet
 	class BitStream;
 }
 
+struct ReceiveBuffer;
+
 /**
 * Typename for player index
 */
@@ -147,6 +149,11 @@ struct Packet
 	* @see PacketEnumerations.h
 	*/
 	unsigned char* data;
+	/**
+	* The pooled datagram data points into, 0 if data was allocated with new [].
+	* Managed by RakNet, do not change.
+	*/
+	ReceiveBuffer* receiveBuffer;
 
 
 	/**
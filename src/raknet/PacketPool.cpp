@@ -32,6 +32,93 @@
 #include "PacketPool.h"
 #include <cassert>
 
+void ReceiveBuffer::AddReference( void )
+{
+	references.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void ReceiveBuffer::Release( void )
+{
+	if ( references.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+		pool->ReturnPointer( this );
+}
+
+bool ReceiveBuffer::IsExclusive( void ) const
+{
+	return references.load( std::memory_order_acquire ) == 1;
+}
+
+ReceiveBufferPool::ReceiveBufferPool()
+{
+}
+
+ReceiveBufferPool::~ReceiveBufferPool()
+{
+#ifdef _DEBUG
+	// If this assert hits then some message still points into a buffer of this pool
+	assert( (int) pool.size() == GetAllocatedCount() );
+#endif
+
+	for ( unsigned i = 0; i < slabs.size(); ++i )
+		delete [] slabs[ i ];
+}
+
+ReceiveBuffer* ReceiveBufferPool::GetPointer( void )
+{
+	poolMutex.Lock();
+
+	if ( pool.empty() )
+	{
+		ReceiveBuffer *slab = new ReceiveBuffer[ BUFFERS_PER_SLAB ];
+		slabs.push_back( slab );
+
+		for ( int i = BUFFERS_PER_SLAB - 1; i >= 0; --i )
+		{
+			slab[ i ].pool = this;
+			pool.push( &slab[ i ] );
+		}
+	}
+
+	ReceiveBuffer *buffer = pool.top();
+	pool.pop();
+
+	poolMutex.Unlock();
+
+	buffer->references.store( 1, std::memory_order_relaxed );
+	return buffer;
+}
+
+void ReceiveBufferPool::ReturnPointer( ReceiveBuffer *buffer )
+{
+	poolMutex.Lock();
+	pool.push( buffer );
+	poolMutex.Unlock();
+}
+
+void ReceiveBufferPool::FreeData( char *data, ReceiveBuffer *buffer )
+{
+	if ( buffer )
+		buffer->Release();
+	else
+		delete [] data;
+}
+
+int ReceiveBufferPool::GetAllocatedCount( void ) const
+{
+	poolMutex.Lock();
+	int count = slabs.size() * BUFFERS_PER_SLAB;
+	poolMutex.Unlock();
+	return count;
+}
+
+int ReceiveBufferPool::GetFreeCount( void ) const
+{
+	poolMutex.Lock();
+	int count = pool.size();
+	poolMutex.Unlock();
+	return count;
+}
+
 PacketPool::PacketPool()
 {
 #ifdef _DEBUG
@@ -64,6 +151,12 @@ void PacketPool::ClearPool( void )
 		delete p;
 	}
 
+	while ( !controlBlocks.empty() )
+	{
+		::operator delete( controlBlocks.top() );
+		controlBlocks.pop();
+	}
+
 	poolMutex.Unlock();
 }
 
@@ -91,6 +184,7 @@ Packet* PacketPool::GetPointer( void )
 	p = new Packet;
 
 	p->data = 0;
+	p->receiveBuffer = 0;
 
 	return p;
 }
@@ -107,8 +201,9 @@ void PacketPool::ReleasePointer( Packet *p )
 		return ;
 	}
 
-	delete [] p->data;
+	ReceiveBufferPool::FreeData( ( char* ) p->data, p->receiveBuffer );
 	p->data = 0;
+	p->receiveBuffer = 0;
 
 	poolMutex.Lock();
 	pool.push( p );
@@ -121,3 +216,29 @@ void PacketPool::ReleasePointer( Packet *p )
 	poolMutex.Unlock();
 }
 
+void* PacketPool::GetControlBlock( void )
+{
+	void *block = 0;
+	poolMutex.Lock();
+
+	if ( !controlBlocks.empty() )
+	{
+		block = controlBlocks.top();
+		controlBlocks.pop();
+	}
+
+	poolMutex.Unlock();
+
+	if ( block )
+		return block;
+
+	return ::operator new( CONTROL_BLOCK_SIZE );
+}
+
+void PacketPool::ReleaseControlBlock( void *block )
+{
+	poolMutex.Lock();
+	controlBlocks.push( block );
+	poolMutex.Unlock();
+}
+
@@ -29,12 +29,124 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+
 #ifndef __PACKET_POOL
 #define __PACKET_POOL
 #include "SimpleMutex.h"
 #include "NetworkTypes.h"
+#include "MTUSize.h"
 
+#include <atomic>
+#include <cstddef>
+#include <new>
 #include <stack>
+#include <vector>
+
+class ReceiveBufferPool;
+
+/**
+* @brief A datagram as it was read from the socket.
+*
+* Messages that were not split are not copied out of the datagram, but point
+* into its data. Every such message holds a reference, so the buffer goes
+* back to its pool once the last message that was read from it is freed.
+*/
+
+struct ReceiveBuffer
+{
+	/**
+	* Take another reference, for a message that points into the data
+	*/
+	void AddReference( void );
+	/**
+	* Give back a reference, returning the buffer to its pool if it was the last one
+	*/
+	void Release( void );
+	/**
+	* True if nobody but the current owner holds a reference
+	*/
+	bool IsExclusive( void ) const;
+
+	/**
+	* Number of owners of this buffer
+	*/
+	std::atomic<int> references;
+	/**
+	* The pool this buffer is returned to
+	*/
+	ReceiveBufferPool *pool;
+	/**
+	* The datagram
+	*/
+	char data[ MAXIMUM_MTU_SIZE ];
+};
+
+/**
+* @brief Manage memory for received datagrams.
+*
+* Buffers are allocated in slabs of BUFFERS_PER_SLAB and never freed
+* before the pool is destroyed. Buffers can be released from any thread,
+* but the pool has to outlive all buffers it handed out.
+*/
+
+class ReceiveBufferPool
+{
+
+public:
+	/**
+	* Number of buffers allocated at once
+	*/
+	static const int BUFFERS_PER_SLAB = 64;
+
+	/**
+	* Constructor
+	*/
+	ReceiveBufferPool();
+	/**
+	* Destructor
+	*/
+	~ReceiveBufferPool();
+	/**
+	* Get a buffer, holding one reference
+	* @return a ReceiveBuffer object
+	*/
+	ReceiveBuffer* GetPointer( void );
+	/**
+	* Frees message data, either by releasing the buffer it points into or by deleting it
+	* @param data The data of the message
+	* @param buffer The buffer data points into, 0 if data was allocated with new []
+	*/
+	static void FreeData( char *data, ReceiveBuffer *buffer );
+	/**
+	* @return The number of buffers in all slabs
+	*/
+	int GetAllocatedCount( void ) const;
+	/**
+	* @return The number of buffers that are not in use
+	*/
+	int GetFreeCount( void ) const;
+
+private:
+	friend struct ReceiveBuffer;
+
+	/**
+	* Put a buffer without references back into the pool
+	*/
+	void ReturnPointer( ReceiveBuffer *buffer );
+
+	/**
+	* All memory of the pool
+	*/
+	std::vector<ReceiveBuffer*> slabs;
+	/**
+	* Store buffers which are not in use
+	*/
+	std::stack<ReceiveBuffer*> pool;
+	/**
+	* Exclusive access to the pool
+	*/
+	mutable SimpleMutex poolMutex;
+};
 
 /**
 * @brief Manage memory for packet. 
@@ -50,6 +162,11 @@ class PacketPool
 {
 
 public:
+	/**
+	* Size of the blocks returned by GetControlBlock
+	*/
+	static const std::size_t CONTROL_BLOCK_SIZE = 64;
+
 	/**
 	* Constructor
 	*/
@@ -69,6 +186,16 @@ public:
 	*/
 	void ReleasePointer( Packet *p );
 	/**
+	* Get memory for the reference count of a packet_ptr
+	* @return CONTROL_BLOCK_SIZE bytes
+	*/
+	void* GetControlBlock( void );
+	/**
+	* Free memory returned by GetControlBlock
+	* @param block The memory to free
+	*/
+	void ReleaseControlBlock( void *block );
+	/**
 	* Clear the Packet Pool 
 	*/
 	void ClearPool( void );
@@ -79,6 +206,10 @@ private:
 	*/
 	std::stack<Packet*> pool;
 	/**
+	* Store control blocks
+	*/
+	std::stack<void*> controlBlocks;
+	/**
 	* Exclusive access to the pool
 	*/
 	SimpleMutex poolMutex;
@@ -91,5 +222,40 @@ private:
 #endif
 };
 
+/**
+* @brief Allocator that takes the control blocks of packet_ptr from a PacketPool,
+* so handing out a packet does not allocate memory once the pool is warm.
+*/
+
+template <class T>
+struct PacketPoolAllocator
+{
+	typedef T value_type;
+
+	explicit PacketPoolAllocator( PacketPool *p ) : pool( p ) {}
+	template <class U> PacketPoolAllocator( const PacketPoolAllocator<U>& other ) : pool( other.pool ) {}
+
+	T* allocate( std::size_t n )
+	{
+		if ( n != 1 || sizeof( T ) > PacketPool::CONTROL_BLOCK_SIZE )
+			return static_cast<T*>( ::operator new( n * sizeof( T ) ) );
+
+		return static_cast<T*>( pool->GetControlBlock() );
+	}
+
+	void deallocate( T* p, std::size_t n )
+	{
+		if ( n != 1 || sizeof( T ) > PacketPool::CONTROL_BLOCK_SIZE )
+			::operator delete( p );
+		else
+			pool->ReleaseControlBlock( p );
+	}
+
+	template <class U> bool operator==( const PacketPoolAllocator<U>& other ) const { return pool == other.pool; }
+	template <class U> bool operator!=( const PacketPoolAllocator<U>& other ) const { return pool != other.pool; }
+
+	PacketPool *pool;
+};
+
 #endif
 
@@ -66,7 +66,7 @@ public:
 	* @param serverPort The port on which to contact @em host
 	* @param clientPort The port to use localy
 	* @param depreciated is legacy and unused
-	* @param threadSleepTimer >=0 for how many ms to Sleep each internal update cycle
+	* @param threadSleepTimer >=0, kept for compatibility. See RakPeer::Initialize
 	* (recommended 30 for low performance, 0 for regular)
 	* @return true on successful initiation, false otherwise
 	*/
@@ -94,6 +94,9 @@
 static const unsigned int SYN_COOKIE_OLD_RANDOM_NUMBER_DURATION = 5000;
 static const int MAX_OFFLINE_DATA_LENGTH=400; // I set this because I limit ID_CONNECTION_REQUEST to 512 bytes, and the password is appended to that packet.
 
+// The update thread wakes up at least this often (in ms), even if no packets arrive and no timer is due
+static const unsigned int MAXIMUM_UPDATE_WAIT = 100;
+
 //#define _DO_PRINTF
 
 // UPDATE_THREAD_POLL_TIME is how often the update thread will poll to see
@@ -106,7 +109,7 @@ static const int MAX_OFFLINE_DATA_LENGTH=400; // I set this because I limit ID_C
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 // Constructor
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-RakPeer::RakPeer()
+RakPeer::RakPeer() : receiveBatch( &receiveBufferPool )
 {
 	connectionSocket = INVALID_SOCKET;
 	MTUSize = DEFAULT_MTU_SIZE;
@@ -118,6 +121,11 @@ RakPeer::RakPeer()
 	endThreads = true;
 	isMainLoopThreadActive = false;
 	connectionSocket = INVALID_SOCKET;
+	wakeupSocket = INVALID_SOCKET;
+	wakeupPending = false;
+	impairmentChanged = false;
+	receiveBatch.SetImpairment( &incomingImpairment );
+	sendBatch.SetImpairment( &outgoingImpairment );
 	myPlayerId = UNASSIGNED_PLAYER_ID;
 	allowConnectionResponseIPMigration = false;
 	incomingPacketQueue.clearAndForceAllocation(128);
@@ -201,6 +209,9 @@ bool RakPeer::Initialize( unsigned short MaximumNumberOfPeers, unsigned short lo
 		// Create the threads
 		threadSleepTimer = _threadSleepTimer;
 
+		if ( wakeupSocket == INVALID_SOCKET )
+			wakeupSocket = SocketLayer::Instance()->CreateWakeupSocket();
+
 		ClearBufferedCommands();
 
 		char ipList[ 10 ][ 16 ];
@@ -257,9 +268,9 @@ bool RakPeer::Initialize( unsigned short MaximumNumberOfPeers, unsigned short lo
 
 			while (  /*isRecvfromThreadActive==false || */isMainLoopThreadActive == false )
 #ifdef _WIN32
-				Sleep( 10 );
+				Sleep( 1 );
 #else
-				usleep( 10 * 1000 );
+				usleep( 1000 );
 #endif
 
 		}
@@ -423,6 +434,7 @@ void RakPeer::Disconnect( unsigned int blockDuration )
 	{
 		// Stop the threads
 		endThreads = true;
+		WakeUpdateThread();
 
 		// Normally the thread will call DecreaseUserCount on termination but if we aren't using threads just do it
 		// manually
@@ -430,9 +442,9 @@ void RakPeer::Disconnect( unsigned int blockDuration )
 
 	while ( isMainLoopThreadActive )
 #ifdef _WIN32
-		Sleep( 15 );
+		Sleep( 1 );
 #else
-		usleep( 15 * 1000 );
+		usleep( 1000 );
 #endif
 
 	// Reset the remote system list after the threads are known to have stopped so threads do not add or update data to them after they are reset
@@ -458,6 +470,12 @@ void RakPeer::Disconnect( unsigned int blockDuration )
 		connectionSocket = INVALID_SOCKET;
 	}
 
+	if ( wakeupSocket != INVALID_SOCKET )
+	{
+		closesocket( wakeupSocket );
+		wakeupSocket = INVALID_SOCKET;
+	}
+
 	// Clear out the queues
 	while ( incomingPacketQueue.size() )
 		packetPool.ReleasePointer( incomingPacketQueue.pop() );
@@ -465,6 +483,10 @@ void RakPeer::Disconnect( unsigned int blockDuration )
 	ClearBufferedCommands();
 	bytesSentPerSecond = bytesReceivedPerSecond = 0;
 
+	// Datagrams held back by the network impairment belong to the closed socket
+	incomingImpairment.Clear();
+	outgoingImpairment.Clear();
+
 	ClearRequestedConnectionList();
 
 
@@ -647,7 +669,7 @@ packet_ptr RakPeer::Receive( void )
 
 	deleter del;
 	del.peer = this;
-	return packet_ptr(val, del);
+	return packet_ptr(val, del, PacketPoolAllocator<Packet>( &packetPool ));
 }
 
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -787,6 +809,7 @@ void RakPeer::Ping( const char* host, unsigned short remotePort, bool onlyReplyO
 		else
 			rcs->actionToTake=RequestedConnectionStruct::PING;
 		requestedConnectionList.WriteUnlock();
+		WakeUpdateThread();
 	}
 }
 
@@ -1015,6 +1038,7 @@ void RakPeer::AdvertiseSystem( char *host, unsigned short remotePort, const char
 	}
 	rcs->actionToTake=RequestedConnectionStruct::ADVERTISE_SYSTEM;
 	requestedConnectionList.WriteUnlock();
+	WakeUpdateThread();
 
 //	unsigned char c = ID_ADVERTISE_SYSTEM;
 //	RakNet::BitStream temp(sizeof(c));
@@ -1079,6 +1103,7 @@ bool RakPeer::SendConnectionRequest( const char* host, unsigned short remotePort
 	rcs->data=0;
 	rcs->actionToTake=RequestedConnectionStruct::CONNECT;
 	requestedConnectionList.WriteUnlock();
+	WakeUpdateThread();
 
 	// Request will be sent in the other thread
 
@@ -1304,11 +1329,14 @@ void RakPeer::CloseConnectionInternalBuffered( PlayerID target, bool sendDisconn
 	else
 	{
 		BufferedCommandStruct *bcs;
+		bufferedCommandsMutex.Lock();
 		bcs=bufferedCommands.WriteLock();
 		bcs->command=BufferedCommandStruct::BCS_CLOSE_CONNECTION;
 		bcs->playerId=target;
 		bcs->data=0;
 		bufferedCommands.WriteUnlock();
+		bufferedCommandsMutex.Unlock();
+		WakeUpdateThread();
 	}
 }
 
@@ -1353,10 +1381,12 @@ bool RakPeer::ValidSendTarget(PlayerID playerId, bool broadcast)
 void RakPeer::SendBuffered( const RakNet::BitStream * bitStream, PacketPriority priority, PacketReliability reliability, char orderingChannel, PlayerID playerId, bool broadcast, RemoteSystemStruct::ConnectMode connectionMode )
 {
 	BufferedCommandStruct *bcs;
-	bcs=bufferedCommands.WriteLock();
+	char *data = new char[bitStream->GetNumberOfBytesUsed()]; // Making a copy doesn't lose efficiency because I tell the reliability layer to use this allocation for its own copy
+	memcpy(data, bitStream->GetData(), bitStream->GetNumberOfBytesUsed());
 
-	bcs->data = new char[bitStream->GetNumberOfBytesUsed()]; // Making a copy doesn't lose efficiency because I tell the reliability layer to use this allocation for its own copy
-	memcpy(bcs->data, bitStream->GetData(), bitStream->GetNumberOfBytesUsed());
+	bufferedCommandsMutex.Lock();
+	bcs=bufferedCommands.WriteLock();
+	bcs->data = data;
     bcs->numberOfBitsToSend=bitStream->GetNumberOfBitsUsed();
 	bcs->priority=priority;
 	bcs->reliability=reliability;
@@ -1366,6 +1396,8 @@ void RakPeer::SendBuffered( const RakNet::BitStream * bitStream, PacketPriority
 	bcs->connectionMode=connectionMode;
 	bcs->command=BufferedCommandStruct::BCS_SEND;
 	bufferedCommands.WriteUnlock();
+	bufferedCommandsMutex.Unlock();
+	WakeUpdateThread();
 }
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 bool RakPeer::SendImmediate( char *data, int numberOfBitsToSend, PacketPriority priority, PacketReliability reliability, char orderingChannel, PlayerID playerId, bool broadcast, bool useCallerDataAllocation, unsigned int currentTime )
@@ -1436,9 +1468,9 @@ void RakPeer::ClearRequestedConnectionList(void)
 
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 #ifdef _WIN32
-void __stdcall ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, RakPeer *rakPeer )
+void __stdcall ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, ReceiveBuffer *receiveBuffer, RakPeer *rakPeer )
 #else
-void ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, RakPeer *rakPeer )
+void ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, ReceiveBuffer *receiveBuffer, RakPeer *rakPeer )
 #endif
 {
 	PlayerID playerId;
@@ -1578,7 +1610,7 @@ void ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, cons
 	{
 		// Handle regular incoming data
 		// HandleSocketReceiveFromConnectedPlayer is only safe to be called from the same thread as Update, which is this thread
-		if ( remoteSystem->reliabilityLayer.HandleSocketReceiveFromConnectedPlayer( data, length ) == false )
+		if ( remoteSystem->reliabilityLayer.HandleSocketReceiveFromConnectedPlayer( data, length, receiveBuffer ) == false )
 		{
 			// These kinds of packets may have been duplicated and incorrectly determined to be
 			// cheat packets.  Anything else really is a cheat packet
@@ -1635,6 +1667,7 @@ bool RakPeer::RunUpdateCycle( void )
 	//PlayerID authoritativeClientPlayerId;
 	int bitSize, byteSize;
 	char *data;
+	ReceiveBuffer *receiveBuffer;
 	int errorCode;
 	int gotData;
 	unsigned int time;
@@ -1643,10 +1676,22 @@ bool RakPeer::RunUpdateCycle( void )
 	bool callerDataAllocationUsed;
 	RakNetStatisticsStruct *rnss;
 
+	if ( impairmentChanged )
+	{
+		impairmentMutex.Lock();
+		NetworkImpairmentSettings settings = impairmentSettings;
+		impairmentChanged = false;
+		impairmentMutex.Unlock();
+
+		incomingImpairment.SetSettings( settings );
+		++settings.seed;
+		outgoingImpairment.SetSettings( settings );
+	}
+
 	do
 	{
-		// Read a packet
-		gotData = SocketLayer::Instance()->RecvFrom( connectionSocket, this, &errorCode );
+		// Read as many packets as fit into the batch
+		gotData = SocketLayer::Instance()->RecvFromBatch( connectionSocket, receiveBatch, &errorCode );
 
 		if ( gotData == SOCKET_ERROR )
 		{
@@ -1684,10 +1729,16 @@ bool RakPeer::RunUpdateCycle( void )
 #endif
 		}
 
+		for ( int i = 0; i < receiveBatch.Size(); ++i )
+		{
+			if ( receiveBatch.GetLength( i ) > 0 )
+				ProcessNetworkPacket( receiveBatch.GetBinaryAddress( i ), receiveBatch.GetPort( i ), receiveBatch.GetData( i ), receiveBatch.GetLength( i ), receiveBatch.GetBuffer( i ), this );
+		}
+
 		if ( endThreads )
 			return false;
 	}
-	while ( gotData>0 ); // Read until there is nothing left
+	while ( receiveBatch.IsFull() ); // Read until there is nothing left
 
 	time=0;
 
@@ -1831,7 +1882,7 @@ bool RakPeer::RunUpdateCycle( void )
 				}
 			}
 
-			remoteSystem->reliabilityLayer.Update( connectionSocket, playerId, MTUSize, time ); // playerId only used for the internet simulator test
+			remoteSystem->reliabilityLayer.Update( connectionSocket, &sendBatch, playerId, MTUSize, time );
 
 			// Check for failure conditions
 			if ( remoteSystem->reliabilityLayer.IsDeadConnection() ||
@@ -1882,7 +1933,7 @@ bool RakPeer::RunUpdateCycle( void )
 
 			// Does the reliability layer have any packets waiting for us?
 			// To be thread safe, this has to be called in the same thread as HandleSocketReceiveFromConnectedPlayer
-			bitSize = remoteSystem->reliabilityLayer.Receive( &data );
+			bitSize = remoteSystem->reliabilityLayer.Receive( &data, &receiveBuffer );
 
 			while ( bitSize > 0 )
 			{
@@ -1895,7 +1946,7 @@ bool RakPeer::RunUpdateCycle( void )
 					if ( (unsigned char)(data)[0] == ID_CONNECTION_REQUEST )
 					{
 						ParseConnectionRequestPacket(remoteSystem, playerId, data, byteSize);
-						delete [] data;
+						ReceiveBufferPool::FreeData( data, receiveBuffer );
 					}
 					else if ( ((unsigned char) data[0] == ID_PONG && byteSize >= sizeof(unsigned char)+sizeof(unsigned int)) ||
 						((unsigned char) data[0] == ID_ADVERTISE_SYSTEM && byteSize<=MAX_OFFLINE_DATA_LENGTH))
@@ -1903,6 +1954,7 @@ bool RakPeer::RunUpdateCycle( void )
 						// Push to the user
 						Packet *packet = packetPool.GetPointer();
 						packet->data = ( unsigned char* ) data;
+						packet->receiveBuffer = receiveBuffer;
 						packet->length = byteSize;
 						packet->bitSize = byteSize*8;
 						packet->playerId = playerId;
@@ -1935,7 +1987,7 @@ bool RakPeer::RunUpdateCycle( void )
 						}
 						// else ID_UNCONNECTED_PING_OPEN_CONNECTIONS and we are full so don't send anything
 
-						delete [] data;
+						ReceiveBufferPool::FreeData( data, receiveBuffer );
 
 						// Disconnect them after replying to their offline ping
 						if (remoteSystem->connectMode!=RemoteSystemStruct::CONNECTED)
@@ -1947,7 +1999,7 @@ bool RakPeer::RunUpdateCycle( void )
 #ifdef _DO_PRINTF
 						printf("Temporarily banning %i:%i for sending nonsense data\n", playerId.binaryAddress, playerId.port);
 #endif
-						delete [] data;
+						ReceiveBufferPool::FreeData( data, receiveBuffer );
 					}
 				}
 				else
@@ -1958,7 +2010,7 @@ bool RakPeer::RunUpdateCycle( void )
 					{
 						if (remoteSystem->weInitiatedTheConnection==false)
 							ParseConnectionRequestPacket(remoteSystem, playerId, data, byteSize);
-						delete [] data;
+						ReceiveBufferPool::FreeData( data, receiveBuffer );
 					}
 					else if ( (unsigned char) data[ 0 ] == ID_NEW_INCOMING_CONNECTION && byteSize == sizeof(unsigned char)+sizeof(unsigned int)+sizeof(unsigned short) )
 					{
@@ -1989,6 +2041,7 @@ bool RakPeer::RunUpdateCycle( void )
 							// Send this info down to the game
 							packet = packetPool.GetPointer();
 							packet->data = ( unsigned char* ) data;
+							packet->receiveBuffer = receiveBuffer;
 							packet->length = byteSize;
 							packet->bitSize = bitSize;
 							packet->playerId = playerId;
@@ -2003,7 +2056,7 @@ bool RakPeer::RunUpdateCycle( void )
 							incomingQueueMutex.Unlock();
 						}
 						else
-							delete [] data;
+							ReceiveBufferPool::FreeData( data, receiveBuffer );
 					}
 					else if ( (unsigned char) data[ 0 ] == ID_CONNECTED_PONG && byteSize == sizeof(unsigned char)+sizeof(unsigned int)*2 )
 					{
@@ -2034,7 +2087,7 @@ bool RakPeer::RunUpdateCycle( void )
 							remoteSystem->reliabilityLayer.SetLostPacketResendDelay( ping * 2 );
 						}
 
-						delete [] data;
+						ReceiveBufferPool::FreeData( data, receiveBuffer );
 					}
 					else if ( (unsigned char)data[0] == ID_CONNECTED_PING && byteSize == sizeof(unsigned char)+sizeof(unsigned int) )
 					{
@@ -2053,13 +2106,14 @@ bool RakPeer::RunUpdateCycle( void )
 							SendImmediate( (char*)outBitStream.GetData(), outBitStream.GetNumberOfBitsUsed(), SYSTEM_PRIORITY, UNRELIABLE, 0, playerId, false, false, time );
 						}
 
-						delete [] data;
+						ReceiveBufferPool::FreeData( data, receiveBuffer );
 					}
 					else if ( (unsigned char) data[ 0 ] == ID_DISCONNECTION_NOTIFICATION )
 					{
 						packet = packetPool.GetPointer();
 
 						packet->data = ( unsigned char* ) data;
+						packet->receiveBuffer = receiveBuffer;
 						packet->bitSize = 8;
 						packet->length = 1;
 
@@ -2082,7 +2136,7 @@ bool RakPeer::RunUpdateCycle( void )
 					else if ( (unsigned char)(data)[0] == ID_KEEPALIVE && byteSize == sizeof(unsigned char) )
 					{
 						// Do nothing
-						delete [] data;
+						ReceiveBufferPool::FreeData( data, receiveBuffer );
 					}
 					else if ( (unsigned char)(data)[0] == ID_CONNECTION_REQUEST_ACCEPTED && byteSize == sizeof(unsigned char)+sizeof(unsigned short)+sizeof(unsigned int)+sizeof(unsigned short)+sizeof(PlayerIndex) )
 					{
@@ -2130,6 +2184,7 @@ bool RakPeer::RunUpdateCycle( void )
 							//packet->data = new unsigned char[ byteSize ];
 							//memcpy( packet->data, data, byteSize );
 							packet->data=(unsigned char*)data;
+							packet->receiveBuffer = receiveBuffer;
 
 							// packet->data[0]=ID_CONNECTION_REQUEST_ACCEPTED;
 							packet->length = byteSize;
@@ -2162,13 +2217,14 @@ bool RakPeer::RunUpdateCycle( void )
 #ifdef _DO_PRINTF
 							printf( "Error: Got a connection accept when we didn't request the connection.\n" );
 #endif
-							delete [] data;
+							ReceiveBufferPool::FreeData( data, receiveBuffer );
 						}
 					}
 					else
 					{
 						packet = packetPool.GetPointer();
 						packet->data = ( unsigned char* ) data;
+						packet->receiveBuffer = receiveBuffer;
 						packet->length = byteSize;
 						packet->bitSize = bitSize;
 						packet->playerId = playerId;
@@ -2185,17 +2241,128 @@ bool RakPeer::RunUpdateCycle( void )
 
 				// Does the reliability layer have any more packets waiting for us?
 				// To be thread safe, this has to be called in the same thread as HandleSocketReceiveFromConnectedPlayer
-				bitSize = remoteSystem->reliabilityLayer.Receive( &data );
+				bitSize = remoteSystem->reliabilityLayer.Receive( &data, &receiveBuffer );
 			}
 		}
 	}
 
+	// Send what the reliability layers produced in this cycle
+	SocketLayer::Instance()->SendBatch( connectionSocket, sendBatch );
+
 	if(mUpdateCallback)
 		mUpdateCallback();
 
 	return true;
 }
 
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+SocketStatistics RakPeer::GetSocketStatistics( void ) const
+{
+	SocketStatistics statistics;
+	statistics.receiveCalls = receiveBatch.GetCalls();
+	statistics.datagramsReceived = receiveBatch.GetDatagrams();
+	statistics.sendCalls = sendBatch.GetCalls();
+	statistics.datagramsSent = sendBatch.GetDatagrams();
+	statistics.datagramsDelayed = statistics.datagramsDropped = 0;
+	statistics.datagramsDuplicated = statistics.datagramsReordered = 0;
+	incomingImpairment.AddStatistics( &statistics );
+	outgoingImpairment.AddStatistics( &statistics );
+	return statistics;
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::SetNetworkImpairment( const NetworkImpairmentSettings &settings )
+{
+	impairmentMutex.Lock();
+	impairmentSettings = settings;
+	impairmentChanged = true;
+	impairmentMutex.Unlock();
+
+	WakeUpdateThread();
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::WaitForUpdate( void )
+{
+	unsigned int wait = GetTimeToNextUpdate( RakNet::GetTime() );
+
+	if ( wait > 0 && endThreads == false )
+		SocketLayer::Instance()->WaitForData( connectionSocket, wakeupSocket, wait );
+
+	// Drain before resetting the flag. A wakeup skipped while the flag is still set queued its commands before
+	// the update cycle that follows, and a wakeup after the reset leaves a byte on the socket so the next wait returns immediately
+	SocketLayer::Instance()->Drain( wakeupSocket );
+	wakeupPending = false;
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+unsigned int RakPeer::GetTimeToNextUpdate( unsigned int time )
+{
+	unsigned int wait = MAXIMUM_UPDATE_WAIT;
+	auto waitFor = [&wait, time]( unsigned int actionTime )
+	{
+		unsigned int remaining = actionTime >= time ? actionTime - time + 1 : 0;
+		if ( remaining < wait )
+			wait = remaining;
+	};
+
+	// Connection requests and offline pings are repeated
+	RequestedConnectionStruct *rcsFirst, *rcs;
+	rcsFirst = requestedConnectionList.ReadLock();
+	rcs = rcsFirst;
+	while ( rcs )
+	{
+		waitFor( rcs->nextRequestTime );
+		rcs = requestedConnectionList.ReadLock();
+	}
+
+	if ( rcsFirst )
+		requestedConnectionList.CancelReadLock( rcsFirst );
+
+	// Held back datagrams are released by the update cycle
+	unsigned int releaseTime;
+	if ( incomingImpairment.GetNextReleaseTime( &releaseTime ) )
+		waitFor( releaseTime );
+	if ( outgoingImpairment.GetNextReleaseTime( &releaseTime ) )
+		waitFor( releaseTime );
+
+	// These have to mirror the timed actions of RunUpdateCycle
+	for ( unsigned remoteSystemIndex = 0; remoteSystemIndex < remoteSystemListSize && wait > 0; ++remoteSystemIndex )
+	{
+		RemoteSystemStruct *remoteSystem = remoteSystemList + remoteSystemIndex;
+		if ( remoteSystem->playerId == UNASSIGNED_PLAYER_ID )
+			continue;
+
+		wait = remoteSystem->reliabilityLayer.GetTimeToNextUpdate( time, wait );
+
+		if ( remoteSystem->connectMode == RemoteSystemStruct::CONNECTED )
+		{
+			// the keep alive is only sent if nothing reliable is in flight
+			if ( remoteSystem->reliabilityLayer.GetStatistics()->messagesOnResendQueue == 0 )
+				waitFor( remoteSystem->lastReliableSend + 5000 );
+			if ( remoteSystem->lowestPing == -1 )
+				waitFor( remoteSystem->nextPingTime );
+		}
+		else
+		{
+			waitFor( remoteSystem->connectionTime + 10000 );
+		}
+	}
+
+	return wait;
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::WakeUpdateThread( void )
+{
+	// Only the first wakeup after each update cycle has to touch the socket
+	if ( wakeupSocket != INVALID_SOCKET && wakeupPending.exchange( true ) == false )
+	{
+		char c = 0;
+		SocketLayer::Instance()->Write( wakeupSocket, &c, 1 );
+	}
+}
+
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 #ifdef _WIN32
 unsigned __stdcall UpdateNetworkLoop( LPVOID arguments )
@@ -2210,12 +2377,7 @@ void* UpdateNetworkLoop( void* arguments )
 	while ( rakPeer->endThreads == false )
 	{
 		rakPeer->RunUpdateCycle();
-#ifdef _WIN32
-		Sleep( rakPeer->threadSleepTimer );
-#else
-		usleep( rakPeer->threadSleepTimer * 1000 );
-#endif
-
+		rakPeer->WaitForUpdate();
 	}
 
 	rakPeer->isMainLoopThreadActive = false;
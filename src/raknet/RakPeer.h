@@ -37,12 +37,13 @@
 #include "PacketPool.h"
 
 #include <functional>
+#include <atomic>
 
 #ifdef _WIN32
-void __stdcall ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, RakPeer *rakPeer );
+void __stdcall ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, ReceiveBuffer *receiveBuffer, RakPeer *rakPeer );
 unsigned __stdcall UpdateNetworkLoop( LPVOID arguments );
 #else
-void ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, RakPeer *rakPeer );
+void ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, ReceiveBuffer *receiveBuffer, RakPeer *rakPeer );
 void* UpdateNetworkLoop( void* arguments );
 #endif
 
@@ -84,7 +85,8 @@ public:
 	* - A pure client would set this to 1.  A pure server would set it to the number of allowed clients.
 	* - A hybrid would set it to the sum of both types of connections
 	* @param localPort The port to listen for connections on.
-	* @param _threadSleepTimer >=0 for how many ms to Sleep each internal update cycle (recommended 30 for low performance, 0 for regular)
+	* @param _threadSleepTimer >=0, kept for compatibility. The update thread no longer sleeps a fixed time but waits
+	* until a datagram arrives, a send is queued or a timer of the reliability layer expires.
 	* @param forceHostAddress Can force RakNet to use a particular IP to host on.  Pass 0 to automatically pick an IP
 	*
 	* @return False on failure (can't create socket or thread), true on success.
@@ -383,6 +385,17 @@ public:
 	*/
 	void PushBackPacket( Packet *packet );
 
+	/**
+	* Simulates a bad network by dropping, delaying, duplicating and reordering the datagrams
+	* this peer sends and receives. The incoming and outgoing datagrams are impaired with
+	* different random decisions derived from the seed. Settings that impair nothing turn the
+	* simulation off once the held back datagrams are out.
+	* Callable from any thread, the update thread applies the settings in its next cycle.
+	*
+	* @param settings How to impair the datagrams
+	*/
+	void SetNetworkImpairment( const NetworkImpairmentSettings &settings );
+
 	/*
 	* --------------------------------------------------------------------------------------------
 	* Statistical Functions - Functions dealing with API performance
@@ -399,6 +412,14 @@ public:
 	*/
 	RakNetStatisticsStruct * const GetStatistics( PlayerID playerId );
 
+	/**
+	* Returns how many system calls the update thread made to receive datagrams and to send the
+	* datagrams of the reliability layers, so you can see how well they are batched, and what the
+	* network impairment did to the datagrams.
+	* Callable from any thread.
+	*/
+	SocketStatistics GetSocketStatistics( void ) const;
+
 	/**
 	* @brief Store Remote System Description.
 	*
@@ -422,10 +443,10 @@ public:
 protected:
 
 #ifdef _WIN32
-	friend void __stdcall ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, RakPeer *rakPeer );
+	friend void __stdcall ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, ReceiveBuffer *receiveBuffer, RakPeer *rakPeer );
 	friend unsigned __stdcall UpdateNetworkLoop( LPVOID arguments );
 #else
-	friend void ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, RakPeer *rakPeer );
+	friend void ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, ReceiveBuffer *receiveBuffer, RakPeer *rakPeer );
 	friend void* UpdateNetworkLoop( void* arguments );
 #endif
 
@@ -529,6 +550,18 @@ protected:
 	BasicDataStructures::SingleProducerConsumer<RequestedConnectionStruct> requestedConnectionList;
 
 	bool RunUpdateCycle( void );
+	/**
+	* Blocks the update thread until there is something to do for RunUpdateCycle
+	*/
+	void WaitForUpdate( void );
+	/**
+	* How long the update thread can sleep until the next timed action is due
+	*/
+	unsigned int GetTimeToNextUpdate( unsigned int time );
+	/**
+	* Interrupts WaitForUpdate, so commands queued by the user thread are processed immediately
+	*/
+	void WakeUpdateThread( void );
 	// void RunMutexedUpdateCycle(void);
 
 	struct BufferedCommandStruct
@@ -546,6 +579,10 @@ protected:
 
 	// Single producer single consumer queue using a linked list
 	BasicDataStructures::SingleProducerConsumer<BufferedCommandStruct> bufferedCommands;
+	/**
+	* Serializes the writers of bufferedCommands, since the server sends from the game threads and the main thread
+	*/
+	SimpleMutex bufferedCommandsMutex;
 
 	bool AllowIncomingConnections(void) const;
 
@@ -564,6 +601,37 @@ protected:
 	int threadSleepTimer;
 
 	SOCKET connectionSocket;
+	/**
+	* Buffers the datagrams are received into. Messages that were not split point into them
+	* until the last packet_ptr of the datagram is gone.
+	*/
+	ReceiveBufferPool receiveBufferPool;
+	/**
+	* Datagrams read in one go by the update thread
+	*/
+	DatagramBatch receiveBatch;
+	/**
+	* Datagrams the reliability layers produced in the current update cycle
+	*/
+	DatagramBatch sendBatch;
+	/**
+	* The simulated bad network the received and the sent datagrams pass through
+	*/
+	NetworkImpairment incomingImpairment, outgoingImpairment;
+	/**
+	* Settings passed to SetNetworkImpairment that the update thread has not applied yet
+	*/
+	NetworkImpairmentSettings impairmentSettings;
+	SimpleMutex impairmentMutex;
+	std::atomic<bool> impairmentChanged;
+	/**
+	* Loopback socket that is written to when the update thread has to wake up
+	*/
+	SOCKET wakeupSocket;
+	/**
+	* True if a wakeup has been signalled that the update thread has not yet seen
+	*/
+	std::atomic<bool> wakeupPending;
 
 	/**
 	* How long it has been since things were updated by a call to receive
@@ -62,7 +62,7 @@ public:
 	/**
 	* Call this to initiate the server with the number of players you want to be allowed connected at once
 	* @param AllowedPlayers Current maximum number of allowed players is 65535
-	* @param threadSleepTimer >=0 for how many ms to Sleep each internal update cycle (recommended 30 for low performance, 0 for regular)
+	* @param threadSleepTimer >=0, kept for compatibility. See RakPeer::Initialize
 	* @param port is the port you want the server to read and write on
 	* Make sure this port is open for UDP
 	* @param forceHostAddress Can force RakNet to use a particular IP to host on. Pass 0 to automatically pick an IP
@@ -49,6 +49,7 @@ extern inline unsigned int randomMT( void );
 extern inline float frandomMT( void );
 
 static const int ACK_BIT_LENGTH = sizeof( PacketNumberType ) *8 + 1;
+static const unsigned int MAXIMUM_SPLIT_PACKET_COUNT = 65535; // More parts than this are junk data
 static const int MAXIMUM_WINDOW_SIZE = ( 8000 - UDP_HEADER_SIZE ) *8 / ACK_BIT_LENGTH; // Sanity check - the most ack packets that could ever (usually) fit into a frame.
 static const int MINIMUM_WINDOW_SIZE = 5; // how many packets can be sent unacknowledged before waiting for an ack
 static const int DEFAULT_RECEIVED_PACKETS_SIZE=128; // Divide by timeout time in seconds to get the max ave. packets per second before requiring reallocation
@@ -102,6 +103,10 @@ void ReliabilityLayer::InitializeVariables( void )
 	lastWindowIncreaseSizeTime = 0;
 	receivedPacketsBaseIndex=0;
 	resetReceivedPackets=true;
+	splitPacketPartsWaiting = 0;
+	lastSplitPacketCleanupTime = 0;
+	orderedPacketsWaiting = 0;
+	resendQueueHead = 0;
 }
 
 //-------------------------------------------------------------------------------------------------------
@@ -124,45 +129,38 @@ void ReliabilityLayer::FreeThreadSafeMemory( void )
 {
 	InternalPacket *internalPacket;
 
-	for ( unsigned i = 0; i < splitPacketList.size(); i++ )
-	{
-		delete [] splitPacketList[ i ]->data;
-		internalPacketPool.ReleasePointer( splitPacketList[ i ] );
-	}
+	for ( auto &entry : splitPacketChannels )
+		FreeSplitPacketChannel( entry.second );
 
-	splitPacketList.clear();
+	splitPacketChannels.clear();
 
 	while ( outputQueue.size() > 0 )
 	{
 		internalPacket = outputQueue.pop();
-		delete [] internalPacket->data;
+		FreeInternalPacketData( internalPacket );
 		internalPacketPool.ReleasePointer( internalPacket );
 	}
 
 	outputQueue.clearAndForceAllocation( 512 );
 
 
-	for ( unsigned i = 0; i < orderingList.size(); i++ )
+	for ( unsigned i = 0; i < NUMBER_OF_ORDERED_STREAMS; i++ )
 	{
-		if ( orderingList[ i ] )
+		for ( unsigned slot = 0; slot < orderingList[ i ].capacity(); slot++ )
 		{
-			BasicDataStructures::LinkedList<InternalPacket*>* theList = orderingList[ i ];
+			InternalPacket **waitingPacket = orderingList[ i ].atSlot( slot );
 
-			if ( theList )
+			if ( waitingPacket )
 			{
-				while ( theList->size() )
-				{
-					internalPacket = orderingList[ i ]->pop();
-					delete [] internalPacket->data;
-					internalPacketPool.ReleasePointer( internalPacket );
-				}
-
-				delete theList;
+				FreeInternalPacketData( *waitingPacket );
+				internalPacketPool.ReleasePointer( *waitingPacket );
 			}
 		}
+
+		orderingList[ i ].clear();
 	}
 
-	orderingList.clear();
+	orderedPacketsWaiting = 0;
 
 	while ( acknowledgementQueue.size() > 0 )
 		internalPacketPool.ReleasePointer( acknowledgementQueue.pop() );
@@ -176,12 +174,14 @@ void ReliabilityLayer::FreeThreadSafeMemory( void )
 
 		if ( internalPacket )
 		{
-			delete [] internalPacket->data;
+			FreeInternalPacketData( internalPacket );
 			internalPacketPool.ReleasePointer( internalPacket );
 		}
 	}
 
 	resendQueue.clearAndForceAllocation( DEFAULT_RECEIVED_PACKETS_SIZE );
+	resendQueueIndex.clear();
+	resendQueueHead = 0;
 
 	unsigned j;
 	for ( unsigned i = 0; i < NUMBER_OF_PRIORITIES; i++ )
@@ -189,21 +189,13 @@ void ReliabilityLayer::FreeThreadSafeMemory( void )
 		j = 0;
 		for ( ; j < sendPacketSet[ i ].size(); j++ )
 		{
-		delete [] ( sendPacketSet[ i ] ) [ j ]->data;
+		FreeInternalPacketData( ( sendPacketSet[ i ] ) [ j ] );
 		internalPacketPool.ReleasePointer( ( sendPacketSet[ i ] ) [ j ] );
 		}
 
 		sendPacketSet[ i ].clearAndForceAllocation( 512 ); // Preallocate the send lists so we don't do a bunch of reallocations unnecessarily
 	}
 
-#ifdef _INTERNET_SIMULATOR
-	#pragma message("-- RakNet _INTERNET_SIMULATOR is defined!! --")
-	for (unsigned i = 0; i < delayList.size(); i++ )
-		delete delayList[ i ];
-
-	delayList.clear();
-#endif
-
 	internalPacketPool.ClearPool();
 }
 
@@ -215,7 +207,7 @@ void ReliabilityLayer::FreeThreadSafeMemory( void )
 // because some data is used internally, such as packet acknowledgement and
 //split packets
 //-------------------------------------------------------------------------------------------------------
-bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffer, int length )
+bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffer, int length, ReceiveBuffer *receiveBuffer )
 {
 #ifdef _DEBUG
 	assert( !( length <= 0 || buffer == 0 ) );
@@ -225,8 +217,6 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffe
 		return true;
 
 	int numberOfAcksInFrame = 0;
-	bool indexFound;
-	int count, size;
 	PacketNumberType holeCount;
 
 	UpdateThreadedMemory();
@@ -240,7 +230,7 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffe
 
 
 	// Parse the bitstream to create an internal packet
-	InternalPacket* internalPacket = CreateInternalPacketFromBitStream( &socketData, time );
+	InternalPacket* internalPacket = CreateInternalPacketFromBitStream( &socketData, time, receiveBuffer );
 
 	while ( internalPacket )
 	{
@@ -248,7 +238,7 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffe
 		{
 			numberOfAcksInFrame++;
 
-			if ( resendQueue.size() == 0 )
+			if ( resendQueueIndex.size() == 0 )
 			{
 				lastAckTime = 0; // Not resending anything so clear this var so we don't drop the connection on not getting any more acks
 			}
@@ -306,7 +296,7 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffe
 				statistics.duplicateMessagesReceived++;
 
 				// Duplicate packet
-				delete [] internalPacket->data;
+				FreeInternalPacketData( internalPacket );
 				internalPacketPool.ReleasePointer( internalPacket );
 				goto CONTINUE_SOCKET_DATA_PARSE_LOOP;
 			}
@@ -327,7 +317,7 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffe
 					statistics.duplicateMessagesReceived++;
 
 					// Duplicate packet
-					delete [] internalPacket->data;
+					FreeInternalPacketData( internalPacket );
 					internalPacketPool.ReleasePointer( internalPacket );
 					goto CONTINUE_SOCKET_DATA_PARSE_LOOP;
 				}
@@ -379,7 +369,7 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffe
 					printf( "Got invalid packet\n" );
 #endif
 
-					delete [] internalPacket->data;
+					FreeInternalPacketData( internalPacket );
 					internalPacketPool.ReleasePointer( internalPacket );
 					goto CONTINUE_SOCKET_DATA_PARSE_LOOP;
 				}
@@ -398,44 +388,24 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffe
 						assert( internalPacket->splitPacketIndex < internalPacket->splitPacketCount );
 						assert( internalPacket->dataBitLength < MAXIMUM_MTU_SIZE * 8 );
 #endif
-						//reliabilityLayerMutexes[splitPacketList_MUTEX].Lock();
-						for ( unsigned cnt = 0; cnt < splitPacketList.size(); cnt++ )
+						// Make sure this is not a duplicate insertion.
+						// If this hits then most likely splitPacketId overflowed into existing waiting split packets (i.e. more than rangeof(splitPacketId) waiting)
+						if ( InsertIntoSplitPacketList( internalPacket, time ) == false )
 						{
-							// Make sure this is not a duplicate insertion.
-							// If this hits then most likely splitPacketId overflowed into existing waiting split packets (i.e. more than rangeof(splitPacketId) waiting)
-							if ( splitPacketList[ cnt ]->splitPacketIndex == internalPacket->splitPacketIndex && splitPacketList[ cnt ]->splitPacketId == splitPacketId )
-							{
-								#ifdef _DEBUG
-								assert(0);
-								#endif
-
-								// Invalid packet
+							// Invalid packet
 #ifdef _DEBUG
-								printf( "Error: Split packet duplicate insertion (1)\n" );
+							printf( "Error: Split packet duplicate insertion (1)\n" );
 #endif
-								delete [] internalPacket->data;
-								internalPacketPool.ReleasePointer( internalPacket );
-								goto CONTINUE_SOCKET_DATA_PARSE_LOOP;
-							}
+							FreeInternalPacketData( internalPacket );
+							internalPacketPool.ReleasePointer( internalPacket );
+							goto CONTINUE_SOCKET_DATA_PARSE_LOOP;
 						}
 
-#ifdef _DEBUG
-						int splitPacketListSize = splitPacketList.size() + 1;
-#endif
-						//reliabilityLayerMutexes[splitPacketList_MUTEX].Unlock();
-
-
 						// Check for a rebuilt packet
-						InsertIntoSplitPacketList( internalPacket );
-
-						// Sequenced
 						internalPacket = BuildPacketFromSplitPacketList( internalPacket->splitPacketId, time );
 
 						if ( internalPacket )
 						{
-#ifdef _DEBUG
-							assert( splitPacketList.size() == splitPacketListSize - internalPacket->splitPacketCount );
-#endif
 							// Update our index to the newest packet
 							waitingForSequencedPacketReadIndex[ internalPacket->orderingChannel ] = internalPacket->orderingIndex + 1;
 
@@ -444,13 +414,6 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffe
 							internalPacket = 0;
 						}
 
-#ifdef _DEBUG
-						else
-						{
-							assert( splitPacketList.size() == (unsigned int) splitPacketListSize );
-						}
-
-#endif
 						// else don't have all the parts yet
 					}
 
@@ -469,7 +432,7 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffe
 					statistics.sequencedMessagesOutOfOrder++;
 
 					// Older sequenced packet. Discard it
-					delete [] internalPacket->data;
+					FreeInternalPacketData( internalPacket );
 					internalPacketPool.ReleasePointer( internalPacket );
 				}
 
@@ -491,50 +454,26 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffe
 				if ( internalPacket->reliability != RELIABLE_ORDERED )
 					internalPacket->orderingChannel = 255; // Use 255 to designate not sequenced and not ordered
 
-				//reliabilityLayerMutexes[splitPacketList_MUTEX].Lock();
-				// Make sure this is not a duplicate insertion.  If this assert hits then splitPacketId overflowed into existing waiting split packets (i.e. more than rangeof(splitPacketId) waiting)
-				for ( unsigned cnt = 0; cnt < splitPacketList.size(); cnt++ )
+				// Make sure this is not a duplicate insertion.  If this hits then splitPacketId overflowed into existing waiting split packets (i.e. more than rangeof(splitPacketId) waiting)
+				if ( InsertIntoSplitPacketList( internalPacket, time ) == false )
 				{
-					if ( splitPacketList[ cnt ]->splitPacketIndex == internalPacket->splitPacketIndex && splitPacketList[ cnt ]->splitPacketId == internalPacket->splitPacketId )
-					{
-#ifdef _DEBUG
-						assert(0);
-#endif
-						// Invalid packet
+					// Invalid packet
 #ifdef _DEBUG
-						printf( "Error: Split packet duplicate insertion (2)\n" );
+					printf( "Error: Split packet duplicate insertion (2)\n" );
 #endif
-						delete [] internalPacket->data;
-						internalPacketPool.ReleasePointer( internalPacket );
-						goto CONTINUE_SOCKET_DATA_PARSE_LOOP;
-
-					}
+					FreeInternalPacketData( internalPacket );
+					internalPacketPool.ReleasePointer( internalPacket );
+					goto CONTINUE_SOCKET_DATA_PARSE_LOOP;
 				}
 
-#ifdef _DEBUG
-				int splitPacketListSize = splitPacketList.size() + 1;
-#endif
-
-				InsertIntoSplitPacketList( internalPacket );
-
 				internalPacket = BuildPacketFromSplitPacketList( internalPacket->splitPacketId, time );
 
 				if ( internalPacket == 0 )
 				{
-#ifdef _DEBUG
-					assert( splitPacketList.size() == (unsigned int) splitPacketListSize );
-#endif
 					// Don't have all the parts yet
 					goto CONTINUE_SOCKET_DATA_PARSE_LOOP;
 				}
 
-#ifdef _DEBUG
-				else
-				{
-					assert( splitPacketList.size() == splitPacketListSize - internalPacket->splitPacketCount );
-				}
-
-#endif
 				// else continue down to handle RELIABLE_ORDERED
 			}
 
@@ -550,15 +489,13 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffe
 					printf("Got invalid ordering channel %i from packet %i\n", internalPacket->orderingChannel, internalPacket->packetNumber);
 #endif
 					// Invalid packet
-					delete [] internalPacket->data;
+					FreeInternalPacketData( internalPacket );
 					internalPacketPool.ReleasePointer( internalPacket );
 					goto CONTINUE_SOCKET_DATA_PARSE_LOOP;
 				}
 
 				if ( waitingForOrderedPacketReadIndex[ internalPacket->orderingChannel ] == internalPacket->orderingIndex )
 				{
-					// Get the list to hold ordered packets for this stream
-					BasicDataStructures::LinkedList<InternalPacket*> *orderingListAtOrderingStream;
 					unsigned char orderingChannelCopy = internalPacket->orderingChannel;
 
 					statistics.orderedMessagesInOrder++;
@@ -573,38 +510,8 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffe
 					// Wait for the next ordered packet in sequence
 					waitingForOrderedPacketReadIndex[ orderingChannelCopy ] ++; // This wraps
 
-					//reliabilityLayerMutexes[orderingList_MUTEX].Lock();
-					orderingListAtOrderingStream = GetOrderingListAtOrderingStream( orderingChannelCopy );
-
-					if ( orderingListAtOrderingStream != 0)
-					{
-						while ( orderingListAtOrderingStream->size() > 0 )
-						{
-							// Cycle through the list until nothing is found
-							orderingListAtOrderingStream->beginning();
-							indexFound=false;
-							size=orderingListAtOrderingStream->size();
-							count=0;
-
-							while (count++ < size)
-							{
-								if ( orderingListAtOrderingStream->peek()->orderingIndex == waitingForOrderedPacketReadIndex[ orderingChannelCopy ] )
-								{
-									//printf("Pushing delayed packet %i with ordering index %i. outputQueue.size()==%i\n", orderingListAtOrderingStream->peek()->packetNumber, orderingListAtOrderingStream->peek()->orderingIndex, outputQueue.size() );
-									outputQueue.push( orderingListAtOrderingStream->pop() );
-									waitingForOrderedPacketReadIndex[ orderingChannelCopy ]++; // This wraps at 255
-									indexFound=true;
-								}
-								else
-									(*orderingListAtOrderingStream)++;
-							}
-
-							if (indexFound==false)
-								break;
-						}
-					}
-
-					internalPacket = 0;
+					// Push the packets that were only waiting for this one
+					DeliverOrderedPackets( orderingChannelCopy );
 				}
 				else
 				{
@@ -612,7 +519,12 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffe
 					statistics.orderedMessagesOutOfOrder++;
 
 					// This is a newer ordered packet than we are waiting for. Store it for future use
-					AddToOrderingList( internalPacket );
+					if ( AddToOrderingList( internalPacket ) == false )
+					{
+						// We already have a packet with this ordering index
+						FreeInternalPacketData( internalPacket );
+						internalPacketPool.ReleasePointer( internalPacket );
+					}
 				}
 
 				goto CONTINUE_SOCKET_DATA_PARSE_LOOP;
@@ -631,7 +543,7 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffe
 
 	CONTINUE_SOCKET_DATA_PARSE_LOOP:
 		// Parse the bitstream to create an internal packet
-		internalPacket = CreateInternalPacketFromBitStream( &socketData, time );
+		internalPacket = CreateInternalPacketFromBitStream( &socketData, time, receiveBuffer );
 	}
 
 	// numberOfAcksInFrame>=windowSize means that all the packets we last sent from the resendQueue are cleared out
@@ -670,7 +582,7 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer( const char *buffe
 //-------------------------------------------------------------------------------------------------------
 // This gets an end-user packet already parsed out. Returns number of BITS put into the buffer
 //-------------------------------------------------------------------------------------------------------
-int ReliabilityLayer::Receive( char **data )
+int ReliabilityLayer::Receive( char **data, ReceiveBuffer **receiveBuffer )
 {
 	// Wait until the clear occurs
 	if (freeThreadedMemoryOnNextUpdate)
@@ -687,6 +599,7 @@ int ReliabilityLayer::Receive( char **data )
 
 		int bitLength;
 		*data = internalPacket->data;
+		*receiveBuffer = internalPacket->receiveBuffer;
 		bitLength = internalPacket->dataBitLength;
 		internalPacketPool.ReleasePointer( internalPacket );
 		return bitLength;
@@ -743,6 +656,7 @@ bool ReliabilityLayer::Send( char *data, int numberOfBitsToSend, PacketPriority
 #endif
 
 	internalPacket->creationTime = currentTime;
+	internalPacket->receiveBuffer = 0;
 
 	if ( makeDataCopy )
 	{
@@ -820,7 +734,7 @@ bool ReliabilityLayer::Send( char *data, int numberOfBitsToSend, PacketPriority
 //-------------------------------------------------------------------------------------------------------
 // Run this once per game cycle.  Handles internal lists and actually does the send
 //-------------------------------------------------------------------------------------------------------
-void ReliabilityLayer::Update( SOCKET s, PlayerID playerId, int MTUSize, unsigned int time )
+void ReliabilityLayer::Update( SOCKET s, DatagramBatch *batch, PlayerID playerId, int MTUSize, unsigned int time )
 {
 	// unsigned resendQueueSize;
 	bool reliableDataSent;
@@ -836,7 +750,7 @@ void ReliabilityLayer::Update( SOCKET s, PlayerID playerId, int MTUSize, unsigne
 
 	// Due to thread vagarities and the way I store the time to avoid slow calls to RakNet::GetTime
 	// time may be less than lastAck
-	if ( resendQueue.size() > 0 && time > lastAck && lastAck && time - lastAck > TIMEOUT_TIME )
+	if ( resendQueueIndex.size() > 0 && time > lastAck && lastAck && time - lastAck > TIMEOUT_TIME )
 	{
 		// SHOW - dead connection
 		// printf("The connection has been lost.\n");
@@ -863,53 +777,17 @@ void ReliabilityLayer::Update( SOCKET s, PlayerID playerId, int MTUSize, unsigne
 
 		if ( updateBitStream.GetNumberOfBitsUsed() > 0 )
 		{
-#ifndef _INTERNET_SIMULATOR
-			SendBitStream( s, playerId, &updateBitStream );
-#else
-			// Delay the send to simulate lag
-			DataAndTime *dt;
-			dt = new DataAndTime;
-			memcpy( dt->data, updateBitStream.GetData(), updateBitStream.GetNumberOfBytesUsed() );
-			dt->length = updateBitStream.GetNumberOfBytesUsed();
-			dt->sendTime = time + 100 + ( rand() % 100 );
-			delayList.insert( dt );
-#endif
-
+			SendBitStream( s, batch, playerId, &updateBitStream );
 		}
 		else
 			break;
 	}
-
-#ifdef _INTERNET_SIMULATOR
-	// Do any lagged sends
-	unsigned i = 0;
-
-	while ( i < delayList.size() )
-	{
-		if ( delayList[ i ]->sendTime < time )
-		{
-			updateBitStream.Reset();
-			updateBitStream.Write( delayList[ i ]->data, delayList[ i ]->length );
-			// Send it now
-			SendBitStream( s, playerId, &updateBitStream );
-
-			delete delayList[ i ];
-			if (i != delayList.size() - 1)
-				delayList[ i ] = delayList[ delayList.size() - 1 ];
-			delayList.del();
-		}
-
-		else
-			i++;
-	}
-
-#endif
 }
 
 //-------------------------------------------------------------------------------------------------------
 // Writes a bitstream to the socket
 //-------------------------------------------------------------------------------------------------------
-void ReliabilityLayer::SendBitStream( SOCKET s, PlayerID playerId, RakNet::BitStream *bitStream )
+void ReliabilityLayer::SendBitStream( SOCKET s, DatagramBatch *batch, PlayerID playerId, RakNet::BitStream *bitStream )
 {
 	// SHOW - showing reliable flow
 	// if (bitStream->GetNumberOfBytesUsed()>50)
@@ -917,23 +795,16 @@ void ReliabilityLayer::SendBitStream( SOCKET s, PlayerID playerId, RakNet::BitSt
 
 	// sentFrames++;
 
-#ifdef _INTERNET_SIMULATOR
-
-	// packetloss
-	if ((rand() % 101)/100.0f <= .05f)
-	{
-	// printf("Frame %i lost\n", sentFrames);
-	return;
-	}
-#endif
-
 	int length = bitStream->GetNumberOfBytesUsed();
 
 	statistics.packetsSent++;
 	statistics.totalBitsSent += length * 8;
 	//printf("total bits=%i length=%i\n", BITS_TO_BYTES(statistics.totalBitsSent), length);
 
-	SocketLayer::Instance()->SendTo( s, ( char* ) bitStream->GetData(), length, playerId.binaryAddress, playerId.port );
+	if ( batch )
+		SocketLayer::Instance()->SendTo( s, *batch, ( char* ) bitStream->GetData(), length, playerId.binaryAddress, playerId.port );
+	else
+		SocketLayer::Instance()->SendTo( s, ( char* ) bitStream->GetData(), length, playerId.binaryAddress, playerId.port );
 }
 
 //-------------------------------------------------------------------------------------------------------
@@ -960,7 +831,7 @@ bool ReliabilityLayer::IsFrameReady( unsigned int time )
 
 	// Does the oldest packet need to be resent?  If so, send it.
 	// Otherwise the throttle may never end
-	if ( resendQueue.size() > 0 && resendQueue.peek() && resendQueue.peek()->nextActionTime < time )
+	if ( resendQueue.size() > 0 && resendQueue.peek()->nextActionTime < time )
 	{
 		//  reliabilityLayerMutexes[resendQueue_MUTEX].Unlock();
 		return true;
@@ -1032,18 +903,12 @@ void ReliabilityLayer::GenerateFrame( RakNet::BitStream *output, int MTUSize, bo
 	//if (output->GetNumberOfBitsUsed()>0)
 	// printf("Sending ack (%i) at time %i. acknowledgementQueue.size()=%i\n", output->GetNumberOfBytesUsed(), RakNet::GetTime(),acknowledgementQueue.size());
 
-	// The resend Queue can have NULL pointer holes.  This is so we can deallocate blocks without having to compress the array
+	// The resend Queue can have NULL pointer holes, but never at its head
 	while ( resendQueue.size() > 0 )
 	{
-		if ( resendQueue.peek() == 0 )
-		{
-			resendQueue.pop();
-			continue; // This was a hole
-		}
-
 		if ( resendQueue.peek()->nextActionTime < time )
 		{
-			internalPacket = resendQueue.pop();
+			internalPacket = resendQueue.peek();
 			// Testing
 			//printf("Resending %i. queue size = %i\n", internalPacket->packetNumber, resendQueue.size());
 
@@ -1051,8 +916,7 @@ void ReliabilityLayer::GenerateFrame( RakNet::BitStream *output, int MTUSize, bo
 
 			if ( output->GetNumberOfBitsUsed() + nextPacketBitLength > maxDataBitSize )
 			{
-				resendQueue.pushAtHead( internalPacket ); // Not enough room to use this packet after all!
-
+				// Not enough room to use this packet after all!
 				if ( anyPacketsLost )
 				{
 					UpdatePacketloss( time );
@@ -1086,6 +950,12 @@ void ReliabilityLayer::GenerateFrame( RakNet::BitStream *output, int MTUSize, bo
 
 			statistics.packetsContainingOnlyAcknowlegementsAndResends++;
 			anyPacketsLost = true;
+
+			// Take it out of the resend list.  Its entry in resendQueueIndex is updated on reinsertion
+			resendQueue.pop();
+			resendQueueHead++;
+			CompressResendQueueHead();
+
 			internalPacket->nextActionTime = time + lostPacketResendDelay;
 
 			// Put the packet back into the resend list at the correct spot
@@ -1170,7 +1040,7 @@ void ReliabilityLayer::GenerateFrame( RakNet::BitStream *output, int MTUSize, bo
 			else
 			{
 				// Unreliable packets are deleted
-				delete [] internalPacket->data;
+				FreeInternalPacketData( internalPacket );
 				internalPacketPool.ReleasePointer( internalPacket );
 			}
 		}
@@ -1223,7 +1093,52 @@ bool ReliabilityLayer::IsDataWaiting(void)
 			return true;
 	}
 
-	return acknowledgementQueue.size() > 0 || resendQueue.size() > 0 || outputQueue.size() > 0 || orderingList.size() > 0 || splitPacketList.size() > 0;
+	return acknowledgementQueue.size() > 0 || resendQueueIndex.size() > 0 || outputQueue.size() > 0 || orderedPacketsWaiting > 0 || splitPacketPartsWaiting > 0;
+}
+
+//-------------------------------------------------------------------------------------------------------
+// How long Update can wait before it has something to do
+//-------------------------------------------------------------------------------------------------------
+unsigned int ReliabilityLayer::GetTimeToNextUpdate( unsigned int time, unsigned int maximumWait )
+{
+	if ( deadConnection )
+		return 0;
+
+	// Timed actions are due once the current time is past their action time
+	unsigned int wait = maximumWait;
+	auto waitFor = [&wait, time]( unsigned int actionTime )
+	{
+		unsigned int remaining = actionTime >= time ? actionTime - time + 1 : 0;
+		if ( remaining < wait )
+			wait = remaining;
+	};
+
+	// This has to mirror IsFrameReady and GenerateFrame, otherwise we would wake up for nothing over and over
+	if ( acknowledgementQueue.size() >= MINIMUM_WINDOW_SIZE )
+		return 0;
+
+	if ( IsSendThrottled() == false )
+	{
+		for ( unsigned i = 0; i < NUMBER_OF_PRIORITIES; i++ )
+		{
+			if ( sendPacketSet[ i ].size() > 0 )
+				return 0;
+		}
+
+		if ( acknowledgementQueue.size() > 0 )
+			waitFor( acknowledgementQueue.peek()->nextActionTime );
+	}
+
+	if ( resendQueue.size() > 0 )
+	{
+		waitFor( resendQueue.peek()->nextActionTime );
+
+		// Update declares the connection dead if no ack arrives for too long
+		if ( lastAckTime )
+			waitFor( lastAckTime + TIMEOUT_TIME );
+	}
+
+	return wait;
 }
 
 //-------------------------------------------------------------------------------------------------------
@@ -1275,63 +1190,54 @@ void ReliabilityLayer::RemovePacketFromResendQueueAndDeleteOlderReliableSequence
 	PacketReliability reliability; // What type of reliability algorithm to use with this packet
 	unsigned char orderingChannel; // What ordering channel this packet is on, if the reliability type uses ordering channels
 	OrderingIndexType orderingIndex; // The ID used as identification for ordering channels
+	unsigned int position;
 
-	for ( unsigned i = 0; i < resendQueue.size(); i ++ )
+	if ( resendQueueIndex.remove( packetNumber, &position ) == false )
 	{
-		if ( resendQueue[i] && packetNumber == resendQueue[i]->packetNumber )
-		{
-			// Found what we wanted to ack
-			statistics.acknowlegementsReceived++;
-
-			if ( i == 0 )
-				internalPacket = resendQueue.pop();
-			else
-			{
-
-				// Generate a hole
-				internalPacket = resendQueue[ i ];
-				// testing
-				// printf("Removing packet %i from resend\n", internalPacket->packetNumber);
-				resendQueue[ i ] = 0;
-			}
+		// Didn't find what we wanted to ack
+		statistics.duplicateAcknowlegementsReceived++;
+		return ;
+	}
 
-			// Save some of the data of the packet
-			reliability = internalPacket->reliability;
-			orderingChannel = internalPacket->orderingChannel;
-			orderingIndex = internalPacket->orderingIndex;
+	// Found what we wanted to ack
+	statistics.acknowlegementsReceived++;
 
-			// Delete the packet
-			//printf("Deleting %i\n", internalPacket->data);
-			delete [] internalPacket->data;
-			internalPacketPool.ReleasePointer( internalPacket );
+	// Generate a hole
+	internalPacket = resendQueue[ position - resendQueueHead ];
+	// testing
+	// printf("Removing packet %i from resend\n", internalPacket->packetNumber);
+	resendQueue[ position - resendQueueHead ] = 0;
 
-			// If the deleted packet was reliable sequenced, also delete all older reliable sequenced resends on the same ordering channel.
-			// This is because we no longer need to send these.
-			if ( reliability == RELIABLE_SEQUENCED )
-			{
-				unsigned j = 0;
+	// Save some of the data of the packet
+	reliability = internalPacket->reliability;
+	orderingChannel = internalPacket->orderingChannel;
+	orderingIndex = internalPacket->orderingIndex;
 
-				while ( j < resendQueue.size() )
-				{
-					internalPacket = resendQueue[ j ];
+	// Delete the packet
+	//printf("Deleting %i\n", internalPacket->data);
+	FreeInternalPacketData( internalPacket );
+	internalPacketPool.ReleasePointer( internalPacket );
 
-					if ( internalPacket && internalPacket->reliability == RELIABLE_SEQUENCED && internalPacket->orderingChannel == orderingChannel && IsOlderOrderedPacket( internalPacket->orderingIndex, orderingIndex ) )
-					{
-						// Delete the packet
-						delete [] internalPacket->data;
-						internalPacketPool.ReleasePointer( internalPacket );
-						resendQueue[ j ] = 0; // Generate a hole
-					}
+	// If the deleted packet was reliable sequenced, also delete all older reliable sequenced resends on the same ordering channel.
+	// This is because we no longer need to send these.
+	if ( reliability == RELIABLE_SEQUENCED )
+	{
+		for ( unsigned j = 0; j < resendQueue.size(); j++ )
+		{
+			internalPacket = resendQueue[ j ];
 
-					j++;
-				}
+			if ( internalPacket && internalPacket->reliability == RELIABLE_SEQUENCED && internalPacket->orderingChannel == orderingChannel && IsOlderOrderedPacket( internalPacket->orderingIndex, orderingIndex ) )
+			{
+				// Delete the packet
+				resendQueueIndex.remove( internalPacket->packetNumber );
+				FreeInternalPacketData( internalPacket );
+				internalPacketPool.ReleasePointer( internalPacket );
+				resendQueue[ j ] = 0; // Generate a hole
 			}
-			return ;
 		}
 	}
 
-	// Didn't find what we wanted to ack
-	statistics.duplicateAcknowlegementsReceived++;
+	CompressResendQueueHead();
 }
 
 //-------------------------------------------------------------------------------------------------------
@@ -1347,6 +1253,7 @@ void ReliabilityLayer::SendAcknowledgementPacket( PacketNumberType packetNumber,
 
 	internalPacket->packetNumber = packetNumber;
 	internalPacket->isAcknowledgement = true;
+	internalPacket->receiveBuffer = 0;
 
 	internalPacket->creationTime = time;
 	// We send this acknowledgement no later than 1/4 the time the remote
@@ -1507,7 +1414,7 @@ int ReliabilityLayer::WriteToBitStreamFromInternalPacket( RakNet::BitStream *bit
 //-------------------------------------------------------------------------------------------------------
 // Parse a bitstream and create an internal packet to represent this data
 //-------------------------------------------------------------------------------------------------------
-InternalPacket* ReliabilityLayer::CreateInternalPacketFromBitStream( RakNet::BitStream *bitStream, unsigned int time )
+InternalPacket* ReliabilityLayer::CreateInternalPacketFromBitStream( RakNet::BitStream *bitStream, unsigned int time, ReceiveBuffer *receiveBuffer )
 {
 	bool bitStreamSucceeded;
 	InternalPacket* internalPacket;
@@ -1523,6 +1430,7 @@ InternalPacket* ReliabilityLayer::CreateInternalPacketFromBitStream( RakNet::Bit
 #endif
 
 	internalPacket->creationTime = time;
+	internalPacket->receiveBuffer = 0;
 
 	//bitStream->AlignReadToByteBoundary();
 
@@ -1700,6 +1608,29 @@ InternalPacket* ReliabilityLayer::CreateInternalPacketFromBitStream( RakNet::Bit
 		return 0;
 	}
 
+	// The data of packets that are not split is used where it is in the datagram. Split packets are copied,
+	// so a reassembly does not hold on to hundreds of datagrams.
+	if ( receiveBuffer && isSplitPacket == false )
+	{
+		int byteLength = BITS_TO_BYTES( internalPacket->dataBitLength );
+		bitStream->AlignReadToByteBoundary();
+
+		if ( bitStream->GetNumberOfUnreadBits() < ( byteLength << 3 ) )
+		{
+			internalPacketPool.ReleasePointer( internalPacket );
+			return 0;
+		}
+
+#ifdef _DEBUG
+		assert( ( char* ) bitStream->GetData() == receiveBuffer->data );
+#endif
+		internalPacket->data = ( char* ) bitStream->GetData() + ( bitStream->GetReadOffset() >> 3 );
+		internalPacket->receiveBuffer = receiveBuffer;
+		receiveBuffer->AddReference();
+		bitStream->IgnoreBits( byteLength << 3 );
+		return internalPacket;
+	}
+
 	// Allocate memory to hold our data
 	internalPacket->data = new char [ BITS_TO_BYTES( internalPacket->dataBitLength ) ];
 	//printf("Allocating %i\n",  internalPacket->data);
@@ -1718,7 +1649,7 @@ InternalPacket* ReliabilityLayer::CreateInternalPacketFromBitStream( RakNet::Bit
 
 	if ( bitStreamSucceeded == false )
 	{
-		delete [] internalPacket->data;
+		FreeInternalPacketData( internalPacket );
 		internalPacketPool.ReleasePointer( internalPacket );
 		return 0;
 	}
@@ -1732,6 +1663,15 @@ InternalPacket* ReliabilityLayer::CreateInternalPacketFromBitStream( RakNet::Bit
 	return internalPacket;
 }
 
+//-------------------------------------------------------------------------------------------------------
+// Deletes the data of an internal packet or releases the buffer it points into
+//-------------------------------------------------------------------------------------------------------
+void ReliabilityLayer::FreeInternalPacketData( InternalPacket *internalPacket )
+{
+	ReceiveBufferPool::FreeData( internalPacket->data, internalPacket->receiveBuffer );
+	internalPacket->receiveBuffer = 0;
+}
+
 //-------------------------------------------------------------------------------------------------------
 // Returns true if newPacketOrderingIndex is older than the waitingForPacketOrderingIndex
 //-------------------------------------------------------------------------------------------------------
@@ -1855,230 +1795,145 @@ void ReliabilityLayer::SplitPacket( InternalPacket *internalPacket, int MTUSize
 	}
 
 	// Delete the original
-	delete [] internalPacket->data;
+	FreeInternalPacketData( internalPacket );
 	internalPacketPool.ReleasePointer( internalPacket );
 }
 
 //-------------------------------------------------------------------------------------------------------
 // Insert a packet into the split packet list
 //-------------------------------------------------------------------------------------------------------
-void ReliabilityLayer::InsertIntoSplitPacketList( InternalPacket * internalPacket )
+bool ReliabilityLayer::InsertIntoSplitPacketList( InternalPacket * internalPacket, unsigned int time )
 {
-	splitPacketList.insert( internalPacket );
+	if ( internalPacket->splitPacketCount > MAXIMUM_SPLIT_PACKET_COUNT || internalPacket->splitPacketIndex >= internalPacket->splitPacketCount )
+		return false;
+
+	SplitPacketChannel &channel = splitPacketChannels[ internalPacket->splitPacketId ];
+
+	if ( channel.parts.empty() )
+	{
+		// The first part of this split packet
+		channel.parts.resize( internalPacket->splitPacketCount, 0 );
+		channel.partsReceived = 0;
+		channel.reliability = internalPacket->reliability;
+	}
+	else if ( channel.parts.size() != internalPacket->splitPacketCount || channel.parts[ internalPacket->splitPacketIndex ] )
+	{
+		return false;
+	}
+
+	channel.parts[ internalPacket->splitPacketIndex ] = internalPacket;
+	channel.partsReceived++;
+	channel.lastUpdateTime = time;
+	splitPacketPartsWaiting++;
+
+	return true;
 }
 
 //-------------------------------------------------------------------------------------------------------
 // Take all split chunks with the specified splitPacketId and try to
 //reconstruct a packet.  If we can, allocate and return it.  Otherwise return 0
-// Optimized version
 //-------------------------------------------------------------------------------------------------------
 InternalPacket * ReliabilityLayer::BuildPacketFromSplitPacketList( unsigned int splitPacketId, unsigned int time )
 {
-	int i, j, size;
-	// How much data all blocks but the last hold
-	int maxDataSize;
-	int numParts;
-	int bitlength;
-	int *indexList;
-	int indexListIndex;
-
-	size = splitPacketList.size();
-
-	for ( i = 0; i < size; i++ )
-	{
-		if ( splitPacketList[ i ]->splitPacketId == splitPacketId )
-		{
-			// Is there enough elements in the list to have all the parts?
-
-			if ( splitPacketList[ i ]->splitPacketCount > splitPacketList.size() - i )
-			{
-				//   if (splitPacketList.size() % 100 == 0 || splitPacketList[i]->splitPacketCount-splitPacketList.size()<100)
-				//    printf("%i out of %i\n", splitPacketList.size(), splitPacketList[i]->splitPacketCount);
-				return 0;
-			}
-
-			//  printf("%i out of %i\n", splitPacketList.size(), splitPacketList[i]->splitPacketCount);
-			// Keep track of the indices of the elements through our first scan so we don't have to rescan to find them
-			indexListIndex = 0;
-
-			numParts = 1;
-
-			bitlength = splitPacketList[ i ]->dataBitLength;
-
-			indexList = ( int* ) alloca( sizeof( int ) * splitPacketList[ i ]->splitPacketCount );
-
-			indexList[ indexListIndex++ ] = i;
-
-			maxDataSize = BITS_TO_BYTES( splitPacketList[ i ]->dataBitLength );
-
-			// Are all the parts there?
-			for ( j = i + 1; j < size; j++ )
-			{
-				if ( splitPacketList[ j ]->splitPacketId == splitPacketId )
-				{
-					indexList[ indexListIndex++ ] = j;
-					numParts++;
-					bitlength += splitPacketList[ j ]->dataBitLength;
-
-					// Verify that we are dealing with the same splitPacketId
-#ifdef _DEBUG
-					assert(splitPacketList[ j ]->splitPacketCount==splitPacketList[ i ]->splitPacketCount);
-#endif
+	std::unordered_map<unsigned int, SplitPacketChannel>::iterator channel = splitPacketChannels.find( splitPacketId );
 
-					if ( ( int ) BITS_TO_BYTES( splitPacketList[ j ]->dataBitLength ) > maxDataSize )
-						maxDataSize = BITS_TO_BYTES( splitPacketList[ j ]->dataBitLength );
-				}
-			}
-
-			if ( (unsigned int)numParts == splitPacketList[ i ]->splitPacketCount )
-			{
-				int allocatedLength;
-				// All the parts are here
-				InternalPacket * internalPacket = CreateInternalPacketCopy( splitPacketList[ i ], 0, 0, time );
-				allocatedLength=BITS_TO_BYTES( bitlength );
-				internalPacket->data = new char[ allocatedLength ];
-#ifdef _DEBUG
-				internalPacket->splitPacketCount = splitPacketList[ i ]->splitPacketCount;
-#endif
+	// Are all the parts there?
+	if ( channel == splitPacketChannels.end() || channel->second.partsReceived < channel->second.parts.size() )
+		return 0;
 
-				// Add each part to internalPacket
-				j = 0;
+	const std::vector<InternalPacket*> &parts = channel->second.parts;
 
-				while ( j < indexListIndex )
-				{
-					if ( splitPacketList[ indexList[ j ] ]->splitPacketCount-1 == splitPacketList[ indexList[ j ] ]->splitPacketIndex )
-					{
-						// Last split packet
-						// If this assert fails,
-						// then the total bit length calculated by adding the last block to the maximum block size * the number of blocks that are not the last block
-						// doesn't match the amount calculated from traversing the list
-#ifdef _DEBUG
-						assert( BITS_TO_BYTES( splitPacketList[ indexList[ j ] ]->dataBitLength ) + splitPacketList[ indexList[ j ] ]->splitPacketIndex * (unsigned)maxDataSize == ( (unsigned)bitlength - 1 ) / 8 + 1 );
-#endif
+	// How much data all blocks but the last hold
+	unsigned int maxDataSize = 0;
+	unsigned int bitlength = 0;
 
-						if (splitPacketList[ indexList[ j ] ]->splitPacketIndex * (unsigned int) maxDataSize + (unsigned int) BITS_TO_BYTES( splitPacketList[ indexList[ j ] ]->dataBitLength ) > (unsigned int) allocatedLength )
-						{
-							// Watch for buffer overruns
-#ifdef _DEBUG
-							assert(0);
-#endif
-							delete internalPacket->data;
-							internalPacketPool.ReleasePointer(internalPacket);
-							return 0;
-						}
+	for ( unsigned i = 0; i < parts.size(); i++ )
+	{
+		bitlength += parts[ i ]->dataBitLength;
 
-						memcpy( internalPacket->data + splitPacketList[ indexList[ j ] ]->splitPacketIndex * maxDataSize, splitPacketList[ indexList[ j ] ]->data, BITS_TO_BYTES( splitPacketList[ indexList[ j ] ]->dataBitLength ) );
-					}
+		if ( BITS_TO_BYTES( parts[ i ]->dataBitLength ) > maxDataSize )
+			maxDataSize = BITS_TO_BYTES( parts[ i ]->dataBitLength );
+	}
 
-					else
-					{
-                        if (splitPacketList[ indexList[ j ] ]->splitPacketIndex * (unsigned int) maxDataSize + (unsigned int) maxDataSize > (unsigned int) allocatedLength )
-						{
-							// Watch for buffer overruns
+	unsigned int allocatedLength = BITS_TO_BYTES( bitlength );
+	InternalPacket * internalPacket = CreateInternalPacketCopy( parts[ 0 ], 0, 0, time );
+	internalPacket->data = new char[ allocatedLength ];
 #ifdef _DEBUG
-							assert(0);
+	internalPacket->splitPacketCount = parts.size();
 #endif
-							delete internalPacket->data;
-							internalPacketPool.ReleasePointer(internalPacket);
-							return 0;
-						}
-						// Not last split packet
-						memcpy( internalPacket->data + splitPacketList[ indexList[ j ] ]->splitPacketIndex * maxDataSize, splitPacketList[ indexList[ j ] ]->data, maxDataSize );
-					}
-
-					internalPacket->dataBitLength += splitPacketList[ indexList[ j ] ]->dataBitLength;
-					InternalPacket *temp;
 
-					temp = splitPacketList[ indexList[ j ] ];
-					delete [] temp->data;
-					internalPacketPool.ReleasePointer( temp );
-					splitPacketList[ indexList[ j ] ] = 0;
-
-#ifdef _DEBUG
-
-					numParts--;
-#endif
-
-					j++;
-					size--;
-				}
+	// Add each part to internalPacket
+	for ( unsigned i = 0; i < parts.size(); i++ )
+	{
+		// All but the last part are full
+		unsigned int partLength = i + 1 == parts.size() ? BITS_TO_BYTES( parts[ i ]->dataBitLength ) : maxDataSize;
 
+		if ( i * maxDataSize + partLength > allocatedLength )
+		{
+			// Watch for buffer overruns
 #ifdef _DEBUG
-				assert( numParts == 0 ); // Make sure the correct # of elements was removed from the list
+			assert(0);
 #endif
-
-				j = 0;
-
-				while ( ( unsigned ) j < splitPacketList.size() )
-					if ( splitPacketList[ j ] == 0 )
-					{
-						// Since order doesn't matter, swap from the tail to the current element.
-						splitPacketList[ j ] = splitPacketList[ splitPacketList.size() - 1 ];
-						splitPacketList[ splitPacketList.size() - 1 ] = 0;
-						// Then just delete the tail (just changes a counter)
-						splitPacketList.del( splitPacketList.size() - 1 );
-					}
-
-					else
-						j++;
-
-				return internalPacket;
-			}
+			FreeInternalPacketData( internalPacket );
+			internalPacketPool.ReleasePointer( internalPacket );
+			internalPacket = 0;
 			break;
 		}
+
+		memcpy( internalPacket->data + i * maxDataSize, parts[ i ]->data, partLength );
+		internalPacket->dataBitLength += parts[ i ]->dataBitLength;
 	}
 
-	return 0;
+	FreeSplitPacketChannel( channel->second );
+	splitPacketChannels.erase( channel );
+
+	return internalPacket;
 }
 
+//-------------------------------------------------------------------------------------------------------
 // Delete any unreliable split packets that have long since expired
+//-------------------------------------------------------------------------------------------------------
 void ReliabilityLayer::DeleteOldUnreliableSplitPackets( unsigned int time )
 {
-	unsigned size, i, orderingIndexToDelete;
-	unsigned int newestUnreliableSplitPacket;
-	bool found;
-	InternalPacket *temp;
+	// This is called for every split packet part, but checking once a second is enough
+	if ( time >= lastSplitPacketCleanupTime && time - lastSplitPacketCleanupTime < 1000 )
+		return;
 
-	// Scan through the list for split packets that were sent unreliably.
-	// If the newest unreliable split packet for a particular ID is more than 3000 ms old, then
-	// delete all of them of that id
+	lastSplitPacketCleanupTime = time;
 
-	size = splitPacketList.size();
-	newestUnreliableSplitPacket = 0;
-	found = false;
+	// If the newest part of an unreliable split packet is more than 5000 ms old, then delete all of its parts
+	std::unordered_map<unsigned int, SplitPacketChannel>::iterator channel = splitPacketChannels.begin();
 
-	for ( i = 0; i < size; i++ )
+	while ( channel != splitPacketChannels.end() )
 	{
-		if ( ( splitPacketList[ i ]->reliability == UNRELIABLE || splitPacketList[ i ]->reliability == UNRELIABLE_SEQUENCED ) &&
-			splitPacketList[ i ]->creationTime >= newestUnreliableSplitPacket )
+		if ( ( channel->second.reliability == UNRELIABLE || channel->second.reliability == UNRELIABLE_SEQUENCED ) &&
+			time > channel->second.lastUpdateTime && time - channel->second.lastUpdateTime > 5000 )
 		{
-			orderingIndexToDelete = splitPacketList[ i ]->orderingIndex;
-			newestUnreliableSplitPacket = splitPacketList[ i ]->creationTime;
-			found = true;
+			FreeSplitPacketChannel( channel->second );
+			channel = splitPacketChannels.erase( channel );
 		}
+		else
+			channel++;
 	}
+}
 
-	if ( found && time>newestUnreliableSplitPacket && time-newestUnreliableSplitPacket > 5000 )
+//-------------------------------------------------------------------------------------------------------
+// Delete the parts of a split packet
+//-------------------------------------------------------------------------------------------------------
+void ReliabilityLayer::FreeSplitPacketChannel( SplitPacketChannel &channel )
+{
+	for ( unsigned i = 0; i < channel.parts.size(); i++ )
 	{
-		// Delete all split packets that use orderingIndexToDelete
-		i = 0;
-
-		while ( i < splitPacketList.size() )
+		if ( channel.parts[ i ] )
 		{
-#pragma warning( disable : 4701 ) //  warning C4701: local variable 'orderingIndexToDelete' may be used without having been initialized
-			if ( splitPacketList[ i ]->orderingIndex == orderingIndexToDelete )
-			{
-				temp = splitPacketList[ i ];
-				splitPacketList[ i ] = splitPacketList[ splitPacketList.size() - 1 ];
-				splitPacketList.del(); // Removes the last element
-				delete [] temp->data;
-				internalPacketPool.ReleasePointer( temp );
-			}
-
-			else
-				i++;
+			FreeInternalPacketData( channel.parts[ i ] );
+			internalPacketPool.ReleasePointer( channel.parts[ i ] );
+			splitPacketPartsWaiting--;
 		}
 	}
+
+	channel.parts.clear();
+	channel.partsReceived = 0;
 }
 
 //-------------------------------------------------------------------------------------------------------
@@ -2102,6 +1957,7 @@ InternalPacket * ReliabilityLayer::CreateInternalPacketCopy( InternalPacket *ori
 	else
 		copy->data = 0;
 
+	copy->receiveBuffer = 0;
 	copy->dataBitLength = dataByteLength << 3;
 	copy->creationTime = time;
 	copy->isAcknowledgement = original->isAcknowledgement;
@@ -2116,21 +1972,9 @@ InternalPacket * ReliabilityLayer::CreateInternalPacketCopy( InternalPacket *ori
 }
 
 //-------------------------------------------------------------------------------------------------------
-// Get the specified ordering list
-// LOCK THIS WHOLE BLOCK WITH reliabilityLayerMutexes[orderingList_MUTEX].Unlock();
+// Add the internal packet to the ordering list at its order index
 //-------------------------------------------------------------------------------------------------------
-BasicDataStructures::LinkedList<InternalPacket*> *ReliabilityLayer::GetOrderingListAtOrderingStream( unsigned char orderingChannel )
-{
-	if ( orderingChannel >= orderingList.size() )
-		return 0;
-
-	return orderingList[ orderingChannel ];
-}
-
-//-------------------------------------------------------------------------------------------------------
-// Add the internal packet to the ordering list in order based on order index
-//-------------------------------------------------------------------------------------------------------
-void ReliabilityLayer::AddToOrderingList( InternalPacket * internalPacket )
+bool ReliabilityLayer::AddToOrderingList( InternalPacket * internalPacket )
 {
 #ifdef _DEBUG
 	assert( internalPacket->orderingChannel < NUMBER_OF_ORDERED_STREAMS );
@@ -2138,32 +1982,35 @@ void ReliabilityLayer::AddToOrderingList( InternalPacket * internalPacket )
 
 	if ( internalPacket->orderingChannel >= NUMBER_OF_ORDERED_STREAMS )
 	{
-		return;
+		return false;
 	}
 
-	BasicDataStructures::LinkedList<InternalPacket*> *theList;
+	BlobNet::ADT::SequenceRing<OrderingIndexType, InternalPacket*> &theList = orderingList[ internalPacket->orderingChannel ];
 
-	if ( internalPacket->orderingChannel >= orderingList.size() || orderingList[ internalPacket->orderingChannel ] == 0 )
-	{
-		// Need a linked list in this index
-		orderingList.replace( new BasicDataStructures::LinkedList<InternalPacket*>, 0, internalPacket->orderingChannel );
-		theList=orderingList[ internalPacket->orderingChannel ];
-	}
-	else
+	// Only possible if the other system has more than rangeof(OrderingIndexType) ordered packets in flight
+	if ( theList.find( internalPacket->orderingIndex ) )
+		return false;
+
+	theList.insert( internalPacket->orderingIndex, internalPacket );
+	orderedPacketsWaiting++;
+
+	return true;
+}
+
+//-------------------------------------------------------------------------------------------------------
+// Move the packets of the ordering list that are next in order to the output queue
+//-------------------------------------------------------------------------------------------------------
+void ReliabilityLayer::DeliverOrderedPackets( unsigned char orderingChannel )
+{
+	InternalPacket *internalPacket;
+
+	while ( orderingList[ orderingChannel ].remove( waitingForOrderedPacketReadIndex[ orderingChannel ], &internalPacket ) )
 	{
-		// Have a linked list in this index
-		if ( orderingList[ internalPacket->orderingChannel ]->size() == 0 )
-		{
-			theList=orderingList[ internalPacket->orderingChannel ];
-		}
-		else
-		{
-			theList = GetOrderingListAtOrderingStream( internalPacket->orderingChannel );
-		}
+		//printf("Pushing delayed packet %i with ordering index %i. outputQueue.size()==%i\n", internalPacket->packetNumber, internalPacket->orderingIndex, outputQueue.size() );
+		outputQueue.push( internalPacket );
+		waitingForOrderedPacketReadIndex[ orderingChannel ]++; // This wraps at 255
+		orderedPacketsWaiting--;
 	}
-
-	theList->end();
-	theList->add(internalPacket);
 }
 
 //-------------------------------------------------------------------------------------------------------
@@ -2181,11 +2028,22 @@ void ReliabilityLayer::InsertPacketIntoResendQueue( InternalPacket *internalPack
 		InternalPacket *pool=internalPacketPool.GetPointer();
 		//printf("Adding %i\n", internalPacket->data);
 		memcpy(pool, internalPacket, sizeof(InternalPacket));
-		resendQueue.push( pool );
+		internalPacket = pool;
 	}
-	else
+
+	resendQueueIndex.insert( internalPacket->packetNumber, resendQueueHead + resendQueue.size() );
+	resendQueue.push( internalPacket );
+}
+
+//-------------------------------------------------------------------------------------------------------
+// Removes the holes at the head of the resend queue, so peek returns the next packet to resend
+//-------------------------------------------------------------------------------------------------------
+void ReliabilityLayer::CompressResendQueueHead( void )
+{
+	while ( resendQueue.size() > 0 && resendQueue.peek() == 0 )
 	{
-		resendQueue.push( internalPacket );
+		resendQueue.pop();
+		resendQueueHead++;
 	}
 }
 
@@ -2210,8 +2068,8 @@ void ReliabilityLayer::KillConnection( void )
 //-------------------------------------------------------------------------------------------------------
 void ReliabilityLayer::SetLostPacketResendDelay( unsigned int i )
 {
-	if ( i > 0 )
-		lostPacketResendDelay = i;
+	// A ping of 0 is possible on the local network, so accept 0, too. It is raised to the minimum below.
+	lostPacketResendDelay = i;
 
 	if ( lostPacketResendDelay < 150 )   // To avoid unnecessary packetloss, this value should be UPDATE_THREAD_UPDATE_TIME + UPDATE_THREAD_POLL_TIME at a minimum
 		lostPacketResendDelay = 150;
@@ -2231,7 +2089,7 @@ RakNetStatisticsStruct * const ReliabilityLayer::GetStatistics( void )
 	}
 
 	statistics.acknowlegementsPending = acknowledgementQueue.size();
-	statistics.messagesWaitingForReassembly = splitPacketList.size();
+	statistics.messagesWaitingForReassembly = splitPacketPartsWaiting;
 	statistics.internalOutputQueueSize = outputQueue.size();
 	statistics.windowSize = windowSize;
 	statistics.lossySize = lossyWindowSize == MAXIMUM_WINDOW_SIZE + 1 ? 0 : lossyWindowSize;
@@ -2250,7 +2108,8 @@ bool ReliabilityLayer::IsExpiredTime(unsigned int input, unsigned int currentTim
 	if (IsReceivedPacketHole(input, currentTime))
 		input -= TIMEOUT_TIME*100;
 
-	if (input < currentTime - TIMEOUT_TIME)
+	// GetTime starts at 0, so nothing can have expired during the first TIMEOUT_TIME
+	if (currentTime > TIMEOUT_TIME && input < currentTime - TIMEOUT_TIME)
 		return true;
 
 	return false;
@@ -2277,8 +2136,7 @@ unsigned int ReliabilityLayer::MakeReceivedPacketHole(unsigned int input) const
 //-------------------------------------------------------------------------------------------------------
 unsigned int ReliabilityLayer::GetResendQueueDataSize(void) const
 {
-	// Not accurate but thread-safe.  The commented version might crash if the queue is cleared while we loop through it
-	return resendQueue.size();
+	return resendQueueIndex.size();
 }
 
 //-------------------------------------------------------------------------------------------------------
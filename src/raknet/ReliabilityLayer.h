@@ -43,8 +43,13 @@
 #include "InternalPacketPool.h"
 #include "RakNetStatistics.h"
 #include "NetworkTypes.h"
+#include "PacketPool.h"
 
 #include "../blobnet/adt/Queue.hpp"
+#include "../blobnet/adt/SequenceRing.hpp"
+
+#include <unordered_map>
+#include <vector>
 
 /**
 * Sizeof an UDP header in byte
@@ -104,19 +109,23 @@ public:
 	* @param restrictToFirstPacket Set to true if this is a connection request.  It will only allow packets with a packetNumber of 0
 	* @param firstPacketDataID If restrictToFirstPacket is true, then this is packetID type that is allowed.  Other types are ignored
 	* @param length The size of buffer
+	* @param receiveBuffer The pooled buffer holding @em buffer. Messages that are not split
+	* keep a reference to it instead of copying their data. 0 to copy all messages.
 	* @return false on modified packets
 	*/
-	bool HandleSocketReceiveFromConnectedPlayer( const char *buffer, int length );
+	bool HandleSocketReceiveFromConnectedPlayer( const char *buffer, int length, ReceiveBuffer *receiveBuffer = 0 );
 
 	/**
 	* This gets an end-user packet already parsed out.
 	*
 	* @param data The game data
+	* @param receiveBuffer The buffer data points into, 0 if data was allocated with new [].
+	* The caller owns the reference, free both with ReceiveBufferPool::FreeData
 	* @return Returns number of BITS put into the buffer
 	* @note Callable from multiple threads
 	*
 	*/
-	int Receive( char**data );
+	int Receive( char**data, ReceiveBuffer **receiveBuffer );
 
 	/**
 	* Puts data on the send queue
@@ -139,6 +148,8 @@ public:
 	* HandleSocketReceiveFromConnectedPlayer
 	*
 	* @param s the communication  end point
+	* @param batch if not 0, the datagrams are queued in it instead
+	* of being sent immediately. The caller has to send the batch.
 	* @param playerId The Unique Player Identifier who should
 	* have sent some packets
 	* @param MTUSize
@@ -146,7 +157,7 @@ public:
 	* @todo
 	* Document MTUSize and time parameter
 	*/
-	void Update( SOCKET s, PlayerID playerId, int MTUSize, unsigned int time );
+	void Update( SOCKET s, DatagramBatch *batch, PlayerID playerId, int MTUSize, unsigned int time );
 
 	/**
 	* Were you ever unable to deliver a packet despite retries?
@@ -176,7 +187,27 @@ public:
 	*/
 	bool IsDataWaiting(void);
 
+	/**
+	* How long Update can wait before it has something to do, i.e. until the next
+	* acknowledgement or resend is due. Incoming data is not considered.
+	* @param time the current time
+	* @param maximumWait the value returned if there is nothing to do at all
+	* @return the time to wait in ms, 0 if Update should be called immediately
+	*/
+	unsigned int GetTimeToNextUpdate( unsigned int time, unsigned int maximumWait );
+
 private:
+	/**
+	* The parts of a split packet that have arrived, indexed by splitPacketIndex
+	*/
+	struct SplitPacketChannel
+	{
+		std::vector<InternalPacket*> parts;
+		unsigned int partsReceived;
+		unsigned int lastUpdateTime;
+		PacketReliability reliability;
+	};
+
 	/**
 	* Returns true if we can or should send a frame.  False if we should not
 	* @param time The time to wait before sending a frame
@@ -199,10 +230,11 @@ private:
 	/**
 	* Writes a bitstream to the socket
 	* @param s The socket used for sending data
+	* @param batch The batch the data is queued in, or 0 to send it immediately
 	* @param playerId The target of the communication
 	* @param bitStream The data to send.
 	*/
-	void SendBitStream( SOCKET s, PlayerID playerId, RakNet::BitStream *bitStream );
+	void SendBitStream( SOCKET s, DatagramBatch *batch, PlayerID playerId, RakNet::BitStream *bitStream );
 	/**
 	* Parse an internalPacket and create a bitstream to represent this data
 	* Returns number of bits used
@@ -210,7 +242,11 @@ private:
 	int WriteToBitStreamFromInternalPacket( RakNet::BitStream *bitStream, const InternalPacket *const internalPacket );
 
 	// Parse a bitstream and create an internal packet to represent this data
-	InternalPacket* CreateInternalPacketFromBitStream( RakNet::BitStream *bitStream, unsigned int time );
+	// If receiveBuffer is not 0, the data of packets that are not split points into it
+	InternalPacket* CreateInternalPacketFromBitStream( RakNet::BitStream *bitStream, unsigned int time, ReceiveBuffer *receiveBuffer );
+
+	// Deletes the data of an internal packet or releases the buffer it points into
+	void FreeInternalPacketData( InternalPacket *internalPacket );
 
 	// Does what the function name says
 	void RemovePacketFromResendQueueAndDeleteOlderReliableSequenced( PacketNumberType packetNumber );
@@ -233,8 +269,8 @@ private:
 	// Split the passed packet into chunks under MTU_SIZE bytes (including headers) and save those new chunks
 	void SplitPacket( InternalPacket *internalPacket, int MTUSize );
 
-	// Insert a packet into the split packet list
-	void InsertIntoSplitPacketList( InternalPacket * internalPacket );
+	// Insert a packet into the split packet list. Returns false if the packet is a duplicate or does not match the other parts, the caller still owns it then
+	bool InsertIntoSplitPacketList( InternalPacket * internalPacket, unsigned int time );
 
 	// Take all split chunks with the specified splitPacketId and try to reconstruct a packet. If we can, allocate and return it.  Otherwise return 0
 	InternalPacket * BuildPacketFromSplitPacketList( unsigned int splitPacketId, unsigned int time );
@@ -242,20 +278,25 @@ private:
 	// Delete any unreliable split packets that have long since expired
 	void DeleteOldUnreliableSplitPackets( unsigned int time );
 
+	// Delete the parts of a split packet
+	void FreeSplitPacketChannel( SplitPacketChannel &channel );
+
 	// Creates a copy of the specified internal packet with data copied from the original starting at dataByteOffset for dataByteLength bytes.
 	// Does not copy any split data parameters as that information is always generated does not have any reason to be copied
 	InternalPacket * CreateInternalPacketCopy( InternalPacket *original, int dataByteOffset, int dataByteLength, unsigned int time );
 
-	// Get the specified ordering list
-	// LOCK THIS WHOLE BLOCK WITH reliabilityLayerMutexes[orderingList_MUTEX].Unlock();
-	BasicDataStructures::LinkedList<InternalPacket*> *GetOrderingListAtOrderingStream( unsigned char orderingChannel );
+	// Add the internal packet to the ordering list of its channel at its order index. Returns false if that index is already taken, the caller still owns the packet then
+	bool AddToOrderingList( InternalPacket * internalPacket );
 
-	// Add the internal packet to the ordering list in order based on order index
-	void AddToOrderingList( InternalPacket * internalPacket );
+	// Move the packets of the ordering list that are next in order to the output queue
+	void DeliverOrderedPackets( unsigned char orderingChannel );
 
 	// Inserts a packet into the resend list in order
 	void InsertPacketIntoResendQueue( InternalPacket *internalPacket, unsigned int time, bool makeCopyOfInternalPacket, bool resetAckTimer );
 
+	// Removes the holes at the head of the resend queue, so peek returns the next packet to resend
+	void CompressResendQueueHead( void );
+
 	// Memory handling
 	void FreeMemory( bool freeAllImmediately );
 	void FreeThreadSafeMemory( void );
@@ -270,10 +311,23 @@ private:
 	unsigned int GetResendQueueDataSize(void) const;
 	void UpdateThreadedMemory(void);
 
-	BasicDataStructures::List<InternalPacket*> splitPacketList;
-	BasicDataStructures::List<BasicDataStructures::LinkedList<InternalPacket*>*> orderingList;
+	// Split packets waiting for reassembly, by splitPacketId
+	std::unordered_map<unsigned int, SplitPacketChannel> splitPacketChannels;
+	unsigned int splitPacketPartsWaiting;
+	unsigned int lastSplitPacketCleanupTime;
+
+	// Ordered packets that arrived early, by ordering index
+	BlobNet::ADT::SequenceRing<OrderingIndexType, InternalPacket*> orderingList[ NUMBER_OF_ORDERED_STREAMS ];
+	unsigned int orderedPacketsWaiting;
+
 	BlobNet::ADT::Queue<InternalPacket*> acknowledgementQueue, outputQueue;
+
+	// Reliable packets in the order they have to be resent. Acknowledged packets leave a hole (0) behind, but the head is never a hole.
+	// resendQueueIndex maps the packet number to the position in resendQueue, counted from the first packet that was ever pushed;
+	// resendQueueHead is the position of resendQueue[ 0 ].
 	BlobNet::ADT::Queue<InternalPacket*> resendQueue;
+	BlobNet::ADT::SequenceRing<PacketNumberType, unsigned int> resendQueueIndex;
+	unsigned int resendQueueHead;
 	BlobNet::ADT::Queue<InternalPacket*> sendPacketSet[ NUMBER_OF_PRIORITIES ];
 	PacketNumberType packetNumber;
 	//unsigned int windowSize;
@@ -318,16 +372,6 @@ private:
 	*/
 	bool freeThreadedMemoryOnNextUpdate;
 
-#ifdef _INTERNET_SIMULATOR
-	struct DataAndTime
-	{
-		char data[ 2000 ];
-		int length;
-		unsigned int sendTime;
-	};
-	BasicDataStructures::List<DataAndTime*> delayList;
-#endif
-
 	// This has to be a member because it's not threadsafe when I removed the mutexes
 	InternalPacketPool internalPacketPool;
 };
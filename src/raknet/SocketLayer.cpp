@@ -30,15 +30,21 @@
 #include "../blobnet/Logger.hpp"
 
 #include "SocketLayer.h"
+#include "PacketPool.h"
+#include "GetTime.h"
 #include <cassert>
+#include <cstdlib> // strtod, strtoul
+#include <cstring> // memcpy
+#include <string>
 #include "MTUSize.h"
 
 #ifdef _WIN32
 #include <process.h>
 typedef int socklen_t;
 #else
-#include <cstring> // memcpy
 #include <fcntl.h>
+#include <poll.h>
+#define closesocket close
 #endif
 
 int SocketLayer::socketLayerInstanceCount = 0;
@@ -46,15 +52,273 @@ int SocketLayer::socketLayerInstanceCount = 0;
 SocketLayer SocketLayer::I;
 
 #ifdef _WIN32
-extern void __stdcall ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, RakPeer *rakPeer );
+extern void __stdcall ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, ReceiveBuffer *receiveBuffer, RakPeer *rakPeer );
 #else
-extern void ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, RakPeer *rakPeer );
+extern void ProcessNetworkPacket( unsigned int binaryAddress, unsigned short port, const char *data, int length, ReceiveBuffer *receiveBuffer, RakPeer *rakPeer );
 #endif
 
 #ifdef _DEBUG
 #include <cstdio>
 #endif
 
+DatagramBatch::DatagramBatch() :
+	buffer( CAPACITY * MAXIMUM_MTU_SIZE ),
+	pool( 0 ),
+	impairment( 0 ),
+	count( 0 ),
+	calls( 0 ),
+	datagrams( 0 )
+{
+	for ( int i = 0; i < CAPACITY; ++i )
+	{
+		receiveBuffers[ i ] = 0;
+		slots[ i ] = &buffer[ i * MAXIMUM_MTU_SIZE ];
+	}
+}
+
+DatagramBatch::DatagramBatch( ReceiveBufferPool *bufferPool ) :
+	pool( bufferPool ),
+	impairment( 0 ),
+	count( 0 ),
+	calls( 0 ),
+	datagrams( 0 )
+{
+	for ( int i = 0; i < CAPACITY; ++i )
+	{
+		receiveBuffers[ i ] = pool->GetPointer();
+		slots[ i ] = receiveBuffers[ i ]->data;
+	}
+}
+
+DatagramBatch::~DatagramBatch()
+{
+	for ( int i = 0; i < CAPACITY; ++i )
+	{
+		if ( receiveBuffers[ i ] )
+			receiveBuffers[ i ]->Release();
+	}
+}
+
+void DatagramBatch::PrepareReceive()
+{
+	if ( pool == 0 )
+		return;
+
+	for ( int i = 0; i < CAPACITY; ++i )
+	{
+		if ( receiveBuffers[ i ]->IsExclusive() )
+			continue;
+
+		receiveBuffers[ i ]->Release();
+		receiveBuffers[ i ] = pool->GetPointer();
+		slots[ i ] = receiveBuffers[ i ]->data;
+	}
+}
+
+bool DatagramBatch::Add( const char *data, int length, unsigned int binaryAddress, unsigned short port )
+{
+	if ( IsFull() || length < 0 || length > MAXIMUM_MTU_SIZE )
+		return false;
+
+	// never write into a buffer a message still points into
+	if ( pool && !receiveBuffers[ count ]->IsExclusive() )
+	{
+		receiveBuffers[ count ]->Release();
+		receiveBuffers[ count ] = pool->GetPointer();
+		slots[ count ] = receiveBuffers[ count ]->data;
+	}
+
+	memcpy( slots[ count ], data, length );
+	lengths[ count ] = length;
+	memset( &addresses[ count ], 0, sizeof( sockaddr_in ) );
+	addresses[ count ].sin_family = AF_INET;
+	addresses[ count ].sin_addr.s_addr = binaryAddress;
+	addresses[ count ].sin_port = htons( port );
+	++count;
+	return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+NetworkImpairmentSettings::NetworkImpairmentSettings() :
+	loss( 0 ),
+	latency( 0 ),
+	jitter( 0 ),
+	duplicate( 0 ),
+	reorder( 0 ),
+	seed( 0 )
+{
+}
+
+bool NetworkImpairmentSettings::Parse( const char *spec )
+{
+	NetworkImpairmentSettings parsed = *this;
+	std::string remaining( spec );
+
+	while ( !remaining.empty() )
+	{
+		std::string::size_type end = remaining.find( ',' );
+		std::string setting = remaining.substr( 0, end );
+		remaining = end == std::string::npos ? "" : remaining.substr( end + 1 );
+
+		std::string::size_type separator = setting.find( '=' );
+		if ( separator == std::string::npos )
+			return false;
+
+		std::string name = setting.substr( 0, separator );
+		const char *value = setting.c_str() + separator + 1;
+		char *valueEnd;
+		double number = strtod( value, &valueEnd );
+		if ( *value == 0 || *valueEnd != 0 || number < 0 )
+			return false;
+
+		if ( name == "loss" || name == "duplicate" || name == "reorder" )
+		{
+			if ( number > 1 )
+				return false;
+			( name == "loss" ? parsed.loss : name == "duplicate" ? parsed.duplicate : parsed.reorder ) = number;
+		}
+		else if ( name == "latency" )
+			parsed.latency = ( unsigned int ) number;
+		else if ( name == "jitter" )
+			parsed.jitter = ( unsigned int ) number;
+		else if ( name == "seed" )
+			parsed.seed = ( unsigned int ) number;
+		else
+			return false;
+	}
+
+	*this = parsed;
+	return true;
+}
+
+bool NetworkImpairmentSettings::IsActive( void ) const
+{
+	return loss > 0 || latency > 0 || jitter > 0 || duplicate > 0 || reorder > 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+NetworkImpairment::NetworkImpairment() :
+	sequence( 0 ),
+	delayed( 0 ),
+	dropped( 0 ),
+	duplicated( 0 ),
+	reordered( 0 )
+{
+	random.seed( settings.seed );
+}
+
+void NetworkImpairment::SetSettings( const NetworkImpairmentSettings &newSettings )
+{
+	settings = newSettings;
+	random.seed( settings.seed );
+}
+
+void NetworkImpairment::Impair( DatagramBatch &batch, unsigned int time )
+{
+	std::uniform_real_distribution<double> chance( 0, 1 );
+	std::uniform_int_distribution<unsigned int> jitter( 0, settings.jitter );
+
+	for ( int i = 0; i < batch.Size(); ++i )
+	{
+		// every decision is only drawn if it can happen, so a setting of 0 does not change the others
+		if ( settings.loss > 0 && chance( random ) < settings.loss )
+		{
+			++dropped;
+			continue;
+		}
+
+		int copies = 1;
+		if ( settings.duplicate > 0 && chance( random ) < settings.duplicate )
+		{
+			++duplicated;
+			copies = 2;
+		}
+
+		for ( int copy = 0; copy < copies; ++copy )
+		{
+			unsigned int releaseTime = time + settings.latency;
+			if ( settings.jitter > 0 )
+				releaseTime += jitter( random );
+
+			if ( settings.reorder > 0 && chance( random ) < settings.reorder )
+			{
+				// not recorded as the latest release, so the following datagrams overtake this one
+				++reordered;
+				releaseTime += REORDER_DELAY;
+			}
+			else
+			{
+				unsigned int &lastReleaseTime = lastReleaseTimes[ Destination( batch.GetBinaryAddress( i ), batch.GetPort( i ) ) ];
+				if ( releaseTime < lastReleaseTime )
+					releaseTime = lastReleaseTime;
+				lastReleaseTime = releaseTime;
+			}
+
+			if ( releaseTime > time )
+				++delayed;
+
+			HoldBack( batch.GetData( i ), batch.GetLength( i ), batch.GetBinaryAddress( i ), batch.GetPort( i ), releaseTime );
+		}
+	}
+
+	batch.Clear();
+}
+
+void NetworkImpairment::HoldBack( const char *data, int length, unsigned int binaryAddress, unsigned short port, unsigned int releaseTime )
+{
+	Datagram &datagram = queue[ ReleaseKey( releaseTime, sequence++ ) ];
+	datagram.data.assign( data, data + length );
+	datagram.binaryAddress = binaryAddress;
+	datagram.port = port;
+}
+
+bool NetworkImpairment::Release( DatagramBatch &batch, unsigned int time )
+{
+	batch.Clear();
+
+	std::map<ReleaseKey, Datagram>::iterator datagram = queue.begin();
+	while ( datagram != queue.end() && datagram->first.first <= time )
+	{
+		if ( batch.IsFull() )
+			return true;
+
+		batch.Add( datagram->second.data.data(), ( int ) datagram->second.data.size(), datagram->second.binaryAddress, datagram->second.port );
+		datagram = queue.erase( datagram );
+	}
+
+	if ( queue.empty() )
+		lastReleaseTimes.clear();
+
+	return false;
+}
+
+bool NetworkImpairment::GetNextReleaseTime( unsigned int *time ) const
+{
+	if ( queue.empty() )
+		return false;
+
+	*time = queue.begin()->first.first;
+	return true;
+}
+
+void NetworkImpairment::Clear( void )
+{
+	queue.clear();
+	lastReleaseTimes.clear();
+}
+
+void NetworkImpairment::AddStatistics( SocketStatistics *statistics ) const
+{
+	statistics->datagramsDelayed += delayed;
+	statistics->datagramsDropped += dropped;
+	statistics->datagramsDuplicated += duplicated;
+	statistics->datagramsReordered += reordered;
+}
+
+//-------------------------------------------------------------------------------------------------
+
 SocketLayer::SocketLayer()
 {
 	// Check if the socketlayer is already started
@@ -257,7 +521,7 @@ int SocketLayer::RecvFrom( SOCKET s, RakPeer *rakPeer, int *errorCode )
 		//strcpy(ip, inet_ntoa(sa.sin_addr));
 		//if (strcmp(ip, "0.0.0.0")==0)
 		// strcpy(ip, "127.0.0.1");
-		ProcessNetworkPacket( sa.sin_addr.s_addr, portnum, data, len, rakPeer );
+		ProcessNetworkPacket( sa.sin_addr.s_addr, portnum, data, len, 0, rakPeer );
 
 		return 1;
 	}
@@ -345,6 +609,267 @@ int SocketLayer::SendTo( SOCKET s, const char *data, int length, char ip[ 16 ],
 	return SendTo( s, data, length, binaryAddress, port );
 }
 
+int SocketLayer::SendTo( SOCKET s, DatagramBatch &batch, const char *data, int length, unsigned int binaryAddress, unsigned short port )
+{
+	if ( s == INVALID_SOCKET )
+	{
+		return -1;
+	}
+
+	if ( batch.IsFull() )
+		SendBatch( s, batch );
+
+	if ( batch.Add( data, length, binaryAddress, port ) )
+		return 0;
+
+	// too long for the batch
+	return SendTo( s, data, length, binaryAddress, port );
+}
+
+int SocketLayer::RecvFromBatch( SOCKET s, DatagramBatch &batch, int *errorCode )
+{
+	NetworkImpairment *impairment = batch.impairment;
+
+	if ( impairment == 0 || !impairment->IsActive() )
+		return ReceiveDatagrams( s, batch, errorCode );
+
+	// drain the socket into the impairment, then hand out what is due
+	unsigned int time = RakNet::GetTime();
+	int received;
+
+	do
+	{
+		received = ReceiveDatagrams( s, batch, errorCode );
+
+		if ( received == SOCKET_ERROR )
+			return SOCKET_ERROR;
+
+		impairment->Impair( batch, time );
+	}
+	while ( received == DatagramBatch::CAPACITY );
+
+	impairment->Release( batch, time );
+	return batch.Size();
+}
+
+int SocketLayer::ReceiveDatagrams( SOCKET s, DatagramBatch &batch, int *errorCode )
+{
+	batch.Clear();
+
+	if ( s == INVALID_SOCKET )
+	{
+		*errorCode = SOCKET_ERROR;
+		return SOCKET_ERROR;
+	}
+
+	batch.PrepareReceive();
+
+#ifdef __linux__
+	mmsghdr messages[ DatagramBatch::CAPACITY ];
+	iovec vectors[ DatagramBatch::CAPACITY ];
+
+	for ( int i = 0; i < DatagramBatch::CAPACITY; ++i )
+	{
+		vectors[ i ].iov_base = batch.slots[ i ];
+		vectors[ i ].iov_len = MAXIMUM_MTU_SIZE;
+		memset( &messages[ i ], 0, sizeof( mmsghdr ) );
+		messages[ i ].msg_hdr.msg_name = &batch.addresses[ i ];
+		messages[ i ].msg_hdr.msg_namelen = sizeof( sockaddr_in );
+		messages[ i ].msg_hdr.msg_iov = &vectors[ i ];
+		messages[ i ].msg_hdr.msg_iovlen = 1;
+	}
+
+	int received = recvmmsg( s, messages, DatagramBatch::CAPACITY, MSG_DONTWAIT, 0 );
+	++batch.calls;
+
+	// like recvfrom errors, these are not fatal. Usually there is just no data.
+	if ( received <= 0 )
+	{
+		*errorCode = 0;
+		return 0;
+	}
+
+	for ( int i = 0; i < received; ++i )
+		batch.lengths[ i ] = messages[ i ].msg_len;
+	batch.count = received;
+#else
+	while ( !batch.IsFull() )
+	{
+		sockaddr_in& sa = batch.addresses[ batch.count ];
+		socklen_t length = sizeof( sockaddr_in );
+		int len = recvfrom( s, batch.slots[ batch.count ], MAXIMUM_MTU_SIZE, 0, ( sockaddr* ) & sa, & length );
+		++batch.calls;
+
+		if ( len == SOCKET_ERROR )
+			break;
+
+		batch.lengths[ batch.count++ ] = len;
+	}
+
+	*errorCode = 0;
+#endif
+
+	batch.datagrams += batch.count;
+	return batch.count;
+}
+
+int SocketLayer::SendBatch( SOCKET s, DatagramBatch &batch )
+{
+	NetworkImpairment *impairment = batch.impairment;
+
+	if ( impairment == 0 || !impairment->IsActive() )
+		return SendDatagrams( s, batch );
+
+	unsigned int time = RakNet::GetTime();
+	impairment->Impair( batch, time );
+
+	int sent = 0;
+	bool more;
+
+	do
+	{
+		more = impairment->Release( batch, time );
+		sent += SendDatagrams( s, batch );
+	}
+	while ( more );
+
+	return sent;
+}
+
+int SocketLayer::SendDatagrams( SOCKET s, DatagramBatch &batch )
+{
+	int count = batch.count;
+	batch.Clear();
+
+	if ( s == INVALID_SOCKET || count == 0 )
+		return 0;
+
+	int sent = 0;
+
+#ifdef __linux__
+	mmsghdr messages[ DatagramBatch::CAPACITY ];
+	iovec vectors[ DatagramBatch::CAPACITY ];
+
+	for ( int i = 0; i < count; ++i )
+	{
+		vectors[ i ].iov_base = batch.slots[ i ];
+		vectors[ i ].iov_len = batch.lengths[ i ];
+		memset( &messages[ i ], 0, sizeof( mmsghdr ) );
+		messages[ i ].msg_hdr.msg_name = &batch.addresses[ i ];
+		messages[ i ].msg_hdr.msg_namelen = sizeof( sockaddr_in );
+		messages[ i ].msg_hdr.msg_iov = &vectors[ i ];
+		messages[ i ].msg_hdr.msg_iovlen = 1;
+	}
+
+	// sendmmsg stops at the first datagram that fails, so we skip that one and continue after it
+	while ( sent < count )
+	{
+		int result = sendmmsg( s, messages + sent, count - sent, 0 );
+		++batch.calls;
+
+		if ( result > 0 )
+		{
+			batch.datagrams += result;
+			sent += result;
+		}
+		else
+		{
+			++sent;
+		}
+	}
+#else
+	for ( int i = 0; i < count; ++i )
+	{
+		int len = sendto( s, batch.slots[ i ], batch.lengths[ i ], 0, ( const sockaddr* ) & batch.addresses[ i ], sizeof( sockaddr_in ) );
+		++batch.calls;
+
+		if ( len != SOCKET_ERROR )
+		{
+			++batch.datagrams;
+			++sent;
+		}
+	}
+#endif
+
+	return sent;
+}
+
+SOCKET SocketLayer::CreateWakeupSocket()
+{
+	SOCKET wakeupSocket = CreateBoundSocket( 0, false, "127.0.0.1" );
+
+	if ( wakeupSocket == INVALID_SOCKET )
+		return INVALID_SOCKET;
+
+	// find out which port we got and connect the socket to itself
+	sockaddr_in address;
+	socklen_t length = sizeof( address );
+
+	if ( getsockname( wakeupSocket, ( sockaddr* ) & address, & length ) == SOCKET_ERROR )
+	{
+		LOG("SocketLayer", "getsockname failed")
+		closesocket( wakeupSocket );
+		return INVALID_SOCKET;
+	}
+
+	if ( connect( wakeupSocket, ( sockaddr* ) & address, length ) != 0 )
+	{
+		LOG("SocketLayer", "connecting wakeup socket failed")
+		closesocket( wakeupSocket );
+		return INVALID_SOCKET;
+	}
+
+	return wakeupSocket;
+}
+
+bool SocketLayer::WaitForData( SOCKET s, SOCKET wakeupSocket, int timeout )
+{
+#ifdef _WIN32
+	fd_set readSet;
+	FD_ZERO( &readSet );
+	FD_SET( s, &readSet );
+
+	if ( wakeupSocket != INVALID_SOCKET )
+		FD_SET( wakeupSocket, &readSet );
+
+	timeval tv;
+	tv.tv_sec = timeout / 1000;
+	tv.tv_usec = ( timeout % 1000 ) * 1000;
+
+	// the first parameter is ignored by winsock
+	if ( select( 0, &readSet, 0, 0, &tv ) <= 0 )
+		return false;
+
+	return FD_ISSET( s, &readSet ) != 0;
+#else
+	pollfd fds[ 2 ];
+	fds[ 0 ].fd = s;
+	fds[ 0 ].events = POLLIN;
+	fds[ 0 ].revents = 0;
+	fds[ 1 ].fd = wakeupSocket;
+	fds[ 1 ].events = POLLIN;
+	fds[ 1 ].revents = 0;
+
+	int count = wakeupSocket != INVALID_SOCKET ? 2 : 1;
+
+	// a signal may interrupt us, but that just means an early update cycle
+	if ( poll( fds, count, timeout ) <= 0 )
+		return false;
+
+	return ( fds[ 0 ].revents & ( POLLIN | POLLERR ) ) != 0;
+#endif
+}
+
+void SocketLayer::Drain( SOCKET s )
+{
+	if ( s == INVALID_SOCKET )
+		return;
+
+	char buffer[ 16 ];
+	while ( recv( s, buffer, sizeof( buffer ), 0 ) > 0 )
+		;
+}
+
 
 void SocketLayer::GetMyIP(char ipList[10][16])
 {
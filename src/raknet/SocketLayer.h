@@ -55,7 +55,239 @@ static const SOCKET INVALID_SOCKET = -1;
 #define SOCKET_ERROR -1
 #endif
 
+#include <atomic>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "MTUSize.h"
+
 class RakPeer;
+struct ReceiveBuffer;
+class ReceiveBufferPool;
+class NetworkImpairment;
+
+/**
+ * Counters of the system calls the socket layer made for a RakPeer
+ */
+struct SocketStatistics
+{
+	/// recvfrom or recvmmsg calls
+	unsigned long receiveCalls;
+	/// datagrams read by these calls
+	unsigned long datagramsReceived;
+	/// sendto or sendmmsg calls of batched sends
+	unsigned long sendCalls;
+	/// datagrams written by these calls
+	unsigned long datagramsSent;
+	/// datagrams the network impairment held back, in both directions
+	unsigned long datagramsDelayed;
+	/// datagrams the network impairment dropped
+	unsigned long datagramsDropped;
+	/// datagrams the network impairment sent twice
+	unsigned long datagramsDuplicated;
+	/// datagrams the network impairment let later ones overtake
+	unsigned long datagramsReordered;
+};
+
+/**
+ * A set of datagrams that SocketLayer::RecvFromBatch and SocketLayer::SendBatch transfer with
+ * a single system call on platforms that support it (recvmmsg and sendmmsg on Linux), and with
+ * one call per datagram elsewhere. The batch counts the calls and datagrams it transferred.
+ */
+class DatagramBatch
+{
+
+public:
+	/**
+	 * Maximum number of datagrams in a batch
+	 */
+	static const int CAPACITY = 32;
+
+	DatagramBatch();
+	/**
+	 * Creates a batch that receives into buffers of the pool. A datagram that is still
+	 * referenced when the next batch is read keeps its buffer, the batch takes a new one.
+	 * Such a batch can not be used for sending.
+	 */
+	explicit DatagramBatch( ReceiveBufferPool *pool );
+	~DatagramBatch();
+
+	/**
+	 * Copies a datagram into the batch
+	 * @return false if the batch is full or the datagram too long
+	 */
+	bool Add( const char *data, int length, unsigned int binaryAddress, unsigned short port );
+	void Clear() { count = 0; }
+
+	int Size() const { return count; }
+	bool IsFull() const { return count == CAPACITY; }
+
+	const char* GetData( int index ) const { return slots[ index ]; }
+	/**
+	 * The pooled buffer that holds a received datagram, 0 if the batch does not use a pool
+	 */
+	ReceiveBuffer* GetBuffer( int index ) const { return receiveBuffers[ index ]; }
+
+	/**
+	 * Passes all datagrams that are sent or received with this batch through an impairment,
+	 * 0 to turn it off. The impairment is only used from the thread using the batch.
+	 */
+	void SetImpairment( NetworkImpairment *networkImpairment ) { impairment = networkImpairment; }
+	NetworkImpairment* GetImpairment( void ) const { return impairment; }
+	int GetLength( int index ) const { return lengths[ index ]; }
+	unsigned int GetBinaryAddress( int index ) const { return addresses[ index ].sin_addr.s_addr; }
+	unsigned short GetPort( int index ) const { return ntohs( addresses[ index ].sin_port ); }
+
+	/**
+	 * Number of system calls made for this batch so far
+	 */
+	unsigned long GetCalls() const { return calls; }
+	/**
+	 * Number of datagrams transferred with this batch so far
+	 */
+	unsigned long GetDatagrams() const { return datagrams; }
+
+private:
+	friend class SocketLayer;
+
+	/**
+	 * Replaces the buffers that are still referenced by received messages
+	 */
+	void PrepareReceive();
+
+	std::vector<char> buffer;
+	ReceiveBufferPool *pool;
+	NetworkImpairment *impairment;
+	ReceiveBuffer *receiveBuffers[ CAPACITY ];
+	char *slots[ CAPACITY ];
+	sockaddr_in addresses[ CAPACITY ];
+	int lengths[ CAPACITY ];
+	int count;
+
+	// written by the update thread, may be read from others
+	std::atomic<unsigned long> calls;
+	std::atomic<unsigned long> datagrams;
+};
+
+/**
+ * How a NetworkImpairment degrades the datagrams passing through it
+ */
+struct NetworkImpairmentSettings
+{
+	/**
+	 * No impairment
+	 */
+	NetworkImpairmentSettings();
+
+	/**
+	 * Reads settings like "loss=0.05,latency=40,jitter=10,duplicate=0.01,reorder=0.01,seed=7".
+	 * Settings that are not mentioned keep their value.
+	 * @return false on an unknown name or an invalid value
+	 */
+	bool Parse( const char *spec );
+	/**
+	 * True if any datagram may be dropped, delayed or duplicated
+	 */
+	bool IsActive( void ) const;
+
+	/// probability that a datagram is dropped, from 0 to 1
+	double loss;
+	/// milliseconds every datagram is delayed
+	unsigned int latency;
+	/// maximum random milliseconds added to the latency. Datagrams to the same address stay in order.
+	unsigned int jitter;
+	/// probability that a datagram is sent twice
+	double duplicate;
+	/// probability that a datagram is held back REORDER_DELAY milliseconds longer, so later ones overtake it
+	double reorder;
+	/// seed of all random decisions, so an impaired run can be repeated
+	unsigned int seed;
+};
+
+/**
+ * Simulates a bad network for the datagrams of a DatagramBatch. Dropped datagrams are
+ * discarded, all others are copied and released again when they are due.
+ */
+class NetworkImpairment
+{
+
+public:
+	/**
+	 * Milliseconds a reordered datagram is held back in addition to latency and jitter
+	 */
+	static const unsigned int REORDER_DELAY = 20;
+
+	NetworkImpairment();
+
+	/**
+	 * Changes the settings and restarts the random decisions from their seed.
+	 * Datagrams that are already held back keep their times.
+	 */
+	void SetSettings( const NetworkImpairmentSettings &newSettings );
+	const NetworkImpairmentSettings& GetSettings( void ) const { return settings; }
+
+	/**
+	 * True if the settings impair datagrams or some are still held back
+	 */
+	bool IsActive( void ) const { return settings.IsActive() || !queue.empty(); }
+
+	/**
+	 * Takes all datagrams out of the batch, dropping some and holding back the others
+	 * @param batch the datagrams, empty afterwards
+	 * @param time the current time
+	 */
+	void Impair( DatagramBatch &batch, unsigned int time );
+	/**
+	 * Moves the held back datagrams that are due into a batch
+	 * @param batch the batch to fill
+	 * @param time the current time
+	 * @return true if the batch ran full before all due datagrams were moved
+	 */
+	bool Release( DatagramBatch &batch, unsigned int time );
+	/**
+	 * @param time Receives when the next held back datagram is due
+	 * @return false if no datagram is held back
+	 */
+	bool GetNextReleaseTime( unsigned int *time ) const;
+	/**
+	 * Discards all held back datagrams
+	 */
+	void Clear( void );
+
+	/**
+	 * Adds the counters of this impairment to statistics. Callable from any thread.
+	 */
+	void AddStatistics( SocketStatistics *statistics ) const;
+
+private:
+	struct Datagram
+	{
+		std::vector<char> data;
+		unsigned int binaryAddress;
+		unsigned short port;
+	};
+
+	/// when a datagram is due, and a sequence number so datagrams due at the same time keep their order
+	typedef std::pair<unsigned int, unsigned long> ReleaseKey;
+	/// a remote address and port
+	typedef std::pair<unsigned int, unsigned short> Destination;
+
+	void HoldBack( const char *data, int length, unsigned int binaryAddress, unsigned short port, unsigned int releaseTime );
+
+	NetworkImpairmentSettings settings;
+	std::mt19937 random;
+	std::map<ReleaseKey, Datagram> queue;
+	/// the latest release time per destination, so jitter does not reorder
+	std::map<Destination, unsigned int> lastReleaseTimes;
+	unsigned long sequence;
+
+	// written by the thread using the impairment, may be read from others
+	std::atomic<unsigned long> delayed;
+	std::atomic<unsigned long> dropped;
+	std::atomic<unsigned long> duplicated;
+	std::atomic<unsigned long> reordered;
+};
 
 /**
  * the SocketLayer provide platform independent Socket implementation
@@ -121,6 +353,18 @@ public:
 	 *
 	 */
 	int RecvFrom( SOCKET s, RakPeer *rakPeer, int *errorCode );
+	/**
+	 * Reads up to DatagramBatch::CAPACITY datagrams from a non-blocking socket into @em batch,
+	 * replacing its previous content. If the batch is not full afterwards, no data is left.
+	 * Datagrams of length 0 are kept in the batch and have to be skipped by the caller.
+	 * If the batch has an impairment, all waiting datagrams pass through it and the batch
+	 * receives those that are due.
+	 * @param s the socket
+	 * @param batch receives the datagrams
+	 * @param errorCode An error code if an error occured
+	 * @return the number of datagrams read, or SOCKET_ERROR on a fatal error
+	 */
+	int RecvFromBatch( SOCKET s, DatagramBatch &batch, int *errorCode );
 	/**
 	 * Send data to a peer. The socket should not be connected to a remote host.
 	 * @param s the socket
@@ -145,6 +389,47 @@ public:
 	 * @todo check return value
 	 */
 	int SendTo( SOCKET s, const char *data, int length, unsigned int binaryAddress, unsigned short port );
+	/**
+	 * Queues data for a peer in @em batch. A full batch is sent first.
+	 * @param s the socket the batch is sent with
+	 * @param batch the datagrams to send with the next SendBatch
+	 * @param data the byte buffer to send
+	 * @param length The length of the @em data
+	 * @param binaryAddress The peer address in binary format.
+	 * @param port The port number used by the remote host
+	 * @return 0 on success.
+	 */
+	int SendTo( SOCKET s, DatagramBatch &batch, const char *data, int length, unsigned int binaryAddress, unsigned short port );
+	/**
+	 * Sends all datagrams of @em batch and clears it. Datagrams the socket does not accept are
+	 * dropped, like with SendTo. If the batch has an impairment, the datagrams pass through it
+	 * and only those that are due are sent.
+	 * @param s the socket
+	 * @param batch the datagrams to send
+	 * @return the number of datagrams sent
+	 */
+	int SendBatch( SOCKET s, DatagramBatch &batch );
+
+	/**
+	 * Creates a non-blocking socket on the loopback interface that is connected to itself.
+	 * Writing a byte to it makes it readable, so it can be used to interrupt WaitForData
+	 * from another thread.
+	 * @return The socket, or INVALID_SOCKET on failure
+	 */
+	SOCKET CreateWakeupSocket();
+	/**
+	 * Blocks until data can be read from a socket or the timeout expires.
+	 * @param s the socket to wait for
+	 * @param wakeupSocket a socket created by CreateWakeupSocket, or INVALID_SOCKET
+	 * @param timeout the maximum time to wait in milliseconds
+	 * @return true if data is waiting on @em s
+	 */
+	bool WaitForData( SOCKET s, SOCKET wakeupSocket, int timeout );
+	/**
+	 * Reads and discards everything that is waiting on a non-blocking socket
+	 * @param s the socket
+	 */
+	void Drain( SOCKET s );
 
 	/// Retrieve all local IP address in a printable format
 	/// @param ipList An array of ip address in dot format.
@@ -159,6 +444,11 @@ public:
 	int nameToIpStrings(char const * const name, char* const buffer, int const bufferEntrySize, int const bufferEntryCount);
 
 private:	
+	/// @brief Receives into a batch, ignoring its impairment
+	int ReceiveDatagrams( SOCKET s, DatagramBatch &batch, int *errorCode );
+	/// @brief Sends a batch, ignoring its impairment
+	int SendDatagrams( SOCKET s, DatagramBatch &batch );
+
 	/// @brief Convert a socketaddress to an ip string
 	/// @param socketaddress Socketaddress
 	/// @param buffer Buffer for the result
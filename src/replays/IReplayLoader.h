@@ -86,6 +86,8 @@ class IReplayLoader : public ObjectCounter<IReplayLoader>
 		virtual int getLength()  const = 0;
 		/// gets the date this replay was recorded
 		virtual std::time_t getDate() const = 0;
+		/// whether the game was played with deterministic physics
+		virtual bool hasDeterministicPhysics() const = 0;
 
 
 		// Replay data interface
@@ -26,7 +26,7 @@ constexpr const char legacyHeader[4] = { 'B', 'V', '2', 'R' };	//!< header of re
 /// \todo add warning when trying to read old files
 
 constexpr const unsigned char REPLAY_FILE_VERSION_MAJOR = 2;
-constexpr const unsigned char REPLAY_FILE_VERSION_MINOR = 0;
+constexpr const unsigned char REPLAY_FILE_VERSION_MINOR = 1;
 
 // 10 secs for normal gamespeed
 const int REPLAY_SAVEPOINT_PERIOD = 750;
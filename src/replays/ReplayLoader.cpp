@@ -72,7 +72,7 @@ class ReplayLoader_V2X: public IReplayLoader
 		~ReplayLoader_V2X() override = default;
 
 		int getVersionMajor() const override { return 2; };
-		int getVersionMinor() const override { return 0; };
+		int getVersionMinor() const override { return 1; };
 
 		std::string getPlayerName(PlayerSide player) const override
 		{
@@ -125,6 +125,11 @@ class ReplayLoader_V2X: public IReplayLoader
 			return mGameDate;
 		};
 
+		bool hasDeterministicPhysics() const override
+		{
+			return mDeterministicPhysics;
+		}
+
 		std::string getRules() const override
 		{
 			return mRules;
@@ -250,6 +255,8 @@ class ReplayLoader_V2X: public IReplayLoader
 					mGameDuration = boost::lexical_cast<int>(value);
 				else if( name == "game_date" )
 					mGameDate = boost::lexical_cast<int>(value);
+				else if( name == "deterministic_physics" )
+					mDeterministicPhysics = boost::lexical_cast<int>(value) != 0;
 				else if( name == "score_left" )
 					mLeftFinalScore = boost::lexical_cast<int>(value);
 				else if( name == "score_right" )
@@ -313,6 +320,7 @@ class ReplayLoader_V2X: public IReplayLoader
 		unsigned int mGameDate;
 		unsigned int mGameLength;
 		unsigned int mGameDuration;
+		bool mDeterministicPhysics = false;
 		Color mLeftColor;
 		Color mRightColor;
 
@@ -63,6 +63,11 @@ int ReplayPlayer::getGameSpeed() const
 	return loader->getSpeed();
 }
 
+bool ReplayPlayer::hasDeterministicPhysics() const
+{
+	return loader->hasDeterministicPhysics();
+}
+
 float ReplayPlayer::getPlayProgress() const
 {
 	return (float)mPosition / mLength;
@@ -52,6 +52,9 @@ class ReplayPlayer : public ObjectCounter<ReplayPlayer>
 		std::string getPlayerName(PlayerSide side) const;
 		Color getBlobColor(PlayerSide side) const;
 		int getGameSpeed() const;
+		/// whether the game was played with deterministic physics. Then the replay has to be
+		/// played with deterministic physics, too, as it contains no save points.
+		bool hasDeterministicPhysics() const;
 
 		// -----------------------------------------------------------------------------------------
 		// 							Status information
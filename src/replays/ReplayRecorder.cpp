@@ -33,8 +33,6 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "raknet/BitStream.h"
 
-#include <SDL2/SDL.h>
-
 #include "Global.h"
 #include "ReplayDefs.h"
 #include "IReplayLoader.h"
@@ -68,6 +66,7 @@ const char* VersionMismatchException::what() const noexcept
 ReplayRecorder::ReplayRecorder()
 {
 	mGameSpeed = -1;
+	mDeterministicPhysics = false;
 }
 
 ReplayRecorder::~ReplayRecorder() = default;
@@ -97,6 +96,7 @@ void ReplayRecorder::save( const std::shared_ptr<FileWrite>& file) const
 	writeAttribute(*file, "game_length", mSaveData.size());
 	writeAttribute(*file, "game_duration", mSaveData.size() / mGameSpeed);
 	writeAttribute(*file, "game_date", std::time(nullptr));
+	writeAttribute(*file, "deterministic_physics", (int)mDeterministicPhysics);
 
 	writeAttribute(*file, "score_left", mEndScore[LEFT_PLAYER]);
 	writeAttribute(*file, "score_right", mEndScore[RIGHT_PLAYER]);
@@ -149,6 +149,7 @@ void ReplayRecorder::send(const std::shared_ptr<GenericOut>& target) const
 	target->uint32( mEndScore[RIGHT_PLAYER] );
 
 	target->string(mGameRules);
+	target->boolean(mDeterministicPhysics);
 
 	target->generic<std::vector<unsigned char> >(mSaveData);
 	target->generic<std::vector<ReplaySavePoint> > (mSavePoints);
@@ -167,6 +168,7 @@ void ReplayRecorder::receive(const std::shared_ptr<GenericIn>& source)
 	source->uint32( mEndScore[RIGHT_PLAYER] );
 
 	source->string(mGameRules);
+	source->boolean(mDeterministicPhysics);
 
 	source->generic<std::vector<unsigned char> >(mSaveData);
 	source->generic<std::vector<ReplaySavePoint> > (mSavePoints);
@@ -175,10 +177,11 @@ void ReplayRecorder::receive(const std::shared_ptr<GenericIn>& source)
 void ReplayRecorder::record(const DuelMatchState& state)
 {
 	// save the state every REPLAY_SAVEPOINT_PERIOD frames
-	// or when something interesting occurs
-	if(mSaveData.size() % REPLAY_SAVEPOINT_PERIOD == 0 ||
+	// or when something interesting occurs. With deterministic physics,
+	// the replay can be recomputed from the inputs alone.
+	if(!mDeterministicPhysics && (mSaveData.size() % REPLAY_SAVEPOINT_PERIOD == 0 ||
 		mEndScore[LEFT_PLAYER] != state.logicState.leftScore ||
-		mEndScore[RIGHT_PLAYER] != state.logicState.rightScore)
+		mEndScore[RIGHT_PLAYER] != state.logicState.rightScore))
 	{
 		ReplaySavePoint sp;
 		sp.state = state;
@@ -225,6 +228,11 @@ void ReplayRecorder::setGameRules( const std::string& rules )
 	boost::algorithm::trim_all(mGameRules);
 }
 
+void ReplayRecorder::setDeterministicPhysics( bool deterministic )
+{
+	mDeterministicPhysics = deterministic;
+}
+
 void ReplayRecorder::finalize(unsigned int left, unsigned int right)
 {
 	mEndScore[LEFT_PLAYER] = left;
@@ -82,6 +82,9 @@ class ReplayRecorder : public ObjectCounter<ReplayRecorder>
 		void setPlayerColors(Color left, Color right);
 		void setGameSpeed(int fps);
 		void setGameRules( const std::string& rules );
+		/// if the game uses deterministic physics, the replay only needs the inputs,
+		/// so no save points are recorded.
+		void setDeterministicPhysics( bool deterministic );
 
 	private:
 		std::vector<uint8_t> mSaveData;
@@ -93,4 +96,5 @@ class ReplayRecorder : public ObjectCounter<ReplayRecorder>
 		unsigned int mEndScore[MAX_PLAYERS];
 		unsigned int mGameSpeed;
 		std::string mGameRules;
+		bool mDeterministicPhysics;
 };
@@ -54,6 +54,7 @@ DedicatedServer::DedicatedServer(ServerInfo info,
 , mAcceptNewPlayers(true)
 , mPlayerHosted( local_server )
 , mServerInfo(std::move(info))
+, mScheduler( local_server ? 1 : 0 )
 {
 	if (!mServer->Start(max_clients, 1, mServerInfo.port))
 	{
@@ -99,11 +100,8 @@ void DedicatedServer::queuePackets()
 			case ID_ENTER_SERVER:
 			case ID_LOBBY:
 			case ID_BLOBBY_SERVER_PRESENT:
-			{
-				std::lock_guard<std::mutex> lock( mPacketQueueMutex );
-				mPacketQueue.push_back( packet );
+				mPacketQueue.push( packet );
 				break;
-			}
 			// game progress packets
 			case ID_INPUT_UPDATE:
 			case ID_PAUSE:
@@ -134,14 +132,9 @@ void DedicatedServer::queuePackets()
 
 void DedicatedServer::processPackets()
 {
-	while (!mPacketQueue.empty())
+	packet_ptr packet;
+	while ((packet = mPacketQueue.pop()))
 	{
-		packet_ptr packet;
-		{
-			std::lock_guard<std::mutex> lock(mPacketQueueMutex);
-			packet = mPacketQueue.front();
-			mPacketQueue.pop_front();
-		}
 		SWLS_PacketCount++;
 
 		switch(packet->data[0])
@@ -181,7 +174,7 @@ void DedicatedServer::processPackets()
 						std::lock_guard<std::mutex> lock( mPlayerMapMutex );
 						mPlayerMap.erase( player );
 					}
-					mMatchMaker.removePlayer( player->first );
+					mMatchMaker.removePlayer( packet->playerId );
 				}
 				else
 				{
@@ -225,7 +218,8 @@ void DedicatedServer::processPackets()
 				/// \todo assert that the player send an ID_ENTER_SERVER before
 
 				// which player is wanted as opponent
-				mMatchMaker.receiveLobbyPacket( packet->playerId, packet->getStream() );
+				RakNet::BitStream stream = packet->getStream();
+				mMatchMaker.receiveLobbyPacket( packet->playerId, stream );
 				break;
 			}
 			case ID_BLOBBY_SERVER_PRESENT:
@@ -254,7 +248,7 @@ void DedicatedServer::updateGames()
 	for(auto & it : mPlayerMap)
 	{
 		auto game = it.second->getGame();
-		if(game && !game->isGameValid())
+		if(game && !game->isGameValid() && !mScheduler.isScheduled(*game))
 		{
 			game->processPackets();
 		}
@@ -308,6 +302,17 @@ void DedicatedServer::allowNewPlayers( bool allow )
 	mAcceptNewPlayers = allow;
 }
 
+void DedicatedServer::setNetworkImpairment( const NetworkImpairmentSettings& settings )
+{
+	if( settings.IsActive() )
+	{
+		syslog(LOG_NOTICE, "simulating a bad network: loss %g, latency %u ms, jitter %u ms, duplicate %g, reorder %g, seed %u",
+				settings.loss, settings.latency, settings.jitter, settings.duplicate, settings.reorder, settings.seed);
+	}
+
+	mServer->SetNetworkImpairment( settings );
+}
+
 // debug
 void DedicatedServer::printAllPlayers(std::ostream& stream) const
 {
@@ -328,7 +333,53 @@ void DedicatedServer::printAllGames(std::ostream& stream) const
 {
 	for(const auto & it : mGameList)
 	{
-		stream << it->getPlayerID(LEFT_PLAYER).toString() << " vs " << it->getPlayerID(RIGHT_PLAYER).toString() << "\n";
+		auto stats = mScheduler.getStatistics(*it);
+		stream << it->getPlayerID(LEFT_PLAYER).toString() << " vs " << it->getPlayerID(RIGHT_PLAYER).toString();
+		stream << " (" << stats.ticks << " ticks, " << stats.overruns << " overruns";
+		auto queue = it->getPacketQueueStatistics();
+		stream << ", " << queue.depth << " queued packets, max " << queue.maxDepth << ")\n";
+	}
+}
+
+void DedicatedServer::printSchedulerStatus(std::ostream& stream) const
+{
+	mScheduler.printStatus(stream);
+}
+
+void DedicatedServer::printPacketQueueStatus(std::ostream& stream) const
+{
+	auto print = [&stream](const char* name, const PacketQueue::Statistics& stats)
+	{
+		stream << " " << name << " packet queue: " << stats.depth << " queued, max " << stats.maxDepth;
+		stream << ", " << stats.pushed << " pushed, " << stats.failedPushes << " overflowed\n";
+	};
+
+	print("server", mPacketQueue.getStatistics());
+
+	PacketQueue::Statistics games;
+	for(const auto& game : mGameList)
+		games.merge( game->getPacketQueueStatistics() );
+	print("game", games);
+}
+
+void DedicatedServer::printSocketStatus(std::ostream& stream) const
+{
+	auto stats = mServer->GetSocketStatistics();
+	auto print = [&stream](const char* direction, unsigned long calls, unsigned long datagrams)
+	{
+		stream << " socket " << direction << ": " << datagrams << " datagrams in " << calls << " system calls";
+		if(calls != 0)
+			stream << " (" << double(datagrams) / calls << " per call)";
+		stream << "\n";
+	};
+
+	print("receive", stats.receiveCalls, stats.datagramsReceived);
+	print("send", stats.sendCalls, stats.datagramsSent);
+
+	if(stats.datagramsDelayed || stats.datagramsDropped || stats.datagramsDuplicated || stats.datagramsReordered)
+	{
+		stream << " network impairment: " << stats.datagramsDropped << " dropped, " << stats.datagramsDelayed << " delayed, ";
+		stream << stats.datagramsDuplicated << " duplicated, " << stats.datagramsReordered << " reordered\n";
 	}
 }
 
@@ -388,15 +439,22 @@ void DedicatedServer::createGame(std::shared_ptr<NetworkPlayer> left,
 								PlayerSide switchSide, std::string rules,
 								int scoreToWin, float gamespeed)
 {
-	auto newgame = std::make_shared<NetworkGame>(*mServer, left, right,
+	// the game asks for the rules checksums right away, and the network thread routes the answers to the
+	// games of the players. protect with mutex, so no answer arrives before the players know their game
+	std::shared_ptr<NetworkGame> newgame;
+	{
+		std::lock_guard<std::mutex> lock( mPlayerMapMutex );
+		newgame = std::make_shared<NetworkGame>(*mServer, left, right,
 								switchSide, rules, scoreToWin, gamespeed);
-	left->setGame( newgame );
-	right->setGame( newgame );
+		left->setGame( newgame );
+		right->setGame( newgame );
+	}
 
 	SWLS_Games++;
 
 	/// \todo add some logging?
 	syslog(LOG_DEBUG, R"(Created game "%s" vs. "%s", rules:%s)", left->getName().c_str(), right->getName().c_str(), rules.c_str());
 	mGameList.push_back(newgame);
+	mScheduler.addGame(newgame);
 }
 
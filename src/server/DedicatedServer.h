@@ -25,14 +25,16 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <map>
 #include <list>
 #include <mutex>
-#include <deque>
 #include <iosfwd>
 
 #include "NetworkPlayer.h"
 #include "NetworkMessage.h"
 #include "server/MatchMaker.h"
+#include "server/GameScheduler.h"
+#include "server/PacketQueue.h"
 
 class RakServer;
+struct NetworkImpairmentSettings;
 
 // function for logging to replacing syslog
 enum {
@@ -72,10 +74,15 @@ class DedicatedServer
 		// debug functions
 		void printAllPlayers(std::ostream& stream) const;
 		void printAllGames(std::ostream& stream) const;
+		void printSchedulerStatus(std::ostream& stream) const;
+		void printPacketQueueStatus(std::ostream& stream) const;
+		void printSocketStatus(std::ostream& stream) const;
 
 
 		// server settings
 		void allowNewPlayers( bool allow );
+		// simulate a bad network for testing, see RakPeer::SetNetworkImpairment
+		void setNetworkImpairment( const NetworkImpairmentSettings& settings );
 
 	private:
 		// packet handling functions / utility functions
@@ -102,12 +109,13 @@ class DedicatedServer
 
 		// containers for all games and mapping players to their games
 		std::list< std::shared_ptr<NetworkGame> > mGameList;
+		// runs the games in mGameList
+		GameScheduler mScheduler;
 		std::map< PlayerID, std::shared_ptr<NetworkPlayer>> mPlayerMap;
 		std::mutex mPlayerMapMutex;
 
-		// packet queue
-		std::deque<packet_ptr> mPacketQueue;
-		std::mutex mPacketQueueMutex;
+		// packets from the raknet thread that are handled by the server itself
+		PacketQueue mPacketQueue;
 
 		MatchMaker mMatchMaker;
 };
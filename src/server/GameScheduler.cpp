@@ -0,0 +1,231 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+/* header include */
+#include "GameScheduler.h"
+
+/* includes */
+#include <algorithm>
+#include <ostream>
+
+#include "NetworkGame.h"
+#include "DedicatedServer.h"
+
+#ifndef WIN32
+#ifndef __ANDROID__
+#include <sys/syslog.h>
+#endif
+#endif
+
+extern int SWLS_GameSteps;
+
+void syslog(int pri, const char* format, ...);
+
+/* implementation */
+
+namespace
+{
+	// heap ordering: the game with the earliest deadline is at the front
+	struct LaterDeadline
+	{
+		template<class T>
+		bool operator()(const T& a, const T& b) const
+		{
+			return a->deadline > b->deadline;
+		}
+	};
+
+	long long toMilliseconds(GameScheduler::clock_type::duration d)
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+	}
+}
+
+const int GameScheduler::MAX_LAG_TICKS;
+
+void GameScheduler::Statistics::merge(const Statistics& other)
+{
+	ticks += other.ticks;
+	overruns += other.overruns;
+	resyncs += other.resyncs;
+	maxLateness = std::max(maxLateness, other.maxLateness);
+}
+
+GameScheduler::GameScheduler(unsigned int threads) : mPool(threads)
+{
+	mDispatcher = std::thread( [this](){ dispatch(); } );
+}
+
+GameScheduler::~GameScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mWakeUp.notify_all();
+	mDispatcher.join();
+
+	// ticks that are already running may still access the queue
+	mPool.wait();
+}
+
+void GameScheduler::addGame(const std::shared_ptr<NetworkGame>& game)
+{
+	auto entry = std::make_shared<ScheduledGame>();
+	entry->game = game;
+	entry->period = std::chrono::duration_cast<clock_type::duration>(
+						std::chrono::duration<double>(1.0 / std::max(game->getGameSpeed(), 1.f)));
+	entry->deadline = clock_type::now();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mGames[game.get()] = entry;
+	enqueue(entry);
+}
+
+bool GameScheduler::isScheduled(const NetworkGame& game) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mGames.count(&game) != 0;
+}
+
+unsigned int GameScheduler::getGameCount() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mGames.size();
+}
+
+GameScheduler::Statistics GameScheduler::getStatistics(const NetworkGame& game) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto found = mGames.find(&game);
+	if( found == mGames.end() )
+		return Statistics();
+	return found->second->stats;
+}
+
+GameScheduler::Statistics GameScheduler::getTotalStatistics() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	Statistics total = mFinished;
+	for(const auto& game : mGames)
+		total.merge(game.second->stats);
+	return total;
+}
+
+void GameScheduler::printStatus(std::ostream& stream) const
+{
+	Statistics total = getTotalStatistics();
+	stream << " scheduled games: " << getGameCount() << " on " << mPool.size() << " threads\n";
+	stream << " game ticks: " << total.ticks << ", overruns: " << total.overruns
+		   << ", resyncs: " << total.resyncs << ", max lateness: " << toMilliseconds(total.maxLateness) << " ms\n";
+}
+
+void GameScheduler::dispatch()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	while( !mStop )
+	{
+		if( mQueue.empty() )
+		{
+			mWakeUp.wait(lock);
+			continue;
+		}
+
+		auto now = clock_type::now();
+		if( now < mQueue.front()->deadline )
+		{
+			mWakeUp.wait_until(lock, mQueue.front()->deadline);
+			continue;
+		}
+
+		// hand every game that is due to the workers
+		while( !mQueue.empty() && mQueue.front()->deadline <= now )
+		{
+			std::pop_heap(mQueue.begin(), mQueue.end(), LaterDeadline());
+			entry_ptr entry = std::move(mQueue.back());
+			mQueue.pop_back();
+			mPool.post( [this, entry](){ tick(entry); } );
+		}
+	}
+}
+
+void GameScheduler::tick(const entry_ptr& entry)
+{
+	NetworkGame& game = *entry->game;
+
+	auto start = clock_type::now();
+	game.processPackets();
+	game.step();
+	auto finish = clock_type::now();
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	SWLS_GameSteps++;
+
+	Statistics& stats = entry->stats;
+	stats.ticks++;
+	stats.maxLateness = std::max(stats.maxLateness, start - entry->deadline);
+
+	entry->deadline += entry->period;
+	if( finish > entry->deadline )
+	{
+		stats.overruns++;
+
+		// if we are hopelessly behind, don't try to catch up all the lost ticks
+		if( finish - entry->deadline > MAX_LAG_TICKS * entry->period )
+		{
+			entry->deadline = finish;
+			stats.resyncs++;
+		}
+	}
+
+	if( game.isGameValid() )
+	{
+		enqueue(entry);
+		return;
+	}
+
+	// the game has ended, remove it and report if it could not keep its pace
+	mFinished.merge(stats);
+	mGames.erase(&game);
+
+	// log without holding the lock, so the dispatcher and the other workers do not wait for it
+	Statistics finished = stats;
+	PlayerID left = game.getPlayerID(LEFT_PLAYER);
+	PlayerID right = game.getPlayerID(RIGHT_PLAYER);
+	lock.unlock();
+
+	if( finished.overruns > 0 )
+	{
+		syslog(LOG_NOTICE, "Game %s vs %s missed %llu of %llu tick deadlines, max lateness %lld ms",
+				left.toString().c_str(), right.toString().c_str(),
+				finished.overruns, finished.ticks, toMilliseconds(finished.maxLateness));
+	}
+}
+
+void GameScheduler::enqueue(const entry_ptr& entry)
+{
+	mQueue.push_back(entry);
+	std::push_heap(mQueue.begin(), mQueue.end(), LaterDeadline());
+
+	// wake up the dispatcher if this is the new earliest deadline
+	if( mQueue.front() == entry )
+		mWakeUp.notify_one();
+}
@@ -0,0 +1,123 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+#pragma once
+
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <iosfwd>
+
+#include "ThreadPool.h"
+#include "BlobbyDebug.h"
+
+class NetworkGame;
+
+/*! \class GameScheduler
+	\brief runs the network games of a server on a fixed pool of worker threads
+	\details Every game has a tick deadline derived from its game speed. A dispatcher thread
+			waits for the earliest deadline and then hands all games that are due to the
+			worker pool, each of which processes the pending packets of the game and steps it.
+			Deadlines advance by exactly one period per tick, so a game that was delayed catches
+			up on its own, unless it falls more than MAX_LAG_TICKS behind, in which case its
+			schedule is reset.
+			A tick that finishes after the next deadline of its game is counted as an overrun.
+			Games are removed from the scheduler as soon as they become invalid.
+*/
+class GameScheduler : public ObjectCounter<GameScheduler>
+{
+	public:
+		typedef std::chrono::steady_clock clock_type;
+
+		/// timing statistics of one game, or accumulated over several games
+		struct Statistics
+		{
+			unsigned long long ticks = 0;
+			/// number of ticks that finished after the next tick was due
+			unsigned long long overruns = 0;
+			/// number of times the game fell so far behind that its schedule was reset
+			unsigned long long resyncs = 0;
+			/// longest delay between a deadline and the start of the corresponding tick
+			clock_type::duration maxLateness = clock_type::duration::zero();
+
+			void merge(const Statistics& other);
+		};
+
+		/// maximum number of ticks a game may lag behind before it is rescheduled
+		static const int MAX_LAG_TICKS = 10;
+
+		/// creates the scheduler with \p threads worker threads, zero means one per hardware thread.
+		explicit GameScheduler(unsigned int threads = 0);
+		~GameScheduler();
+
+		/// starts ticking \p game with its game speed.
+		void addGame(const std::shared_ptr<NetworkGame>& game);
+
+		/// whether \p game is still ticked by the scheduler
+		bool isScheduled(const NetworkGame& game) const;
+
+		/// number of scheduled games
+		unsigned int getGameCount() const;
+
+		/// timing statistics of a scheduled game. Returns empty statistics for unknown games.
+		Statistics getStatistics(const NetworkGame& game) const;
+
+		/// timing statistics of all games, including the ones that already finished
+		Statistics getTotalStatistics() const;
+
+		/// prints a summary of the scheduler state
+		void printStatus(std::ostream& stream) const;
+
+	private:
+		struct ScheduledGame
+		{
+			std::shared_ptr<NetworkGame> game;
+			clock_type::duration period;
+			clock_type::time_point deadline;
+			Statistics stats;
+		};
+		typedef std::shared_ptr<ScheduledGame> entry_ptr;
+
+		// dispatcher thread main function
+		void dispatch();
+		// runs one tick of a game, called from the worker threads
+		void tick(const entry_ptr& entry);
+		// adds entry to the deadline queue. mMutex has to be held.
+		void enqueue(const entry_ptr& entry);
+
+		// min-heap of all games waiting for their next tick, ordered by deadline
+		std::vector<entry_ptr> mQueue;
+		// all scheduled games, including the ones currently running
+		std::map<const NetworkGame*, entry_ptr> mGames;
+		// statistics of games that have been removed
+		Statistics mFinished;
+
+		mutable std::mutex mMutex;
+		std::condition_variable mWakeUp;
+		bool mStop = false;
+
+		ThreadPool mPool;
+		std::thread mDispatcher;
+};
@@ -26,6 +26,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <iostream>
 #include <stdexcept>
 #include <cassert>
+#include <atomic>
 
 #include <boost/make_shared.hpp>
 
@@ -37,6 +38,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "NetworkMessage.h"
 #include "replays/ReplayRecorder.h"
 #include "FileRead.h"
+#include "RulesCache.h"
 #include "FileSystem.h"
 #include "GenericIO.h"
 #include "MatchEvents.h"
@@ -44,10 +46,19 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "NetworkPlayer.h"
 #include "InputSource.h"
 
-extern int SWLS_GameSteps;
+#ifndef WIN32
+#ifndef __ANDROID__
+#include <sys/syslog.h>
+#endif
+#endif
+
+void syslog(int pri, const char* format, ...);
 
 /* implementation */
 
+extern std::atomic<unsigned long long> SWLS_GameUpdates;
+extern std::atomic<unsigned long long> SWLS_GameUpdateBytes;
+
 NetworkGame::NetworkGame(RakServer& server, const std::shared_ptr<NetworkPlayer>& leftPlayer,
 			const std::shared_ptr<NetworkPlayer>& rightPlayer, PlayerSide switchedSide,
 			std::string rules, int scoreToWin, float speed) :
@@ -56,7 +67,7 @@ NetworkGame::NetworkGame(RakServer& server, const std::shared_ptr<NetworkPlayer>
 	mLeftInput (new InputSource()),
 	mRightInput(new InputSource()),
 	mRecorder(new ReplayRecorder()),
-	mSpeedController(speed),
+	mGameSpeed(speed),
 	mGameValid(true)
 {
 	// check that both players don't have an active game
@@ -79,19 +90,20 @@ NetworkGame::NetworkGame(RakServer& server, const std::shared_ptr<NetworkPlayer>
 
 	mRecorder->setPlayerNames(leftPlayer->getName(), rightPlayer->getName());
 	mRecorder->setPlayerColors(leftPlayer->getColor(), rightPlayer->getColor());
-	mRecorder->setGameSpeed(mSpeedController.getGameSpeed());
+	mRecorder->setGameSpeed(mGameSpeed);
 
-	// read rulesfile into a string
-	int checksum = 0;
-	mRulesLength = 0;
+	// get the rules file. Usually, it is already in the rules cache, so we don't have to touch the disk here.
 	mRulesSent[0] = false;
 	mRulesSent[1] = false;
 
-	rules = FileRead::makeLuaFilename( rules );
-	FileRead file(std::string("rules/") + rules);
-	checksum = file.calcChecksum(0);
-	mRulesLength = file.length();
-	mRulesString = file.readRawBytes(mRulesLength);
+	std::string rulesFile = "rules/" + FileRead::makeLuaFilename( rules );
+	auto script = RulesCache::find( rulesFile );
+	if( !script )
+		script = RulesCache::readScript( rulesFile );
+
+	int checksum = script->checksum;
+	mRulesLength = script->length;
+	mRulesString = script->source;
 
 	// writing rules checksum
 	RakNet::BitStream stream;
@@ -100,31 +112,13 @@ NetworkGame::NetworkGame(RakServer& server, const std::shared_ptr<NetworkPlayer>
 	stream.Write(mMatch->getScoreToWin());
 	/// \todo write file author and title, too; maybe add a version number in scripts, too.
 	broadcastBitstream(stream);
-
-	// game loop
-	mGameThread = std::thread(
-		[this]()
-		{
-			while(mGameValid)
-			{
-				processPackets();
-				step();
-				SWLS_GameSteps++;
-				mSpeedController.update();
-			}
-		}					);
 }
 
-NetworkGame::~NetworkGame()
-{
-	mGameValid = false;
-	mGameThread.join();
-}
+NetworkGame::~NetworkGame() = default;
 
 void NetworkGame::injectPacket(const packet_ptr& packet)
 {
-	std::lock_guard<std::mutex> lock(mPacketQueueMutex);
-	mPacketQueue.push_back(packet);
+	mPacketQueue.push(packet);
 }
 
 void NetworkGame::broadcastBitstream(const RakNet::BitStream& stream, const RakNet::BitStream& switchedstream)
@@ -161,15 +155,9 @@ void NetworkGame::broadcastBitstream(const RakNet::BitStream& stream)
 
 void NetworkGame::processPackets()
 {
-	while (!mPacketQueue.empty())
+	packet_ptr packet;
+	while ((packet = mPacketQueue.pop()))
 	{
-		packet_ptr packet;
-		{
-			std::lock_guard<std::mutex> lock(mPacketQueueMutex);
-			packet = mPacketQueue.front();
-			mPacketQueue.pop_front();
-		}
-
 		processPacket( packet );
 	}
 }
@@ -201,12 +189,18 @@ void NetworkGame::processPacket( const packet_ptr& packet )
 			stream.Read(time);
 			PlayerInputAbs newInput(stream);
 
+			// clients that support delta encoded game updates append the newest frame they received
+			unsigned ackedFrame = 0;
+			bool acknowledges = stream.Read(ackedFrame);
+
 			if (packet->playerId == mLeftPlayer)
 			{
 				if (mSwitchedSide == LEFT_PLAYER)
 					newInput.swapSides();
 				mLeftInput->setInput(newInput);
 				mLeftLastTime = time;
+				mDeltaUpdates[LEFT_PLAYER] = acknowledges;
+				mAckedFrame[LEFT_PLAYER] = ackedFrame;
 			}
 			if (packet->playerId == mRightPlayer)
 			{
@@ -214,6 +208,8 @@ void NetworkGame::processPacket( const packet_ptr& packet )
 					newInput.swapSides();
 				mRightInput->setInput(newInput);
 				mRightLastTime = time;
+				mDeltaUpdates[RIGHT_PLAYER] = acknowledges;
+				mAckedFrame[RIGHT_PLAYER] = ackedFrame;
 			}
 			break;
 		}
@@ -299,7 +295,7 @@ void NetworkGame::processPacket( const packet_ptr& packet )
 				// writing data into leftStream
 				RakNet::BitStream leftStream;
 				leftStream.Write((unsigned char)ID_GAME_READY);
-				leftStream.Write((int)mSpeedController.getGameSpeed());
+				leftStream.Write((int)mGameSpeed);
 				strncpy(name, mMatch->getPlayer(RIGHT_PLAYER).getName().c_str(), sizeof(name));
 				leftStream.Write(name, sizeof(name));
 				leftStream.Write(mMatch->getPlayer(RIGHT_PLAYER).getStaticColor().toInt());
@@ -307,7 +303,7 @@ void NetworkGame::processPacket( const packet_ptr& packet )
 				// writing data into rightStream
 				RakNet::BitStream rightStream;
 				rightStream.Write((unsigned char)ID_GAME_READY);
-				rightStream.Write((int)mSpeedController.getGameSpeed());
+				rightStream.Write((int)mGameSpeed);
 				strncpy(name, mMatch->getPlayer(LEFT_PLAYER).getName().c_str(), sizeof(name));
 				rightStream.Write(name, sizeof(name));
 				rightStream.Write(mMatch->getPlayer(LEFT_PLAYER).getStaticColor().toInt());
@@ -340,18 +336,36 @@ void NetworkGame::step()
 	// don't record the pauses
 	if(!mMatch->isPaused())
 	{
-		mRecorder->record(mMatch->getState());
+		mMatch->getState(mMatchState);
+		mRecorder->record(mMatchState);
+
+		try
+		{
+			mMatch->step();
+		}
+		catch( const ScriptException& except )
+		{
+			// the rules script exceeded its budget, and the server is configured to abort such games
+			syslog(LOG_ERR, "Aborted game %s vs %s: %s", getPlayerID(LEFT_PLAYER).toString().c_str(),
+					getPlayerID(RIGHT_PLAYER).toString().c_str(), except.luaerror.c_str());
 
-		mMatch->step();
+			RakNet::BitStream stream;
+			stream.Write((unsigned char)ID_OPPONENT_DISCONNECTED);
+			broadcastBitstream(stream);
+			mMatch->pause();
+			mGameValid = false;
+			return;
+		}
 
 		broadcastGameEvents();
+		mMatch->getState(mMatchState);
 
 		PlayerSide winning = mMatch->winningPlayer();
 		if (winning != NO_PLAYER)
 		{
 			// if someone has won, the game is paused
 			mMatch->pause();
-			mRecorder->record(mMatch->getState());
+			mRecorder->record(mMatchState);
 			mRecorder->finalize( mMatch->getScore(LEFT_PLAYER), mMatch->getScore(RIGHT_PLAYER) );
 
 			RakNet::BitStream stream;
@@ -365,41 +379,69 @@ void NetworkGame::step()
 			broadcastBitstream(stream, switchStream);
 		}
 
-		broadcastPhysicState(mMatch->getState());
+		broadcastPhysicState(mMatchState);
 	}
 }
 
-void NetworkGame::broadcastPhysicState(const DuelMatchState& state) const
+void NetworkGame::broadcastPhysicState(const DuelMatchState& state)
 {
-	DuelMatchState ms = state;	// modifiable copy
-
-	RakNet::BitStream stream;
-	stream.Write((unsigned char)ID_GAME_UPDATE);
-	stream.Write( mLeftLastTime );
-
-	/// \todo this required dynamic memory allocation! not good!
-	std::shared_ptr<GenericOut> out = createGenericWriter( &stream );
-
-	if (mSwitchedSide == LEFT_PLAYER)
-		ms.swapSides();
-
-	out->generic<DuelMatchState> (ms);
-	mServer.Send(&stream, HIGH_PRIORITY, UNRELIABLE_SEQUENCED, 0, mLeftPlayer, false);
-
-	// reset state and stream
-	stream.Reset();
-	stream.Write((unsigned char)ID_GAME_UPDATE);
-	stream.Write( mRightLastTime );
+	++mUpdateFrame;
+	mStateHistory.store(mUpdateFrame, state);
+
+	// The state is encoded in server view and swapped by the client, so players that acknowledged the
+	// same frame get the same encoded data. Only the header differs between them.
+	unsigned baseline[MAX_PLAYERS];
+	RakNet::BitStream encoded[MAX_PLAYERS];
+	const RakNet::BitStream* data[MAX_PLAYERS];
+	for(int side = LEFT_PLAYER; side < MAX_PLAYERS; ++side)
+	{
+		baseline[side] = getBaselineFrame(PlayerSide(side));
+		data[side] = &encoded[side];
+		if(side == RIGHT_PLAYER && mDeltaUpdates[LEFT_PLAYER] && baseline[LEFT_PLAYER] == baseline[RIGHT_PLAYER])
+			data[side] = &encoded[LEFT_PLAYER];
+		else if(mDeltaUpdates[side])
+			DuelMatchStateCodec::encode(encoded[side], state, mStateHistory.find(baseline[side]), mUpdateFrame - baseline[side]);
+	}
 
-	out = createGenericWriter( &stream );
+	for(int side = LEFT_PLAYER; side < MAX_PLAYERS; ++side)
+	{
+		RakNet::BitStream stream;
+		if(mDeltaUpdates[side])
+		{
+			stream.Write((unsigned char)ID_GAME_UPDATE_DELTA);
+			stream.Write( side == LEFT_PLAYER ? mLeftLastTime : mRightLastTime );
+			stream.Write( mUpdateFrame );
+			stream.Write( (unsigned char)(baseline[side] != 0 ? mUpdateFrame - baseline[side] : 0) );
+			stream.Write( mSwitchedSide == side );
+			stream.WriteBits( data[side]->GetData(), data[side]->GetNumberOfBitsUsed(), false );
+		}
+		else
+		{
+			// clients that do not acknowledge updates get the complete state in their view
+			DuelMatchState ms = state;
+			if (mSwitchedSide == side)
+				ms.swapSides();
 
-	// either switch back, or perform switching for right side
-	if (mSwitchedSide == LEFT_PLAYER || mSwitchedSide == RIGHT_PLAYER)
-		ms.swapSides();
+			stream.Write((unsigned char)ID_GAME_UPDATE);
+			stream.Write( side == LEFT_PLAYER ? mLeftLastTime : mRightLastTime );
+			std::shared_ptr<GenericOut> out = createGenericWriter( &stream );
+			out->generic<DuelMatchState> (ms);
+		}
 
-	out->generic<DuelMatchState> (ms);
+		mServer.Send(&stream, HIGH_PRIORITY, UNRELIABLE_SEQUENCED, 0, getPlayerID(PlayerSide(side)), false);
+		SWLS_GameUpdates++;
+		SWLS_GameUpdateBytes += stream.GetNumberOfBytesUsed();
+	}
+}
 
-	mServer.Send(&stream, HIGH_PRIORITY, UNRELIABLE_SEQUENCED, 0, mRightPlayer, false);
+unsigned NetworkGame::getBaselineFrame(PlayerSide side) const
+{
+	unsigned acked = mAckedFrame[side];
+	// send a keyframe regularly, and when the acknowledged frame is no longer in the history
+	if( acked == 0 || mUpdateFrame % DuelMatchStateCodec::KEYFRAME_INTERVAL == 0 ||
+			mUpdateFrame - acked >= DuelMatchStateCodec::HISTORY_SIZE || !mStateHistory.find(acked) )
+		return 0;
+	return acked;
 }
 
 // helper function that writes a single event to bit stream in a space efficient way.
@@ -418,7 +460,7 @@ void NetworkGame::broadcastGameEvents() const
 {
 	RakNet::BitStream stream;
 
-	auto events = mMatch->getEvents();
+	const auto& events = mMatch->getEvents();
 	// send the events
 	if( events.empty() )
 		return;
@@ -451,3 +493,13 @@ PlayerID NetworkGame::getPlayerID( PlayerSide side ) const
 	assert(0);
 }
 
+
+float NetworkGame::getGameSpeed() const
+{
+	return mGameSpeed;
+}
+
+PacketQueue::Statistics NetworkGame::getPacketQueueStatistics() const
+{
+	return mPacketQueue.getStatistics();
+}
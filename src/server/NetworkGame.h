@@ -20,25 +20,22 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #pragma once
 
-#include <list>
-#include <mutex>
-#include <thread>
+#include <atomic>
 
 #include <boost/shared_array.hpp>
 
 #include "Global.h"
 #include "raknet/NetworkTypes.h"
 #include "raknet/BitStream.h"
-#include "SpeedController.h"
 #include "DuelMatch.h"
+#include "DuelMatchStateCodec.h"
+#include "server/PacketQueue.h"
 #include "BlobbyDebug.h"
 
 class RakServer;
 class ReplayRecorder;
 class NetworkPlayer;
 
-typedef std::list<packet_ptr> PacketQueue;
-
 class NetworkGame : public ObjectCounter<NetworkGame>
 {
 	public:
@@ -61,9 +58,9 @@ class NetworkGame : public ObjectCounter<NetworkGame>
 		/// It returns whether both clients are still connected.
 		bool isGameValid() const;
 
-		// This function processes the queued network packets,
-		// makes a physic step, checks the rules and broadcasts
+		// This function makes a physic step, checks the rules and broadcasts
 		// the current state and outstanding messages to the clients.
+		// Games do not run on their own, they are ticked by the GameScheduler.
 		void step();
 
 		/// This function processes all queued network packets.
@@ -72,11 +69,17 @@ class NetworkGame : public ObjectCounter<NetworkGame>
 		// game info
 		/// gets network IDs of players
 		PlayerID getPlayerID( PlayerSide side ) const;
+		/// gets the number of steps per second
+		float getGameSpeed() const;
+		/// gets the counters of the queue between the network thread and this game
+		PacketQueue::Statistics getPacketQueueStatistics() const;
 
 	private:
 		void broadcastBitstream(const RakNet::BitStream& stream, const RakNet::BitStream& switchedstream);
 		void broadcastBitstream(const RakNet::BitStream& stream);
-		void broadcastPhysicState(const DuelMatchState& state) const;
+		void broadcastPhysicState(const DuelMatchState& state);
+		/// gets the frame the game update for \p side is encoded against, or 0 for a keyframe.
+		unsigned getBaselineFrame(PlayerSide side) const;
 		void broadcastGameEvents() const;
 		void writeEventToStream(RakNet::BitStream& stream, MatchEvent e, bool switchSides ) const;
 		bool isGameStarted() { return mRulesSent[LEFT_PLAYER] && mRulesSent[RIGHT_PLAYER]; }
@@ -90,19 +93,27 @@ class NetworkGame : public ObjectCounter<NetworkGame>
 		PlayerSide mSwitchedSide;
 
 		PacketQueue mPacketQueue;
-		std::mutex mPacketQueueMutex;
 
 		std::unique_ptr<DuelMatch> mMatch;
-		SpeedController mSpeedController;
+		float mGameSpeed;
 		std::shared_ptr<InputSource> mLeftInput;
 		std::shared_ptr<InputSource> mRightInput;
 		unsigned mLeftLastTime = -1;
 		unsigned mRightLastTime = -1;
-		std::thread mGameThread;
+		/// state of the match, refreshed in place for recording and broadcasting
+		DuelMatchState mMatchState;
+
+		// delta encoded game updates. Frame numbers start at 1, so 0 means no frame.
+		DuelMatchStateCodec mStateHistory;
+		unsigned mUpdateFrame = 0;
+		/// whether the client acknowledges game updates, i.e. can decode ID_GAME_UPDATE_DELTA
+		bool mDeltaUpdates[MAX_PLAYERS] = {false, false};
+		/// newest game update frame the client has acknowledged
+		unsigned mAckedFrame[MAX_PLAYERS] = {0, 0};
 
 		std::unique_ptr<ReplayRecorder> mRecorder;
 
-		bool mGameValid;
+		std::atomic<bool> mGameValid;
 
 		bool mRulesSent[MAX_PLAYERS];
 		int mRulesLength;
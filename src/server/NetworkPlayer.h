@@ -44,9 +44,9 @@ class NetworkPlayer : public ObjectCounter<NetworkPlayer>, public boost::noncopy
 		NetworkPlayer();
 
 		NetworkPlayer(PlayerID id, const std::string& name, Color color, PlayerSide side);
-		// i guess we should! not need to make a copy here
-		// but this is saver as this constructor can't mess up other code.
-		NetworkPlayer(PlayerID id, RakNet::BitStream stream);
+		// reads the player data from stream, which is usually the packet data
+		// itself, so nothing is copied. Advances the read position of stream.
+		NetworkPlayer(PlayerID id, RakNet::BitStream& stream);
 
 		bool valid() const;
 
@@ -0,0 +1,97 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+/* header include */
+#include "PacketQueue.h"
+
+/* includes */
+#include <algorithm>
+
+/* implementation */
+
+void PacketQueue::Statistics::merge(const Statistics& other)
+{
+	depth += other.depth;
+	maxDepth = std::max(maxDepth, other.maxDepth);
+	pushed += other.pushed;
+	failedPushes += other.failedPushes;
+}
+
+PacketQueue::PacketQueue(std::size_t capacity) :
+	mQueue(capacity),
+	mOverflowing(false),
+	mDepth(0),
+	mMaxDepth(0),
+	mPushed(0),
+	mFailedPushes(0)
+{
+}
+
+void PacketQueue::push(const packet_ptr& packet)
+{
+	// count first, so the depth never drops below zero when the consumer is faster
+	std::size_t depth = ++mDepth;
+	std::size_t maxDepth = mMaxDepth.load(std::memory_order_relaxed);
+	while(depth > maxDepth && !mMaxDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed))
+		;
+	++mPushed;
+
+	// once a packet went to the overflow list, all later ones have to follow it there.
+	if(!mOverflowing.load(std::memory_order_acquire) && mQueue.push(packet))
+		return;
+
+	++mFailedPushes;
+	std::lock_guard<std::mutex> lock(mOverflowMutex);
+	mOverflow.push_back(packet);
+	mOverflowing.store(true, std::memory_order_release);
+}
+
+packet_ptr PacketQueue::pop()
+{
+	packet_ptr packet;
+	if(!mQueue.pop(packet))
+	{
+		// all packets in the overflow list are newer than the ones in the lock-free queue, so
+		// they are only processed after that is empty.
+		if(!mOverflowing.load(std::memory_order_acquire))
+			return packet;
+
+		std::lock_guard<std::mutex> lock(mOverflowMutex);
+		if(mOverflow.empty())
+			return packet;
+		packet = mOverflow.front();
+		mOverflow.pop_front();
+		if(mOverflow.empty())
+			mOverflowing.store(false, std::memory_order_release);
+	}
+
+	--mDepth;
+	return packet;
+}
+
+PacketQueue::Statistics PacketQueue::getStatistics() const
+{
+	Statistics stats;
+	stats.depth = mDepth;
+	stats.maxDepth = mMaxDepth;
+	stats.pushed = mPushed;
+	stats.failedPushes = mFailedPushes;
+	return stats;
+}
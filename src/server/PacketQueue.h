@@ -0,0 +1,75 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+
+#include "raknet/NetworkTypes.h"
+#include "MPSCQueue.h"
+#include "BlobbyDebug.h"
+
+/*! \class PacketQueue
+	\brief hands received packets from the network thread to the thread that processes them
+	\details Packets are passed through a bounded lock-free MPSCQueue, so pushing neither locks nor
+			allocates. If that queue is full, packets go to an overflow list protected by a mutex
+			instead, and keep going there until the consumer has emptied it. This way no packet
+			is lost or reordered, even when a consumer stalls for a while.
+			push may be called from any thread, pop only from one thread at a time.
+*/
+class PacketQueue : public ObjectCounter<PacketQueue>
+{
+	public:
+		static const std::size_t DEFAULT_CAPACITY = 256;
+
+		struct Statistics
+		{
+			std::size_t depth = 0;					///< number of packets currently waiting
+			std::size_t maxDepth = 0;				///< largest number of waiting packets so far
+			unsigned long long pushed = 0;			///< total number of pushed packets
+			unsigned long long failedPushes = 0;	///< packets that had to go to the overflow list
+
+			void merge(const Statistics& other);
+		};
+
+		explicit PacketQueue(std::size_t capacity = DEFAULT_CAPACITY);
+
+		/// adds a packet to the queue. Can be called from any thread.
+		void push(const packet_ptr& packet);
+		/// removes the oldest packet from the queue, or returns an empty pointer if there is none.
+		packet_ptr pop();
+
+		Statistics getStatistics() const;
+
+	private:
+		MPSCQueue<packet_ptr> mQueue;
+
+		std::mutex mOverflowMutex;
+		std::deque<packet_ptr> mOverflow;
+		std::atomic<bool> mOverflowing;
+
+		std::atomic<std::size_t> mDepth;
+		std::atomic<std::size_t> mMaxDepth;
+		std::atomic<unsigned long long> mPushed;
+		std::atomic<unsigned long long> mFailedPushes;
+};
@@ -22,11 +22,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "DedicatedServer.h"
 
 /* includes */
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <cstdio>
 #include <ctime>
 #include <future>
+#include <atomic>
 
 #include <cerrno>
 #include <unistd.h>
@@ -40,8 +42,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "DedicatedServer.h"
 #include "SpeedController.h"
 #include "FileSystem.h"
+#include "RulesCache.h"
+#include "LuaStatePool.h"
+#include "ScriptWatchdog.h"
 #include "UserConfig.h"
 #include "Global.h"
+#include "raknet/SocketLayer.h"
 
 // platform specific
 #ifndef WIN32
@@ -72,6 +78,7 @@ void syslog(int pri, const char* format, ...);
 static bool g_run_in_foreground = false;
 static bool g_print_syslog_to_stderr = false;
 static std::string g_config_file = "server.xml";
+static std::string g_impairment; // network impairment given on the command line
 static std::atomic<bool> g_run_server(true); // set this variable to false to stop the server
 
 // ...
@@ -79,17 +86,21 @@ void printHelp();
 void process_arguments(int argc, char** argv);
 void fork_to_background();
 void setup_physfs(char* argv0);
+NetworkImpairmentSettings read_impairment(const UserConfig& config);
 
 // server workload statistics
 int SWLS_PacketCount = 0;
 int SWLS_Connections = 0;
 int SWLS_Games		 = 0;
 int SWLS_GameSteps	 = 0;
+std::atomic<unsigned long long> SWLS_GameUpdates{0};
+std::atomic<unsigned long long> SWLS_GameUpdateBytes{0};
 int SWLS_RunningTime = 0;
 
 const int UPDATE_FREQUENCY = 10;
 
-void main_loop(DedicatedServer& server);
+void main_loop(DedicatedServer& server, const LuaStatePool& luaStates, const ScriptWatchdog& watchdog);
+void print_update_statistics(std::ostream& stream);
 
 int main(int argc, char** argv)
 {
@@ -110,6 +121,12 @@ int main(int argc, char** argv)
 
 	setup_physfs(argv[0]);
 
+	// read and compile all rules now, so starting a game does not have to wait for the disk
+	RulesCache rulesCache;
+	syslog(LOG_NOTICE, "%u rules scripts cached", rulesCache.loadAll());
+	// and keep the lua states of finished games for the next ones
+	LuaStatePool luaStates;
+
 	int maxClients = 100;
 	std::string rulesFile = DEFAULT_RULES_FILE;
 	std::string gameSpeeds = "75";
@@ -131,6 +148,9 @@ int main(int argc, char** argv)
 		syslog(LOG_ERR, "server.xml not found. Falling back to default values.");
 	}
 
+	// rules scripts are sent by the clients, so we have to make sure they cannot stall the server
+	ScriptWatchdog watchdog( ScriptWatchdog::readBudget(config) );
+
 	ServerInfo myinfo(config);
 	std::vector<std::string> rule_vec;
 	boost::algorithm::split(rule_vec, rulesFile, boost::algorithm::is_space(), boost::algorithm::token_compress_on);
@@ -143,10 +163,15 @@ int main(int argc, char** argv)
 
 	DedicatedServer server(myinfo, rule_vec, speed_vec, maxClients);
 
+	// the command line overrides the single settings of the config file
+	NetworkImpairmentSettings impairment = read_impairment(config);
+	impairment.Parse( g_impairment.c_str() );
+	server.setNetworkImpairment( impairment );
+
 	syslog(LOG_NOTICE, "Blobby Volley 2 dedicated server version %i.%i started", BLOBBY_VERSION_MAJOR, BLOBBY_VERSION_MINOR);
 
 	// main loop
-	auto serverthread = std::async(std::launch::async, [&](){main_loop(server);});
+	auto serverthread = std::async(std::launch::async, [&](){main_loop(server, luaStates, watchdog);});
 
 	while(true)
 	{
@@ -171,6 +196,10 @@ int main(int argc, char** argv)
 		{
 			server.printAllGames(std::cout);
 		}
+		else if ( cmd_vec[0] == "reload" )
+		{
+			std::cout << rulesCache.loadAll() << " rules scripts changed\n";
+		}
 		else if ( cmd_vec[0] == "status" )
 		{
 			std::cout << "Blobby Server Status Report " << (SWLS_RunningTime / UPDATE_FREQUENCY / 60 / 60) << "h running \n";
@@ -178,6 +207,12 @@ int main(int argc, char** argv)
 			std::cout << " accepted connections: " << SWLS_Connections << "\n";
 			std::cout << " started games: " << SWLS_Games << "\n";
 			std::cout << " game steps: " << SWLS_GameSteps << "\n";
+			print_update_statistics(std::cout);
+			server.printSchedulerStatus(std::cout);
+			server.printPacketQueueStatus(std::cout);
+			server.printSocketStatus(std::cout);
+			luaStates.printStatus(std::cout);
+			watchdog.printStatus(std::cout);
 		}
 
 	}
@@ -191,7 +226,7 @@ int main(int argc, char** argv)
 // -----------------------------------------------------------------------------------------
 //    server main loop function
 // ------------------------------
-void main_loop( DedicatedServer& server)
+void main_loop( DedicatedServer& server, const LuaStatePool& luaStates, const ScriptWatchdog& watchdog)
 {
 	SpeedController scontroller( UPDATE_FREQUENCY );
 
@@ -210,6 +245,12 @@ void main_loop( DedicatedServer& server)
 			std::cout << " accepted connections: " << SWLS_Connections << "\n";
 			std::cout << " started games: " << SWLS_Games << "\n";
 			std::cout << " game steps: " << SWLS_GameSteps << "\n";
+			print_update_statistics(std::cout);
+			server.printSchedulerStatus(std::cout);
+			server.printPacketQueueStatus(std::cout);
+			server.printSocketStatus(std::cout);
+			luaStates.printStatus(std::cout);
+			watchdog.printStatus(std::cout);
 		}
 
 		server.processPackets();
@@ -227,11 +268,14 @@ void printHelp()
 	std::cout << "  -n, --no-daemon           Don't run as background process" << std::endl;
 	std::cout << "  -p, --print-msgs          Print messages to stderr" << std::endl;
 	std::cout << "  -c, --config-file <path>  Use custom config file instead of server.xml" << std::endl;
+	std::cout << "  -i, --impair <settings>   Simulate a bad network, e.g. loss=0.05,latency=40,jitter=10," << std::endl;
+	std::cout << "                            duplicate=0.01,reorder=0.01,seed=7" << std::endl;
 	std::cout << "  -h, --help                This message\n" << std::endl;
 	std::cout << "during the run of the programme, the following commands can be used:\n"
 			  << "players:   print player list\n"
 			  << "games:     print game list\n"
 			  << "status:    print server status\n"
+			  << "reload:    reload changed rules scripts\n"
 			  << "exit:      exits server (kills all running games!)" << std::endl;
 }
 
@@ -264,6 +308,19 @@ void process_arguments(int argc, char** argv)
 				g_config_file = std::string("server/") + argv[i];
 				continue;
 			}
+			if (strcmp(argv[i], "--impair") == 0 || strcmp(argv[i], "-i") == 0)
+			{
+				++i;
+				NetworkImpairmentSettings settings;
+				if (i >= argc || !settings.Parse(argv[i]))
+				{
+					std::cout << "\"impair\" option needs settings like loss=0.05,latency=40" << std::endl;
+					printHelp();
+					exit(1);
+				}
+				g_impairment = argv[i];
+				continue;
+			}
 			if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
 			{
 				printHelp();
@@ -276,6 +333,18 @@ void process_arguments(int argc, char** argv)
 	}
 }
 
+NetworkImpairmentSettings read_impairment(const UserConfig& config)
+{
+	NetworkImpairmentSettings settings;
+	settings.loss = config.getFloat("impairment_loss");
+	settings.latency = std::max(0, config.getInteger("impairment_latency"));
+	settings.jitter = std::max(0, config.getInteger("impairment_jitter"));
+	settings.duplicate = config.getFloat("impairment_duplicate");
+	settings.reorder = config.getFloat("impairment_reorder");
+	settings.seed = std::max(0, config.getInteger("impairment_seed"));
+	return settings;
+}
+
 void fork_to_background()
 {
 	#ifndef WIN32
@@ -347,3 +416,13 @@ void syslog(int pri, const char* format, ...)
 	fprintf(target, "\n");
 }
 #endif
+
+void print_update_statistics(std::ostream& stream)
+{
+	unsigned long long updates = SWLS_GameUpdates;
+	unsigned long long bytes = SWLS_GameUpdateBytes;
+	stream << " game updates: " << updates << " (" << bytes << " bytes";
+	if(updates != 0)
+		stream << ", " << double(bytes) / updates << " bytes per update";
+	stream << ")\n";
+}
@@ -0,0 +1,392 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+/* includes */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "DuelMatch.h"
+#include "FileSystem.h"
+#include "FileWrite.h"
+#include "Global.h"
+#include "HeadlessTool.h"
+#include "LuaStatePool.h"
+#include "MatchEvents.h"
+#include "ScriptedInputSource.h"
+#include "ScriptWatchdog.h"
+#include "SearchInputSource.h"
+#include "replays/ReplayRecorder.h"
+
+/* implementation */
+
+// the simulation runs as fast as possible, but all times are given in game time at normal speed
+const int GAME_SPEED = 75;
+// bot name that selects the native SearchInputSource instead of a script
+const std::string SEARCH_BOT = "search";
+
+struct SimConfig
+{
+	std::string script[MAX_PLAYERS];
+	std::string rules = DEFAULT_RULES_FILE;
+	int matches = 1;
+	unsigned int threads = 0;
+	int scoreToWin = 0;
+	unsigned int difficulty = 0;
+	// matches where the bots get stuck, e.g. because nobody serves, are aborted after one hour
+	unsigned int maxSteps = GAME_SPEED * 3600;
+	bool deterministic = false;
+	bool asyncBots = false;
+	// zero means that the search bot evaluates all candidates, which keeps the results deterministic
+	std::chrono::microseconds searchBudget{0};
+	bool verbose = false;
+	bool scriptStats = false;
+	std::string replayDir;
+	std::string output = "-";
+};
+
+struct MatchResult
+{
+	int score[MAX_PLAYERS] = {0, 0};
+	int hits[MAX_PLAYERS] = {0, 0};
+	PlayerSide winner = NO_PLAYER;
+	unsigned int steps = 0;
+	std::string replay;
+	std::string error;
+};
+
+// several matches may finish at the same time, but we only write one replay at a time
+std::mutex g_replay_mutex;
+
+std::shared_ptr<InputSource> createBot(const SimConfig& config, PlayerSide side, int index)
+{
+	if(config.script[side] == SEARCH_BOT)
+	{
+		// the matches already run in parallel, so the search uses a single thread
+		SearchInputSource::Settings settings;
+		settings.budget = config.searchBudget;
+		return std::make_shared<SearchInputSource>(side, settings);
+	}
+
+	auto bot = std::make_shared<ScriptedInputSource>("scripts/" + config.script[side], side, config.difficulty);
+	// the bots must not depend on the order in which the threads start their matches
+	bot->setRandomSeed(index * MAX_PLAYERS + side);
+	// without a deadline, so the results stay deterministic
+	if(config.asyncBots)
+		bot->enableAsync();
+	return bot;
+}
+
+MatchResult playMatch(const SimConfig& config, int index)
+{
+	MatchResult result;
+
+	DuelMatch match(false, config.rules, config.scoreToWin);
+	match.setDeterministicPhysics( config.deterministic );
+	match.setInputSources( createBot(config, LEFT_PLAYER, index), createBot(config, RIGHT_PLAYER, index) );
+
+	std::unique_ptr<ReplayRecorder> recorder;
+	if(!config.replayDir.empty())
+	{
+		recorder.reset( new ReplayRecorder() );
+		recorder->setPlayerNames( config.script[LEFT_PLAYER], config.script[RIGHT_PLAYER] );
+		recorder->setPlayerColors( Color(0, 0, 255), Color(255, 0, 0) );
+		recorder->setGameSpeed( GAME_SPEED );
+		recorder->setGameRules( config.rules );
+		recorder->setDeterministicPhysics( config.deterministic );
+	}
+
+	while(match.winningPlayer() == NO_PLAYER && result.steps < config.maxSteps)
+	{
+		if(recorder)
+			recorder->record( match.getState() );
+
+		match.step();
+		++result.steps;
+
+		for(const auto& event : match.getEvents())
+		{
+			if(event.event == MatchEvent::BALL_HIT_BLOB)
+				++result.hits[event.side];
+		}
+	}
+
+	result.winner = match.winningPlayer();
+	result.score[LEFT_PLAYER] = match.getScore(LEFT_PLAYER);
+	result.score[RIGHT_PLAYER] = match.getScore(RIGHT_PLAYER);
+
+	if(recorder)
+	{
+		recorder->record( match.getState() );
+		recorder->finalize( result.score[LEFT_PLAYER], result.score[RIGHT_PLAYER] );
+
+		std::ostringstream name;
+		name << "sim-" << std::setw(6) << std::setfill('0') << index << ".bvr";
+		result.replay = name.str();
+
+		std::lock_guard<std::mutex> lock(g_replay_mutex);
+		auto target = std::make_shared<FileWrite>( result.replay );
+		recorder->save( target );
+		target->close();
+	}
+
+	return result;
+}
+
+void printHelp()
+{
+	std::cout << "Usage: blobby-sim [OPTION...] <left script> <right script>" << std::endl;
+	std::cout << "Plays bot versus bot matches as fast as possible and prints one line of CSV per match." << std::endl;
+	std::cout << "The script name \"" << SEARCH_BOT << "\" selects the native search bot." << std::endl;
+	std::cout << "  -n, --matches <n>         Number of matches (default 1)" << std::endl;
+	std::cout << "  -j, --threads <n>         Number of worker threads (default: one per core)" << std::endl;
+	std::cout << "  -r, --rules <file>        Rules file (default " << DEFAULT_RULES_FILE << ")" << std::endl;
+	std::cout << "  -s, --score-to-win <n>    Score to win (default from config.xml)" << std::endl;
+	std::cout << "  -d, --difficulty <n>      Handicap of the bots, 0 is strongest (default 0)" << std::endl;
+	std::cout << "  -m, --max-steps <n>       Abort matches after n steps (default " << GAME_SPEED * 3600 << ")" << std::endl;
+	std::cout << "  -o, --output <file>       Write results to file instead of stdout" << std::endl;
+	std::cout << "      --replays <dir>       Save a replay of every match in dir" << std::endl;
+	std::cout << "      --deterministic       Use deterministic fixed point physics" << std::endl;
+	std::cout << "      --async-bots          Run the bots on worker threads, one frame behind the match" << std::endl;
+	std::cout << "      --search-budget <us>  Time per frame for the search bot (default 0: no limit)" << std::endl;
+	std::cout << "  -v, --verbose             Show output of rules and bot scripts" << std::endl;
+	std::cout << "      --script-stats        Print call times and budget overruns of the scripts" << std::endl;
+	std::cout << "  -h, --help                This message" << std::endl;
+}
+
+void process_arguments(int argc, char** argv, SimConfig& config)
+{
+	std::vector<std::string> scripts;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		// returns the argument of the current option
+		auto value = [&]() -> const char*
+		{
+			if (i + 1 >= argc)
+			{
+				std::cerr << "\"" << arg << "\" option needs an argument" << std::endl;
+				printHelp();
+				exit(1);
+			}
+			return argv[++i];
+		};
+
+		if (arg == "--matches" || arg == "-n")
+			config.matches = std::atoi( value() );
+		else if (arg == "--threads" || arg == "-j")
+			config.threads = std::atoi( value() );
+		else if (arg == "--rules" || arg == "-r")
+			config.rules = value();
+		else if (arg == "--score-to-win" || arg == "-s")
+			config.scoreToWin = std::atoi( value() );
+		else if (arg == "--difficulty" || arg == "-d")
+			config.difficulty = std::atoi( value() );
+		else if (arg == "--max-steps" || arg == "-m")
+			config.maxSteps = std::atoi( value() );
+		else if (arg == "--output" || arg == "-o")
+			config.output = value();
+		else if (arg == "--replays")
+			config.replayDir = value();
+		else if (arg == "--deterministic")
+			config.deterministic = true;
+		else if (arg == "--async-bots")
+			config.asyncBots = true;
+		else if (arg == "--search-budget")
+			config.searchBudget = std::chrono::microseconds( std::atoi( value() ) );
+		else if (arg == "--verbose" || arg == "-v")
+			config.verbose = true;
+		else if (arg == "--script-stats")
+			config.scriptStats = true;
+		else if (arg == "--help" || arg == "-h")
+		{
+			printHelp();
+			exit(0);
+		}
+		else if (arg.size() > 1 && arg[0] == '-')
+		{
+			std::cerr << "Unknown option \"" << arg << "\"" << std::endl;
+			printHelp();
+			exit(1);
+		}
+		else
+			scripts.push_back( arg );
+	}
+
+	if (scripts.size() != 2)
+	{
+		std::cerr << "Exactly two bot scripts are required" << std::endl;
+		printHelp();
+		exit(1);
+	}
+	config.script[LEFT_PLAYER] = scripts[0];
+	config.script[RIGHT_PLAYER] = scripts[1];
+
+	if (config.threads == 0)
+		config.threads = std::max(1u, std::thread::hardware_concurrency());
+}
+
+void writeResults(std::ostream& target, const std::vector<MatchResult>& results, bool replays)
+{
+	target << "match,left_score,right_score,winner,steps,game_time,left_hits,right_hits";
+	target << (replays ? ",replay\n" : "\n");
+
+	for(unsigned int i = 0; i < results.size(); ++i)
+	{
+		const auto& r = results[i];
+		target << i << ",";
+		if(!r.error.empty())
+		{
+			// keep the number of columns, so the file can be read by simple tools
+			target << ",,error,,,,";
+			target << (replays ? "," : "") << "\n";
+			continue;
+		}
+
+		const char* winner = r.winner == LEFT_PLAYER ? "left" : (r.winner == RIGHT_PLAYER ? "right" : "none");
+		target << r.score[LEFT_PLAYER] << "," << r.score[RIGHT_PLAYER] << "," << winner << ","
+				<< r.steps << "," << std::fixed << std::setprecision(2) << double(r.steps) / GAME_SPEED << ","
+				<< r.hits[LEFT_PLAYER] << "," << r.hits[RIGHT_PLAYER];
+		if(replays)
+			target << "," << r.replay;
+		target << "\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	SimConfig config;
+	process_arguments(argc, argv, config);
+
+	FileSystem fileSys(argv[0]);
+	setupHeadlessSearchPath();
+
+	// only limit the instructions, as a time limit would make the results depend on the load of the machine
+	ScriptWatchdog::Budget budget;
+	budget.time = std::chrono::microseconds(0);
+	ScriptWatchdog watchdog(budget);
+
+	// every worker plays one match at a time, so this many states of each kind can be reused
+	LuaStatePool luaStates( std::max<std::size_t>(config.threads, LuaStatePool::DEFAULT_MAX_IDLE) );
+
+	if(!config.replayDir.empty())
+	{
+		try
+		{
+			fileSys.setWriteDir( config.replayDir );
+		}
+		catch(std::exception& e)
+		{
+			std::cerr << "Can not write replays to " << config.replayDir << ": " << e.what() << std::endl;
+			return 1;
+		}
+	}
+
+	// rules and bots may print to stdout, which would mix with the results
+	StdoutSilencer silencer(!config.verbose);
+
+	std::vector<MatchResult> results( config.matches );
+	std::atomic<int> next_match(0);
+	std::mutex error_mutex;
+
+	auto start = std::chrono::steady_clock::now();
+
+	// every worker takes the next unplayed match until all matches are done
+	auto worker = [&]()
+	{
+		for(int index = next_match++; index < config.matches; index = next_match++)
+		{
+			try
+			{
+				results[index] = playMatch(config, index);
+			}
+			catch(std::exception& e)
+			{
+				results[index].error = e.what();
+				std::lock_guard<std::mutex> lock(error_mutex);
+				std::cerr << "match " << index << " failed: " << e.what() << std::endl;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for(unsigned int i = 0; i < config.threads; ++i)
+		threads.emplace_back(worker);
+	for(auto& thread : threads)
+		thread.join();
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	silencer.restore();
+
+	if(config.output == "-")
+	{
+		writeResults(std::cout, results, !config.replayDir.empty());
+	}
+	else
+	{
+		std::ofstream target(config.output);
+		writeResults(target, results, !config.replayDir.empty());
+		if(!target)
+		{
+			std::cerr << "Could not write " << config.output << std::endl;
+			return 1;
+		}
+	}
+
+	// short summary for humans
+	int wins[MAX_PLAYERS] = {0, 0};
+	int failed = 0;
+	unsigned long long steps = 0;
+	for(const auto& r : results)
+	{
+		if(!r.error.empty())
+			++failed;
+		else if(r.winner != NO_PLAYER)
+			++wins[r.winner];
+		steps += r.steps;
+	}
+
+	std::cerr << config.matches << " matches in " << std::fixed << std::setprecision(1) << seconds << "s using "
+			<< config.threads << " threads, " << std::setprecision(0) << steps / seconds << " steps/s\n";
+	std::cerr << config.script[LEFT_PLAYER] << ": " << wins[LEFT_PLAYER] << " wins, "
+			<< config.script[RIGHT_PLAYER] << ": " << wins[RIGHT_PLAYER] << " wins";
+	if(failed > 0)
+		std::cerr << ", " << failed << " failed";
+	std::cerr << std::endl;
+
+	luaStates.printStatus(std::cerr);
+	if(config.scriptStats)
+		watchdog.printStatus(std::cerr);
+
+	return failed > 0 ? 1 : 0;
+}
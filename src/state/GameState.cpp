@@ -79,7 +79,7 @@ void GameState::presentGame()
 
 	rmanager.setBall(mMatch->getBallPosition(), mMatch->getWorld().getBallRotation());
 
-	auto events = mMatch->getEvents( );
+	const auto& events = mMatch->getEvents( );
 	for(const auto& e : events )
 	{
 		if( e.event == MatchEvent::BALL_HIT_BLOB )
@@ -61,11 +61,13 @@ LocalGameState::LocalGameState()
 	mMatch.reset(new DuelMatch( false, config->getString("rules")));
 	mMatch->setPlayers(leftPlayer, rightPlayer);
 	mMatch->setInputSources(leftInput, rightInput);
+	mMatch->setDeterministicPhysics( config->getBool("deterministic_physics", false) );
 
 	mRecorder->setPlayerNames(leftPlayer.getName(), rightPlayer.getName());
 	mRecorder->setPlayerColors( leftPlayer.getStaticColor(), rightPlayer.getStaticColor() );
 	mRecorder->setGameSpeed((float)config->getInteger("gamefps"));
 	mRecorder->setGameRules( config->getString("rules") );
+	mRecorder->setDeterministicPhysics( mMatch->hasDeterministicPhysics() );
 }
 
 void LocalGameState::step_impl()
@@ -137,7 +139,16 @@ void LocalGameState::step_impl()
 	else
 	{
 		mRecorder->record(mMatch->getState());
-		mMatch->step();
+		try
+		{
+			mMatch->step();
+		}
+		catch (const ScriptException& except)
+		{
+			// a bot or the rules exceeded the script budget, and the policy is to abort the match
+			mErrorMessage = "Script error:" + except.luaerror;
+			mMatch->pause();
+		}
 
 		if (mMatch->winningPlayer() != NO_PLAYER)
 		{
@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <iostream>
 #include <utility>
 #include <ctime>
+#include <atomic>
 
 #include <boost/scoped_array.hpp>
 #include <boost/make_shared.hpp>
@@ -54,6 +55,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "server/DedicatedServer.h"
 #include "LobbyStates.h"
 #include "InputManager.h"
+#include "MatchPredictor.h"
+#include "PhysicWorld.h"
 
 // global variable to save the lag
 int CURRENT_NETWORK_LAG = -1;
@@ -65,7 +68,9 @@ NetworkGameState::NetworkGameState( std::shared_ptr<RakClient> client, int rule_
 	 mClient(std::move(client)),
 	 mNetworkState(WAITING_FOR_OPPONENT),
 	 mWinningPlayer(NO_PLAYER),
+	 mNextInputId(1),
 	 mWaitingForReplay(false),
+	 mLastUpdateFrame(0),
 	 mSelectedChatmessage(0),
 	 mChatCursorPosition(0),
 	 mChattext("")
@@ -75,6 +80,7 @@ NetworkGameState::NetworkGameState( std::shared_ptr<RakClient> client, int rule_
 	mUseRemoteColor = config->getBool("use_remote_color");
 	mLocalInput.reset(new LocalInputSource(mOwnSide));
 	mLocalInput->setMatch(mMatch.get());
+	mPredictor.reset(new MatchPredictor(*mMatch, mOwnSide));
 
 	/// \todo why do we need this here?
 	RenderManager::getSingleton().redraw();
@@ -147,14 +153,61 @@ void NetworkGameState::step_impl()
 				stream.IgnoreBytes(1);	//ID_GAME_UPDATE
 				unsigned timeBack;
 				stream.Read(timeBack);
-				CURRENT_NETWORK_LAG = SDL_GetTicks() - timeBack;
+				updateNetworkLag(timeBack);
 				DuelMatchState ms;
 				/// \todo this is a performance nightmare: we create a new reader for every packet!
 				///			there should be a better way to do that
 				std::shared_ptr<GenericIn> in = createGenericReader(&stream);
 				in->generic<DuelMatchState> (ms);
-				// inject network data into game
-				mMatch->setState( ms );
+				// inject network data into game, and replay the inputs the server did not know yet
+				mPredictor->correct( ms, timeBack );
+				break;
+			}
+
+			case ID_GAME_UPDATE_DELTA:
+			{
+				RakNet::BitStream stream((char*)packet->data, packet->length, false);
+				stream.IgnoreBytes(1);	//ID_GAME_UPDATE_DELTA
+				unsigned timeBack;
+				unsigned frame;
+				unsigned char baselineDistance;
+				bool swapped;
+				stream.Read(timeBack);
+				stream.Read(frame);
+				stream.Read(baselineDistance);
+				stream.Read(swapped);
+
+				// updates are sequenced, so a missing baseline means we cannot decode this one.
+				// the server falls back to a keyframe once the acknowledged frame is too old.
+				const DuelMatchState* baseline = nullptr;
+				if( baselineDistance != 0 )
+				{
+					baseline = mStateHistory.find(frame - baselineDistance);
+					if( !baseline )
+						break;
+				}
+
+				DuelMatchState ms;
+				if( !DuelMatchStateCodec::decode(stream, ms, baseline, baselineDistance) )
+				{
+					// our prediction of the baseline differs from the one of the server. drop all baselines,
+					// so we acknowledge no frame and the server sends a keyframe.
+					if( baseline )
+					{
+						mStateHistory.clear();
+						mLastUpdateFrame = 0;
+					}
+					break;
+				}
+
+				updateNetworkLag(timeBack);
+				mStateHistory.store(frame, ms);
+				mLastUpdateFrame = frame;
+
+				if( swapped )
+					ms.swapSides();
+				// inject network data into game, and replay the inputs the server did not know yet
+				mPredictor->correct( ms, timeBack );
 				break;
 			}
 
@@ -204,6 +257,7 @@ void NetworkGameState::step_impl()
 				{
 					mNetworkState = PAUSING;
 					mMatch->pause();
+					mPredictor->reset();
 				}
 				break;
 			case ID_UNPAUSE:
@@ -376,6 +430,13 @@ void NetworkGameState::step_impl()
 	// does this generate any problems if we pause at the exact moment an event is set ( i.e. the ball hit sound
 	// could be played in a loop)?
 	presentGame();
+	// draw ball and blobs with the smoothed out prediction correction
+	rmanager->setBall(mMatch->getBallPosition() + mPredictor->getBallOffset(), mMatch->getWorld().getBallRotation());
+	for(auto side : {LEFT_PLAYER, RIGHT_PLAYER})
+	{
+		rmanager->setBlob(side, mMatch->getBlobPosition(side) + mPredictor->getBlobOffset(side),
+							mMatch->getWorld().getBlobState(side));
+	}
 	presentGameUI();
 
 	if (InputManager::getSingleton()->exit() && mNetworkState != PLAYING)
@@ -497,10 +558,14 @@ void NetworkGameState::step_impl()
 		}
 		case PLAYING:
 		{
-			mMatch->step();
-
 			mLocalInput->updateInput();
 			PlayerInputAbs input = mLocalInput->getRealInput();
+			// the ids have to be unique per frame, several frames can be stepped in the same millisecond
+			unsigned inputId = mNextInputId++;
+			mInputSendTime[inputId % MatchPredictor::BUFFER_SIZE] = SDL_GetTicks();
+
+			// our own input is used immediately, the server state will correct it later
+			mPredictor->step( inputId, input.toPlayerInput(mMatch.get()) );
 
 			if (InputManager::getSingleton()->exit())
 			{
@@ -510,8 +575,9 @@ void NetworkGameState::step_impl()
 			}
 			RakNet::BitStream stream;
 			stream.Write((unsigned char)ID_INPUT_UPDATE);
-			stream.Write( SDL_GetTicks() );
+			stream.Write( inputId );
 			input.writeTo(stream);
+			stream.Write( mLastUpdateFrame );
 			mClient->Send(&stream, HIGH_PRIORITY, UNRELIABLE_SEQUENCED, 0);
 			break;
 		}
@@ -577,6 +643,14 @@ void NetworkGameState::step_impl()
 	}
 }
 
+void NetworkGameState::updateNetworkLag(unsigned inputId)
+{
+	// the server echoes -1 until it got our first input, and we only know the times of the last inputs
+	if( inputId == unsigned(-1) || mNextInputId - inputId - 1 >= MatchPredictor::BUFFER_SIZE )
+		return;
+	CURRENT_NETWORK_LAG = SDL_GetTicks() - mInputSendTime[inputId % MatchPredictor::BUFFER_SIZE];
+}
+
 const char* NetworkGameState::getStateName() const
 {
 	return "NetworkGameState";
@@ -592,4 +666,6 @@ int SWLS_PacketCount;
 int SWLS_Connections;
 int SWLS_Games;
 int SWLS_GameSteps;
+std::atomic<unsigned long long> SWLS_GameUpdates;
+std::atomic<unsigned long long> SWLS_GameUpdateBytes;
 int SWLS_ServerEntered;
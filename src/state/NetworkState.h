@@ -23,6 +23,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "GameState.h"
 #include "NetworkMessage.h"
 #include "PlayerIdentity.h"
+#include "DuelMatchStateCodec.h"
+#include "MatchPredictor.h"
 
 #include <vector>
 #include <memory>
@@ -52,6 +54,9 @@ public:
 	const char* getStateName() const override;
 
 private:
+	/// sets CURRENT_NETWORK_LAG from the send time of the input \p inputId, which the server has just echoed
+	void updateNetworkLag(unsigned inputId);
+
 	enum
 	{
 		WAITING_FOR_OPPONENT,
@@ -70,11 +75,21 @@ private:
 	bool mUseRemoteColor;
 
 	std::unique_ptr<InputSource> mLocalInput;
+	/// steps the match with the local input before the server confirms it
+	std::unique_ptr<MatchPredictor> mPredictor;
+	/// id of the next input that is sent, the server echoes the newest one it applied
+	unsigned mNextInputId;
+	/// SDL_GetTicks() when each of the last inputs was sent, indexed by input id, to measure the lag
+	unsigned mInputSendTime[MatchPredictor::BUFFER_SIZE];
 
 	bool mWaitingForReplay;
 
 	std::shared_ptr<RakClient> mClient;
 	PlayerSide mOwnSide;
+
+	// received game updates, used as baselines for ID_GAME_UPDATE_DELTA
+	DuelMatchStateCodec mStateHistory;
+	unsigned mLastUpdateFrame;
 	PlayerSide mWinningPlayer;
 
 	// Chat Vars
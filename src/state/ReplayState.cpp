@@ -63,6 +63,7 @@ void ReplayState::loadReplay(const std::string& file)
 		rulesFile.write(mReplayPlayer->getRules());
 		rulesFile.close();
 		mMatch.reset(new DuelMatch(false, TEMP_RULES_NAME));
+		mMatch->setDeterministicPhysics(mReplayPlayer->hasDeterministicPhysics());
 
 		SoundManager::getSingleton().playSound(	"sounds/pfiff.wav", ROUND_START_SOUND_VOLUME);
 
@@ -0,0 +1,133 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+/* header include */
+#include "Rating.h"
+
+/* includes */
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+/* implementation */
+
+namespace
+{
+	const int MAX_ITERATIONS = 10000;
+	const double TOLERANCE = 1e-10;
+
+	// fits the Bradley-Terry model with the minorization-maximization algorithm and returns Elo ratings
+	std::vector<double> fitElo(unsigned int players, const std::vector<GameRecord>& games)
+	{
+		// points and number of games of every pair, including the virtual games against the average player
+		std::vector<double> points(players, 1.0);
+		std::vector<double> pairs(players * players, 0.0);
+		for(const auto& game : games)
+		{
+			points[game.first] += game.score;
+			points[game.second] += 1.0 - game.score;
+			pairs[game.first * players + game.second] += 1;
+			pairs[game.second * players + game.first] += 1;
+		}
+
+		std::vector<double> gamma(players, 1.0);
+		std::vector<double> next(players);
+		for(int iteration = 0; iteration < MAX_ITERATIONS; ++iteration)
+		{
+			double change = 0;
+			for(unsigned int i = 0; i < players; ++i)
+			{
+				double denominator = 2.0 / (gamma[i] + 1.0);
+				for(unsigned int j = 0; j < players; ++j)
+				{
+					if(pairs[i * players + j] > 0)
+						denominator += pairs[i * players + j] / (gamma[i] + gamma[j]);
+				}
+				next[i] = points[i] / denominator;
+				change = std::max(change, std::abs(next[i] - gamma[i]) / gamma[i]);
+			}
+			gamma.swap(next);
+			if(change < TOLERANCE)
+				break;
+		}
+
+		std::vector<double> elo(players);
+		double mean = 0;
+		for(unsigned int i = 0; i < players; ++i)
+		{
+			elo[i] = 400.0 * std::log10(gamma[i]);
+			mean += elo[i] / players;
+		}
+		for(auto& e : elo)
+			e -= mean;
+		return elo;
+	}
+}
+
+std::vector<Rating> estimateRatings(unsigned int players, const std::vector<GameRecord>& games,
+									unsigned int samples, unsigned int seed)
+{
+	std::vector<Rating> ratings(players);
+	if(players == 0)
+		return ratings;
+
+	auto elo = fitElo(players, games);
+	for(unsigned int i = 0; i < players; ++i)
+	{
+		ratings[i].elo = elo[i];
+		ratings[i].lower = elo[i];
+		ratings[i].upper = elo[i];
+	}
+	for(const auto& game : games)
+	{
+		++ratings[game.first].games;
+		++ratings[game.second].games;
+		ratings[game.first].score += game.score;
+		ratings[game.second].score += 1.0 - game.score;
+	}
+
+	if(samples == 0 || games.empty())
+		return ratings;
+
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<std::size_t> pick(0, games.size() - 1);
+	std::vector<GameRecord> resample(games.size());
+	std::vector<std::vector<double>> estimates(players);
+	for(unsigned int sample = 0; sample < samples; ++sample)
+	{
+		for(auto& game : resample)
+			game = games[pick(gen)];
+
+		auto sampled = fitElo(players, resample);
+		for(unsigned int i = 0; i < players; ++i)
+			estimates[i].push_back(sampled[i]);
+	}
+
+	for(unsigned int i = 0; i < players; ++i)
+	{
+		auto& values = estimates[i];
+		std::sort(values.begin(), values.end());
+		ratings[i].lower = values[ std::size_t(0.025 * (values.size() - 1) + 0.5) ];
+		ratings[i].upper = values[ std::size_t(0.975 * (values.size() - 1) + 0.5) ];
+	}
+
+	return ratings;
+}
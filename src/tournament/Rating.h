@@ -0,0 +1,55 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#pragma once
+
+#include <vector>
+
+/// result of a single game between two players, identified by their index
+struct GameRecord
+{
+	unsigned int first;
+	unsigned int second;
+	/// points of the first player: 1 for a win, 0.5 for a draw and 0 for a loss
+	double score;
+};
+
+/// estimated strength of a player
+struct Rating
+{
+	double elo = 0;
+	/// bounds of the 95% confidence interval
+	double lower = 0;
+	double upper = 0;
+	unsigned int games = 0;
+	/// sum of the points of the player
+	double score = 0;
+};
+
+/*! \brief computes Elo ratings from game results
+	\details The ratings are the maximum likelihood estimate of the Bradley-Terry model, on the Elo scale
+			and shifted so that the average rating is zero. Draws count as half a win for both players.
+			Every player gets one virtual win and one virtual loss against an average player, so players
+			that won or lost all their games still get a finite rating.
+			The confidence intervals are estimated by refitting the ratings to \p samples bootstrap
+			resamples of the games. The resampling uses a fixed \p seed, so the results are reproducible.
+*/
+std::vector<Rating> estimateRatings(unsigned int players, const std::vector<GameRecord>& games,
+									unsigned int samples = 200, unsigned int seed = 1);
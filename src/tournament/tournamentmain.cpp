@@ -0,0 +1,626 @@
+/*=============================================================================
+Blobby Volley 2
+Copyright (C) 2006 Jonathan Sieber (jonathan_sieber@yahoo.de)
+Copyright (C) 2006 Daniel Knobe (daniel-knobe@web.de)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+
+/* includes */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "DuelMatch.h"
+#include "FileSystem.h"
+#include "Global.h"
+#include "HeadlessTool.h"
+#include "LuaStatePool.h"
+#include "ScriptedInputSource.h"
+#include "ScriptWatchdog.h"
+#include "SearchInputSource.h"
+
+#include "Rating.h"
+
+/* implementation */
+
+// all times are given in game time at normal speed
+const int GAME_SPEED = 75;
+// bot name that selects the native SearchInputSource instead of a script
+const std::string SEARCH_BOT = "search";
+
+enum class Format
+{
+	ROUND_ROBIN,
+	SWISS
+};
+
+struct TournamentConfig
+{
+	std::vector<std::string> bots;
+	std::vector<std::string> rules;
+	Format format = Format::ROUND_ROBIN;
+	// number of swiss rounds, zero selects enough rounds to find a winner
+	unsigned int rounds = 0;
+	// games per pairing and rules file. The bots change sides after every game.
+	unsigned int games = 2;
+	int scoreToWin = 0;
+	unsigned int threads = 0;
+	// games that take longer are a draw
+	unsigned int maxSteps = GAME_SPEED * 3600;
+	bool deterministic = false;
+	bool verbose = false;
+	unsigned int bootstrap = 200;
+	std::string checkpoint;
+	std::string output = "-";
+};
+
+struct Game
+{
+	unsigned int id = 0;
+	unsigned int round = 0;
+	unsigned int player[MAX_PLAYERS] = {0, 0};
+	std::string rules;
+
+	bool played = false;
+	int score[MAX_PLAYERS] = {0, 0};
+	PlayerSide winner = NO_PLAYER;
+	unsigned int steps = 0;
+	std::string error;
+
+	// points of the bot on \p side. Games that were not decided count as a draw.
+	double getPoints(PlayerSide side) const
+	{
+		return winner == NO_PLAYER ? 0.5 : (winner == side ? 1.0 : 0.0);
+	}
+};
+
+std::shared_ptr<InputSource> createBot(const std::string& name, PlayerSide side, unsigned int seed)
+{
+	if(name == SEARCH_BOT)
+	{
+		// the games already run in parallel, and a time limit would make the results depend on the load
+		SearchInputSource::Settings settings;
+		settings.budget = std::chrono::microseconds(0);
+		return std::make_shared<SearchInputSource>(side, settings);
+	}
+
+	auto bot = std::make_shared<ScriptedInputSource>("scripts/" + name, side, 0);
+	bot->setRandomSeed(seed);
+	return bot;
+}
+
+void playGame(const TournamentConfig& config, Game& game)
+{
+	DuelMatch match(false, game.rules, config.scoreToWin);
+	match.setDeterministicPhysics( config.deterministic );
+	match.setInputSources( createBot(config.bots[game.player[LEFT_PLAYER]], LEFT_PLAYER, 2 * game.id),
+							createBot(config.bots[game.player[RIGHT_PLAYER]], RIGHT_PLAYER, 2 * game.id + 1) );
+
+	while(match.winningPlayer() == NO_PLAYER && game.steps < config.maxSteps)
+	{
+		match.step();
+		++game.steps;
+	}
+
+	game.winner = match.winningPlayer();
+	game.score[LEFT_PLAYER] = match.getScore(LEFT_PLAYER);
+	game.score[RIGHT_PLAYER] = match.getScore(RIGHT_PLAYER);
+	game.played = true;
+}
+
+// adds the games of all rules files between \p first and \p second to \p games
+void addPairing(const TournamentConfig& config, unsigned int round, unsigned int first, unsigned int second,
+				std::vector<Game>& games, unsigned int& next_id)
+{
+	for(const auto& rules : config.rules)
+	{
+		for(unsigned int i = 0; i < config.games; ++i)
+		{
+			Game game;
+			game.id = next_id++;
+			game.round = round;
+			game.player[LEFT_PLAYER] = i % 2 == 0 ? first : second;
+			game.player[RIGHT_PLAYER] = i % 2 == 0 ? second : first;
+			game.rules = rules;
+			games.push_back(game);
+		}
+	}
+}
+
+std::vector<Game> scheduleRoundRobin(const TournamentConfig& config)
+{
+	std::vector<Game> games;
+	unsigned int next_id = 0;
+	for(unsigned int first = 0; first < config.bots.size(); ++first)
+	{
+		for(unsigned int second = first + 1; second < config.bots.size(); ++second)
+			addPairing(config, 0, first, second, games, next_id);
+	}
+	return games;
+}
+
+/// pairs bots with similar points that have not met yet. The result only depends on the finished games,
+/// so resuming a tournament schedules the same games again.
+std::vector<Game> scheduleSwissRound(const TournamentConfig& config, unsigned int round, const std::vector<Game>& finished,
+									const std::vector<unsigned int>& byes, unsigned int& next_id)
+{
+	unsigned int count = config.bots.size();
+	std::vector<double> points(count, 0.0);
+	std::vector<bool> met(count * count, false);
+	for(const auto& game : finished)
+	{
+		if(!game.played)
+			continue;
+		unsigned int left = game.player[LEFT_PLAYER];
+		unsigned int right = game.player[RIGHT_PLAYER];
+		points[left] += game.getPoints(LEFT_PLAYER);
+		points[right] += game.getPoints(RIGHT_PLAYER);
+		met[left * count + right] = met[right * count + left] = true;
+	}
+	// a bye is worth as much as winning all games of a pairing
+	for(unsigned int bot : byes)
+		points[bot] += config.games * config.rules.size();
+
+	std::vector<unsigned int> standings(count);
+	for(unsigned int i = 0; i < count; ++i)
+		standings[i] = i;
+	std::stable_sort(standings.begin(), standings.end(), [&](unsigned int a, unsigned int b) { return points[a] > points[b]; });
+
+	// with an odd number of bots, the lowest bot that did not have a bye yet sits this round out
+	std::vector<bool> paired(count, false);
+	if(count % 2 == 1)
+	{
+		unsigned int bye = standings[count - 1];
+		for(unsigned int i = count; i > 0; --i)
+		{
+			if(std::find(byes.begin(), byes.end(), standings[i - 1]) == byes.end())
+			{
+				bye = standings[i - 1];
+				break;
+			}
+		}
+		paired[bye] = true;
+	}
+
+	std::vector<Game> games;
+	for(unsigned int i = 0; i < count; ++i)
+	{
+		unsigned int first = standings[i];
+		if(paired[first])
+			continue;
+
+		// the best bot it has not met yet, or the best remaining bot if it has met all of them
+		int opponent = -1;
+		for(unsigned int j = i + 1; j < count; ++j)
+		{
+			unsigned int candidate = standings[j];
+			if(paired[candidate])
+				continue;
+			if(opponent < 0)
+				opponent = candidate;
+			if(!met[first * count + candidate])
+			{
+				opponent = candidate;
+				break;
+			}
+		}
+
+		if(opponent < 0)
+			continue;
+
+		paired[first] = paired[opponent] = true;
+		addPairing(config, round, first, opponent, games, next_id);
+	}
+	return games;
+}
+
+// the settings that have to match when a tournament is resumed
+std::string describe(const TournamentConfig& config)
+{
+	std::ostringstream desc;
+	desc << "# format=" << (config.format == Format::SWISS ? "swiss" : "round-robin")
+		<< " rounds=" << config.rounds << " games=" << config.games << " score=" << config.scoreToWin
+		<< " max-steps=" << config.maxSteps << " deterministic=" << config.deterministic << " bots=";
+	for(unsigned int i = 0; i < config.bots.size(); ++i)
+		desc << (i ? "," : "") << config.bots[i];
+	desc << " rules=";
+	for(unsigned int i = 0; i < config.rules.size(); ++i)
+		desc << (i ? "," : "") << config.rules[i];
+	return desc.str();
+}
+
+/// reads the finished games of an interrupted run. Throws if the checkpoint was written with other settings.
+std::map<unsigned int, Game> loadCheckpoint(const TournamentConfig& config)
+{
+	std::map<unsigned int, Game> games;
+	std::ifstream source(config.checkpoint);
+	if(!source)
+		return games;
+
+	std::string line;
+	if(!std::getline(source, line) || line != describe(config))
+		throw std::runtime_error("checkpoint " + config.checkpoint + " belongs to a tournament with other settings");
+
+	while(std::getline(source, line))
+	{
+		std::istringstream fields(line);
+		Game game;
+		char sep;
+		int winner;
+		if( !(fields >> game.id >> sep >> game.round >> sep >> game.player[LEFT_PLAYER] >> sep >> game.player[RIGHT_PLAYER] >> sep) )
+			continue;
+		if( !std::getline(fields, game.rules, ',') )
+			continue;
+		// a line that was cut off when the last run was interrupted is ignored
+		if( !(fields >> game.score[LEFT_PLAYER] >> sep >> game.score[RIGHT_PLAYER] >> sep >> winner >> sep >> game.steps) )
+			continue;
+		game.winner = PlayerSide(winner);
+		game.played = true;
+		games[game.id] = game;
+	}
+	return games;
+}
+
+void writeCheckpoint(std::ostream& target, const Game& game)
+{
+	target << game.id << "," << game.round << "," << game.player[LEFT_PLAYER] << "," << game.player[RIGHT_PLAYER] << ","
+			<< game.rules << "," << game.score[LEFT_PLAYER] << "," << game.score[RIGHT_PLAYER] << ","
+			<< int(game.winner) << "," << game.steps << std::endl;
+}
+
+struct Progress
+{
+	std::ofstream checkpoint;
+	std::mutex mutex;
+	unsigned int played = 0;
+	unsigned int resumed = 0;
+	unsigned int failed = 0;
+	unsigned long long steps = 0;
+};
+
+/// plays all \p games that are not in the checkpoint, on all threads
+void playGames(const TournamentConfig& config, std::vector<Game>& games, const std::map<unsigned int, Game>& done,
+				Progress& progress)
+{
+	std::vector<Game*> pending;
+	for(auto& game : games)
+	{
+		auto previous = done.find(game.id);
+		if(previous == done.end())
+		{
+			pending.push_back(&game);
+			continue;
+		}
+
+		const Game& result = previous->second;
+		if(result.round != game.round || result.rules != game.rules ||
+			result.player[LEFT_PLAYER] != game.player[LEFT_PLAYER] || result.player[RIGHT_PLAYER] != game.player[RIGHT_PLAYER])
+		{
+			throw std::runtime_error("game " + std::to_string(game.id) + " in the checkpoint does not match the schedule");
+		}
+		game = result;
+		++progress.resumed;
+	}
+
+	std::atomic<unsigned int> next_game(0);
+	auto worker = [&]()
+	{
+		for(unsigned int index = next_game++; index < pending.size(); index = next_game++)
+		{
+			Game& game = *pending[index];
+			try
+			{
+				playGame(config, game);
+			}
+			catch(std::exception& e)
+			{
+				game.error = e.what();
+			}
+
+			std::lock_guard<std::mutex> lock(progress.mutex);
+			if(!game.error.empty())
+			{
+				// failed games are not saved, so they are played again when the tournament is resumed
+				++progress.failed;
+				std::cerr << "game " << game.id << " failed: " << game.error << std::endl;
+				continue;
+			}
+			++progress.played;
+			progress.steps += game.steps;
+			if(progress.checkpoint.is_open())
+				writeCheckpoint(progress.checkpoint, game);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for(unsigned int i = 0; i < config.threads; ++i)
+		threads.emplace_back(worker);
+	for(auto& thread : threads)
+		thread.join();
+}
+
+void writeRatings(std::ostream& target, const TournamentConfig& config, const std::vector<Rating>& ratings)
+{
+	std::vector<unsigned int> order(ratings.size());
+	for(unsigned int i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return ratings[a].elo > ratings[b].elo; });
+
+	target << "rank,bot,elo,elo_lower,elo_upper,games,score\n";
+	for(unsigned int rank = 0; rank < order.size(); ++rank)
+	{
+		const Rating& r = ratings[order[rank]];
+		target << rank + 1 << "," << config.bots[order[rank]] << "," << std::fixed << std::setprecision(1)
+				<< r.elo << "," << r.lower << "," << r.upper << "," << r.games << "," << r.score << "\n";
+	}
+}
+
+void printHelp()
+{
+	std::cout << "Usage: blobby-tournament [OPTION...] [bot...]" << std::endl;
+	std::cout << "Plays a tournament between bots as fast as possible and prints their Elo ratings as CSV." << std::endl;
+	std::cout << "Without bot names, all scripts in data/scripts take part. The name \"" << SEARCH_BOT << "\" selects" << std::endl;
+	std::cout << "the native search bot." << std::endl;
+	std::cout << "  -r, --rules <file>        Rules file, may be given several times (default " << DEFAULT_RULES_FILE << ")" << std::endl;
+	std::cout << "      --all-rules           Play with every rules file" << std::endl;
+	std::cout << "  -g, --games <n>           Games per pairing and rules file (default 2)" << std::endl;
+	std::cout << "      --swiss <rounds>      Swiss system instead of round robin, 0 rounds selects log2(bots)" << std::endl;
+	std::cout << "  -s, --score-to-win <n>    Score to win (default from config.xml)" << std::endl;
+	std::cout << "  -j, --threads <n>         Number of worker threads (default: one per core)" << std::endl;
+	std::cout << "  -m, --max-steps <n>       Games that take longer are a draw (default " << GAME_SPEED * 3600 << ")" << std::endl;
+	std::cout << "  -c, --checkpoint <file>   Save finished games in file, and resume from it" << std::endl;
+	std::cout << "  -b, --bootstrap <n>       Resamples for the confidence intervals (default 200)" << std::endl;
+	std::cout << "  -o, --output <file>       Write ratings to file instead of stdout" << std::endl;
+	std::cout << "      --deterministic       Use deterministic fixed point physics" << std::endl;
+	std::cout << "  -v, --verbose             Show output of rules and bot scripts" << std::endl;
+	std::cout << "  -h, --help                This message" << std::endl;
+}
+
+void process_arguments(int argc, char** argv, TournamentConfig& config, bool& all_rules)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		// returns the argument of the current option
+		auto value = [&]() -> const char*
+		{
+			if (i + 1 >= argc)
+			{
+				std::cerr << "\"" << arg << "\" option needs an argument" << std::endl;
+				printHelp();
+				exit(1);
+			}
+			return argv[++i];
+		};
+
+		if (arg == "--rules" || arg == "-r")
+			config.rules.push_back( value() );
+		else if (arg == "--all-rules")
+			all_rules = true;
+		else if (arg == "--games" || arg == "-g")
+			config.games = std::max(1, std::atoi( value() ));
+		else if (arg == "--swiss")
+		{
+			config.format = Format::SWISS;
+			config.rounds = std::atoi( value() );
+		}
+		else if (arg == "--score-to-win" || arg == "-s")
+			config.scoreToWin = std::atoi( value() );
+		else if (arg == "--threads" || arg == "-j")
+			config.threads = std::atoi( value() );
+		else if (arg == "--max-steps" || arg == "-m")
+			config.maxSteps = std::atoi( value() );
+		else if (arg == "--checkpoint" || arg == "-c")
+			config.checkpoint = value();
+		else if (arg == "--bootstrap" || arg == "-b")
+			config.bootstrap = std::atoi( value() );
+		else if (arg == "--output" || arg == "-o")
+			config.output = value();
+		else if (arg == "--deterministic")
+			config.deterministic = true;
+		else if (arg == "--verbose" || arg == "-v")
+			config.verbose = true;
+		else if (arg == "--help" || arg == "-h")
+		{
+			printHelp();
+			exit(0);
+		}
+		else if (arg.size() > 1 && arg[0] == '-')
+		{
+			std::cerr << "Unknown option \"" << arg << "\"" << std::endl;
+			printHelp();
+			exit(1);
+		}
+		else
+			config.bots.push_back( arg );
+	}
+
+	if (config.threads == 0)
+		config.threads = std::max(1u, std::thread::hardware_concurrency());
+}
+
+int main(int argc, char** argv)
+{
+	TournamentConfig config;
+	bool all_rules = false;
+	process_arguments(argc, argv, config, all_rules);
+
+	FileSystem fileSys(argv[0]);
+	setupHeadlessSearchPath();
+
+	// sort the files, so the schedule does not depend on the file system
+	if (config.bots.empty())
+	{
+		config.bots = fileSys.enumerateFiles("scripts", ".lua");
+		std::sort(config.bots.begin(), config.bots.end());
+	}
+	if (all_rules)
+	{
+		config.rules = fileSys.enumerateFiles("rules", ".lua", true);
+		std::sort(config.rules.begin(), config.rules.end());
+	}
+	else if (config.rules.empty())
+	{
+		config.rules.push_back( DEFAULT_RULES_FILE );
+	}
+
+	if (config.bots.size() < 2)
+	{
+		std::cerr << "A tournament needs at least two bots" << std::endl;
+		return 1;
+	}
+	if (config.format == Format::SWISS && config.rounds == 0)
+		config.rounds = std::max(1, int(std::ceil(std::log2(config.bots.size()))));
+
+	// only limit the instructions, as a time limit would make the results depend on the load of the machine
+	ScriptWatchdog::Budget budget;
+	budget.time = std::chrono::microseconds(0);
+	ScriptWatchdog watchdog(budget);
+
+	// every worker plays one match at a time, so this many states of each kind can be reused
+	LuaStatePool luaStates( std::max<std::size_t>(config.threads, LuaStatePool::DEFAULT_MAX_IDLE) );
+
+	Progress progress;
+	std::map<unsigned int, Game> done;
+	if (!config.checkpoint.empty())
+	{
+		bool fresh = !std::ifstream(config.checkpoint);
+		try
+		{
+			done = loadCheckpoint(config);
+		}
+		catch(std::exception& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+
+		// a line that was cut off must not be continued by the next game
+		bool complete = true;
+		std::ifstream previous(config.checkpoint, std::ios::binary | std::ios::ate);
+		if (previous && previous.tellg() > 0)
+		{
+			previous.seekg(-1, std::ios::end);
+			complete = previous.get() == '\n';
+		}
+
+		progress.checkpoint.open(config.checkpoint, std::ios::app);
+		if (fresh)
+			progress.checkpoint << describe(config) << std::endl;
+		else if (!complete)
+			progress.checkpoint << std::endl;
+		if (!progress.checkpoint)
+		{
+			std::cerr << "Could not write " << config.checkpoint << std::endl;
+			return 1;
+		}
+	}
+
+	// rules and bots may print to stdout, which would mix with the results
+	StdoutSilencer silencer(!config.verbose);
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<Game> games;
+	try
+	{
+		if (config.format == Format::ROUND_ROBIN)
+		{
+			games = scheduleRoundRobin(config);
+			playGames(config, games, done, progress);
+		}
+		else
+		{
+			unsigned int next_id = 0;
+			std::vector<unsigned int> byes;
+			for (unsigned int round = 0; round < config.rounds; ++round)
+			{
+				auto next = scheduleSwissRound(config, round, games, byes, next_id);
+				playGames(config, next, done, progress);
+
+				// with an odd number of bots, the one that was not paired gets a bye
+				std::vector<bool> paired(config.bots.size(), false);
+				for (const auto& game : next)
+					paired[game.player[LEFT_PLAYER]] = paired[game.player[RIGHT_PLAYER]] = true;
+				for (unsigned int bot = 0; bot < paired.size(); ++bot)
+				{
+					if (!paired[bot])
+						byes.push_back(bot);
+				}
+				games.insert(games.end(), next.begin(), next.end());
+			}
+		}
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	silencer.restore();
+
+	std::vector<GameRecord> records;
+	for (const auto& game : games)
+	{
+		if (game.played)
+			records.push_back( GameRecord{game.player[LEFT_PLAYER], game.player[RIGHT_PLAYER], game.getPoints(LEFT_PLAYER)} );
+	}
+	auto ratings = estimateRatings(config.bots.size(), records, config.bootstrap);
+
+	if(config.output == "-")
+	{
+		writeRatings(std::cout, config, ratings);
+	}
+	else
+	{
+		std::ofstream target(config.output);
+		writeRatings(target, config, ratings);
+		if(!target)
+		{
+			std::cerr << "Could not write " << config.output << std::endl;
+			return 1;
+		}
+	}
+
+	// throughput of this run, without the games from the checkpoint
+	std::cerr << progress.played << " games in " << std::fixed << std::setprecision(1) << seconds << "s using "
+			<< config.threads << " threads, " << std::setprecision(2) << progress.played / seconds << " games/s, "
+			<< std::setprecision(0) << progress.steps / seconds << " steps/s";
+	if (progress.resumed > 0)
+		std::cerr << ", " << progress.resumed << " games from the checkpoint";
+	if (progress.failed > 0)
+		std::cerr << ", " << progress.failed << " failed";
+	std::cerr << std::endl;
+	luaStates.printStatus(std::cerr);
+
+	return progress.failed > 0 ? 1 : 0;
+}
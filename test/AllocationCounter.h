@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Counts all allocations of the test program, to check that hot paths do not allocate.
+// This replaces the global allocation functions, so only one file of a test program may include it.
+
+// gcc pairs the free of an inlined operator delete with the new expression of the caller, and warns
+#if defined(__GNUC__)
+#define ALLOCATION_COUNTER_NOINLINE __attribute__((noinline))
+#else
+#define ALLOCATION_COUNTER_NOINLINE
+#endif
+
+std::atomic<unsigned long> g_allocations(0);
+
+ALLOCATION_COUNTER_NOINLINE void* operator new(std::size_t size)
+{
+	++g_allocations;
+	if(void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+ALLOCATION_COUNTER_NOINLINE void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete[](void* p) noexcept
+{
+	operator delete(p);
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete(void* p, std::size_t) noexcept
+{
+	operator delete(p);
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete[](void* p, std::size_t) noexcept
+{
+	operator delete(p);
+}
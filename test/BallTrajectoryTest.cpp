@@ -0,0 +1,114 @@
+#define BOOST_TEST_MODULE BallTrajectory
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <cmath>
+
+#include "PhysicWorld.h"
+#include "BallTrajectory.h"
+#include "GameConstants.h"
+
+typedef BallTrajectory::BallState BallState;
+
+BallState step_world(PhysicWorld& world, const BallState& start, int steps)
+{
+	world.setBallPosition(start.position);
+	world.setBallVelocity(start.velocity);
+	for(int i = 0; i < steps; ++i)
+		world.step(PlayerInput(), PlayerInput(), false, true);
+	return BallState{world.getBallPosition(), world.getBallVelocity()};
+}
+
+void check_state_close(const BallState& a, const BallState& b, float tolerance)
+{
+	BOOST_CHECK_SMALL( a.position.x - b.position.x, tolerance );
+	BOOST_CHECK_SMALL( a.position.y - b.position.y, tolerance );
+	BOOST_CHECK_SMALL( a.velocity.x - b.velocity.x, tolerance );
+	BOOST_CHECK_SMALL( a.velocity.y - b.velocity.y, tolerance );
+}
+
+BOOST_AUTO_TEST_SUITE( ball_trajectory )
+
+BOOST_AUTO_TEST_CASE( free_flight )
+{
+	PhysicWorld world;
+	BallTrajectory trajectory;
+	BallState start{Vector2(200, 300), Vector2(2, -10)};
+	for(int steps = 0; steps < 50; ++steps)
+		check_state_close( step_world(world, start, steps), trajectory.advance(start, steps), 0.01 );
+}
+
+BOOST_AUTO_TEST_CASE( wall_and_ground_bounces )
+{
+	PhysicWorld world;
+	BallTrajectory trajectory;
+	BallState start{Vector2(150, 100), Vector2(-12, -5)};
+	for(int steps = 0; steps < 150; ++steps)
+		check_state_close( step_world(world, start, steps), trajectory.advance(start, steps), 0.1 );
+}
+
+BOOST_AUTO_TEST_CASE( net_bounce )
+{
+	PhysicWorld world;
+	BallTrajectory trajectory;
+	// falls onto the top of the net
+	BallState start{Vector2(395, 100), Vector2(0, 0)};
+	for(int steps = 0; steps < 80; ++steps)
+		check_state_close( step_world(world, start, steps), trajectory.advance(start, steps), 0.1 );
+}
+
+// compares with step-by-step simulation for random starting states. As rounding errors can change
+// the outcome of a collision, a few predictions are allowed to deviate.
+BOOST_AUTO_TEST_CASE( random_states )
+{
+	std::mt19937 gen(1210);
+	std::uniform_real_distribution<float> xdist(LEFT_PLANE + BALL_RADIUS, RIGHT_PLANE - BALL_RADIUS);
+	std::uniform_real_distribution<float> ydist(0, GROUND_PLANE_HEIGHT_MAX - BALL_RADIUS);
+	std::uniform_real_distribution<float> vdist(-15, 15);
+	std::uniform_int_distribution<int> sdist(1, 100);
+
+	PhysicWorld world;
+	BallTrajectory trajectory;
+	const int COUNT = 10000;
+	int deviations = 0;
+	for(int i = 0; i < COUNT; ++i)
+	{
+		Vector2 pos{xdist(gen), ydist(gen)};
+		Vector2 vel{vdist(gen), vdist(gen)};
+		BallState start{pos, vel};
+		int steps = sdist(gen);
+		auto expected = step_world(world, start, steps);
+		auto result = trajectory.advance(start, steps);
+		if( std::abs(expected.position.x - result.position.x) > 0.5 || std::abs(expected.position.y - result.position.y) > 0.5 )
+			++deviations;
+	}
+	BOOST_CHECK_LT( deviations, COUNT / 1000 );
+}
+
+BOOST_AUTO_TEST_CASE( advance_until )
+{
+	PhysicWorld world;
+	BallTrajectory trajectory;
+	BallState start{Vector2(150, 100), Vector2(-12, -5)};
+
+	// reference: step until the ball crosses y = 400
+	world.setBallPosition(start.position);
+	world.setBallVelocity(start.velocity);
+	int expected = 0;
+	while(world.getBallPosition().y < 400)
+	{
+		world.step(PlayerInput(), PlayerInput(), false, true);
+		++expected;
+	}
+
+	BallState state = start;
+	BOOST_CHECK_EQUAL( trajectory.advanceUntil(state, BallTrajectory::Axis::Y, 400, 375), expected );
+	check_state_close( state, BallState{world.getBallPosition(), world.getBallVelocity()}, 0.1 );
+
+	// the ball never gets above the net
+	state = start;
+	BOOST_CHECK_EQUAL( trajectory.advanceUntil(state, BallTrajectory::Axis::Y, 10, 375), -1 );
+	check_state_close( state, step_world(world, start, 375), 0.5 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,176 @@
+#define BOOST_TEST_MODULE DeterministicPhysics
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <cstring>
+
+#include "PhysicWorld.h"
+#include "FixedPoint.h"
+#include "GameConstants.h"
+
+// simple linear congruential generator, so the input sequence is the same with every standard library
+struct InputGenerator
+{
+	uint32_t state = 12345;
+	unsigned next()
+	{
+		state = state * 1664525u + 1013904223u;
+		return state >> 16;
+	}
+
+	PlayerInput input()
+	{
+		PlayerInput in;
+		in.setAll( next() % 8 );
+		return in;
+	}
+};
+
+uint64_t hash_state(const PhysicState& st, uint64_t hash)
+{
+	auto add = [&hash](float f)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &f, sizeof(bits));
+		hash = (hash ^ bits) * 1099511628211ull;
+	};
+
+	for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+	{
+		add(st.blobPosition[p].x);
+		add(st.blobPosition[p].y);
+		add(st.blobVelocity[p].x);
+		add(st.blobVelocity[p].y);
+		add(st.blobState[p]);
+	}
+	add(st.ballPosition.x);
+	add(st.ballPosition.y);
+	add(st.ballVelocity.x);
+	add(st.ballVelocity.y);
+	add(st.ballRotation);
+	add(st.ballAngularVelocity);
+	return hash;
+}
+
+bool on_grid(float f)
+{
+	return Fixed::fromFloat(f).toFloat() == f;
+}
+
+// runs a deterministic world with pseudo random inputs and returns a hash of all states
+uint64_t run_world(int steps, int& events)
+{
+	PhysicWorld world;
+	world.setDeterministic(true);
+	events = 0;
+	MatchEventBuffer buffer;
+	world.setEventBuffer( &buffer );
+
+	InputGenerator gen;
+	uint64_t hash = 14695981039346656037ull;
+	for(int step = 0; step < steps; ++step)
+	{
+		// throw the ball around every now and then, to get all kinds of collisions
+		if(step % 200 == 0)
+		{
+			// function arguments are evaluated in unspecified order, so we have to sequence the generator calls
+			float x = gen.next() % 800;
+			float y = gen.next() % 400;
+			float vx = (int)(gen.next() % 31) - 15;
+			float vy = (int)(gen.next() % 31) - 15;
+			world.setBallPosition( Vector2(x, y) );
+			world.setBallVelocity( Vector2(vx, vy) );
+		}
+
+		PlayerInput left = gen.input();
+		PlayerInput right = gen.input();
+		world.step( left, right, true, true );
+		events += buffer.size();
+		buffer.clear();
+		hash = hash_state(world.getState(), hash);
+	}
+	return hash;
+}
+
+BOOST_AUTO_TEST_SUITE( fixed_point )
+
+BOOST_AUTO_TEST_CASE( conversion )
+{
+	BOOST_CHECK_EQUAL( Fixed::fromFloat(1.5f).raw(), 6144 );
+	BOOST_CHECK_EQUAL( Fixed::fromFloat(-1.5f).raw(), -6144 );
+	BOOST_CHECK_EQUAL( Fixed::fromFloat(0.1f).raw(), 410 );
+	BOOST_CHECK_EQUAL( Fixed::fromFloat(-0.1f).raw(), -410 );
+	BOOST_CHECK_EQUAL( Fixed::fromRaw(-61850).toFloat(), -61850.f / 4096 );
+	// saturation
+	BOOST_CHECK_EQUAL( Fixed::fromFloat(1e20f).raw(), std::numeric_limits<int32_t>::max() );
+	BOOST_CHECK_EQUAL( Fixed::fromFloat(-1e20f).raw(), std::numeric_limits<int32_t>::min() );
+}
+
+BOOST_AUTO_TEST_CASE( arithmetic )
+{
+	// rounding is symmetric around zero
+	BOOST_CHECK_EQUAL( (Fixed::fromRaw(3) * Fixed::fromRaw(2048)).raw(), 2 );
+	BOOST_CHECK_EQUAL( (Fixed::fromRaw(-3) * Fixed::fromRaw(2048)).raw(), -2 );
+	BOOST_CHECK_EQUAL( (Fixed::fromInt(1) / Fixed::fromInt(3)).raw(), 1365 );
+	BOOST_CHECK_EQUAL( (Fixed::fromInt(-1) / Fixed::fromInt(3)).raw(), -1365 );
+	BOOST_CHECK_EQUAL( (Fixed::fromInt(2) / Fixed::fromInt(3)).raw(), 2731 );
+	BOOST_CHECK_EQUAL( (Fixed::fromInt(1) / Fixed()).raw(), 0 );
+
+	BOOST_CHECK_EQUAL( Fixed::sqrt(Fixed::fromInt(16)).raw(), Fixed::fromInt(4).raw() );
+	BOOST_CHECK_EQUAL( Fixed::sqrt(Fixed::fromInt(2)).raw(), 5792 );
+	BOOST_CHECK_EQUAL( Fixed::sqrt(Fixed::fromInt(-2)).raw(), 0 );
+
+	FixedVector2 v(Fixed::fromInt(3), Fixed::fromInt(-4));
+	BOOST_CHECK_EQUAL( v.length().raw(), Fixed::fromInt(5).raw() );
+	FixedVector2 n = v.withLength(Fixed::fromInt(10));
+	BOOST_CHECK_EQUAL( n.x.raw(), Fixed::fromInt(6).raw() );
+	BOOST_CHECK_EQUAL( n.y.raw(), Fixed::fromInt(-8).raw() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( deterministic_physics )
+
+BOOST_AUTO_TEST_CASE( state_on_grid )
+{
+	PhysicWorld world;
+	world.setDeterministic(true);
+	InputGenerator gen;
+	for(int step = 0; step < 5000; ++step)
+	{
+		PlayerInput left = gen.input();
+		PlayerInput right = gen.input();
+		world.step( left, right, true, true );
+		PhysicState st = world.getState();
+		for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+		{
+			BOOST_REQUIRE( on_grid(st.blobPosition[p].x) && on_grid(st.blobPosition[p].y) );
+			BOOST_REQUIRE( on_grid(st.blobVelocity[p].x) && on_grid(st.blobVelocity[p].y) );
+			BOOST_REQUIRE( on_grid(st.blobState[p]) );
+		}
+		BOOST_REQUIRE( on_grid(st.ballPosition.x) && on_grid(st.ballPosition.y) );
+		BOOST_REQUIRE( on_grid(st.ballVelocity.x) && on_grid(st.ballVelocity.y) );
+		BOOST_REQUIRE( on_grid(st.ballRotation) );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( reproducible )
+{
+	int events_a, events_b;
+	BOOST_CHECK_EQUAL( run_world(20000, events_a), run_world(20000, events_b) );
+	BOOST_CHECK_EQUAL( events_a, events_b );
+	BOOST_CHECK( events_a > 0 );
+}
+
+// this checks that the results do not depend on platform, compiler or compiler settings.
+// if the deterministic physics are changed on purpose, the reference value has to be updated,
+// which makes old deterministic replays invalid.
+BOOST_AUTO_TEST_CASE( reference_result )
+{
+	int events;
+	uint64_t hash = run_world(20000, events);
+	BOOST_CHECK_EQUAL( hash, 7326890179872968877ull );
+	BOOST_CHECK_EQUAL( events, 1039 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
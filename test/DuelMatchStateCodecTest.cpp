@@ -0,0 +1,165 @@
+#define BOOST_TEST_MODULE DuelMatchStateCodec
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+
+#include "DuelMatchStateCodec.h"
+#include "PhysicWorld.h"
+#include "raknet/BitStream.h"
+
+void check_state_equal(const DuelMatchState& a, const DuelMatchState& b)
+{
+	// decoding has to be lossless, so compare the raw memory of the physic state
+	BOOST_CHECK_EQUAL( std::memcmp(&a.worldState, &b.worldState, sizeof(PhysicState)), 0 );
+	BOOST_CHECK_EQUAL( a.logicState.leftScore, b.logicState.leftScore );
+	BOOST_CHECK_EQUAL( a.logicState.rightScore, b.logicState.rightScore );
+	BOOST_CHECK_EQUAL( a.logicState.hitCount[LEFT_PLAYER], b.logicState.hitCount[LEFT_PLAYER] );
+	BOOST_CHECK_EQUAL( a.logicState.hitCount[RIGHT_PLAYER], b.logicState.hitCount[RIGHT_PLAYER] );
+	BOOST_CHECK_EQUAL( a.logicState.servingPlayer, b.logicState.servingPlayer );
+	BOOST_CHECK_EQUAL( a.logicState.winningPlayer, b.logicState.winningPlayer );
+	BOOST_CHECK_EQUAL( a.logicState.squish[LEFT_PLAYER], b.logicState.squish[LEFT_PLAYER] );
+	BOOST_CHECK_EQUAL( a.logicState.squish[RIGHT_PLAYER], b.logicState.squish[RIGHT_PLAYER] );
+	BOOST_CHECK_EQUAL( a.logicState.squishWall, b.logicState.squishWall );
+	BOOST_CHECK_EQUAL( a.logicState.squishGround, b.logicState.squishGround );
+	BOOST_CHECK_EQUAL( a.logicState.isGameRunning, b.logicState.isGameRunning );
+	BOOST_CHECK_EQUAL( a.logicState.isBallValid, b.logicState.isBallValid );
+	BOOST_CHECK( a.playerInput[LEFT_PLAYER] == b.playerInput[LEFT_PLAYER] );
+	BOOST_CHECK( a.playerInput[RIGHT_PLAYER] == b.playerInput[RIGHT_PLAYER] );
+}
+
+// a state as it could occur in a running match
+DuelMatchState make_state(const PhysicWorld& world, unsigned frame)
+{
+	DuelMatchState state;
+	state.worldState = world.getState();
+	state.logicState.leftScore = frame / 500;
+	state.logicState.rightScore = frame / 700;
+	state.logicState.hitCount[LEFT_PLAYER] = (frame / 100) % 3;
+	state.logicState.hitCount[RIGHT_PLAYER] = 0;
+	state.logicState.servingPlayer = (frame / 500) % 2 ? LEFT_PLAYER : RIGHT_PLAYER;
+	state.logicState.winningPlayer = NO_PLAYER;
+	state.logicState.squish[LEFT_PLAYER] = frame % 7;
+	state.logicState.squish[RIGHT_PLAYER] = 0;
+	state.logicState.squishWall = 0;
+	state.logicState.squishGround = frame % 300 < 10 ? frame % 300 : 0;
+	state.logicState.isGameRunning = true;
+	state.logicState.isBallValid = frame % 300 >= 10;
+	return state;
+}
+
+DuelMatchState roundtrip(const DuelMatchState& state, const DuelMatchState* baseline, unsigned frames, int* bits = nullptr)
+{
+	RakNet::BitStream stream;
+	DuelMatchStateCodec::encode(stream, state, baseline, frames);
+	if(bits)
+		*bits = stream.GetNumberOfBitsUsed();
+
+	DuelMatchState decoded;
+	BOOST_REQUIRE( DuelMatchStateCodec::decode(stream, decoded, baseline, frames) );
+	BOOST_CHECK_EQUAL( stream.GetNumberOfUnreadBits(), 0 );
+	return decoded;
+}
+
+BOOST_AUTO_TEST_SUITE( duel_match_state_codec )
+
+BOOST_AUTO_TEST_CASE( keyframe_roundtrip )
+{
+	PhysicWorld world;
+	DuelMatchState state = make_state(world, 0);
+	state.playerInput[LEFT_PLAYER] = PlayerInput(true, false, true);
+	check_state_equal( state, roundtrip(state, nullptr, 0) );
+
+	state.logicState.winningPlayer = RIGHT_PLAYER;
+	state.logicState.leftScore = 0xFFFFFFFF;
+	check_state_equal( state, roundtrip(state, nullptr, 0) );
+}
+
+// simulates a game and encodes every frame against the state a few frames earlier
+BOOST_AUTO_TEST_CASE( delta_roundtrip )
+{
+	PhysicWorld world;
+
+	DuelMatchStateCodec history;
+	int deltaBits = 0;
+	int keyframeBits = 0;
+	for(unsigned frame = 1; frame < 2000; ++frame)
+	{
+		PlayerInput left((frame / 30) % 3 == 0, (frame / 30) % 3 == 1, (frame / 11) % 4 == 0);
+		PlayerInput right((frame / 40) % 2 == 0, (frame / 40) % 2 == 1, (frame / 13) % 3 == 0);
+		world.step(left, right, true, true);
+
+		DuelMatchState state = make_state(world, frame);
+		state.playerInput[LEFT_PLAYER] = left;
+		state.playerInput[RIGHT_PLAYER] = right;
+		history.store(frame, state);
+
+		unsigned distance = 1 + frame % 4;
+		const DuelMatchState* baseline = history.find(frame - distance);
+		int bits;
+		check_state_equal( state, roundtrip(state, baseline, distance, &bits) );
+		if(baseline)
+			deltaBits += bits;
+		check_state_equal( state, roundtrip(state, nullptr, 0, &bits) );
+		keyframeBits += bits;
+	}
+
+	// delta encoding should be considerably smaller than keyframes
+	BOOST_CHECK_LT( deltaBits * 3, keyframeBits );
+}
+
+BOOST_AUTO_TEST_CASE( unchanged_state )
+{
+	PhysicWorld world;
+	DuelMatchState state = make_state(world, 0);
+	int bits;
+	roundtrip(state, &state, 0, &bits);
+	// a single bit per field, and the checksum
+	BOOST_CHECK_EQUAL( bits, 30 + DuelMatchStateCodec::CHECKSUM_BITS );
+}
+
+// a receiver whose baseline differs from the one of the sender notices that
+BOOST_AUTO_TEST_CASE( baseline_mismatch )
+{
+	PhysicWorld world;
+	DuelMatchState state = make_state(world, 0);
+	DuelMatchState other = state;
+	other.worldState.ballPosition.x += 0.001f;
+
+	RakNet::BitStream stream;
+	DuelMatchStateCodec::encode(stream, state, &state, 0);
+	DuelMatchState decoded;
+	BOOST_CHECK( !DuelMatchStateCodec::decode(stream, decoded, &other, 0) );
+}
+
+BOOST_AUTO_TEST_CASE( truncated_stream )
+{
+	PhysicWorld world;
+	DuelMatchState state = make_state(world, 0);
+
+	RakNet::BitStream stream;
+	DuelMatchStateCodec::encode(stream, state, nullptr, 0);
+	RakNet::BitStream truncated(reinterpret_cast<char*>(stream.GetData()), stream.GetNumberOfBytesUsed() / 2, false);
+	DuelMatchState decoded;
+	BOOST_CHECK( !DuelMatchStateCodec::decode(truncated, decoded, nullptr, 0) );
+}
+
+BOOST_AUTO_TEST_CASE( history )
+{
+	DuelMatchStateCodec history;
+	DuelMatchState state;
+	BOOST_CHECK( history.find(0) == nullptr );
+	BOOST_CHECK( history.find(5) == nullptr );
+
+	history.store(5, state);
+	BOOST_CHECK( history.find(5) != nullptr );
+	BOOST_CHECK( history.find(5 + DuelMatchStateCodec::HISTORY_SIZE) == nullptr );
+
+	history.store(5 + DuelMatchStateCodec::HISTORY_SIZE, state);
+	BOOST_CHECK( history.find(5) == nullptr );
+	BOOST_CHECK( history.find(5 + DuelMatchStateCodec::HISTORY_SIZE) != nullptr );
+
+	history.clear();
+	BOOST_CHECK( history.find(5 + DuelMatchStateCodec::HISTORY_SIZE) == nullptr );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
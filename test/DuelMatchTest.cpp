@@ -0,0 +1,154 @@
+#define BOOST_TEST_MODULE DuelMatch
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <random>
+
+#include "DuelMatch.h"
+#include "DuelMatchState.h"
+#include "GameLogic.h"
+#include "InputSource.h"
+#include "MatchEvents.h"
+
+#include "AllocationCounter.h"
+#include "FileSystemFixture.h"
+
+const char TEST_NAME[] = "DuelMatchTest";
+
+/// a match with input sources that are controlled by the test
+struct TestMatch
+{
+	explicit TestMatch(bool lua) : match(false, "default.lua", 1000)
+	{
+		if(lua)
+			match.setGameLogic( createLuaGameLogic("default.lua", &match, 1000) );
+		for(int i = 0; i < MAX_PLAYERS; ++i)
+			input[i] = std::make_shared<InputSource>();
+		match.setInputSources(input[LEFT_PLAYER], input[RIGHT_PLAYER]);
+	}
+
+	// steps the match with random input
+	void step(std::mt19937& gen)
+	{
+		std::uniform_int_distribution<int> dist(0, 7);
+		for(auto& source : input)
+		{
+			PlayerInput ip;
+			ip.setAll( dist(gen) );
+			source->setInput( ip );
+		}
+		match.step();
+	}
+
+	DuelMatch match;
+	std::shared_ptr<InputSource> input[MAX_PLAYERS];
+};
+
+BOOST_AUTO_TEST_SUITE( match_event_buffer )
+
+BOOST_AUTO_TEST_CASE( push_and_clear )
+{
+	MatchEventBuffer buffer;
+	BOOST_CHECK( buffer.empty() );
+	BOOST_CHECK( buffer.begin() == buffer.end() );
+
+	buffer.push_back( MatchEvent(MatchEvent::BALL_HIT_BLOB, LEFT_PLAYER, 2.f) );
+	buffer.emplace_back( MatchEvent::BALL_HIT_GROUND, RIGHT_PLAYER );
+	BOOST_REQUIRE_EQUAL( buffer.size(), 2u );
+	BOOST_CHECK_EQUAL( buffer[0].event, MatchEvent::BALL_HIT_BLOB );
+	BOOST_CHECK_EQUAL( buffer[0].intensity, 2.f );
+	BOOST_CHECK_EQUAL( buffer[1].event, MatchEvent::BALL_HIT_GROUND );
+	BOOST_CHECK_EQUAL( buffer[1].side, RIGHT_PLAYER );
+
+	buffer.clear();
+	BOOST_CHECK( buffer.empty() );
+	BOOST_CHECK( buffer.begin() == buffer.end() );
+}
+
+BOOST_AUTO_TEST_CASE( overflow_keeps_newest )
+{
+	MatchEventBuffer buffer;
+	const unsigned CAPACITY = MatchEventBuffer::CAPACITY;
+	const unsigned PUSHED = CAPACITY + 5;
+	for(unsigned i = 0; i < PUSHED; ++i)
+		buffer.emplace_back( MatchEvent::BALL_HIT_BLOB, LEFT_PLAYER, float(i) );
+
+	BOOST_REQUIRE_EQUAL( buffer.size(), CAPACITY );
+	float expected = PUSHED - CAPACITY;
+	for(const auto& event : buffer)
+	{
+		BOOST_CHECK_EQUAL( event.intensity, expected );
+		expected += 1;
+	}
+	BOOST_CHECK_EQUAL( expected, float(PUSHED) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_FIXTURE_TEST_SUITE( duel_match, FileSystemFixture<TEST_NAME> )
+
+BOOST_AUTO_TEST_CASE( state_in_place )
+{
+	TestMatch test(false);
+	std::mt19937 gen(3);
+	DuelMatchState state;
+	for(int i = 0; i < 1000; ++i)
+	{
+		test.step(gen);
+		test.match.getState(state);
+		DuelMatchState copy = test.match.getState();
+		BOOST_REQUIRE_EQUAL( state.getBallPosition().x, copy.getBallPosition().x );
+		BOOST_REQUIRE_EQUAL( state.getBallPosition().y, copy.getBallPosition().y );
+		BOOST_REQUIRE_EQUAL( state.getBlobPosition(RIGHT_PLAYER).x, copy.getBlobPosition(RIGHT_PLAYER).x );
+		BOOST_REQUIRE_EQUAL( state.getHitcount(LEFT_PLAYER), copy.getHitcount(LEFT_PLAYER) );
+		BOOST_REQUIRE_EQUAL( state.getScore(LEFT_PLAYER), copy.getScore(LEFT_PLAYER) );
+		BOOST_REQUIRE( state.playerInput[LEFT_PLAYER] == copy.playerInput[LEFT_PLAYER] );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( events )
+{
+	TestMatch test(false);
+	std::mt19937 gen(11);
+	int hits = 0;
+	int resets = 0;
+	for(int i = 0; i < 5000; ++i)
+	{
+		test.step(gen);
+		for(const auto& event : test.match.getEvents())
+		{
+			hits += event.event == MatchEvent::BALL_HIT_BLOB;
+			resets += event.event == MatchEvent::RESET_BALL;
+		}
+	}
+	BOOST_CHECK_GT( hits, 0 );
+	BOOST_CHECK_GT( resets, 0 );
+
+	// external events show up after the next step, and resimulate leaves them pending
+	test.match.trigger( MatchEvent(MatchEvent::PLAYER_ERROR, LEFT_PLAYER) );
+	test.match.resimulate();
+	test.match.updateEvents();
+	BOOST_REQUIRE_EQUAL( test.match.getEvents().size(), 1u );
+	BOOST_CHECK_EQUAL( test.match.getEvents()[0].event, MatchEvent::PLAYER_ERROR );
+}
+
+BOOST_AUTO_TEST_CASE( no_allocations )
+{
+	for(bool lua : {false, true})
+	{
+		BOOST_TEST_CONTEXT( (lua ? "lua rules" : "native rules") )
+		{
+			TestMatch test(lua);
+			std::mt19937 gen(5);
+			for(int i = 0; i < 100; ++i)
+				test.step(gen);
+
+			unsigned long before = g_allocations;
+			for(int i = 0; i < 20000; ++i)
+				test.step(gen);
+			BOOST_CHECK_EQUAL( g_allocations - before, 0u );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
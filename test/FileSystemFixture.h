@@ -0,0 +1,23 @@
+#pragma once
+
+#include "FileSystem.h"
+
+// path to the data directory, relative to the directory the test is run from
+#ifndef TEST_DATA_PATH
+#define TEST_DATA_PATH "../data"
+#endif
+
+// Sets up the file system for the tests that load scripts from the data directory.
+// NAME is the name of the test program, e.g. declared as
+//	const char TEST_NAME[] = "RulesCacheTest";
+// and used as BOOST_FIXTURE_TEST_SUITE( suite, FileSystemFixture<TEST_NAME> ).
+template<const char* NAME>
+struct FileSystemFixture
+{
+	FileSystemFixture() : fs(NAME)
+	{
+		fs.addToSearchPath(TEST_DATA_PATH);
+	}
+
+	FileSystem fs;
+};
@@ -0,0 +1,90 @@
+#define BOOST_TEST_MODULE LatencyHistogram
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "loadgen/LatencyHistogram.h"
+
+BOOST_AUTO_TEST_SUITE( latency_histogram )
+
+BOOST_AUTO_TEST_CASE( empty )
+{
+	LatencyHistogram histogram;
+	BOOST_CHECK_EQUAL( histogram.getCount(), 0u );
+	BOOST_CHECK_EQUAL( histogram.getMaximum(), 0u );
+	BOOST_CHECK_EQUAL( histogram.getMean(), 0.0 );
+	BOOST_CHECK_EQUAL( histogram.getPercentile(50), 0u );
+	BOOST_CHECK_EQUAL( histogram.getPercentile(100), 0u );
+}
+
+BOOST_AUTO_TEST_CASE( small_values_are_exact )
+{
+	LatencyHistogram histogram;
+	for(std::uint64_t value = 0; value < 100; ++value)
+		histogram.add(value);
+
+	BOOST_CHECK_EQUAL( histogram.getCount(), 100u );
+	BOOST_CHECK_EQUAL( histogram.getMaximum(), 99u );
+	BOOST_CHECK_CLOSE( histogram.getMean(), 49.5, 1e-9 );
+	BOOST_CHECK_EQUAL( histogram.getPercentile(0), 0u );
+	BOOST_CHECK_EQUAL( histogram.getPercentile(1), 0u );
+	BOOST_CHECK_EQUAL( histogram.getPercentile(50), 49u );
+	BOOST_CHECK_EQUAL( histogram.getPercentile(99), 98u );
+	BOOST_CHECK_EQUAL( histogram.getPercentile(100), 99u );
+}
+
+BOOST_AUTO_TEST_CASE( bounded_relative_error )
+{
+	std::mt19937_64 gen(3);
+	std::lognormal_distribution<double> dist(9, 2);
+	std::vector<std::uint64_t> samples;
+	LatencyHistogram histogram;
+	for(int i = 0; i < 100000; ++i)
+	{
+		samples.push_back( std::uint64_t(dist(gen)) );
+		histogram.add( samples.back() );
+	}
+	std::sort(samples.begin(), samples.end());
+
+	for(double percent : {10.0, 50.0, 90.0, 99.0, 99.9})
+	{
+		BOOST_TEST_CONTEXT( percent << "th percentile" )
+		{
+			std::uint64_t exact = samples[ std::size_t(percent / 100 * samples.size()) - 1 ];
+			std::uint64_t estimate = histogram.getPercentile(percent);
+			BOOST_CHECK_GE( estimate, exact );
+			BOOST_CHECK_LE( estimate, exact + exact / LatencyHistogram::SUB_BUCKETS );
+		}
+	}
+	BOOST_CHECK_EQUAL( histogram.getPercentile(100), samples.back() );
+	BOOST_CHECK_EQUAL( histogram.getMaximum(), samples.back() );
+}
+
+BOOST_AUTO_TEST_CASE( merge )
+{
+	LatencyHistogram low, high, both;
+	for(std::uint64_t value = 1; value <= 1000; ++value)
+	{
+		low.add(value);
+		high.add(value * 1000);
+		both.add(value);
+		both.add(value * 1000);
+	}
+
+	low.merge(high);
+	BOOST_CHECK_EQUAL( low.getCount(), both.getCount() );
+	BOOST_CHECK_EQUAL( low.getMaximum(), 1000000u );
+	BOOST_CHECK_CLOSE( low.getMean(), both.getMean(), 1e-9 );
+	for(double percent : {25.0, 50.0, 75.0, 99.0})
+		BOOST_CHECK_EQUAL( low.getPercentile(percent), both.getPercentile(percent) );
+
+	// merging into an empty histogram copies it
+	LatencyHistogram empty;
+	empty.merge(both);
+	BOOST_CHECK_EQUAL( empty.getPercentile(50), both.getPercentile(50) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
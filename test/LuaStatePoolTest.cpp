@@ -0,0 +1,143 @@
+#define BOOST_TEST_MODULE LuaStatePool
+#include <boost/test/unit_test.hpp>
+
+#include "lua.hpp"
+#include "FileWrite.h"
+#include "GameLogic.h"
+#include "LuaStatePool.h"
+#include "RulesCache.h"
+
+#include "FileSystemFixture.h"
+
+const char TEST_NAME[] = "LuaStatePoolTest";
+
+bool has_global(lua_State* state, const char* name)
+{
+	lua_getglobal(state, name);
+	bool result = !lua_isnil(state, -1);
+	lua_pop(state, 1);
+	return result;
+}
+
+BOOST_FIXTURE_TEST_SUITE( lua_state_pool, FileSystemFixture<TEST_NAME> )
+
+BOOST_AUTO_TEST_CASE( without_pool )
+{
+	auto logic = createGameLogic("default.lua", nullptr, 15);
+	BOOST_CHECK_EQUAL( logic->getSourceFile(), "default.lua" );
+	BOOST_CHECK_NE( logic->getTitle(), "untitled script" );
+}
+
+BOOST_AUTO_TEST_CASE( reset_globals )
+{
+	LuaStatePool pool;
+	int setups = 0;
+	auto setup = [&setups](lua_State* state)
+	{
+		++setups;
+		lua_pushnumber(state, 5);
+		lua_setglobal(state, "SETUP_VALUE");
+	};
+
+	lua_State* state = LuaStatePool::acquire("test", {"rules/default"}, setup);
+	BOOST_CHECK( !has_global(state, "__TITLE__") );
+	BOOST_REQUIRE_EQUAL( LuaStatePool::runScripts(state), 0 );
+	BOOST_CHECK( has_global(state, "__TITLE__") );
+
+	lua_pushnumber(state, 1);
+	lua_setglobal(state, "ADDED_VALUE");
+	lua_pushnil(state);
+	lua_setglobal(state, "SETUP_VALUE");
+	LuaStatePool::release(state);
+
+	// we get the same state back, in the state it was after the setup
+	lua_State* second = LuaStatePool::acquire("test", {"rules/default"}, setup);
+	BOOST_CHECK_EQUAL( second, state );
+	BOOST_CHECK_EQUAL( setups, 1 );
+	BOOST_CHECK( !has_global(second, "__TITLE__") );
+	BOOST_CHECK( !has_global(second, "ADDED_VALUE") );
+	BOOST_CHECK( has_global(second, "SETUP_VALUE") );
+
+	// another script list is a different kind of state
+	lua_State* third = LuaStatePool::acquire("test", {"rules/blitz"}, setup);
+	BOOST_CHECK_NE( third, second );
+	BOOST_CHECK_EQUAL( setups, 2 );
+
+	LuaStatePool::release(second);
+	LuaStatePool::release(third);
+
+	auto stats = pool.getStatistics();
+	BOOST_CHECK_EQUAL( stats.acquired, 3u );
+	BOOST_CHECK_EQUAL( stats.hits, 1u );
+	BOOST_CHECK_EQUAL( stats.idle, 2u );
+}
+
+BOOST_AUTO_TEST_CASE( reuse_game_logic )
+{
+	LuaStatePool pool(1);
+	std::string title;
+	for(int i = 0; i < 3; ++i)
+	{
+		auto first = createLuaGameLogic("default.lua", nullptr, 15);
+		auto second = createLuaGameLogic("default.lua", nullptr, 15);
+		if(i == 0)
+			title = first->getTitle();
+		BOOST_CHECK_EQUAL( first->getTitle(), title );
+		BOOST_CHECK_EQUAL( second->getTitle(), title );
+	}
+
+	auto stats = pool.getStatistics();
+	BOOST_CHECK_EQUAL( stats.acquired, 6u );
+	// only one state is kept, so the second logic in each round needs a new one
+	BOOST_CHECK_EQUAL( stats.hits, 2u );
+	BOOST_CHECK_EQUAL( stats.discarded, 3u );
+	BOOST_CHECK_EQUAL( stats.idle, 1u );
+}
+
+// a script that changed in the rules cache must not run from a pooled state of the old version
+BOOST_AUTO_TEST_CASE( reload_changed_script )
+{
+	fs.setWriteDir(".");
+	fs.addToSearchPath(".", false);
+	auto write = [](const char* source)
+	{
+		FileWrite file("pool_reload.lua");
+		file.write(std::string(source));
+	};
+	auto value = [](lua_State* state)
+	{
+		BOOST_REQUIRE_EQUAL( LuaStatePool::runScripts(state), 0 );
+		lua_getglobal(state, "VALUE");
+		int result = lua_tointeger(state, -1);
+		lua_pop(state, 1);
+		return result;
+	};
+
+	RulesCache cache;
+	LuaStatePool pool;
+	int setups = 0;
+	auto setup = [&setups](lua_State*) { ++setups; };
+
+	write("VALUE = 1");
+	cache.load("pool_reload.lua");
+	lua_State* state = LuaStatePool::acquire("test", {"pool_reload"}, setup);
+	BOOST_CHECK_EQUAL( value(state), 1 );
+	LuaStatePool::release(state);
+
+	// unchanged, so the state is reused
+	state = LuaStatePool::acquire("test", {"pool_reload"}, setup);
+	BOOST_CHECK_EQUAL( value(state), 1 );
+	BOOST_CHECK_EQUAL( setups, 1 );
+	LuaStatePool::release(state);
+
+	write("VALUE = 2");
+	cache.load("pool_reload.lua");
+	state = LuaStatePool::acquire("test", {"pool_reload"}, setup);
+	BOOST_CHECK_EQUAL( value(state), 2 );
+	BOOST_CHECK_EQUAL( setups, 2 );
+	LuaStatePool::release(state);
+
+	fs.deleteFile("pool_reload.lua");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,94 @@
+#define BOOST_TEST_MODULE MPSCQueue
+#include <boost/test/unit_test.hpp>
+
+#include <thread>
+#include <vector>
+
+#include "MPSCQueue.h"
+
+BOOST_AUTO_TEST_SUITE( mpsc_queue )
+
+BOOST_AUTO_TEST_CASE( capacity_is_power_of_two )
+{
+	BOOST_CHECK_EQUAL( MPSCQueue<int>(0).capacity(), 2u );
+	BOOST_CHECK_EQUAL( MPSCQueue<int>(5).capacity(), 8u );
+	BOOST_CHECK_EQUAL( MPSCQueue<int>(64).capacity(), 64u );
+}
+
+BOOST_AUTO_TEST_CASE( fifo_order )
+{
+	MPSCQueue<int> queue(8);
+	int value = -1;
+	BOOST_CHECK( !queue.pop(value) );
+
+	for(int round = 0; round < 3; ++round)
+	{
+		for(int i = 0; i < 5; ++i)
+			BOOST_CHECK( queue.push(i) );
+		for(int i = 0; i < 5; ++i)
+		{
+			BOOST_REQUIRE( queue.pop(value) );
+			BOOST_CHECK_EQUAL( value, i );
+		}
+		BOOST_CHECK( !queue.pop(value) );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( push_fails_when_full )
+{
+	MPSCQueue<int> queue(4);
+	for(int i = 0; i < 4; ++i)
+		BOOST_CHECK( queue.push(i) );
+	BOOST_CHECK( !queue.push(4) );
+
+	int value = -1;
+	BOOST_REQUIRE( queue.pop(value) );
+	BOOST_CHECK_EQUAL( value, 0 );
+	BOOST_CHECK( queue.push(4) );
+}
+
+// several producers push increasing numbers concurrently to a small queue, the consumer
+// has to get every number exactly once and in order for each producer.
+BOOST_AUTO_TEST_CASE( multiple_producers )
+{
+	const int PRODUCERS = 4;
+	const int COUNT = 100000;
+
+	MPSCQueue<int> queue(16);
+	std::vector<std::thread> producers;
+	for(int p = 0; p < PRODUCERS; ++p)
+	{
+		producers.emplace_back([&queue, p]()
+		{
+			for(int i = 0; i < COUNT; ++i)
+			{
+				while( !queue.push(p * COUNT + i) )
+					std::this_thread::yield();
+			}
+		});
+	}
+
+	std::vector<int> next(PRODUCERS, 0);
+	int received = 0;
+	while( received < PRODUCERS * COUNT )
+	{
+		int value;
+		if( !queue.pop(value) )
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		int producer = value / COUNT;
+		BOOST_REQUIRE_EQUAL( value % COUNT, next[producer] );
+		++next[producer];
+		++received;
+	}
+
+	for(auto& t : producers)
+		t.join();
+
+	int value;
+	BOOST_CHECK( !queue.pop(value) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,180 @@
+#define BOOST_TEST_MODULE NativeGameLogic
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "DuelMatch.h"
+#include "DuelMatchState.h"
+#include "GameLogicState.h"
+#include "GameLogic.h"
+#include "InputSource.h"
+#include "NativeGameLogic.h"
+#include "RulesCache.h"
+
+#include "FileSystemFixture.h"
+
+const char* const BUNDLED_RULES[] = {"default.lua", "classic.lua", "blitz.lua", "firewall.lua",
+	"jumping_jack.lua", "one_hit_wonder.lua", "sticky_mode.lua", "the_double.lua",
+	"back_defence.lua", "tennis.lua"};
+
+const int SCORE_TO_WIN = 5;
+const int RALLIES = 2000;
+
+const char TEST_NAME[] = "NativeGameLogicTest";
+
+/// a match running the lua version of the rules, and one running the native version,
+/// which get the same input.
+struct MatchPair
+{
+	explicit MatchPair(const std::string& rules) :
+		lua(false, rules, SCORE_TO_WIN), native(false, rules, SCORE_TO_WIN)
+	{
+		lua.setGameLogic( createLuaGameLogic(rules, &lua, SCORE_TO_WIN) );
+		for(int i = 0; i < MAX_PLAYERS; ++i)
+		{
+			luaInput[i] = std::make_shared<InputSource>();
+			nativeInput[i] = std::make_shared<InputSource>();
+		}
+		lua.setInputSources(luaInput[LEFT_PLAYER], luaInput[RIGHT_PLAYER]);
+		native.setInputSources(nativeInput[LEFT_PLAYER], nativeInput[RIGHT_PLAYER]);
+	}
+
+	void setInput(PlayerSide side, PlayerInput ip)
+	{
+		luaInput[side]->setInput(ip);
+		nativeInput[side]->setInput(ip);
+	}
+
+	DuelMatch lua;
+	DuelMatch native;
+	std::shared_ptr<InputSource> luaInput[MAX_PLAYERS];
+	std::shared_ptr<InputSource> nativeInput[MAX_PLAYERS];
+};
+
+std::string to_string(const GameLogicState& state)
+{
+	std::ostringstream stream;
+	stream << state;
+	return stream.str();
+}
+
+void check_equal(const DuelMatch& lua, const DuelMatch& native)
+{
+	BOOST_REQUIRE_EQUAL( lua.getScore(LEFT_PLAYER), native.getScore(LEFT_PLAYER) );
+	BOOST_REQUIRE_EQUAL( lua.getScore(RIGHT_PLAYER), native.getScore(RIGHT_PLAYER) );
+	BOOST_REQUIRE_EQUAL( lua.getScoreToWin(), native.getScoreToWin() );
+	BOOST_REQUIRE_EQUAL( lua.winningPlayer(), native.winningPlayer() );
+
+	auto ls = lua.getState();
+	auto ns = native.getState();
+	BOOST_REQUIRE_EQUAL( to_string(ls.logicState), to_string(ns.logicState) );
+	for(int i = 0; i < MAX_PLAYERS; ++i)
+	{
+		BOOST_REQUIRE( ls.playerInput[i] == ns.playerInput[i] );
+		BOOST_REQUIRE_EQUAL( ls.worldState.blobPosition[i].x, ns.worldState.blobPosition[i].x );
+		BOOST_REQUIRE_EQUAL( ls.worldState.blobPosition[i].y, ns.worldState.blobPosition[i].y );
+	}
+	BOOST_REQUIRE_EQUAL( ls.worldState.ballPosition.x, ns.worldState.ballPosition.x );
+	BOOST_REQUIRE_EQUAL( ls.worldState.ballPosition.y, ns.worldState.ballPosition.y );
+}
+
+BOOST_FIXTURE_TEST_SUITE( native_game_logic, FileSystemFixture<TEST_NAME> )
+
+BOOST_AUTO_TEST_CASE( bundled_rules_are_native )
+{
+	for( auto rules : BUNDLED_RULES )
+	{
+		BOOST_TEST_CONTEXT( rules )
+		{
+			auto native = createNativeGameLogic(rules, nullptr, SCORE_TO_WIN);
+			BOOST_REQUIRE( native );
+			auto lua = createLuaGameLogic(rules, nullptr, SCORE_TO_WIN);
+			BOOST_CHECK_EQUAL( native->getSourceFile(), lua->getSourceFile() );
+			BOOST_CHECK_EQUAL( native->getTitle(), lua->getTitle() );
+			BOOST_CHECK_EQUAL( native->getAuthor(), lua->getAuthor() );
+			BOOST_CHECK_EQUAL( native->getScoreToWin(), lua->getScoreToWin() );
+			BOOST_CHECK_EQUAL( native->clone()->getScoreToWin(), lua->clone()->getScoreToWin() );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( cached_checksum )
+{
+	RulesCache cache;
+	cache.loadAll();
+	BOOST_CHECK( createNativeGameLogic("tennis", nullptr, SCORE_TO_WIN) );
+}
+
+BOOST_AUTO_TEST_CASE( unknown_rules )
+{
+	BOOST_CHECK( !createNativeGameLogic("does_not_exist.lua", nullptr, SCORE_TO_WIN) );
+	// api.lua exists, but is no rules script
+	BOOST_CHECK( !createNativeGameLogic("../api.lua", nullptr, SCORE_TO_WIN) );
+}
+
+// plays the same random rallies with the lua and the native rules
+BOOST_AUTO_TEST_CASE( same_scoring_as_lua )
+{
+	std::mt19937 gen(42);
+	std::uniform_int_distribution<int> hold(1, 30);
+	std::bernoulli_distribution press(0.5);
+	std::uniform_real_distribution<float> kick(-12.f, 12.f);
+
+	for( auto rules : BUNDLED_RULES )
+	{
+		BOOST_TEST_CONTEXT( rules )
+		{
+			MatchPair match(rules);
+
+			int rallies = 0;
+			int games = 0;
+			int remaining[MAX_PLAYERS] = {0, 0};
+			while( rallies < RALLIES )
+			{
+				// hold random inputs for a random number of steps
+				for(int i = 0; i < MAX_PLAYERS; ++i)
+				{
+					if( --remaining[i] > 0 )
+						continue;
+					remaining[i] = hold(gen);
+					match.setInput( (PlayerSide)i, PlayerInput(press(gen), press(gen), press(gen)) );
+				}
+
+				// occasionally kick the ball, so it reaches the walls and the net more often
+				if( gen() % 200 == 0 )
+				{
+					Vector2 velocity(kick(gen), kick(gen));
+					for( DuelMatch* m : {&match.lua, &match.native} )
+					{
+						auto state = m->getState();
+						state.worldState.ballVelocity = velocity;
+						m->setState(state);
+					}
+				}
+
+				bool was_valid = !match.native.getBallDown();
+				match.lua.step();
+				match.native.step();
+				check_equal(match.lua, match.native);
+
+				if( was_valid && match.native.getBallDown() )
+					++rallies;
+
+				if( match.native.winningPlayer() != NO_PLAYER )
+				{
+					++games;
+					match.lua.reset();
+					match.native.reset();
+					check_equal(match.lua, match.native);
+				}
+			}
+
+			BOOST_TEST_MESSAGE( rules << ": " << rallies << " rallies, " << games << " games" );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,147 @@
+#define BOOST_TEST_MODULE PhysicWorldBatch
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <vector>
+#include <cstring>
+
+#include "PhysicWorld.h"
+#include "PhysicWorldBatch.h"
+#include "GameConstants.h"
+
+#include "AllocationCounter.h"
+
+void check_state_equal(const PhysicState& a, const PhysicState& b)
+{
+	// we want bit-identical results, so compare the raw memory
+	for(int p = LEFT_PLAYER; p < MAX_PLAYERS; ++p)
+	{
+		BOOST_CHECK_EQUAL( std::memcmp(&a.blobPosition[p], &b.blobPosition[p], sizeof(Vector2)), 0 );
+		BOOST_CHECK_EQUAL( std::memcmp(&a.blobVelocity[p], &b.blobVelocity[p], sizeof(Vector2)), 0 );
+		BOOST_CHECK_EQUAL( std::memcmp(&a.blobState[p], &b.blobState[p], sizeof(float)), 0 );
+	}
+	BOOST_CHECK_EQUAL( std::memcmp(&a.ballPosition, &b.ballPosition, sizeof(Vector2)), 0 );
+	BOOST_CHECK_EQUAL( std::memcmp(&a.ballVelocity, &b.ballVelocity, sizeof(Vector2)), 0 );
+	BOOST_CHECK_EQUAL( std::memcmp(&a.ballRotation, &b.ballRotation, sizeof(float)), 0 );
+	BOOST_CHECK_EQUAL( std::memcmp(&a.ballAngularVelocity, &b.ballAngularVelocity, sizeof(float)), 0 );
+}
+
+BOOST_AUTO_TEST_SUITE( physic_world_batch )
+
+BOOST_AUTO_TEST_CASE( initial_state )
+{
+	PhysicWorld world;
+	PhysicWorldBatch batch(3);
+	for(unsigned i = 0; i < batch.size(); ++i)
+		check_state_equal(world.getState(), batch.getState(i));
+}
+
+// runs a number of worlds with random inputs and random ball resets both as single PhysicWorlds
+// and as one batch and checks that states and events are the same after every step.
+BOOST_AUTO_TEST_CASE( bit_identical_to_physic_world )
+{
+	const unsigned WORLDS = 17;
+	const int STEPS = 20000;
+
+	std::mt19937 gen(5011);
+	std::uniform_int_distribution<int> input_dist(0, 7);
+	std::uniform_real_distribution<float> xdist(LEFT_PLANE, RIGHT_PLANE);
+	std::uniform_real_distribution<float> ydist(100, GROUND_PLANE_HEIGHT_MAX);
+	std::uniform_real_distribution<float> vdist(-15, 15);
+
+	std::vector<PhysicWorld> worlds(WORLDS);
+	PhysicWorldBatch batch(WORLDS);
+	std::vector<MatchEventBuffer> single_events(WORLDS);
+	std::vector<MatchEventBuffer> batch_events(WORLDS);
+	for(unsigned i = 0; i < WORLDS; ++i)
+	{
+		worlds[i].setEventBuffer( &single_events[i] );
+		batch.setEventBuffer( i, &batch_events[i] );
+	}
+
+	std::vector<PhysicWorldBatch::StepInput> inputs(WORLDS);
+
+	for(int step = 0; step < STEPS; ++step)
+	{
+		for(unsigned i = 0; i < WORLDS; ++i)
+		{
+			auto& in = inputs[i];
+			in.input[LEFT_PLAYER].setAll( input_dist(gen) );
+			in.input[RIGHT_PLAYER].setAll( input_dist(gen) );
+			in.isBallValid = (step / 200 + i) % 5 != 0;
+			in.isGameRunning = (step / 300 + i) % 7 != 0;
+
+			// every now and then, throw the ball somewhere random to get all kinds of collisions
+			if( (step + 13 * i) % 150 == 0 )
+			{
+				Vector2 pos{xdist(gen), ydist(gen)};
+				Vector2 vel{vdist(gen), vdist(gen)};
+				worlds[i].setBallPosition( pos );
+				worlds[i].setBallVelocity( vel );
+				batch.setBallPosition( i, pos );
+				batch.setBallVelocity( i, vel );
+			}
+
+			worlds[i].step( in.input[LEFT_PLAYER], in.input[RIGHT_PLAYER], in.isBallValid, in.isGameRunning );
+		}
+
+		batch.step( inputs.data() );
+
+		for(unsigned i = 0; i < WORLDS; ++i)
+		{
+			check_state_equal( worlds[i].getState(), batch.getState(i) );
+
+			BOOST_REQUIRE_EQUAL( single_events[i].size(), batch_events[i].size() );
+			for(unsigned e = 0; e < single_events[i].size(); ++e)
+			{
+				BOOST_CHECK_EQUAL( single_events[i][e].event, batch_events[i][e].event );
+				BOOST_CHECK_EQUAL( single_events[i][e].side, batch_events[i][e].side );
+				BOOST_CHECK_EQUAL( std::memcmp(&single_events[i][e].intensity, &batch_events[i][e].intensity, sizeof(float)), 0 );
+			}
+			single_events[i].clear();
+			batch_events[i].clear();
+		}
+	}
+}
+
+// stepping produces events, which go to the buffers without any allocation
+BOOST_AUTO_TEST_CASE( step_does_not_allocate )
+{
+	const unsigned WORLDS = 8;
+	PhysicWorldBatch batch(WORLDS);
+	std::vector<MatchEventBuffer> events(WORLDS);
+	for(unsigned i = 0; i < WORLDS; ++i)
+		batch.setEventBuffer( i, &events[i] );
+
+	std::vector<PhysicWorldBatch::StepInput> inputs(WORLDS);
+	for(unsigned i = 0; i < WORLDS; ++i)
+		inputs[i].input[LEFT_PLAYER] = PlayerInput(i % 2, !(i % 2), true);
+
+	unsigned long before = g_allocations;
+	unsigned int count = 0;
+	for(int step = 0; step < 500; ++step)
+	{
+		batch.step( inputs.data() );
+		for(auto& buffer : events)
+		{
+			count += buffer.size();
+			buffer.clear();
+		}
+	}
+	BOOST_CHECK_EQUAL( g_allocations - before, 0u );
+	BOOST_CHECK_GT( count, 0u );
+}
+
+BOOST_AUTO_TEST_CASE( set_state_roundtrip )
+{
+	PhysicWorld world;
+	for(int i = 0; i < 100; ++i)
+		world.step( PlayerInput(false, true, true), PlayerInput(true, false, i % 2), true, true );
+
+	PhysicWorldBatch batch(2);
+	batch.setState(1, world.getState());
+	check_state_equal(world.getState(), batch.getState(1));
+	check_state_equal(PhysicWorld().getState(), batch.getState(0));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+#define BOOST_TEST_MODULE Rating
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <vector>
+
+#include "tournament/Rating.h"
+
+// adds \p wins wins, \p draws draws and \p losses losses of \p first against \p second
+void addGames(std::vector<GameRecord>& games, unsigned int first, unsigned int second, int wins, int draws, int losses)
+{
+	for(int i = 0; i < wins; ++i)
+		games.push_back( GameRecord{first, second, 1.0} );
+	for(int i = 0; i < draws; ++i)
+		games.push_back( GameRecord{second, first, 0.5} );
+	for(int i = 0; i < losses; ++i)
+		games.push_back( GameRecord{second, first, 1.0} );
+}
+
+BOOST_AUTO_TEST_SUITE( rating )
+
+BOOST_AUTO_TEST_CASE( no_games )
+{
+	auto ratings = estimateRatings(3, {});
+	BOOST_REQUIRE_EQUAL( ratings.size(), 3u );
+	for(const auto& r : ratings)
+	{
+		BOOST_CHECK_EQUAL( r.elo, 0.0 );
+		BOOST_CHECK_EQUAL( r.games, 0u );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( equal_players )
+{
+	std::vector<GameRecord> games;
+	addGames(games, 0, 1, 10, 0, 10);
+	auto ratings = estimateRatings(2, games);
+	BOOST_CHECK_SMALL( ratings[0].elo, 1e-6 );
+	BOOST_CHECK_SMALL( ratings[1].elo, 1e-6 );
+	BOOST_CHECK_EQUAL( ratings[0].games, 20u );
+	BOOST_CHECK_EQUAL( ratings[0].score, 10.0 );
+	BOOST_CHECK_LT( ratings[0].lower, 0.0 );
+	BOOST_CHECK_GT( ratings[0].upper, 0.0 );
+}
+
+// a player that scores 75% is about 191 Elo better. The virtual games pull this slightly towards zero.
+BOOST_AUTO_TEST_CASE( elo_scale )
+{
+	std::vector<GameRecord> games;
+	addGames(games, 0, 1, 750, 0, 250);
+	auto ratings = estimateRatings(2, games, 0);
+	double difference = ratings[0].elo - ratings[1].elo;
+	BOOST_CHECK_CLOSE( difference, 400 * std::log10(3.0), 1.0 );
+	BOOST_CHECK_SMALL( ratings[0].elo + ratings[1].elo, 1e-6 );
+}
+
+BOOST_AUTO_TEST_CASE( draws_count_half )
+{
+	std::vector<GameRecord> with_draws;
+	addGames(with_draws, 0, 1, 10, 20, 0);
+	std::vector<GameRecord> without_draws;
+	addGames(without_draws, 0, 1, 20, 0, 10);
+	auto a = estimateRatings(2, with_draws, 0);
+	auto b = estimateRatings(2, without_draws, 0);
+	BOOST_CHECK_EQUAL( a[0].score, 20.0 );
+	BOOST_CHECK_CLOSE( a[0].elo, b[0].elo, 1e-6 );
+}
+
+// players that never lost get a finite rating, and the order follows the results
+BOOST_AUTO_TEST_CASE( transitive )
+{
+	std::vector<GameRecord> games;
+	addGames(games, 0, 1, 8, 0, 0);
+	addGames(games, 1, 2, 6, 0, 2);
+	addGames(games, 0, 2, 8, 0, 0);
+	auto ratings = estimateRatings(3, games);
+	BOOST_CHECK( std::isfinite(ratings[0].elo) );
+	BOOST_CHECK_GT( ratings[0].elo, ratings[1].elo );
+	BOOST_CHECK_GT( ratings[1].elo, ratings[2].elo );
+	for(const auto& r : ratings)
+	{
+		BOOST_CHECK_LE( r.lower, r.elo );
+		BOOST_CHECK_GE( r.upper, r.elo );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( reproducible )
+{
+	std::vector<GameRecord> games;
+	addGames(games, 0, 1, 5, 3, 7);
+	addGames(games, 1, 2, 4, 1, 2);
+	auto a = estimateRatings(3, games, 50, 9);
+	auto b = estimateRatings(3, games, 50, 9);
+	for(unsigned int i = 0; i < 3; ++i)
+	{
+		BOOST_CHECK_EQUAL( a[i].lower, b[i].lower );
+		BOOST_CHECK_EQUAL( a[i].upper, b[i].upper );
+	}
+}
+
+// more games give a narrower confidence interval
+BOOST_AUTO_TEST_CASE( interval_shrinks )
+{
+	std::vector<GameRecord> few;
+	addGames(few, 0, 1, 6, 0, 4);
+	std::vector<GameRecord> many;
+	addGames(many, 0, 1, 600, 0, 400);
+	auto a = estimateRatings(2, few);
+	auto b = estimateRatings(2, many);
+	BOOST_CHECK_GT( a[0].upper - a[0].lower, 3 * (b[0].upper - b[0].lower) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
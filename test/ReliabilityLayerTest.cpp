@@ -0,0 +1,274 @@
+#define BOOST_TEST_MODULE ReliabilityLayer
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "raknet/GetTime.h"
+#include "raknet/MTUSize.h"
+#include "raknet/PacketPool.h"
+#include "raknet/ReliabilityLayer.h"
+#include "raknet/SocketLayer.h"
+
+/// one end of a connection over the loopback interface
+struct Endpoint
+{
+	Endpoint() : receiveBatch( &receivePool )
+	{
+		socket = SocketLayer::Instance()->CreateBoundSocket( 0, false, "127.0.0.1" );
+		BOOST_REQUIRE( socket != INVALID_SOCKET );
+		sockaddr_in sa;
+		socklen_t length = sizeof( sa );
+		getsockname( socket, ( sockaddr* ) & sa, & length );
+		id.binaryAddress = inet_addr( "127.0.0.1" );
+		id.port = ntohs( sa.sin_port );
+	}
+
+	~Endpoint()
+	{
+		close( socket );
+	}
+
+	SOCKET socket;
+	PlayerID id;
+	// declared before everything that references its buffers
+	ReceiveBufferPool receivePool;
+	ReliabilityLayer layer;
+	DatagramBatch sendBatch;
+	DatagramBatch receiveBatch;
+};
+
+/// two reliability layers that talk to each other, dropping some of the datagrams
+struct Connection
+{
+	Connection( double loss, int mtu ) : lossRate( loss ), mtuSize( mtu ), maximumInFlight( 0 ), maximumReassembling( 0 ), random( 7 )
+	{
+		// resend quickly, so lost datagrams do not slow down the test
+		for ( Endpoint* endpoint : { &a, &b } )
+			endpoint->layer.SetLostPacketResendDelay( 0 );
+	}
+
+	void pump()
+	{
+		pump( a, b );
+		pump( b, a );
+	}
+
+	void pump( Endpoint& from, Endpoint& to )
+	{
+		from.layer.Update( from.socket, &from.sendBatch, to.id, mtuSize, RakNet::GetTime() );
+		SocketLayer::Instance()->SendBatch( from.socket, from.sendBatch );
+		maximumInFlight = std::max( maximumInFlight, from.layer.GetStatistics()->messagesOnResendQueue );
+
+		int errorCode = 0;
+		std::uniform_real_distribution<double> dist( 0, 1 );
+		while ( SocketLayer::Instance()->RecvFromBatch( to.socket, to.receiveBatch, &errorCode ) > 0 )
+		{
+			for ( int i = 0; i < to.receiveBatch.Size(); ++i )
+			{
+				if ( dist( random ) < lossRate )
+					continue;
+				BOOST_REQUIRE( to.layer.HandleSocketReceiveFromConnectedPlayer( to.receiveBatch.GetData( i ), to.receiveBatch.GetLength( i ), to.receiveBatch.GetBuffer( i ) ) );
+			}
+		}
+		maximumReassembling = std::max( maximumReassembling, to.layer.GetStatistics()->messagesWaitingForReassembly );
+	}
+
+	/// sends a message with the sequence number in front, padded to size bytes
+	void send( unsigned int sequence, int size, PacketReliability reliability, unsigned char channel )
+	{
+		std::vector<char> data( size, char( sequence ) );
+		std::memcpy( data.data(), &sequence, sizeof( sequence ) );
+		BOOST_REQUIRE( a.layer.Send( data.data(), size * 8, HIGH_PRIORITY, reliability, channel, true, mtuSize, RakNet::GetTime() ) );
+	}
+
+	/// pumps until b received count messages or the time is up, and returns them
+	std::vector<std::vector<char>> receive( unsigned int count, int seconds = 60 )
+	{
+		std::vector<std::vector<char>> received;
+		auto end = std::chrono::steady_clock::now() + std::chrono::seconds( seconds );
+		while ( received.size() < count && std::chrono::steady_clock::now() < end )
+		{
+			pump();
+			char* data;
+			ReceiveBuffer* buffer;
+			int bits;
+			while ( ( bits = b.layer.Receive( &data, &buffer ) ) > 0 )
+			{
+				received.emplace_back( data, data + BITS_TO_BYTES( bits ) );
+				ReceiveBufferPool::FreeData( data, buffer );
+			}
+			std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+		}
+		return received;
+	}
+
+	static unsigned int sequenceOf( const std::vector<char>& message )
+	{
+		unsigned int sequence;
+		std::memcpy( &sequence, message.data(), sizeof( sequence ) );
+		return sequence;
+	}
+
+	Endpoint a;
+	Endpoint b;
+	double lossRate;
+	int mtuSize;
+	/// the most reliable packets that were waiting for an acknowledgement at once
+	unsigned int maximumInFlight;
+	/// the most parts of split packets that were waiting for reassembly at once
+	unsigned int maximumReassembling;
+	std::mt19937 random;
+};
+
+BOOST_AUTO_TEST_SUITE( reliability_layer )
+
+BOOST_AUTO_TEST_CASE( reliable_in_flight )
+{
+	const unsigned int COUNT = 50000;
+	Connection connection( 0.05, MAXIMUM_MTU_SIZE );
+	for ( unsigned int i = 0; i < COUNT; ++i )
+		connection.send( i, sizeof( i ), RELIABLE, 0 );
+
+	auto received = connection.receive( COUNT );
+	BOOST_CHECK_EQUAL( received.size(), COUNT );
+
+	// every message arrives exactly once
+	std::vector<bool> seen( COUNT, false );
+	for ( const auto& message : received )
+	{
+		unsigned int sequence = Connection::sequenceOf( message );
+		BOOST_REQUIRE_LT( sequence, COUNT );
+		BOOST_REQUIRE( !seen[ sequence ] );
+		seen[ sequence ] = true;
+	}
+
+	// at least a full frame of packets waits for its acknowledgements
+	BOOST_CHECK_GT( connection.maximumInFlight, 500u );
+	BOOST_CHECK_GT( connection.a.layer.GetStatistics()->messageResends, 0u );
+
+	// everything is acknowledged in the end
+	connection.receive( 1, 1 );
+	BOOST_CHECK_EQUAL( connection.a.layer.GetStatistics()->messagesOnResendQueue, 0u );
+	BOOST_CHECK( !connection.a.layer.IsDataWaiting() );
+}
+
+BOOST_AUTO_TEST_CASE( ordered_channels )
+{
+	// one message per datagram, so a lost datagram lets the following messages overtake
+	const unsigned int COUNT = 1000;
+	const unsigned char CHANNELS = 4;
+	Connection connection( 0.02, DEFAULT_MTU_SIZE );
+	for ( unsigned int i = 0; i < COUNT; ++i )
+		connection.send( i, DEFAULT_MTU_SIZE / 2 + 100, RELIABLE_ORDERED, i % CHANNELS );
+
+	auto received = connection.receive( COUNT );
+	BOOST_REQUIRE_EQUAL( received.size(), COUNT );
+
+	// every channel is delivered in order
+	std::vector<unsigned int> next( CHANNELS );
+	for ( unsigned char channel = 0; channel < CHANNELS; ++channel )
+		next[ channel ] = channel;
+	for ( const auto& message : received )
+	{
+		unsigned int sequence = Connection::sequenceOf( message );
+		BOOST_REQUIRE_EQUAL( sequence, next[ sequence % CHANNELS ] );
+		next[ sequence % CHANNELS ] += CHANNELS;
+	}
+
+	BOOST_CHECK_GT( connection.b.layer.GetStatistics()->orderedMessagesOutOfOrder, 0u );
+
+	// nothing is left over once the acknowledgements are out
+	connection.receive( 1, 1 );
+	BOOST_CHECK( !connection.b.layer.IsDataWaiting() );
+}
+
+BOOST_AUTO_TEST_CASE( split_packets )
+{
+	// one huge message, whose parts all wait for reassembly, and smaller ones behind it
+	const unsigned int COUNT = 10;
+	const int HUGE_SIZE = 1200 * DEFAULT_MTU_SIZE;
+	const int SIZE = 20 * DEFAULT_MTU_SIZE;
+	Connection connection( 0.02, DEFAULT_MTU_SIZE );
+	connection.send( 0, HUGE_SIZE, RELIABLE_ORDERED, 0 );
+	for ( unsigned int i = 1; i < COUNT; ++i )
+		connection.send( i, SIZE, RELIABLE_ORDERED, 0 );
+
+	auto received = connection.receive( COUNT );
+	BOOST_REQUIRE_EQUAL( received.size(), COUNT );
+	for ( unsigned int i = 0; i < COUNT; ++i )
+	{
+		BOOST_REQUIRE_EQUAL( received[ i ].size(), unsigned( i == 0 ? HUGE_SIZE : SIZE ) );
+		BOOST_CHECK_EQUAL( Connection::sequenceOf( received[ i ] ), i );
+		BOOST_CHECK_EQUAL( received[ i ].back(), char( i ) );
+	}
+
+	BOOST_CHECK_GT( connection.maximumReassembling, 1000u );
+
+	// nothing is left over once the acknowledgements are out
+	connection.receive( 1, 1 );
+	BOOST_CHECK_EQUAL( connection.b.layer.GetStatistics()->messagesWaitingForReassembly, 0u );
+	BOOST_CHECK( !connection.b.layer.IsDataWaiting() );
+}
+
+BOOST_AUTO_TEST_CASE( zero_copy_receive )
+{
+	// small messages share datagrams, the big one is split
+	const unsigned int COUNT = 200;
+	Connection connection( 0, DEFAULT_MTU_SIZE );
+	for ( unsigned int i = 0; i < COUNT; ++i )
+		connection.send( i, 16, RELIABLE_ORDERED, 0 );
+	connection.send( COUNT, 4 * DEFAULT_MTU_SIZE, RELIABLE_ORDERED, 0 );
+
+	struct Message
+	{
+		char* data;
+		int bits;
+		ReceiveBuffer* buffer;
+	};
+	std::vector<Message> messages;
+	auto end = std::chrono::steady_clock::now() + std::chrono::seconds( 30 );
+	while ( messages.size() < COUNT + 1 && std::chrono::steady_clock::now() < end )
+	{
+		connection.pump();
+		Message message;
+		while ( ( message.bits = connection.b.layer.Receive( &message.data, &message.buffer ) ) > 0 )
+			messages.push_back( message );
+		std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+	}
+	BOOST_REQUIRE_EQUAL( messages.size(), COUNT + 1 );
+
+	// the small messages point into the datagrams they arrived in
+	std::vector<ReceiveBuffer*> buffers;
+	for ( unsigned int i = 0; i < COUNT; ++i )
+	{
+		const Message& message = messages[ i ];
+		BOOST_REQUIRE( message.buffer );
+		BOOST_CHECK( message.data > message.buffer->data && message.data + 16 <= message.buffer->data + MAXIMUM_MTU_SIZE );
+		BOOST_CHECK_EQUAL( message.bits, 16 * 8 );
+		BOOST_CHECK_EQUAL( Connection::sequenceOf( std::vector<char>( message.data, message.data + 16 ) ), i );
+		if ( buffers.empty() || buffers.back() != message.buffer )
+			buffers.push_back( message.buffer );
+	}
+	BOOST_CHECK_LT( buffers.size(), COUNT / 10 );
+
+	// the split message was reassembled into memory of its own
+	BOOST_CHECK( messages[ COUNT ].buffer == 0 );
+	BOOST_CHECK_EQUAL( messages[ COUNT ].bits, 4 * DEFAULT_MTU_SIZE * 8 );
+
+	// the batch took new buffers while the messages held on to the old ones
+	connection.receive( 1, 1 );
+	ReceiveBufferPool& pool = connection.b.receivePool;
+	BOOST_CHECK_LT( pool.GetFreeCount(), pool.GetAllocatedCount() - DatagramBatch::CAPACITY );
+
+	// and all of them come back with the last message
+	for ( const Message& message : messages )
+		ReceiveBufferPool::FreeData( message.data, message.buffer );
+	BOOST_CHECK_EQUAL( pool.GetFreeCount(), pool.GetAllocatedCount() - DatagramBatch::CAPACITY );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,78 @@
+#define BOOST_TEST_MODULE RulesCache
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+
+#include "lua.hpp"
+#include "FileRead.h"
+#include "RulesCache.h"
+
+#include "FileSystemFixture.h"
+
+const char TEST_NAME[] = "RulesCacheTest";
+
+BOOST_FIXTURE_TEST_SUITE( rules_cache, FileSystemFixture<TEST_NAME> )
+
+BOOST_AUTO_TEST_CASE( matches_file )
+{
+	auto script = RulesCache::readScript("rules/default");
+	BOOST_CHECK_EQUAL( script->filename, "rules/default.lua" );
+	BOOST_CHECK( !script->bytecode.empty() );
+
+	FileRead file("rules/default.lua");
+	BOOST_CHECK_EQUAL( script->checksum, file.calcChecksum(0) );
+	BOOST_REQUIRE_EQUAL( script->length, file.length() );
+	auto source = file.readRawBytes(file.length());
+	BOOST_CHECK_EQUAL( std::memcmp(source.get(), script->source.get(), script->length), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( find_needs_cache )
+{
+	BOOST_CHECK( !RulesCache::find("rules/default.lua") );
+	{
+		RulesCache cache;
+		BOOST_CHECK( !RulesCache::find("rules/default.lua") );
+		BOOST_CHECK_GT( cache.loadAll(), 2u );
+		BOOST_CHECK( RulesCache::find("api.lua") );
+		BOOST_CHECK( RulesCache::find("rules_api") );
+		BOOST_CHECK( RulesCache::find("rules/default.lua") );
+		BOOST_CHECK( !RulesCache::find("rules/does_not_exist.lua") );
+
+		// nothing changed, so nothing is reloaded
+		BOOST_CHECK_EQUAL( cache.loadAll(), 0u );
+	}
+	BOOST_CHECK( !RulesCache::find("rules/default.lua") );
+}
+
+// the precompiled script has to define the same globals as the source
+BOOST_AUTO_TEST_CASE( bytecode_runs )
+{
+	RulesCache cache;
+	auto script = cache.load("rules/default.lua");
+
+	std::string titles[2];
+	for(int i = 0; i < 2; ++i)
+	{
+		lua_State* state = luaL_newstate();
+		luaL_openlibs(state);
+		if(i == 0)
+			BOOST_REQUIRE_EQUAL( RulesCache::loadScript(state, *script), 0 );
+		else
+			BOOST_REQUIRE_EQUAL( FileRead::readLuaScript("rules/default.lua", state), 0 );
+		BOOST_REQUIRE_EQUAL( lua_pcall(state, 0, 0, 0), 0 );
+
+		lua_getglobal(state, "__TITLE__");
+		BOOST_REQUIRE( lua_isstring(state, -1) );
+		titles[i] = lua_tostring(state, -1);
+		lua_close(state);
+	}
+	BOOST_CHECK_EQUAL( titles[0], titles[1] );
+}
+
+BOOST_AUTO_TEST_CASE( missing_file )
+{
+	RulesCache cache;
+	BOOST_CHECK_THROW( cache.load("rules/does_not_exist.lua"), FileLoadException );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,120 @@
+#define BOOST_TEST_MODULE ScriptWatchdog
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+
+#include "lua.hpp"
+#include "ScriptWatchdog.h"
+
+typedef ScriptWatchdog::Result Result;
+
+struct LuaFixture
+{
+	LuaFixture() : state(luaL_newstate())
+	{
+		luaL_openlibs(state);
+	}
+
+	~LuaFixture()
+	{
+		lua_close(state);
+	}
+
+	// pushes the function defined by \p code
+	void push(const char* code)
+	{
+		BOOST_REQUIRE_EQUAL( luaL_loadstring(state, code), 0 );
+	}
+
+	ScriptWatchdog::Budget budget;
+	ScriptWatchdog::Statistics stats;
+	lua_State* state;
+};
+
+BOOST_FIXTURE_TEST_SUITE( script_watchdog, LuaFixture )
+
+BOOST_AUTO_TEST_CASE( results )
+{
+	push("return 1, 2");
+	BOOST_REQUIRE( ScriptWatchdog::call(state, 0, 2, budget, stats) == Result::OK );
+	BOOST_CHECK_EQUAL( lua_tointeger(state, -2), 1 );
+	BOOST_CHECK_EQUAL( lua_tointeger(state, -1), 2 );
+	BOOST_CHECK_EQUAL( stats.calls, 1u );
+	BOOST_CHECK_EQUAL( stats.overruns, 0u );
+	BOOST_CHECK_EQUAL( stats.errors, 0u );
+}
+
+BOOST_AUTO_TEST_CASE( error )
+{
+	push("error('failed')");
+	BOOST_CHECK( ScriptWatchdog::call(state, 0, 0, budget, stats) == Result::ERROR );
+	BOOST_CHECK( lua_isstring(state, -1) );
+	BOOST_CHECK_EQUAL( stats.errors, 1u );
+}
+
+BOOST_AUTO_TEST_CASE( instruction_budget )
+{
+	budget.instructions = 10000;
+	budget.time = std::chrono::microseconds(0);
+	push("while true do end");
+	BOOST_CHECK( ScriptWatchdog::call(state, 0, 0, budget, stats) == Result::OVERRUN );
+	BOOST_CHECK_EQUAL( lua_gettop(state), 1 );
+	BOOST_CHECK_EQUAL( stats.overruns, 1u );
+
+	// the hook is removed afterwards
+	lua_settop(state, 0);
+	push("local x = 0 for i = 1, 100000 do x = x + i end return x");
+	BOOST_CHECK_EQUAL( lua_pcall(state, 0, 1, 0), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( time_budget )
+{
+	budget.instructions = 0;
+	budget.time = std::chrono::milliseconds(5);
+	push("while true do end");
+	auto start = std::chrono::steady_clock::now();
+	BOOST_CHECK( ScriptWatchdog::call(state, 0, 0, budget, stats) == Result::OVERRUN );
+	auto duration = std::chrono::steady_clock::now() - start;
+	BOOST_CHECK( duration >= std::chrono::milliseconds(5) );
+	BOOST_CHECK( duration < std::chrono::milliseconds(500) );
+	BOOST_CHECK_GE( stats.maxTime, 5000 );
+}
+
+// a script must not be able to continue by catching the error of the watchdog
+BOOST_AUTO_TEST_CASE( catching_the_error )
+{
+	budget.instructions = 10000;
+	push("for i = 1, 10 do pcall(function() while true do end end) end return 1");
+	BOOST_CHECK( ScriptWatchdog::call(state, 0, 1, budget, stats) == Result::OVERRUN );
+	BOOST_CHECK_EQUAL( lua_gettop(state), 1 );
+	BOOST_CHECK( lua_isstring(state, -1) );
+}
+
+BOOST_AUTO_TEST_CASE( percentile )
+{
+	for(int i = 0; i < 99; ++i)
+		stats.addCall( std::chrono::microseconds(10) );
+	stats.addCall( std::chrono::milliseconds(10) );
+
+	BOOST_CHECK_CLOSE( stats.getMeanTime(), (99 * 10 + 10000) / 100.0, 0.001 );
+	BOOST_CHECK_GE( stats.getPercentile(0.99), 10 );
+	BOOST_CHECK_LE( stats.getPercentile(0.99), 12.5 );
+	BOOST_CHECK_EQUAL( stats.getPercentile(1.0), 10000 );
+}
+
+BOOST_AUTO_TEST_CASE( record )
+{
+	push("return");
+	ScriptWatchdog::call(state, 0, 0, budget, stats);
+	// without a watchdog, statistics are dropped
+	ScriptWatchdog::record("test.lua", stats);
+
+	ScriptWatchdog watchdog;
+	ScriptWatchdog::record("test.lua", stats);
+	ScriptWatchdog::record("test.lua", stats);
+	auto all = watchdog.getStatistics();
+	BOOST_REQUIRE_EQUAL( all.size(), 1u );
+	BOOST_CHECK_EQUAL( all["test.lua"].calls, 2u );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,81 @@
+#define BOOST_TEST_MODULE ScriptedInputSource
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <string>
+
+#include "DuelMatch.h"
+#include "DuelMatchState.h"
+#include "ScriptedInputSource.h"
+
+#include "FileSystemFixture.h"
+
+const int SCORE_TO_WIN = 2;
+const int MAX_STEPS = 20000;
+
+const char TEST_NAME[] = "ScriptedInputSourceTest";
+
+/// a match between two bots
+struct BotMatch
+{
+	BotMatch(const std::string& left, const std::string& right, bool async) :
+		match(false, "default.lua", SCORE_TO_WIN)
+	{
+		bots[LEFT_PLAYER] = std::make_shared<ScriptedInputSource>("scripts/" + left, LEFT_PLAYER, 0);
+		bots[RIGHT_PLAYER] = std::make_shared<ScriptedInputSource>("scripts/" + right, RIGHT_PLAYER, 0);
+		for(int side = LEFT_PLAYER; side < MAX_PLAYERS; ++side)
+		{
+			bots[side]->setRandomSeed(side);
+			if(async)
+				bots[side]->enableAsync();
+		}
+		match.setInputSources(bots[LEFT_PLAYER], bots[RIGHT_PLAYER]);
+	}
+
+	DuelMatch match;
+	std::shared_ptr<ScriptedInputSource> bots[MAX_PLAYERS];
+};
+
+BOOST_FIXTURE_TEST_SUITE( scripted_input_source, FileSystemFixture<TEST_NAME> )
+
+// the asynchronous bot answers one frame later, so it cannot know anything in the first frame
+BOOST_AUTO_TEST_CASE( async_first_frame )
+{
+	BotMatch bots("com_11.lua", "com_11.lua", true);
+	bots.match.step();
+	DuelMatchState state = bots.match.getState();
+	for(int side = LEFT_PLAYER; side < MAX_PLAYERS; ++side)
+	{
+		BOOST_CHECK( state.playerInput[side] == PlayerInput() );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( async_deterministic )
+{
+	BotMatch first("gintonicV9.lua", "com_11.lua", true);
+	BotMatch second("gintonicV9.lua", "com_11.lua", true);
+
+	int steps = 0;
+	while(first.match.winningPlayer() == NO_PLAYER && steps < MAX_STEPS)
+	{
+		first.match.step();
+		second.match.step();
+		++steps;
+
+		DuelMatchState a = first.match.getState();
+		DuelMatchState b = second.match.getState();
+		for(int side = LEFT_PLAYER; side < MAX_PLAYERS; ++side)
+		{
+			BOOST_REQUIRE( a.playerInput[side] == b.playerInput[side] );
+			BOOST_REQUIRE_EQUAL( a.worldState.blobPosition[side].x, b.worldState.blobPosition[side].x );
+			BOOST_REQUIRE_EQUAL( a.worldState.blobPosition[side].y, b.worldState.blobPosition[side].y );
+		}
+		BOOST_REQUIRE_EQUAL( a.worldState.ballPosition.x, b.worldState.ballPosition.x );
+		BOOST_REQUIRE_EQUAL( a.worldState.ballPosition.y, b.worldState.ballPosition.y );
+	}
+
+	BOOST_CHECK_EQUAL( first.match.winningPlayer(), second.match.winningPlayer() );
+	BOOST_CHECK_EQUAL( first.bots[LEFT_PLAYER]->getMissedDeadlines(), 0u );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,109 @@
+#define BOOST_TEST_MODULE SearchInputSource
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+
+#include "DuelMatch.h"
+#include "DuelMatchState.h"
+#include "InputSource.h"
+#include "SearchInputSource.h"
+
+#include "FileSystemFixture.h"
+
+const int MAX_STEPS = 10000;
+
+const char TEST_NAME[] = "SearchInputSourceTest";
+
+SearchInputSource::Settings unlimited(unsigned int threads = 1)
+{
+	SearchInputSource::Settings settings;
+	settings.budget = std::chrono::microseconds(0);
+	settings.threads = threads;
+	return settings;
+}
+
+BOOST_FIXTURE_TEST_SUITE( search_input_source, FileSystemFixture<TEST_NAME> )
+
+BOOST_AUTO_TEST_CASE( no_match )
+{
+	SearchInputSource bot(LEFT_PLAYER);
+	BOOST_CHECK( bot.updateInput() == PlayerInput() );
+	BOOST_CHECK_EQUAL( bot.getStatistics().frames, 0u );
+}
+
+// an opponent that only jumps in place loses the match, on both sides of the net
+BOOST_AUTO_TEST_CASE( beats_jumping_opponent )
+{
+	for(int side = LEFT_PLAYER; side < MAX_PLAYERS; ++side)
+	{
+		DuelMatch match(false, "default.lua", 2);
+		auto bot = std::make_shared<SearchInputSource>(PlayerSide(side), unlimited());
+		auto jumping = std::make_shared<InputSource>();
+		jumping->setInput( PlayerInput(false, false, true) );
+		if(side == LEFT_PLAYER)
+			match.setInputSources(bot, jumping);
+		else
+			match.setInputSources(jumping, bot);
+
+		int steps = 0;
+		while(match.winningPlayer() == NO_PLAYER && steps < MAX_STEPS)
+		{
+			match.step();
+			++steps;
+		}
+
+		BOOST_CHECK_EQUAL( match.winningPlayer(), PlayerSide(side) );
+		BOOST_CHECK_EQUAL( bot->getStatistics().frames, (unsigned long long)steps );
+	}
+}
+
+// without a time limit, the result does not depend on the timing or the number of threads
+BOOST_AUTO_TEST_CASE( deterministic )
+{
+	DuelMatch first(false, "default.lua", 2);
+	DuelMatch second(false, "default.lua", 2);
+	first.setInputSources( std::make_shared<SearchInputSource>(LEFT_PLAYER, unlimited(1)),
+							std::make_shared<SearchInputSource>(RIGHT_PLAYER, unlimited(1)) );
+	second.setInputSources( std::make_shared<SearchInputSource>(LEFT_PLAYER, unlimited(3)),
+							std::make_shared<SearchInputSource>(RIGHT_PLAYER, unlimited(2)) );
+
+	for(int step = 0; step < 1000; ++step)
+	{
+		first.step();
+		second.step();
+
+		DuelMatchState a = first.getState();
+		DuelMatchState b = second.getState();
+		for(int side = LEFT_PLAYER; side < MAX_PLAYERS; ++side)
+		{
+			BOOST_REQUIRE( a.playerInput[side] == b.playerInput[side] );
+			BOOST_REQUIRE_EQUAL( a.worldState.blobPosition[side].x, b.worldState.blobPosition[side].x );
+			BOOST_REQUIRE_EQUAL( a.worldState.blobPosition[side].y, b.worldState.blobPosition[side].y );
+		}
+		BOOST_REQUIRE_EQUAL( a.worldState.ballPosition.x, b.worldState.ballPosition.x );
+		BOOST_REQUIRE_EQUAL( a.worldState.ballPosition.y, b.worldState.ballPosition.y );
+	}
+}
+
+// with a tiny budget, only a few candidates are evaluated, but always at least one
+BOOST_AUTO_TEST_CASE( budget )
+{
+	DuelMatch match(false, "default.lua", 2);
+	SearchInputSource::Settings settings;
+	settings.budget = std::chrono::microseconds(1);
+	auto limited = std::make_shared<SearchInputSource>(LEFT_PLAYER, settings);
+	auto full = std::make_shared<SearchInputSource>(RIGHT_PLAYER, unlimited());
+	match.setInputSources(limited, full);
+
+	for(int step = 0; step < 100; ++step)
+		match.step();
+
+	auto few = limited->getStatistics();
+	auto all = full->getStatistics();
+	BOOST_CHECK_EQUAL( few.frames, 100u );
+	BOOST_CHECK_GE( few.rollouts, few.frames );
+	BOOST_CHECK_LT( few.rollouts, all.rollouts );
+	BOOST_CHECK_LT( few.steps, all.steps );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,397 @@
+#define BOOST_TEST_MODULE SocketLayer
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "raknet/PacketPool.h"
+#include "raknet/SocketLayer.h"
+
+/// two non-blocking sockets on the loopback interface
+struct SocketFixture
+{
+	SocketFixture()
+	{
+		sender = SocketLayer::Instance()->CreateBoundSocket( 0, false, "127.0.0.1" );
+		receiver = SocketLayer::Instance()->CreateBoundSocket( 0, false, "127.0.0.1" );
+		BOOST_REQUIRE( sender != INVALID_SOCKET );
+		BOOST_REQUIRE( receiver != INVALID_SOCKET );
+		address = inet_addr( "127.0.0.1" );
+		senderPort = getPort( sender );
+		receiverPort = getPort( receiver );
+	}
+
+	~SocketFixture()
+	{
+		close( sender );
+		close( receiver );
+	}
+
+	static unsigned short getPort( SOCKET s )
+	{
+		sockaddr_in sa;
+		socklen_t length = sizeof( sa );
+		getsockname( s, ( sockaddr* ) & sa, & length );
+		return ntohs( sa.sin_port );
+	}
+
+	SOCKET sender;
+	SOCKET receiver;
+	unsigned int address;
+	unsigned short senderPort;
+	unsigned short receiverPort;
+};
+
+BOOST_FIXTURE_TEST_SUITE( socket_layer, SocketFixture )
+
+BOOST_AUTO_TEST_CASE( batch_add )
+{
+	DatagramBatch batch;
+	BOOST_CHECK_EQUAL( batch.Size(), 0 );
+
+	BOOST_CHECK( batch.Add( "abc", 3, address, 1234 ) );
+	BOOST_CHECK_EQUAL( batch.Size(), 1 );
+	BOOST_CHECK_EQUAL( std::string( batch.GetData( 0 ), batch.GetLength( 0 ) ), "abc" );
+	BOOST_CHECK_EQUAL( batch.GetBinaryAddress( 0 ), address );
+	BOOST_CHECK_EQUAL( batch.GetPort( 0 ), 1234 );
+
+	// too long datagrams are refused
+	std::string huge( MAXIMUM_MTU_SIZE + 1, 'x' );
+	BOOST_CHECK( !batch.Add( huge.data(), huge.size(), address, 1234 ) );
+
+	while ( batch.Add( "x", 1, address, 1234 ) )
+		;
+	BOOST_CHECK( batch.IsFull() );
+	BOOST_CHECK_EQUAL( batch.Size(), int( DatagramBatch::CAPACITY ) );
+
+	batch.Clear();
+	BOOST_CHECK_EQUAL( batch.Size(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( send_and_receive )
+{
+	const int COUNT = DatagramBatch::CAPACITY + 10;
+	DatagramBatch sendBatch;
+	for ( int i = 0; i < COUNT; ++i )
+	{
+		std::string data = "datagram " + std::to_string( i );
+		BOOST_CHECK_EQUAL( SocketLayer::Instance()->SendTo( sender, sendBatch, data.data(), data.size(), address, receiverPort ), 0 );
+	}
+	// the first full batch was sent when the next datagram was queued
+	BOOST_CHECK_EQUAL( sendBatch.GetDatagrams(), unsigned( DatagramBatch::CAPACITY ) );
+	BOOST_CHECK_EQUAL( SocketLayer::Instance()->SendBatch( sender, sendBatch ), 10 );
+	BOOST_CHECK_EQUAL( sendBatch.Size(), 0 );
+	BOOST_CHECK_EQUAL( sendBatch.GetDatagrams(), unsigned( COUNT ) );
+
+	DatagramBatch receiveBatch;
+	int errorCode = 0;
+	int received = 0;
+	while ( received < COUNT )
+	{
+		int count = SocketLayer::Instance()->RecvFromBatch( receiver, receiveBatch, &errorCode );
+		BOOST_REQUIRE_GT( count, 0 );
+		BOOST_REQUIRE_EQUAL( count, receiveBatch.Size() );
+		for ( int i = 0; i < count; ++i )
+		{
+			BOOST_CHECK_EQUAL( std::string( receiveBatch.GetData( i ), receiveBatch.GetLength( i ) ), "datagram " + std::to_string( received + i ) );
+			BOOST_CHECK_EQUAL( receiveBatch.GetBinaryAddress( i ), address );
+			BOOST_CHECK_EQUAL( receiveBatch.GetPort( i ), senderPort );
+		}
+		received += count;
+	}
+	BOOST_CHECK_EQUAL( received, COUNT );
+	BOOST_CHECK_EQUAL( receiveBatch.GetDatagrams(), unsigned( COUNT ) );
+
+	// nothing left
+	BOOST_CHECK_EQUAL( SocketLayer::Instance()->RecvFromBatch( receiver, receiveBatch, &errorCode ), 0 );
+	BOOST_CHECK_EQUAL( errorCode, 0 );
+
+#ifdef __linux__
+	// one system call per batch
+	BOOST_CHECK_EQUAL( sendBatch.GetCalls(), 2u );
+	BOOST_CHECK_LE( receiveBatch.GetCalls(), 4u );
+#endif
+}
+
+BOOST_AUTO_TEST_CASE( pooled_receive )
+{
+	ReceiveBufferPool pool;
+	DatagramBatch batch( &pool );
+	BOOST_CHECK_EQUAL( pool.GetFreeCount(), pool.GetAllocatedCount() - DatagramBatch::CAPACITY );
+
+	int errorCode = 0;
+	BOOST_CHECK_EQUAL( SocketLayer::Instance()->SendTo( sender, "first", 5, address, receiverPort ), 0 );
+	BOOST_REQUIRE_EQUAL( SocketLayer::Instance()->RecvFromBatch( receiver, batch, &errorCode ), 1 );
+	ReceiveBuffer* first = batch.GetBuffer( 0 );
+	BOOST_REQUIRE( first );
+	BOOST_CHECK( batch.GetData( 0 ) == first->data );
+
+	// a referenced buffer is not overwritten by the next receive
+	first->AddReference();
+	BOOST_CHECK_EQUAL( SocketLayer::Instance()->SendTo( sender, "second", 6, address, receiverPort ), 0 );
+	BOOST_REQUIRE_EQUAL( SocketLayer::Instance()->RecvFromBatch( receiver, batch, &errorCode ), 1 );
+	BOOST_CHECK( batch.GetBuffer( 0 ) != first );
+	BOOST_CHECK_EQUAL( std::string( batch.GetData( 0 ), batch.GetLength( 0 ) ), "second" );
+	BOOST_CHECK_EQUAL( std::string( first->data, 5 ), "first" );
+
+	// the last reference returns it to the pool
+	first->Release();
+	BOOST_CHECK_EQUAL( pool.GetFreeCount(), pool.GetAllocatedCount() - DatagramBatch::CAPACITY );
+
+	// copying into the batch does not overwrite a referenced buffer either
+	ReceiveBuffer* second = batch.GetBuffer( 0 );
+	second->AddReference();
+	batch.Clear();
+	BOOST_REQUIRE( batch.Add( "abc", 3, address, 1234 ) );
+	BOOST_CHECK( batch.GetBuffer( 0 ) != second );
+	BOOST_CHECK_EQUAL( std::string( batch.GetData( 0 ), batch.GetLength( 0 ) ), "abc" );
+	BOOST_CHECK_EQUAL( std::string( second->data, 6 ), "second" );
+	second->Release();
+	BOOST_CHECK_EQUAL( pool.GetFreeCount(), pool.GetAllocatedCount() - DatagramBatch::CAPACITY );
+}
+
+BOOST_AUTO_TEST_CASE( invalid_socket )
+{
+	DatagramBatch batch;
+	int errorCode = 0;
+	BOOST_CHECK_EQUAL( SocketLayer::Instance()->RecvFromBatch( INVALID_SOCKET, batch, &errorCode ), SOCKET_ERROR );
+	BOOST_CHECK_EQUAL( errorCode, SOCKET_ERROR );
+	BOOST_CHECK_EQUAL( SocketLayer::Instance()->SendTo( INVALID_SOCKET, batch, "a", 1, address, receiverPort ), -1 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+/// passes numbered datagrams through an impairment and records what comes out when
+struct ImpairmentFixture
+{
+	explicit ImpairmentFixture( const char* spec )
+	{
+		BOOST_REQUIRE( settings.Parse( spec ) );
+		impairment.SetSettings( settings );
+	}
+
+	/// impairs count datagrams at time, numbered from first
+	void send( int first, int count, unsigned int time, unsigned short port = 1234 )
+	{
+		DatagramBatch batch;
+		for ( int i = first; i < first + count; ++i )
+		{
+			if ( batch.IsFull() )
+				impairment.Impair( batch, time );
+			std::string data = std::to_string( i );
+			BOOST_REQUIRE( batch.Add( data.data(), data.size(), 1, port ) );
+		}
+		impairment.Impair( batch, time );
+	}
+
+	/// releases everything that is due at time
+	void release( unsigned int time )
+	{
+		DatagramBatch batch;
+		bool more;
+		do
+		{
+			more = impairment.Release( batch, time );
+			for ( int i = 0; i < batch.Size(); ++i )
+			{
+				received.push_back( std::stoi( std::string( batch.GetData( i ), batch.GetLength( i ) ) ) );
+				times.push_back( time );
+			}
+		}
+		while ( more );
+	}
+
+	/// releases everything, each datagram when it is due
+	void releaseAll( unsigned int time )
+	{
+		unsigned int next;
+		while ( impairment.GetNextReleaseTime( &next ) )
+			release( time = std::max( time, next ) );
+	}
+
+	SocketStatistics statistics()
+	{
+		SocketStatistics result = SocketStatistics();
+		impairment.AddStatistics( &result );
+		return result;
+	}
+
+	NetworkImpairmentSettings settings;
+	NetworkImpairment impairment;
+	std::vector<int> received;
+	std::vector<unsigned int> times;
+};
+
+BOOST_AUTO_TEST_SUITE( network_impairment )
+
+BOOST_AUTO_TEST_CASE( parse )
+{
+	NetworkImpairmentSettings settings;
+	BOOST_CHECK( !settings.IsActive() );
+	BOOST_CHECK( settings.Parse( "" ) );
+	BOOST_CHECK( !settings.IsActive() );
+
+	BOOST_REQUIRE( settings.Parse( "loss=0.05,latency=40,jitter=10,duplicate=0.01,reorder=0.02,seed=7" ) );
+	BOOST_CHECK( settings.IsActive() );
+	BOOST_CHECK_CLOSE( settings.loss, 0.05, 1e-9 );
+	BOOST_CHECK_EQUAL( settings.latency, 40u );
+	BOOST_CHECK_EQUAL( settings.jitter, 10u );
+	BOOST_CHECK_CLOSE( settings.duplicate, 0.01, 1e-9 );
+	BOOST_CHECK_CLOSE( settings.reorder, 0.02, 1e-9 );
+	BOOST_CHECK_EQUAL( settings.seed, 7u );
+
+	// other settings are kept
+	BOOST_REQUIRE( settings.Parse( "latency=5" ) );
+	BOOST_CHECK_EQUAL( settings.latency, 5u );
+	BOOST_CHECK_EQUAL( settings.jitter, 10u );
+
+	// invalid settings change nothing
+	for ( const char* invalid : { "latency", "latency=", "latency=x", "lag=5", "loss=2", "jitter=-1", "latency=1,seed" } )
+	{
+		BOOST_TEST_CONTEXT( invalid )
+		{
+			BOOST_CHECK( !settings.Parse( invalid ) );
+			BOOST_CHECK_EQUAL( settings.latency, 5u );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( latency_and_jitter )
+{
+	const int COUNT = 1000;
+	ImpairmentFixture fixture( "latency=40,jitter=10" );
+	for ( int i = 0; i < COUNT; ++i )
+		fixture.send( i, 1, 1000 + i );
+
+	fixture.release( 1039 );
+	BOOST_CHECK( fixture.received.empty() );
+
+	for ( unsigned int time = 1040; fixture.received.size() < unsigned( COUNT ) && time < 3000; ++time )
+		fixture.release( time );
+	BOOST_REQUIRE_EQUAL( fixture.received.size(), unsigned( COUNT ) );
+
+	// jitter delays, but does not reorder
+	int late = 0;
+	for ( int i = 0; i < COUNT; ++i )
+	{
+		BOOST_REQUIRE_EQUAL( fixture.received[ i ], i );
+		BOOST_CHECK_GE( fixture.times[ i ], 1040u + i );
+		late += fixture.times[ i ] > 1040u + i;
+	}
+	BOOST_CHECK_GT( late, COUNT / 2 );
+	BOOST_CHECK_EQUAL( fixture.statistics().datagramsDelayed, unsigned( COUNT ) );
+	unsigned int next;
+	BOOST_CHECK( !fixture.impairment.GetNextReleaseTime( &next ) );
+}
+
+BOOST_AUTO_TEST_CASE( loss_and_duplication )
+{
+	const int COUNT = 20000;
+	ImpairmentFixture fixture( "loss=0.1,duplicate=0.05,seed=3" );
+	fixture.send( 0, COUNT, 1000 );
+	fixture.release( 1000 );
+
+	SocketStatistics statistics = fixture.statistics();
+	BOOST_CHECK_CLOSE( double( statistics.datagramsDropped ), COUNT * 0.1, 10 );
+	BOOST_CHECK_CLOSE( double( statistics.datagramsDuplicated ), COUNT * 0.9 * 0.05, 15 );
+	BOOST_CHECK_EQUAL( statistics.datagramsDelayed, 0u );
+	BOOST_CHECK_EQUAL( fixture.received.size(), COUNT - statistics.datagramsDropped + statistics.datagramsDuplicated );
+
+	// without latency, the datagrams come out right away and in order
+	BOOST_CHECK( std::is_sorted( fixture.received.begin(), fixture.received.end() ) );
+	BOOST_CHECK( std::adjacent_find( fixture.received.begin(), fixture.received.end() ) != fixture.received.end() );
+}
+
+BOOST_AUTO_TEST_CASE( reorder )
+{
+	const int COUNT = 1000;
+	ImpairmentFixture fixture( "latency=10,reorder=0.05" );
+	for ( int i = 0; i < COUNT; ++i )
+		fixture.send( i, 1, 1000 + i );
+	fixture.releaseAll( 1000 );
+	BOOST_REQUIRE_EQUAL( fixture.received.size(), unsigned( COUNT ) );
+
+	// reordered datagrams are overtaken by later ones, the others stay in order
+	unsigned long reordered = fixture.statistics().datagramsReordered;
+	BOOST_CHECK_CLOSE( double( reordered ), COUNT * 0.05, 30 );
+	unsigned long overtaken = 0;
+	int previous = -1;
+	for ( int sequence : fixture.received )
+	{
+		if ( sequence < previous )
+			++overtaken;
+		previous = std::max( previous, sequence );
+	}
+	BOOST_CHECK_EQUAL( overtaken, reordered );
+	for ( int i = 0; i < COUNT; ++i )
+		BOOST_CHECK_LE( fixture.times[ i ], 1000u + COUNT + 10 + NetworkImpairment::REORDER_DELAY );
+	unsigned int next;
+	BOOST_CHECK( !fixture.impairment.GetNextReleaseTime( &next ) );
+}
+
+BOOST_AUTO_TEST_CASE( reproducible )
+{
+	const char* spec = "loss=0.2,latency=30,jitter=20,duplicate=0.1,reorder=0.1,seed=42";
+	ImpairmentFixture first( spec );
+	ImpairmentFixture second( spec );
+	for ( ImpairmentFixture* fixture : { &first, &second } )
+	{
+		for ( int i = 0; i < 500; ++i )
+			fixture->send( i * 10, 10, 1000 + i, 1000 + i % 3 );
+		fixture->releaseAll( 1000 );
+	}
+	BOOST_CHECK( first.received == second.received );
+	BOOST_CHECK( first.times == second.times );
+
+	// a different seed makes other decisions
+	ImpairmentFixture other( "loss=0.2,latency=30,jitter=20,duplicate=0.1,reorder=0.1,seed=43" );
+	for ( int i = 0; i < 500; ++i )
+		other.send( i * 10, 10, 1000 + i, 1000 + i % 3 );
+	other.releaseAll( 1000 );
+	BOOST_CHECK( first.received != other.received );
+}
+
+BOOST_FIXTURE_TEST_CASE( socket_round_trip, SocketFixture )
+{
+	// the batches pass the datagrams through their impairments
+	NetworkImpairmentSettings settings;
+	BOOST_REQUIRE( settings.Parse( "latency=30" ) );
+	NetworkImpairment outgoing, incoming;
+	outgoing.SetSettings( settings );
+	incoming.SetSettings( settings );
+
+	ReceiveBufferPool pool;
+	DatagramBatch sendBatch, receiveBatch( &pool );
+	sendBatch.SetImpairment( &outgoing );
+	receiveBatch.SetImpairment( &incoming );
+
+	auto start = std::chrono::steady_clock::now();
+	BOOST_CHECK_EQUAL( SocketLayer::Instance()->SendTo( sender, sendBatch, "delayed", 7, address, receiverPort ), 0 );
+	BOOST_CHECK_EQUAL( SocketLayer::Instance()->SendBatch( sender, sendBatch ), 0 );
+
+	int errorCode = 0;
+	std::string received;
+	while ( received.empty() && std::chrono::steady_clock::now() < start + std::chrono::seconds( 5 ) )
+	{
+		SocketLayer::Instance()->SendBatch( sender, sendBatch );
+		if ( SocketLayer::Instance()->RecvFromBatch( receiver, receiveBatch, &errorCode ) > 0 )
+			received.assign( receiveBatch.GetData( 0 ), receiveBatch.GetLength( 0 ) );
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	}
+	BOOST_CHECK_EQUAL( received, "delayed" );
+	// delayed on the way out and on the way in
+	BOOST_CHECK_GE( std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - start ).count(), 59 );
+	BOOST_CHECK_EQUAL( receiveBatch.GetPort( 0 ), senderPort );
+
+	// turned off, datagrams pass right through
+	outgoing.SetSettings( NetworkImpairmentSettings() );
+	incoming.SetSettings( NetworkImpairmentSettings() );
+	BOOST_CHECK( !outgoing.IsActive() && !incoming.IsActive() );
+	BOOST_CHECK_EQUAL( SocketLayer::Instance()->SendTo( sender, sendBatch, "direct", 6, address, receiverPort ), 0 );
+	BOOST_CHECK_EQUAL( SocketLayer::Instance()->SendBatch( sender, sendBatch ), 1 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,50 @@
+#define BOOST_TEST_MODULE ThreadPool
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <vector>
+
+#include "ThreadPool.h"
+
+BOOST_AUTO_TEST_SUITE( thread_pool )
+
+BOOST_AUTO_TEST_CASE( default_size )
+{
+	ThreadPool pool;
+	BOOST_CHECK_GE( pool.size(), 1u );
+}
+
+BOOST_AUTO_TEST_CASE( runs_all_tasks )
+{
+	ThreadPool pool(4);
+	std::atomic<int> counter{0};
+	for(int i = 0; i < 1000; ++i)
+		pool.post( [&counter](){ ++counter; } );
+
+	pool.wait();
+	BOOST_CHECK_EQUAL( counter, 1000 );
+}
+
+BOOST_AUTO_TEST_CASE( tasks_may_post_tasks )
+{
+	ThreadPool pool(2);
+	std::atomic<int> counter{0};
+	for(int i = 0; i < 10; ++i)
+		pool.post( [&](){ ++counter; pool.post( [&counter](){ ++counter; } ); } );
+
+	pool.wait();
+	BOOST_CHECK_EQUAL( counter, 20 );
+}
+
+BOOST_AUTO_TEST_CASE( destructor_finishes_queue )
+{
+	std::atomic<int> counter{0};
+	{
+		ThreadPool pool(1);
+		for(int i = 0; i < 100; ++i)
+			pool.post( [&counter](){ ++counter; } );
+	}
+	BOOST_CHECK_EQUAL( counter, 100 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
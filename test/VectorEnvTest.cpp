@@ -0,0 +1,172 @@
+#define BOOST_TEST_MODULE VectorEnv
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <vector>
+
+#include "SearchInputSource.h"
+#include "env/VectorEnv.h"
+
+#include "AllocationCounter.h"
+#include "FileSystemFixture.h"
+
+const char TEST_NAME[] = "VectorEnvTest";
+
+std::vector<int> randomActions(std::mt19937& gen, unsigned int count)
+{
+	std::uniform_int_distribution<int> action(0, VectorEnv::ACTION_COUNT - 1);
+	std::vector<int> actions(count);
+	for(auto& a : actions)
+		a = action(gen);
+	return actions;
+}
+
+BOOST_FIXTURE_TEST_SUITE( vector_env, FileSystemFixture<TEST_NAME> )
+
+BOOST_AUTO_TEST_CASE( reset )
+{
+	VectorEnv env( VectorEnv::Settings{} );
+	env.reset(3);
+	BOOST_CHECK_EQUAL( env.size(), 3u );
+	BOOST_CHECK_EQUAL( env.getAgentsPerMatch(), 2u );
+	BOOST_CHECK_EQUAL( env.getAgentCount(), 6u );
+
+	// at the start, both players see the blobs in the same place. The ball is on the left side.
+	const float* obs = env.getObservations();
+	const float* right = obs + VectorEnv::OBSERVATION_SIZE;
+	for(int i = 0; i < VectorEnv::BALL_POSITION_X; ++i)
+		BOOST_CHECK_EQUAL( obs[i], right[i] );
+	BOOST_CHECK_EQUAL( obs[VectorEnv::BALL_POSITION_X], 0.25f );
+	BOOST_CHECK_EQUAL( right[VectorEnv::BALL_POSITION_X], 0.75f );
+	BOOST_CHECK_EQUAL( obs[VectorEnv::BALL_VALID], 1.f );
+	BOOST_CHECK_EQUAL( obs[VectorEnv::GAME_RUNNING], 0.f );
+	BOOST_CHECK_EQUAL( env.getRewards()[0], 0.f );
+	BOOST_CHECK_EQUAL( env.getDone()[0], 0.f );
+}
+
+// the actions of the right player are mirrored, too
+BOOST_AUTO_TEST_CASE( mirrored_actions )
+{
+	VectorEnv env( VectorEnv::Settings{} );
+	env.reset(1);
+
+	// both players walk towards the net
+	const int towards_net[] = {2, 2};
+	for(int i = 0; i < 10; ++i)
+		env.step(towards_net);
+
+	const float* obs = env.getObservations();
+	BOOST_CHECK_GT( obs[VectorEnv::OWN_VELOCITY_X], 0.f );
+	for(int i = 0; i < VectorEnv::BALL_POSITION_X; ++i)
+		BOOST_CHECK_EQUAL( obs[i], obs[VectorEnv::OBSERVATION_SIZE + i] );
+}
+
+BOOST_AUTO_TEST_CASE( auto_reset )
+{
+	VectorEnv::Settings settings;
+	settings.maxSteps = 10;
+	VectorEnv env(settings);
+	env.reset(2);
+	std::vector<float> initial(env.getObservations(), env.getObservations() + env.getAgentCount() * VectorEnv::OBSERVATION_SIZE);
+
+	const int actions[] = {4, 1, 2, 5};
+	for(int i = 1; i <= 10; ++i)
+	{
+		env.step(actions);
+		for(unsigned int agent = 0; agent < env.getAgentCount(); ++agent)
+			BOOST_CHECK_EQUAL( env.getDone()[agent], i == 10 ? 1.f : 0.f );
+	}
+
+	// after the last step, the observations are those of the new matches
+	std::vector<float> after(env.getObservations(), env.getObservations() + initial.size());
+	BOOST_CHECK( after == initial );
+}
+
+BOOST_AUTO_TEST_CASE( rewards )
+{
+	VectorEnv::Settings settings;
+	settings.scoreToWin = 2;
+	settings.maxSteps = 0;
+	settings.opponent = []()
+	{
+		SearchInputSource::Settings search;
+		search.budget = std::chrono::microseconds(0);
+		return std::make_shared<SearchInputSource>(RIGHT_PLAYER, search);
+	};
+	VectorEnv env(settings);
+	env.reset(1);
+	BOOST_CHECK_EQUAL( env.getAgentCount(), 1u );
+
+	// the agent always jumps, so it serves, but the search bot wins
+	const int jump = 1;
+	int won = 0;
+	int lost = 0;
+	for(int step = 0; step < 20000 && env.getDone()[0] == 0.f; ++step)
+	{
+		env.step(&jump);
+		float reward = env.getRewards()[0];
+		BOOST_REQUIRE( reward == 0.f || reward == 1.f || reward == -1.f );
+		won += reward > 0;
+		lost += reward < 0;
+	}
+
+	BOOST_CHECK_EQUAL( env.getDone()[0], 1.f );
+	BOOST_CHECK_EQUAL( lost, 2 );
+	BOOST_CHECK_EQUAL( won, 0 );
+}
+
+// the number of threads does not change the results
+BOOST_AUTO_TEST_CASE( threads )
+{
+	VectorEnv::Settings settings;
+	settings.maxSteps = 300;
+	VectorEnv single(settings);
+	settings.threads = 3;
+	VectorEnv multi(settings);
+	single.reset(7);
+	multi.reset(7);
+
+	std::mt19937 gen(5);
+	for(int step = 0; step < 1000; ++step)
+	{
+		auto actions = randomActions(gen, single.getAgentCount());
+		single.step(actions.data());
+		multi.step(actions.data());
+
+		for(unsigned int i = 0; i < single.getAgentCount() * VectorEnv::OBSERVATION_SIZE; ++i)
+			BOOST_REQUIRE_EQUAL( single.getObservations()[i], multi.getObservations()[i] );
+		for(unsigned int i = 0; i < single.getAgentCount(); ++i)
+		{
+			BOOST_REQUIRE_EQUAL( single.getRewards()[i], multi.getRewards()[i] );
+			BOOST_REQUIRE_EQUAL( single.getDone()[i], multi.getDone()[i] );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( no_allocations )
+{
+	for(unsigned int threads = 1; threads <= 2; ++threads)
+	{
+		VectorEnv::Settings settings;
+		settings.maxSteps = 100;
+		settings.threads = threads;
+		VectorEnv env(settings);
+		env.reset(4);
+
+		std::mt19937 gen(7);
+		std::vector<std::vector<int>> actions;
+		for(int i = 0; i < 500; ++i)
+			actions.push_back( randomActions(gen, env.getAgentCount()) );
+
+		// the first steps may still allocate, e.g. for lazily created buffers
+		for(int i = 0; i < 100; ++i)
+			env.step(actions[i].data());
+
+		unsigned long before = g_allocations;
+		for(int i = 100; i < 500; ++i)
+			env.step(actions[i].data());
+		BOOST_CHECK_EQUAL( g_allocations - before, 0u );
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()